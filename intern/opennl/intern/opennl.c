@@ -146,6 +146,10 @@ static void __nl_should_not_have_reached(char* file, int line) {
 #define __NL_CLEAR(T, x)           memset(x, 0, sizeof(T)) 
 #define __NL_CLEAR_ARRAY(T,x,NB)   if(NB) memset(x, 0, (NB)*sizeof(T)) 
 
+/* systems smaller than this are solved on a single thread, right hand
+ * sides are independent so larger ones are handled one per thread */
+#define __NL_PARALLEL_MIN_SIZE     1000
+
 /************************************************************************************/
 /* Dynamic arrays for sparse row/columns */
 
@@ -912,7 +916,7 @@ static void __nlEndMatrixRHS(NLuint rhs) {
 
 static void __nlEndMatrix() {
 	__NLContext *context = __nlCurrentContext;
-	NLuint i;
+	NLint i;
 
 	__nlTransition(__NL_STATE_MATRIX, __NL_STATE_MATRIX_CONSTRUCTED);	
 	
@@ -927,7 +931,8 @@ static void __nlEndMatrix() {
 		}
 	}
 
-	for(i=0; i<context->nb_rhs; i++)
+#pragma omp parallel for if (context->m > __NL_PARALLEL_MIN_SIZE) schedule(static)
+	for(i=0; i<(NLint)context->nb_rhs; i++)
 		__nlEndMatrixRHS(i);
 }
 
@@ -1138,16 +1143,31 @@ static NLboolean __nlInvert_SUPERLU(__NLContext *context) {
 	/* OpenNL Context */
 	NLdouble* b = (context->least_squares)? context->Mtb: context->b;
 	NLdouble* x = context->x;
-	NLuint n = context->n, j;
+	NLuint n = context->n;
+	NLint nb_rhs = (NLint)context->nb_rhs, j;
+	NLboolean result = NL_TRUE;
 
-	/* SuperLU variables */
-	SuperMatrix B;
-	NLint info = 0;
+	/* The right hand sides only share the read-only L and U factors,
+	 * so each one is substituted on its own thread. */
+#pragma omp parallel for if (n > __NL_PARALLEL_MIN_SIZE) schedule(static)
+	for(j=0; j<nb_rhs; j++) {
+		/* SuperLU variables, statistics are kept per thread since
+		 * sgstrs writes the operation count */
+		SuperMatrix B;
+		SuperLUStat_t stat;
+		flops_t ops[NPHASES] = {0};
+		double utime[NPHASES] = {0};
+		NLint info = 0;
+
+		stat.panel_histo = NULL;
+		stat.utime = utime;
+		stat.ops = ops;
+		stat.TinyPivots = 0;
+		stat.RefineSteps = 0;
 
-	for(j=0; j<context->nb_rhs; j++, b+=n, x+=n) {
 		/* Create superlu array for B */
 		sCreate_Dense_Matrix(
-			&B, n, 1, b, n, 
+			&B, n, 1, b + n*j, n, 
 			SLU_DN, /* Fortran-type column-wise storage */
 			SLU_S,  /* doubles						  */
 			SLU_GE  /* general						  */
@@ -1156,15 +1176,17 @@ static NLboolean __nlInvert_SUPERLU(__NLContext *context) {
 		/* Forward/Back substitution to compute x */
 		sgstrs(TRANS, &(context->slu.L), &(context->slu.U),
 			context->slu.perm_c, context->slu.perm_r, &B,
-			&(context->slu.stat), &info);
+			&stat, &info);
 
 		if(info == 0)
-			memcpy(x, ((DNformat*)B.Store)->nzval, sizeof(*x)*n);
+			memcpy(x + n*j, ((DNformat*)B.Store)->nzval, sizeof(*x)*n);
+		else
+			result = NL_FALSE;
 
 		Destroy_SuperMatrix_Store(&B);
 	}
 
-	return (info == 0);
+	return result;
 }
 
 static void __nlFree_SUPERLU(__NLContext *context) {
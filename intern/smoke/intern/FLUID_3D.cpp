@@ -51,6 +51,7 @@ FLUID_3D::FLUID_3D(int *res, float dx, float dtdef, int init_heat, int init_fire
 	_dt = dtdef;	// just in case. set in step from a RNA factor
 
 	_iterations = 100;
+	_pressureSolver = NULL;
 	_tempAmb = 0; 
 	_heatDiffusion = 1e-3;
 	_totalTime = 0.0f;
@@ -94,6 +95,9 @@ FLUID_3D::FLUID_3D(int *res, float dx, float dtdef, int init_heat, int init_fire
 	_densityOld   = new float[_totalCells];
 	_obstacles    = new unsigned char[_totalCells]; // set 0 at end of step
 
+	Vec3Int bres = blockRes(Vec3Int(_xRes, _yRes, _zRes));
+	_activeBlocks = new unsigned char[bres[0] * bres[1] * bres[2]];
+
 	// For threaded version:
 	_xVelocityTemp = new float[_totalCells];
 	_yVelocityTemp = new float[_totalCells];
@@ -277,6 +281,7 @@ FLUID_3D::~FLUID_3D()
 	if (_heat) delete[] _heat;
 	if (_heatOld) delete[] _heatOld;
 	if (_obstacles) delete[] _obstacles;
+	if (_activeBlocks) delete[] _activeBlocks;
 
 	if (_xVelocityTemp) delete[] _xVelocityTemp;
 	if (_yVelocityTemp) delete[] _yVelocityTemp;
@@ -307,7 +312,8 @@ FLUID_3D::~FLUID_3D()
 
 // init direct access functions from blender
 void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *borderCollision, float *burning_rate,
-							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp)
+							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp,
+							  int *pressure_solver)
 {
 	_alpha = alpha;
 	_beta = beta;
@@ -320,6 +326,7 @@ void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float
 	_flame_vorticity = flame_vorticity;
 	_ignition_temp = flame_ignition_temp;
 	_max_temp = flame_max_temp;
+	_pressureSolver = pressure_solver;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -400,30 +407,19 @@ void FLUID_3D::step(float dt, float gravity[3])
 	SWAP_POINTERS(_zVelocity, _zVelocityTemp);
 #if PARALLEL==1
 	}	// end of single
-
-	#pragma omp barrier
-
-	#pragma omp for
-	for (int i=0; i<2; i++)
-	{
-		if (i==0)
-		{
-#endif
-			project();
-#if PARALLEL==1
-		}
-		else if (i==1)
-		{
+	}	// end of parallel, the solvers split their own loops over the threads
 #endif
-			if (_heat) {
-				diffuseHeat();
-			}
-#if PARALLEL==1
-		}
+
+	project();
+	if (_heat) {
+		diffuseHeat();
 	}
 
-	#pragma omp barrier
+	updateAdvectionBlocks();
 
+#if PARALLEL==1
+	#pragma omp parallel
+	{
 	#pragma omp single
 	{
 #endif
@@ -994,7 +990,10 @@ void FLUID_3D::project()
 	copyBorderAll(_pressure, 0, _zRes);
 
 	// solve Poisson equation
-	solvePressurePre(_pressure, _divergence, _obstacles);
+	if (_pressureSolver && *_pressureSolver == 1)
+		solvePressureMG(_pressure, _divergence, _obstacles);
+	else
+		solvePressurePre(_pressure, _divergence, _obstacles);
 
 	setObstaclePressure(_pressure, 0, _zRes);
 
@@ -1496,6 +1495,33 @@ void FLUID_3D::advectMacCormackBegin(int zBegin, int zEnd)
 	setZeroZ(_zVelocityOld, res, zBegin, zEnd);
 }
 
+//////////////////////////////////////////////////////////////////////
+// Find the blocks the scalar fields can be advected to this step,
+// called before the fields are swapped to their "Old" arrays
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::updateAdvectionBlocks()
+{
+	float *fields[7];
+	int numFields = 0;
+
+	fields[numFields++] = _density;
+	if (_heat) {
+		fields[numFields++] = _heat;
+	}
+	if (_fuel) {
+		fields[numFields++] = _fuel;
+		fields[numFields++] = _react;
+	}
+	if (_color_r) {
+		fields[numFields++] = _color_r;
+		fields[numFields++] = _color_g;
+		fields[numFields++] = _color_b;
+	}
+
+	updateActiveBlocks(_activeBlocks, Vec3Int(_xRes, _yRes, _zRes), fields, numFields,
+	                   _dt / _dx, _xVelocity, _yVelocity, _zVelocity);
+}
+
 //////////////////////////////////////////////////////////////////////
 // Advect using the MacCormack method from the Selle paper
 //////////////////////////////////////////////////////////////////////
@@ -1505,29 +1531,29 @@ void FLUID_3D::advectMacCormackEnd1(int zBegin, int zEnd)
 
 	const float dt0 = _dt / _dx;
 
-	int begin=zBegin * _slabSize;
-	int end=begin + (zEnd - zBegin) * _slabSize;
-	for (int x = begin; x < end; x++)
-		_xForce[x] = 0.0;
-
-	// advectFieldMacCormack1(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res)
+	// advect all fields along the velocity in a single pass, scalar
+	// fields skip the blocks without smoke, see updateAdvectionBlocks()
+	float *oldFields[7], *tempFields[7];
+	int numFields = 0;
 
-	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _densityTemp, res, zBegin, zEnd);
+	oldFields[numFields] = _densityOld; tempFields[numFields++] = _densityTemp;
 	if (_heat) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heatTemp, res, zBegin, zEnd);
+		oldFields[numFields] = _heatOld; tempFields[numFields++] = _heatTemp;
 	}
 	if (_fuel) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuelTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _reactTemp, res, zBegin, zEnd);
+		oldFields[numFields] = _fuelOld; tempFields[numFields++] = _fuelTemp;
+		oldFields[numFields] = _reactOld; tempFields[numFields++] = _reactTemp;
 	}
 	if (_color_r) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_rTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_gTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_bTemp, res, zBegin, zEnd);
+		oldFields[numFields] = _color_rOld; tempFields[numFields++] = _color_rTemp;
+		oldFields[numFields] = _color_gOld; tempFields[numFields++] = _color_gTemp;
+		oldFields[numFields] = _color_bOld; tempFields[numFields++] = _color_bTemp;
 	}
-	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _xVelocityOld, _xVelocity, res, zBegin, zEnd);
-	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _yVelocityOld, _yVelocity, res, zBegin, zEnd);
-	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _zVelocityOld, _zVelocity, res, zBegin, zEnd);
+	advectFieldsMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, oldFields, tempFields, numFields, res, zBegin, zEnd, _activeBlocks);
+
+	float *oldVelocity[3] = {_xVelocityOld, _yVelocityOld, _zVelocityOld};
+	float *tempVelocity[3] = {_xVelocity, _yVelocity, _zVelocity};
+	advectFieldsMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, oldVelocity, tempVelocity, 3, res, zBegin, zEnd);
 
 	// Have to wait untill all the threads are done -> so continuing in step 3
 }
@@ -1540,28 +1566,31 @@ void FLUID_3D::advectMacCormackEnd2(int zBegin, int zEnd)
 	const float dt0 = _dt / _dx;
 	Vec3Int res = Vec3Int(_xRes,_yRes,_zRes);
 
-	// use force array as temp array
-	float* t1 = _xForce;
-
-	// advectFieldMacCormack2(dt, xVelocity, yVelocity, zVelocity, oldField, newField, tempfield, temp, res, obstacles)
-
 	/* finish advection */
-	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _density, _densityTemp, t1, res, _obstacles, zBegin, zEnd);
+	float *oldFields[7], *newFields[7], *tempFields[7];
+	int numFields = 0;
+
+	oldFields[numFields] = _densityOld; newFields[numFields] = _density; tempFields[numFields++] = _densityTemp;
 	if (_heat) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heat, _heatTemp, t1, res, _obstacles, zBegin, zEnd);
+		oldFields[numFields] = _heatOld; newFields[numFields] = _heat; tempFields[numFields++] = _heatTemp;
 	}
 	if (_fuel) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuel, _fuelTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _react, _reactTemp, t1, res, _obstacles, zBegin, zEnd);
+		oldFields[numFields] = _fuelOld; newFields[numFields] = _fuel; tempFields[numFields++] = _fuelTemp;
+		oldFields[numFields] = _reactOld; newFields[numFields] = _react; tempFields[numFields++] = _reactTemp;
 	}
 	if (_color_r) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_r, _color_rTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_g, _color_gTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_b, _color_bTemp, t1, res, _obstacles, zBegin, zEnd);
+		oldFields[numFields] = _color_rOld; newFields[numFields] = _color_r; tempFields[numFields++] = _color_rTemp;
+		oldFields[numFields] = _color_gOld; newFields[numFields] = _color_g; tempFields[numFields++] = _color_gTemp;
+		oldFields[numFields] = _color_bOld; newFields[numFields] = _color_b; tempFields[numFields++] = _color_bTemp;
 	}
-	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _xVelocityOld, _xVelocityTemp, _xVelocity, t1, res, _obstacles, zBegin, zEnd);
-	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _yVelocityOld, _yVelocityTemp, _yVelocity, t1, res, _obstacles, zBegin, zEnd);
-	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _zVelocityOld, _zVelocityTemp, _zVelocity, t1, res, _obstacles, zBegin, zEnd);
+	advectFieldsMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, oldFields, newFields, tempFields, numFields,
+	                        res, _obstacles, zBegin, zEnd, _activeBlocks);
+
+	float *oldVelocity[3] = {_xVelocityOld, _yVelocityOld, _zVelocityOld};
+	float *newVelocity[3] = {_xVelocityTemp, _yVelocityTemp, _zVelocityTemp};
+	float *tempVelocity[3] = {_xVelocity, _yVelocity, _zVelocity};
+	advectFieldsMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, oldVelocity, newVelocity, tempVelocity, 3,
+	                        res, _obstacles, zBegin, zEnd);
 
 	/* set boundary conditions for velocity */
 	if(!_domainBcLeft) copyBorderX(_xVelocityTemp, res, zBegin, zEnd);
@@ -43,6 +43,12 @@ using namespace std;
 using namespace BasicVector;
 struct WTURBULENCE;
 
+// Scalar fields are advected per block of SMOKE_BLOCK_SIZE^3 cells, blocks
+// without smoke within reach of the advection are skipped and stay empty.
+#define SMOKE_BLOCK_SIZE 8
+#define SMOKE_BLOCK_SHIFT 3
+#define SMOKE_BLOCK_EPSILON 1e-6f
+
 struct FLUID_3D  
 {
 	public:
@@ -55,7 +61,8 @@ struct FLUID_3D
 		void initColors(float init_r, float init_g, float init_b);
 
 		void initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *border_colli, float *burning_rate,
-							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp);
+							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp,
+							int *pressure_solver);
 		
 		// create & allocate vector noise advection 
 		void initVectorNoise(int amplify);
@@ -112,6 +119,7 @@ struct FLUID_3D
 		float* _zForce;
 		unsigned char*  _obstacles; /* only used (useful) for static obstacles like domain boundaries */
 		unsigned char*  _obstaclesAnim;
+		unsigned char*  _activeBlocks; /* scalar field blocks touched by the advection, see SMOKE_BLOCK_SIZE */
 
 		// Required for proper threading:
 		float* _xVelocityTemp;
@@ -143,6 +151,7 @@ struct FLUID_3D
 
 		// CG fields
 		int _iterations;
+		int *_pressureSolver; // RNA pointer, 0: diagonal preconditioner, 1: multigrid preconditioner
 
 		// simulation constants
 		float _dt;
@@ -187,6 +196,7 @@ struct FLUID_3D
 		void diffuseColor();
 		void solvePressure(float* field, float* b, unsigned char* skip);
 		void solvePressurePre(float* field, float* b, unsigned char* skip);
+		void solvePressureMG(float* field, float* b, unsigned char* skip);
 		void solveHeat(float* field, float* b, unsigned char* skip);
 		void solveDiffusion(float* field, float* b, float* factor);
 
@@ -199,6 +209,7 @@ struct FLUID_3D
 		// advection, accessed e.g. by WTURBULENCE class
 		//void advectMacCormack();
 		void advectMacCormackBegin(int zBegin, int zEnd);
+		void updateAdvectionBlocks();
 		void advectMacCormackEnd1(int zBegin, int zEnd);
 		void advectMacCormackEnd2(int zBegin, int zEnd);
 
@@ -231,13 +242,30 @@ struct FLUID_3D
 
 		
 
-		// static advection functions, also used by WTURBULENCE
+		// static advection functions, also used by WTURBULENCE,
+		// cells of inactive blocks are set to zero when 'blocks' is given
 		static void advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
-				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd);
+				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks = NULL);
 		static void advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd);
+				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks = NULL);
 		static void advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* newField, float* tempResult, float* temp1,Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd);
+				float* oldField, float* newField, float* tempResult, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *blocks = NULL);
+
+		// same as above for several fields advected along the same velocity
+		// in one pass, each backtrace is computed once for all of them
+		static void advectFieldsSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
+				float** oldFields, float** newFields, int numFields, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks = NULL);
+		static void advectFieldsMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float** oldFields, float** tempResults, int numFields, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks = NULL);
+		static void advectFieldsMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float** oldFields, float** newFields, float** tempResults, int numFields, Vec3Int res, const unsigned char* obstacles,
+				int zBegin, int zEnd, const unsigned char *blocks = NULL);
+
+		// active blocks for a MacCormack advection of the given scalar fields
+		static Vec3Int blockRes(Vec3Int res);
+		static void updateActiveBlocks(unsigned char *blocks, Vec3Int res, float **fields, int numFields,
+				const float dt, const float* velx, const float* vely, const float* velz);
 
 
 		// temp ones for testing
@@ -247,10 +275,9 @@ struct FLUID_3D
 				float* oldField, float* newField, Vec3Int res);*/
 
 		// maccormack helper functions
-		static void clampExtrema(const float dt, const float* xVelocity, const float* yVelocity,  const float* zVelocity,
-				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd);
-		static void clampOutsideRays(const float dt, const float* xVelocity, const float* yVelocity,  const float* zVelocity,
-				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd);
+		static void clampFields(const float dt, const float* xVelocity, const float* yVelocity,  const float* zVelocity,
+				float** oldFields, float** newFields, int numFields, Vec3Int res, const unsigned char* obstacles, float** oldAdvections,
+				int zBegin, int zEnd, const unsigned char *blocks = NULL);
 
 
 
@@ -28,19 +28,40 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "FLUID_3D.h"
+#include <algorithm>
 #include <cstring>
 #define SOLVER_ACCURACY 1e-06
 
+#if PARALLEL==1
+#include <omp.h>
+#endif // PARALLEL 
+
+// The solvers run their loops in parallel over z-slices, reductions are
+// gathered per slice first so the result doesn't depend on the thread count.
+static float sliceSum(const float *slices, int zRes)
+{
+	float sum = 0.0f;
+	for (int z = 1; z < zRes - 1; z++)
+		sum += slices[z];
+	return sum;
+}
+
+static float sliceMax(const float *slices, int zRes)
+{
+	float max = 0.0f;
+	for (int z = 1; z < zRes - 1; z++)
+		max = (slices[z] > max) ? slices[z] : max;
+	return max;
+}
+
 //////////////////////////////////////////////////////////////////////
 // solve the heat equation with CG
 //////////////////////////////////////////////////////////////////////
 void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 {
-	int x, y, z;
-	const int twoxr = 2 * _xRes;
-	size_t index;
 	const float heatConst = _dt * _heatDiffusion / (_dx * _dx);
 	float *_q, *_residual, *_direction, *_Acenter;
+	float *_sliceSum, *_sliceMax;
 
 	// i = 0
 	int i = 0;
@@ -49,6 +70,8 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 	_direction    = new float[_totalCells]; // set 0
 	_q            = new float[_totalCells]; // set 0
 	_Acenter       = new float[_totalCells]; // set 0
+	_sliceSum     = new float[_zRes];
+	_sliceMax     = new float[_zRes];
 
   	memset(_residual, 0, sizeof(float)*_totalCells);
 	memset(_q, 0, sizeof(float)*_totalCells);
@@ -58,10 +81,15 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 	float deltaNew = 0.0f;
 
   // r = b - Ax
-  index = _slabSize + _xRes + 1;
-  for (z = 1; z < _zRes - 1; z++, index += twoxr)
-    for (y = 1; y < _yRes - 1; y++, index += 2)
-      for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+  #pragma omp parallel for schedule(static)
+#endif
+  for (int z = 1; z < _zRes - 1; z++)
+  {
+    size_t index = (size_t)z * _slabSize + _xRes + 1;
+    float sum = 0.0f;
+    for (int y = 1; y < _yRes - 1; y++, index += 2)
+      for (int x = 1; x < _xRes - 1; x++, index++)
       {
         // if the cell is a variable
         _Acenter[index] = 1.0f;
@@ -89,8 +117,11 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 		}
 
 		_direction[index] = _residual[index];
-		deltaNew += _residual[index] * _residual[index];
+		sum += _residual[index] * _residual[index];
       }
+    _sliceSum[z] = sum;
+  }
+  deltaNew = sliceSum(_sliceSum, _zRes);
 
 
   // While deltaNew > (eps^2) * delta0
@@ -101,10 +132,15 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
     // q = Ad
 	float alpha = 0.0f;
 
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += twoxr)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      float sum = 0.0f;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
         {
           // if the cell is a variable
           if (!skip[index])
@@ -122,37 +158,52 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 		  {
           _q[index] = 0.0f;
 		  }
-		  alpha += _direction[index] * _q[index];
+		  sum += _direction[index] * _q[index];
         }
+      _sliceSum[z] = sum;
+    }
+    alpha = sliceSum(_sliceSum, _zRes);
 
     if (fabs(alpha) > 0.0f)
       alpha = deltaNew / alpha;
 	
 	float deltaOld = deltaNew;
-	deltaNew = 0.0f;
-
-	maxR = 0.0f;
 
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += twoxr)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      float sum = 0.0f, max = 0.0f;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
 		{
           field[index] += alpha * _direction[index];
 
 		  _residual[index] -= alpha * _q[index];
-          maxR = (_residual[index] > maxR) ? _residual[index] : maxR;
+          max = (_residual[index] > max) ? _residual[index] : max;
 
-		  deltaNew += _residual[index] * _residual[index];
+		  sum += _residual[index] * _residual[index];
 		}
+      _sliceSum[z] = sum;
+      _sliceMax[z] = max;
+    }
+    deltaNew = sliceSum(_sliceSum, _zRes);
+    maxR = sliceMax(_sliceMax, _zRes);
 
     float beta = deltaNew / deltaOld;
 
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += twoxr)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
          _direction[index] = _residual[index] + beta * _direction[index];
+    }
 
 	
     i++;
@@ -163,13 +214,14 @@ void FLUID_3D::solveHeat(float* field, float* b, unsigned char* skip)
 	if (_direction) delete[] _direction;
 	if (_q)       delete[] _q;
 	if (_Acenter)  delete[] _Acenter;
+	delete[] _sliceSum;
+	delete[] _sliceMax;
 }
 
 void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 {
-	int x, y, z;
-	size_t index;
 	float *_q, *_Precond, *_h, *_residual, *_direction;
+	float *_sliceSum, *_sliceMax;
 
 	// i = 0
 	int i = 0;
@@ -179,6 +231,8 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 	_q            = new float[_totalCells]; // set 0
 	_h			  = new float[_totalCells]; // set 0
 	_Precond	  = new float[_totalCells]; // set 0
+	_sliceSum     = new float[_zRes];
+	_sliceMax     = new float[_zRes];
 
 	memset(_residual, 0, sizeof(float)*_xRes*_yRes*_zRes);
 	memset(_q, 0, sizeof(float)*_xRes*_yRes*_zRes);
@@ -189,10 +243,15 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 	float deltaNew = 0.0f;
 
 	// r = b - Ax
-	index = _slabSize + _xRes + 1;
-	for (z = 1; z < _zRes - 1; z++, index += 2 * _xRes)
-		for (y = 1; y < _yRes - 1; y++, index += 2)
-		  for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < _zRes - 1; z++)
+	{
+		size_t index = (size_t)z * _slabSize + _xRes + 1;
+		float sum = 0.0f;
+		for (int y = 1; y < _yRes - 1; y++, index += 2)
+		  for (int x = 1; x < _xRes - 1; x++, index++)
 		  {
 			// if the cell is a variable
 			float Acenter = 0.0f;
@@ -228,8 +287,11 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 			// p = P^-1 * r
 			_direction[index] = _residual[index] * _Precond[index];
 
-			deltaNew += _residual[index] * _direction[index];
+			sum += _residual[index] * _direction[index];
 		  }
+		_sliceSum[z] = sum;
+	}
+	deltaNew = sliceSum(_sliceSum, _zRes);
 
 
   // While deltaNew > (eps^2) * delta0
@@ -242,10 +304,15 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 
 	float alpha = 0.0f;
 
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += 2 * _xRes)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      float sum = 0.0f;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
         {
           // if the cell is a variable
           float Acenter = 0.0f;
@@ -272,25 +339,28 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
           _q[index] = 0.0f;
 		  }
 
-		  alpha += _direction[index] * _q[index];
+		  sum += _direction[index] * _q[index];
         }
+      _sliceSum[z] = sum;
+    }
+    alpha = sliceSum(_sliceSum, _zRes);
 
 
     if (fabs(alpha) > 0.0f)
       alpha = deltaNew / alpha;
 
 	float deltaOld = deltaNew;
-	deltaNew = 0.0f;
-
-	maxR = 0.0;
-
-	float tmp;
 
     // x = x + alpha * d
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += 2 * _xRes)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      float sum = 0.0f, max = 0.0f, tmp;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
 		{
           field[index] += alpha * _direction[index];
 
@@ -299,21 +369,31 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 		  _h[index] = _Precond[index] * _residual[index];
 
 		  tmp = _residual[index] * _h[index];
-		  deltaNew += tmp;
-		  maxR = (tmp > maxR) ? tmp : maxR;
+		  sum += tmp;
+		  max = (tmp > max) ? tmp : max;
 
 		}
+      _sliceSum[z] = sum;
+      _sliceMax[z] = max;
+    }
+    deltaNew = sliceSum(_sliceSum, _zRes);
+    maxR = sliceMax(_sliceMax, _zRes);
 
 
     // beta = deltaNew / deltaOld
     float beta = deltaNew / deltaOld;
 
     // d = h + beta * d
-    index = _slabSize + _xRes + 1;
-    for (z = 1; z < _zRes - 1; z++, index += 2 * _xRes)
-      for (y = 1; y < _yRes - 1; y++, index += 2)
-        for (x = 1; x < _xRes - 1; x++, index++)
+#if PARALLEL==1
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zRes - 1; z++)
+    {
+      size_t index = (size_t)z * _slabSize + _xRes + 1;
+      for (int y = 1; y < _yRes - 1; y++, index += 2)
+        for (int x = 1; x < _xRes - 1; x++, index++)
           _direction[index] = _h[index] + beta * _direction[index];
+    }
 
     // i = i + 1
     i++;
@@ -325,4 +405,480 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 	if (_residual) delete[] _residual;
 	if (_direction) delete[] _direction;
 	if (_q)       delete[] _q;
+	delete[] _sliceSum;
+	delete[] _sliceMax;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Multigrid preconditioned CG for the pressure
+//
+// Same system as solvePressurePre(), but each CG step applies a V-cycle
+// instead of the diagonal preconditioner, which keeps the iteration count
+// almost independent of the grid resolution. Levels are built by merging
+// 2x2x2 cells, every level keeps a one cell border like the fine grid so
+// the stencil loops don't need any bounds checks. Values of cells that are
+// not variables are kept at zero, which lets the stencil skip the obstacle
+// tests and vectorise.
+//////////////////////////////////////////////////////////////////////
+
+// cell types of a multigrid level
+#define MG_CELL_SKIP	0	// obstacle, not coupled to anything
+#define MG_CELL_FLUID	1	// variable
+#define MG_CELL_FIXED	2	// open domain border, held at zero
+
+#define MG_SMOOTH_STEPS 2
+#define MG_SMOOTH_WEIGHT (6.0f / 7.0f)
+#define MG_COARSEST_STEPS 32
+#define MG_COARSEST_RES 4	// stop coarsening when no axis has more variables
+#define MG_COARSE_SCALE 3.0f	// stencil weight of a coarse level relative to the finer one
+
+struct MG_LEVEL {
+	int xRes, yRes, zRes, slabSize;
+	size_t totalCells;
+	float offDiag;	// weight of a neighbour in the stencil
+	unsigned char *type;
+	float *diag, *invDiag;	// zero for cells that are not variables
+	float *x, *b, *t;	// solution, right hand side and temporary
+};
+
+// out = A * in, 'in' has to be zero on cells that are not variables
+static void mgApply(const MG_LEVEL &l, const float *in, float *out)
+{
+	const int xRes = l.xRes, slabSize = l.slabSize;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < l.zRes - 1; z++) {
+		for (int y = 1; y < l.yRes - 1; y++) {
+			const size_t row = (size_t)z * slabSize + (size_t)y * xRes;
+			const float *diag = l.diag + row;
+			const float *c = in + row;
+			float *o = out + row;
+
+			for (int x = 1; x < xRes - 1; x++) {
+				const float v = diag[x] * c[x] - l.offDiag * (c[x - 1] + c[x + 1] +
+				                                               c[x - xRes] + c[x + xRes] +
+				                                               c[x - slabSize] + c[x + slabSize]);
+				o[x] = (diag[x] > 0.0f) ? v : 0.0f;
+			}
+		}
+	}
+}
+
+// out = b - A * x
+static void mgResidual(const MG_LEVEL &l, const float *x, float *out)
+{
+	const int xRes = l.xRes, slabSize = l.slabSize;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < l.zRes - 1; z++) {
+		for (int y = 1; y < l.yRes - 1; y++) {
+			const size_t row = (size_t)z * slabSize + (size_t)y * xRes;
+			const float *diag = l.diag + row, *b = l.b + row;
+			const float *c = x + row;
+			float *o = out + row;
+
+			for (int x = 1; x < xRes - 1; x++) {
+				const float v = b[x] - diag[x] * c[x] + l.offDiag * (c[x - 1] + c[x + 1] +
+				                                                     c[x - xRes] + c[x + xRes] +
+				                                                     c[x - slabSize] + c[x + slabSize]);
+				o[x] = (diag[x] > 0.0f) ? v : 0.0f;
+			}
+		}
+	}
+}
+
+// damped Jacobi, starting from x = 0 when 'zero' is set
+static void mgSmooth(MG_LEVEL &l, int steps, bool zero)
+{
+	const int xRes = l.xRes, slabSize = l.slabSize;
+
+	if (zero) {
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 0; z < l.zRes; z++) {
+			const size_t slab = (size_t)z * slabSize;
+			for (int i = 0; i < slabSize; i++)
+				l.x[slab + i] = MG_SMOOTH_WEIGHT * l.invDiag[slab + i] * l.b[slab + i];
+		}
+		steps--;
+	}
+
+	for (int s = 0; s < steps; s++) {
+		// t = x + w * D^-1 * (b - Ax), t is all zero on the border
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < l.zRes - 1; z++) {
+			for (int y = 1; y < l.yRes - 1; y++) {
+				const size_t row = (size_t)z * slabSize + (size_t)y * xRes;
+				const float *diag = l.diag + row, *invDiag = l.invDiag + row, *b = l.b + row;
+				const float *c = l.x + row;
+				float *o = l.t + row;
+
+				for (int x = 1; x < xRes - 1; x++) {
+					const float r = b[x] - diag[x] * c[x] + l.offDiag * (c[x - 1] + c[x + 1] +
+					                                                     c[x - xRes] + c[x + xRes] +
+					                                                     c[x - slabSize] + c[x + slabSize]);
+					o[x] = c[x] + MG_SMOOTH_WEIGHT * invDiag[x] * r;
+				}
+			}
+		}
+		std::swap(l.x, l.t);
+	}
+}
+
+// fine variables of a coarse cell along one axis, 'n' is the number of fine variables
+static inline int mgChildren(int c, int n, int *child)
+{
+	child[0] = 2 * c - 1;
+	child[1] = 2 * c;
+	return (child[1] <= n) ? 2 : 1;
+}
+
+// coarse.b = sum of fine residuals, fine.t has to hold the residual
+static void mgRestrict(const MG_LEVEL &fine, const MG_LEVEL &coarse)
+{
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < coarse.zRes - 1; z++) {
+		int cz[2], cy[2], cx[2];
+		const int nz = mgChildren(z, fine.zRes - 2, cz);
+
+		for (int y = 1; y < coarse.yRes - 1; y++) {
+			const int ny = mgChildren(y, fine.yRes - 2, cy);
+			size_t index = (size_t)z * coarse.slabSize + (size_t)y * coarse.xRes + 1;
+
+			for (int x = 1; x < coarse.xRes - 1; x++, index++) {
+				const int nx = mgChildren(x, fine.xRes - 2, cx);
+				float sum = 0.0f;
+
+				for (int k = 0; k < nz; k++)
+					for (int j = 0; j < ny; j++) {
+						const float *t = fine.t + (size_t)cz[k] * fine.slabSize + (size_t)cy[j] * fine.xRes;
+						for (int i = 0; i < nx; i++)
+							sum += t[cx[i]];
+					}
+
+				coarse.b[index] = (coarse.diag[index] > 0.0f) ? sum : 0.0f;
+			}
+		}
+	}
+}
+
+// fine.x += coarse.x, constant over the merged cells
+static void mgProlong(const MG_LEVEL &coarse, const MG_LEVEL &fine)
+{
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < fine.zRes - 1; z++) {
+		for (int y = 1; y < fine.yRes - 1; y++) {
+			const float *c = coarse.x + (size_t)((z + 1) >> 1) * coarse.slabSize + (size_t)((y + 1) >> 1) * coarse.xRes;
+			const size_t row = (size_t)z * fine.slabSize + (size_t)y * fine.xRes;
+
+			for (int x = 1; x < fine.xRes - 1; x++) {
+				if (fine.diag[row + x] > 0.0f)
+					fine.x[row + x] += c[(x + 1) >> 1];
+			}
+		}
+	}
+}
+
+static void mgVCycle(MG_LEVEL *levels, int numLevels, int l)
+{
+	MG_LEVEL &level = levels[l];
+
+	if (l == numLevels - 1) {
+		mgSmooth(level, MG_COARSEST_STEPS, true);
+		return;
+	}
+
+	mgSmooth(level, MG_SMOOTH_STEPS, true);
+	mgResidual(level, level.x, level.t);
+
+	mgRestrict(level, levels[l + 1]);
+	mgVCycle(levels, numLevels, l + 1);
+	mgProlong(levels[l + 1], level);
+
+	mgSmooth(level, MG_SMOOTH_STEPS, false);
+}
+
+// diagonal of the stencil from the cell types, the outer layer is never a variable
+static void mgInitDiagonal(MG_LEVEL &l)
+{
+	memset(l.diag, 0, sizeof(float) * l.totalCells);
+	memset(l.invDiag, 0, sizeof(float) * l.totalCells);
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < l.zRes - 1; z++) {
+		size_t index = (size_t)z * l.slabSize + l.xRes + 1;
+		for (int y = 1; y < l.yRes - 1; y++, index += 2)
+			for (int x = 1; x < l.xRes - 1; x++, index++) {
+				if (l.type[index] != MG_CELL_FLUID)
+					continue;
+
+				const int count = (l.type[index - 1] != MG_CELL_SKIP) + (l.type[index + 1] != MG_CELL_SKIP) +
+				                  (l.type[index - l.xRes] != MG_CELL_SKIP) + (l.type[index + l.xRes] != MG_CELL_SKIP) +
+				                  (l.type[index - l.slabSize] != MG_CELL_SKIP) + (l.type[index + l.slabSize] != MG_CELL_SKIP);
+				if (count) {
+					l.diag[index] = l.offDiag * (float)count;
+					l.invDiag[index] = 1.0f / l.diag[index];
+				}
+			}
+	}
+}
+
+static void mgAllocLevel(MG_LEVEL &l, int xRes, int yRes, int zRes, bool alloc_xb)
+{
+	l.xRes = xRes;
+	l.yRes = yRes;
+	l.zRes = zRes;
+	l.slabSize = xRes * yRes;
+	l.totalCells = (size_t)l.slabSize * zRes;
+
+	l.type = new unsigned char[l.totalCells];
+	l.diag = new float[l.totalCells];
+	l.invDiag = new float[l.totalCells];
+	l.t = new float[l.totalCells];
+	memset(l.t, 0, sizeof(float) * l.totalCells);
+
+	if (alloc_xb) {
+		l.x = new float[l.totalCells];
+		l.b = new float[l.totalCells];
+		memset(l.x, 0, sizeof(float) * l.totalCells);
+		memset(l.b, 0, sizeof(float) * l.totalCells);
+	}
+	else {
+		l.x = l.b = NULL;
+	}
+}
+
+// merge 2x2x2 variables of the finer level, border cells only take the border
+static void mgCoarsenTypes(const MG_LEVEL &fine, MG_LEVEL &coarse)
+{
+	const int n[3] = {fine.xRes - 2, fine.yRes - 2, fine.zRes - 2};
+	const int m[3] = {coarse.xRes - 2, coarse.yRes - 2, coarse.zRes - 2};
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 0; z < coarse.zRes; z++) {
+		int child[3][2], num[3];
+		size_t index = (size_t)z * coarse.slabSize;
+
+		for (int y = 0; y < coarse.yRes; y++) {
+			for (int x = 0; x < coarse.xRes; x++, index++) {
+				const int c[3] = {x, y, z};
+				unsigned char type = MG_CELL_SKIP;
+
+				for (int a = 0; a < 3; a++) {
+					if (c[a] == 0) {
+						child[a][0] = 0;
+						num[a] = 1;
+					}
+					else if (c[a] == m[a] + 1) {
+						child[a][0] = n[a] + 1;
+						num[a] = 1;
+					}
+					else {
+						num[a] = mgChildren(c[a], n[a], child[a]);
+					}
+				}
+
+				for (int k = 0; k < num[2]; k++)
+					for (int j = 0; j < num[1]; j++)
+						for (int i = 0; i < num[0]; i++) {
+							const unsigned char t = fine.type[(size_t)child[2][k] * fine.slabSize +
+							                                  (size_t)child[1][j] * fine.xRes + child[0][i]];
+							if (t == MG_CELL_FLUID || (t == MG_CELL_FIXED && type == MG_CELL_SKIP))
+								type = t;
+						}
+
+				coarse.type[index] = type;
+			}
+		}
+	}
+}
+
+void FLUID_3D::solvePressureMG(float* field, float* b, unsigned char* skip)
+{
+	MG_LEVEL levels[16];
+	int numLevels = 1;
+	float *_residual, *_direction, *_q;
+	float *_sliceSum, *_sliceMax;
+
+	// finest level, x and b are the preconditioned and plain CG residuals
+	MG_LEVEL &fine = levels[0];
+	mgAllocLevel(fine, _xRes, _yRes, _zRes, true);
+	fine.offDiag = 1.0f;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 0; z < _zRes; z++) {
+		size_t index = (size_t)z * _slabSize;
+		for (int y = 0; y < _yRes; y++)
+			for (int x = 0; x < _xRes; x++, index++) {
+				const bool border = (x == 0 || y == 0 || z == 0 || x == _xRes - 1 || y == _yRes - 1 || z == _zRes - 1);
+				fine.type[index] = skip[index] ? MG_CELL_SKIP : (border ? MG_CELL_FIXED : MG_CELL_FLUID);
+			}
+	}
+	mgInitDiagonal(fine);
+
+	while (numLevels < 16) {
+		const MG_LEVEL &l = levels[numLevels - 1];
+		const int n[3] = {l.xRes - 2, l.yRes - 2, l.zRes - 2};
+
+		if (n[0] <= MG_COARSEST_RES && n[1] <= MG_COARSEST_RES && n[2] <= MG_COARSEST_RES)
+			break;
+
+		MG_LEVEL &coarse = levels[numLevels];
+		mgAllocLevel(coarse, (n[0] + 1) / 2 + 2, (n[1] + 1) / 2 + 2, (n[2] + 1) / 2 + 2, true);
+		coarse.offDiag = l.offDiag * MG_COARSE_SCALE;
+		mgCoarsenTypes(l, coarse);
+		mgInitDiagonal(coarse);
+		numLevels++;
+	}
+
+	_residual = fine.b;
+	_direction = new float[_totalCells];
+	_q = new float[_totalCells];
+	_sliceSum = new float[_zRes];
+	_sliceMax = new float[_zRes];
+	memset(_direction, 0, sizeof(float) * _totalCells);
+	memset(_q, 0, sizeof(float) * _totalCells);
+
+	// r = b - Ax, the only place where 'field' may be non-zero on obstacles
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < _zRes - 1; z++) {
+		size_t index = (size_t)z * _slabSize + _xRes + 1;
+		for (int y = 1; y < _yRes - 1; y++, index += 2)
+			for (int x = 1; x < _xRes - 1; x++, index++) {
+				if (fine.diag[index] > 0.0f) {
+					_residual[index] = b[index] - (fine.diag[index] * field[index] -
+					        (skip[index - 1] ? 0.0f : field[index - 1]) -
+					        (skip[index + 1] ? 0.0f : field[index + 1]) -
+					        (skip[index - _xRes] ? 0.0f : field[index - _xRes]) -
+					        (skip[index + _xRes] ? 0.0f : field[index + _xRes]) -
+					        (skip[index - _slabSize] ? 0.0f : field[index - _slabSize]) -
+					        (skip[index + _slabSize] ? 0.0f : field[index + _slabSize]));
+				}
+			}
+	}
+
+	// z = M^-1 r, d = z
+	mgVCycle(levels, numLevels, 0);
+	memcpy(_direction, fine.x, sizeof(float) * _totalCells);
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < _zRes - 1; z++) {
+		const size_t slab = (size_t)z * _slabSize;
+		float sum = 0.0f;
+		for (int k = 0; k < _slabSize; k++)
+			sum += _residual[slab + k] * fine.x[slab + k];
+		_sliceSum[z] = sum;
+	}
+	float deltaNew = sliceSum(_sliceSum, _zRes);
+
+	// same stop criterion as solvePressurePre()
+	const float eps = SOLVER_ACCURACY;
+	float maxR = 2.0f * eps;
+	int i = 0;
+
+	while ((i < _iterations) && (maxR > 0.001f * eps)) {
+		// q = Ad
+		mgApply(fine, _direction, _q);
+
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			const size_t slab = (size_t)z * _slabSize;
+			float sum = 0.0f;
+			for (int k = 0; k < _slabSize; k++)
+				sum += _direction[slab + k] * _q[slab + k];
+			_sliceSum[z] = sum;
+		}
+		float alpha = sliceSum(_sliceSum, _zRes);
+
+		if (fabs(alpha) > 0.0f)
+			alpha = deltaNew / alpha;
+
+		// x = x + alpha * d, r = r - alpha * q
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			size_t index = (size_t)z * _slabSize + _xRes + 1;
+			float max = 0.0f;
+			for (int y = 1; y < _yRes - 1; y++, index += 2)
+				for (int x = 1; x < _xRes - 1; x++, index++) {
+					field[index] += alpha * _direction[index];
+					_residual[index] -= alpha * _q[index];
+
+					const float tmp = _residual[index] * _residual[index] * fine.invDiag[index];
+					max = (tmp > max) ? tmp : max;
+				}
+			_sliceMax[z] = max;
+		}
+		maxR = sliceMax(_sliceMax, _zRes);
+		i++;
+
+		if (!(maxR > 0.001f * eps))
+			break;
+
+		// z = M^-1 r
+		mgVCycle(levels, numLevels, 0);
+
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			const size_t slab = (size_t)z * _slabSize;
+			float sum = 0.0f;
+			for (int k = 0; k < _slabSize; k++)
+				sum += _residual[slab + k] * fine.x[slab + k];
+			_sliceSum[z] = sum;
+		}
+		const float deltaOld = deltaNew;
+		deltaNew = sliceSum(_sliceSum, _zRes);
+
+		// d = z + beta * d
+		const float beta = deltaNew / deltaOld;
+
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			const size_t slab = (size_t)z * _slabSize;
+			for (int k = 0; k < _slabSize; k++)
+				_direction[slab + k] = fine.x[slab + k] + beta * _direction[slab + k];
+		}
+	}
+	// cout << i << " iterations converged to " << sqrt(maxR) << endl;
+
+	for (int l = 0; l < numLevels; l++) {
+		delete[] levels[l].type;
+		delete[] levels[l].diag;
+		delete[] levels[l].invDiag;
+		delete[] levels[l].x;
+		delete[] levels[l].b;
+		delete[] levels[l].t;
+	}
+	delete[] _direction;
+	delete[] _q;
+	delete[] _sliceSum;
+	delete[] _sliceMax;
 }
@@ -34,6 +34,17 @@
 #include "WTURBULENCE.h"
 #include "INTERPOLATE.h"
 
+// block activity of a row of cells, NULL when advecting the whole grid
+static inline const unsigned char *blockRow(const unsigned char *blocks, Vec3Int res, int y, int z)
+{
+	if (!blocks)
+		return NULL;
+
+	const int xBlocks = (res[0] + SMOKE_BLOCK_SIZE - 1) >> SMOKE_BLOCK_SHIFT;
+	const int yBlocks = (res[1] + SMOKE_BLOCK_SIZE - 1) >> SMOKE_BLOCK_SHIFT;
+	return blocks + (y >> SMOKE_BLOCK_SHIFT) * xBlocks + (z >> SMOKE_BLOCK_SHIFT) * xBlocks * yBlocks;
+}
+
 //////////////////////////////////////////////////////////////////////
 // add a test cube of density to the center
 //////////////////////////////////////////////////////////////////////
@@ -293,229 +304,214 @@ void FLUID_3D::copyBorderZ(float* field, Vec3Int res, int zBegin, int zEnd)
 	}
 }
 
-/////////////////////////////////////////////////////////////////////
-// advect field with the semi lagrangian method
 //////////////////////////////////////////////////////////////////////
-void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
-		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd)
+// trilinear interpolation of a traced position, computed once per
+// cell and shared by all fields advected along the same velocity
+//////////////////////////////////////////////////////////////////////
+struct TRACE_SAMPLE {
+	int i000;
+	float s0, s1, t0, t1, u0, u1;
+};
+
+static inline void traceSample(float xTrace, float yTrace, float zTrace, Vec3Int res, TRACE_SAMPLE &sample)
+{
+	// clamp backtrace to grid boundaries
+	if (xTrace < 0.5f) xTrace = 0.5f;
+	if (xTrace > res[0] - 1.5f) xTrace = res[0] - 1.5f;
+	if (yTrace < 0.5f) yTrace = 0.5f;
+	if (yTrace > res[1] - 1.5f) yTrace = res[1] - 1.5f;
+	if (zTrace < 0.5f) zTrace = 0.5f;
+	if (zTrace > res[2] - 1.5f) zTrace = res[2] - 1.5f;
+
+	// locate neighbors to interpolate
+	const int x0 = (int)xTrace;
+	const int y0 = (int)yTrace;
+	const int z0 = (int)zTrace;
+
+	// get interpolation weights
+	sample.s1 = xTrace - x0;
+	sample.s0 = 1.0f - sample.s1;
+	sample.t1 = yTrace - y0;
+	sample.t0 = 1.0f - sample.t1;
+	sample.u1 = zTrace - z0;
+	sample.u0 = 1.0f - sample.u1;
+
+	sample.i000 = x0 + y0 * res[0] + z0 * res[0] * res[1];
+}
+
+static inline float traceInterpolate(const float *field, const TRACE_SAMPLE &sample, int xres, int slabSize)
+{
+	const float *f0 = field + sample.i000;
+	const float *f1 = f0 + slabSize;
+
+	return sample.u0 * (sample.s0 * (sample.t0 * f0[0] +
+				sample.t1 * f0[xres]) +
+			sample.s1 * (sample.t0 * f0[1] +
+				sample.t1 * f0[xres + 1])) +
+		sample.u1 * (sample.s0 * (sample.t0 * f1[0] +
+					sample.t1 * f1[xres]) +
+				sample.s1 * (sample.t0 * f1[1] +
+					sample.t1 * f1[xres + 1]));
+}
+
+//////////////////////////////////////////////////////////////////////
+// advect fields with the semi lagrangian method, the backtrace is
+// shared by all fields so the velocity is only read once
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::advectFieldsSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
+		float** oldFields, float** newFields, int numFields, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks)
 {
 	const int xres = res[0];
 	const int yres = res[1];
-	const int zres = res[2];
 	const int slabSize = res[0] * res[1];
 
-
 	for (int z = zBegin; z < zEnd; z++)
 		for (int y = 0; y < yres; y++)
+		{
+			const unsigned char *rowBlocks = blockRow(blocks, res, y, z);
+
 			for (int x = 0; x < xres; x++)
 			{
-				const int index = x + y * xres + z * xres*yres;
-				
-        // backtrace
-				float xTrace = x - dt * velx[index];
-				float yTrace = y - dt * vely[index];
-				float zTrace = z - dt * velz[index];
-
-				// clamp backtrace to grid boundaries
-				if (xTrace < 0.5f) xTrace = 0.5f;
-				if (xTrace > xres - 1.5f) xTrace = xres - 1.5f;
-				if (yTrace < 0.5f) yTrace = 0.5f;
-				if (yTrace > yres - 1.5f) yTrace = yres - 1.5f;
-				if (zTrace < 0.5f) zTrace = 0.5f;
-				if (zTrace > zres - 1.5f) zTrace = zres - 1.5f;
-
-				// locate neighbors to interpolate
-				const int x0 = (int)xTrace;
-				const int x1 = x0 + 1;
-				const int y0 = (int)yTrace;
-				const int y1 = y0 + 1;
-				const int z0 = (int)zTrace;
-				const int z1 = z0 + 1;
-
-				// get interpolation weights
-				const float s1 = xTrace - x0;
-				const float s0 = 1.0f - s1;
-				const float t1 = yTrace - y0;
-				const float t0 = 1.0f - t1;
-				const float u1 = zTrace - z0;
-				const float u0 = 1.0f - u1;
-
-				const int i000 = x0 + y0 * xres + z0 * slabSize;
-				const int i010 = x0 + y1 * xres + z0 * slabSize;
-				const int i100 = x1 + y0 * xres + z0 * slabSize;
-				const int i110 = x1 + y1 * xres + z0 * slabSize;
-				const int i001 = x0 + y0 * xres + z1 * slabSize;
-				const int i011 = x0 + y1 * xres + z1 * slabSize;
-				const int i101 = x1 + y0 * xres + z1 * slabSize;
-				const int i111 = x1 + y1 * xres + z1 * slabSize;
-
-				// interpolate
-				// (indices could be computed once)
-				newField[index] = u0 * (s0 * (t0 * oldField[i000] +
-							t1 * oldField[i010]) +
-						s1 * (t0 * oldField[i100] +
-							t1 * oldField[i110])) +
-					u1 * (s0 * (t0 * oldField[i001] +
-								t1 * oldField[i011]) +
-							s1 * (t0 * oldField[i101] +
-								t1 * oldField[i111]));
+				const int index = x + y * xres + z * slabSize;
+
+				if (rowBlocks && !rowBlocks[x >> SMOKE_BLOCK_SHIFT]) {
+					for (int f = 0; f < numFields; f++)
+						newFields[f][index] = 0.0f;
+					continue;
+				}
+
+				// backtrace
+				TRACE_SAMPLE sample;
+				traceSample(x - dt * velx[index], y - dt * vely[index], z - dt * velz[index], res, sample);
+
+				for (int f = 0; f < numFields; f++)
+					newFields[f][index] = traceInterpolate(oldFields[f], sample, xres, slabSize);
 			}
+		}
+}
+
+void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
+		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks)
+{
+	advectFieldsSemiLagrange(dt, velx, vely, velz, &oldField, &newField, 1, res, zBegin, zEnd, blocks);
 }
 
 
 /////////////////////////////////////////////////////////////////////
-// advect field with the maccormack method
+// advect fields with the maccormack method
 //
 // comments are the pseudocode from selle's paper
 //////////////////////////////////////////////////////////////////////
-void FLUID_3D::advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd)
+void FLUID_3D::advectFieldsMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float** oldFields, float** tempResults, int numFields, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks)
 {
-	/*const int sx= res[0];
-	const int sy= res[1];
-	const int sz= res[2];
-
-	for (int x = 0; x < sx * sy * sz; x++)
-		phiHatN[x] = phiHatN1[x] = oldField[x];*/	// not needed as all the values are written first
-
-	float*& phiN    = oldField;
-	float*& phiN1   = tempResult;
-
-
-
 	// phiHatN1 = A(phiN)
-	advectFieldSemiLagrange(  dt, xVelocity, yVelocity, zVelocity, phiN, phiN1, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+	advectFieldsSemiLagrange(dt, xVelocity, yVelocity, zVelocity, oldFields, tempResults, numFields, res, zBegin, zEnd, blocks);		// uses wide data from old field and velocities (both are whole)
 }
 
-
-
-void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* newField, float* tempResult, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd)
+void FLUID_3D::advectFieldsMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float** oldFields, float** newFields, float** tempResults, int numFields, Vec3Int res, const unsigned char* obstacles,
+				int zBegin, int zEnd, const unsigned char *blocks)
 {
-	float* phiHatN  = tempResult;
-	float* t1  = temp1;
-	const int sx= res[0];
-	const int sy= res[1];
+	float** phiN     = oldFields;
+	float** phiN1    = newFields;
+	float** phiHatN  = tempResults;
+	const int sx = res[0];
+	const int sy = res[1];
+	const int slabSize = res[0] * res[1];
 
-	float*& phiN    = oldField;
-	float*& phiN1   = newField;
+	// phiHatN = A^R(phiHatN1)
+	// phiN1 = phiHatN1 + (phiN - phiHatN) / 2
+	// the reverse advection is interpolated directly into the correction,
+	// it uses wide data from phiHatN1 and velocities (both are whole)
+	for (int z = zBegin; z < zEnd; z++)
+		for (int y = 0; y < sy; y++)
+		{
+			const unsigned char *rowBlocks = blockRow(blocks, res, y, z);
 
+			for (int x = 0; x < sx; x++)
+			{
+				const int index = x + y * sx + z * slabSize;
 
+				if (rowBlocks && !rowBlocks[x >> SMOKE_BLOCK_SHIFT]) {
+					for (int f = 0; f < numFields; f++)
+						phiN1[f][index] = 0.0f;
+					continue;
+				}
 
-	// phiHatN = A^R(phiHatN1)
-	advectFieldSemiLagrange( -1.0f*dt, xVelocity, yVelocity, zVelocity, phiHatN, t1, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+				TRACE_SAMPLE sample;
+				traceSample(x + dt * xVelocity[index], y + dt * yVelocity[index], z + dt * zVelocity[index], res, sample);
 
-	// phiN1 = phiHatN1 + (phiN - phiHatN) / 2
-	const int border = 0; 
-	for (int z = zBegin+border; z < zEnd-border; z++)
-		for (int y = border; y < sy-border; y++)
-			for (int x = border; x < sx-border; x++) {
-				int index = x + y * sx + z * sx*sy;
-				phiN1[index] = phiHatN[index] + (phiN[index] - t1[index]) * 0.50f;
-				//phiN1[index] = phiHatN1[index]; // debug, correction off
+				for (int f = 0; f < numFields; f++)
+					phiN1[f][index] = phiHatN[f][index] + (phiN[f][index] - traceInterpolate(phiHatN[f], sample, sx, slabSize)) * 0.50f;
 			}
-	copyBorderX(phiN1, res, zBegin, zEnd);
-	copyBorderY(phiN1, res, zBegin, zEnd);
-	copyBorderZ(phiN1, res, zBegin, zEnd);
+		}
+
+	for (int f = 0; f < numFields; f++) {
+		copyBorderX(phiN1[f], res, zBegin, zEnd);
+		copyBorderY(phiN1[f], res, zBegin, zEnd);
+		copyBorderZ(phiN1[f], res, zBegin, zEnd);
+	}
 
-	// clamp any newly created extrema
-	clampExtrema(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+	// clamp any newly created extrema, and if the error estimate
+	// was bad, revert to first order
+	clampFields(dt, xVelocity, yVelocity, zVelocity, oldFields, newFields, numFields, res, obstacles, phiHatN, zBegin, zEnd, blocks);	// phiHatN is only used at cells within thread range, so its ok
+}
 
-	// if the error estimate was bad, revert to first order
-	clampOutsideRays(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, obstacles, phiHatN, zBegin, zEnd);	// phiHatN is only used at cells within thread range, so its ok
+void FLUID_3D::advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *blocks)
+{
+	advectFieldsMacCormack1(dt, xVelocity, yVelocity, zVelocity, &oldField, &tempResult, 1, res, zBegin, zEnd, blocks);
+}
 
-} 
+void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float* oldField, float* newField, float* tempResult, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *blocks)
+{
+	advectFieldsMacCormack2(dt, xVelocity, yVelocity, zVelocity, &oldField, &newField, &tempResult, 1, res, obstacles, zBegin, zEnd, blocks);
+}
 
 
 //////////////////////////////////////////////////////////////////////
-// Clamp the extrema generated by the BFECC error correction
+// Clamp the extrema generated by the BFECC error correction, and
+// revert any backtraces that go into boundaries back to first 
+// order -- in this case the error correction term was totally
+// incorrect
 //////////////////////////////////////////////////////////////////////
-void FLUID_3D::clampExtrema(const float dt, const float* velx, const float* vely,  const float* velz,
-		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd)
+static inline bool traceHitsObstacle(float xTrace, float yTrace, float zTrace, Vec3Int res, const unsigned char* obstacles)
 {
-	const int xres= res[0];
-	const int yres= res[1];
-	const int zres= res[2];
+	const int sx = res[0];
 	const int slabSize = res[0] * res[1];
 
-	int bb=0;
-	int bt=0;
-
-	if (zBegin == 0) {bb = 1;}
-	if (zEnd == res[2]) {bt = 1;}
-
-
-	for (int z = zBegin+bb; z < zEnd-bt; z++)
-		for (int y = 1; y < yres-1; y++)
-			for (int x = 1; x < xres-1; x++)
-			{
-				const int index = x + y * xres+ z * xres*yres;
-				// backtrace
-				float xTrace = x - dt * velx[index];
-				float yTrace = y - dt * vely[index];
-				float zTrace = z - dt * velz[index];
-
-				// clamp backtrace to grid boundaries
-				if (xTrace < 0.5f) xTrace = 0.5f;
-				if (xTrace > xres - 1.5f) xTrace = xres - 1.5f;
-				if (yTrace < 0.5f) yTrace = 0.5f;
-				if (yTrace > yres - 1.5f) yTrace = yres - 1.5f;
-				if (zTrace < 0.5f) zTrace = 0.5f;
-				if (zTrace > zres - 1.5f) zTrace = zres - 1.5f;
-
-				// locate neighbors to interpolate
-				const int x0 = (int)xTrace;
-				const int x1 = x0 + 1;
-				const int y0 = (int)yTrace;
-				const int y1 = y0 + 1;
-				const int z0 = (int)zTrace;
-				const int z1 = z0 + 1;
-
-				const int i000 = x0 + y0 * xres + z0 * slabSize;
-				const int i010 = x0 + y1 * xres + z0 * slabSize;
-				const int i100 = x1 + y0 * xres + z0 * slabSize;
-				const int i110 = x1 + y1 * xres + z0 * slabSize;
-				const int i001 = x0 + y0 * xres + z1 * slabSize;
-				const int i011 = x0 + y1 * xres + z1 * slabSize;
-				const int i101 = x1 + y0 * xres + z1 * slabSize;
-				const int i111 = x1 + y1 * xres + z1 * slabSize;
-
-				float minField = oldField[i000];
-				float maxField = oldField[i000];
-
-				minField = (oldField[i010] < minField) ? oldField[i010] : minField;
-				maxField = (oldField[i010] > maxField) ? oldField[i010] : maxField;
-
-				minField = (oldField[i100] < minField) ? oldField[i100] : minField;
-				maxField = (oldField[i100] > maxField) ? oldField[i100] : maxField;
-
-				minField = (oldField[i110] < minField) ? oldField[i110] : minField;
-				maxField = (oldField[i110] > maxField) ? oldField[i110] : maxField;
-
-				minField = (oldField[i001] < minField) ? oldField[i001] : minField;
-				maxField = (oldField[i001] > maxField) ? oldField[i001] : maxField;
-
-				minField = (oldField[i011] < minField) ? oldField[i011] : minField;
-				maxField = (oldField[i011] > maxField) ? oldField[i011] : maxField;
-
-				minField = (oldField[i101] < minField) ? oldField[i101] : minField;
-				maxField = (oldField[i101] > maxField) ? oldField[i101] : maxField;
-
-				minField = (oldField[i111] < minField) ? oldField[i111] : minField;
-				maxField = (oldField[i111] > maxField) ? oldField[i111] : maxField;
-
-				newField[index] = (newField[index] > maxField) ? maxField : newField[index];
-				newField[index] = (newField[index] < minField) ? minField : newField[index];
-			}
+	// clamp to prevent an out of bounds access when looking into
+	// the _obstacles array
+	zTrace = (zTrace < 0.5f) ? 0.5f : zTrace;
+	zTrace = (zTrace > res[2] - 1.5f) ? res[2] - 1.5f : zTrace;
+	yTrace = (yTrace < 0.5f) ? 0.5f : yTrace;
+	yTrace = (yTrace > res[1] - 1.5f) ? res[1] - 1.5f : yTrace;
+	xTrace = (xTrace < 0.5f) ? 0.5f : xTrace;
+	xTrace = (xTrace > sx - 1.5f) ? sx - 1.5f : xTrace;
+
+	const int x0 = (int)xTrace;
+	const int x1 = x0 + 1;
+	const int y0 = (int)yTrace;
+	const int y1 = y0 + 1;
+	const int z0 = (int)zTrace;
+	const int z1 = z0 + 1;
+
+	return obstacles[x0 + y0 * sx + z0*slabSize] ||
+		obstacles[x0 + y1 * sx + z0*slabSize] ||
+		obstacles[x1 + y0 * sx + z0*slabSize] ||
+		obstacles[x1 + y1 * sx + z0*slabSize] ||
+		obstacles[x0 + y0 * sx + z1*slabSize] ||
+		obstacles[x0 + y1 * sx + z1*slabSize] ||
+		obstacles[x1 + y0 * sx + z1*slabSize] ||
+		obstacles[x1 + y1 * sx + z1*slabSize];
 }
 
-//////////////////////////////////////////////////////////////////////
-// Reverts any backtraces that go into boundaries back to first 
-// order -- in this case the error correction term was totally
-// incorrect
-//////////////////////////////////////////////////////////////////////
-void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float* vely,  const float* velz,
-				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd)
+void FLUID_3D::clampFields(const float dt, const float* velx, const float* vely,  const float* velz,
+				float** oldFields, float** newFields, int numFields, Vec3Int res, const unsigned char* obstacles, float** oldAdvections,
+				int zBegin, int zEnd, const unsigned char *blocks)
 {
 	const int sx= res[0];
 	const int sy= res[1];
@@ -530,18 +526,27 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 
 	for (int z = zBegin+bb; z < zEnd-bt; z++)
 		for (int y = 1; y < sy-1; y++)
+		{
+			const unsigned char *rowBlocks = blockRow(blocks, res, y, z);
+
 			for (int x = 1; x < sx-1; x++)
 			{
 				const int index = x + y * sx+ z * slabSize;
+
+				// all neighbors are empty in inactive blocks
+				if (rowBlocks && !rowBlocks[x >> SMOKE_BLOCK_SHIFT])
+					continue;
+
 				// backtrace
-				float xBackward = x + dt * velx[index];
-				float yBackward = y + dt * vely[index];
-				float zBackward = z + dt * velz[index];
-				float xTrace    = x - dt * velx[index];
-				float yTrace    = y - dt * vely[index];
-				float zTrace    = z - dt * velz[index];
-
-				// see if it goes outside the boundaries
+				const float xBackward = x + dt * velx[index];
+				const float yBackward = y + dt * vely[index];
+				const float zBackward = z + dt * velz[index];
+				const float xTrace    = x - dt * velx[index];
+				const float yTrace    = y - dt * vely[index];
+				const float zTrace    = z - dt * velz[index];
+
+				// see if either the forward or backward ray goes outside the
+				// boundaries or into an obstacle
 				bool hasObstacle = 
 					(zTrace < 1.0f)    || (zTrace > sz - 2.0f) ||
 					(yTrace < 1.0f)    || (yTrace > sy - 2.0f) ||
@@ -549,98 +554,158 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 					(zBackward < 1.0f) || (zBackward > sz - 2.0f) ||
 					(yBackward < 1.0f) || (yBackward > sy - 2.0f) ||
 					(xBackward < 1.0f) || (xBackward > sx - 2.0f);
-				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
-
-				// clamp to prevent an out of bounds access when looking into
-				// the _obstacles array
-				zTrace = (zTrace < 0.5f) ? 0.5f : zTrace;
-				zTrace = (zTrace > sz - 1.5f) ? sz - 1.5f : zTrace;
-				yTrace = (yTrace < 0.5f) ? 0.5f : yTrace;
-				yTrace = (yTrace > sy - 1.5f) ? sy - 1.5f : yTrace;
-				xTrace = (xTrace < 0.5f) ? 0.5f : xTrace;
-				xTrace = (xTrace > sx - 1.5f) ? sx - 1.5f : xTrace;
-
-				// locate neighbors to interpolate,
-				// do backward first since we will use the forward indices if a
-				// reversion is actually necessary
-				zBackward = (zBackward < 0.5f) ? 0.5f : zBackward;
-				zBackward = (zBackward > sz - 1.5f) ? sz - 1.5f : zBackward;
-				yBackward = (yBackward < 0.5f) ? 0.5f : yBackward;
-				yBackward = (yBackward > sy - 1.5f) ? sy - 1.5f : yBackward;
-				xBackward = (xBackward < 0.5f) ? 0.5f : xBackward;
-				xBackward = (xBackward > sx - 1.5f) ? sx - 1.5f : xBackward;
-
-				int x0 = (int)xBackward;
-				int x1 = x0 + 1;
-				int y0 = (int)yBackward;
-				int y1 = y0 + 1;
-				int z0 = (int)zBackward;
-				int z1 = z0 + 1;
-				if(obstacles && !hasObstacle) {
-					hasObstacle = hasObstacle || 
-						obstacles[x0 + y0 * sx + z0*slabSize] ||
-						obstacles[x0 + y1 * sx + z0*slabSize] ||
-						obstacles[x1 + y0 * sx + z0*slabSize] ||
-						obstacles[x1 + y1 * sx + z0*slabSize] ||
-						obstacles[x0 + y0 * sx + z1*slabSize] ||
-						obstacles[x0 + y1 * sx + z1*slabSize] ||
-						obstacles[x1 + y0 * sx + z1*slabSize] ||
-						obstacles[x1 + y1 * sx + z1*slabSize] ;
+				if (obstacles && !hasObstacle) {
+					hasObstacle =
+						traceHitsObstacle(xBackward, yBackward, zBackward, res, obstacles) ||
+						traceHitsObstacle(xTrace, yTrace, zTrace, res, obstacles);
 				}
-				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
-
-				x0 = (int)xTrace;
-				x1 = x0 + 1;
-				y0 = (int)yTrace;
-				y1 = y0 + 1;
-				z0 = (int)zTrace;
-				z1 = z0 + 1;
-				if(obstacles && !hasObstacle) {
-					hasObstacle = hasObstacle || 
-						obstacles[x0 + y0 * sx + z0*slabSize] ||
-						obstacles[x0 + y1 * sx + z0*slabSize] ||
-						obstacles[x1 + y0 * sx + z0*slabSize] ||
-						obstacles[x1 + y1 * sx + z0*slabSize] ||
-						obstacles[x0 + y0 * sx + z1*slabSize] ||
-						obstacles[x0 + y1 * sx + z1*slabSize] ||
-						obstacles[x1 + y0 * sx + z1*slabSize] ||
-						obstacles[x1 + y1 * sx + z1*slabSize] ;
-				} // obstacle array
-				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
 
-				// see if either the forward or backward ray went into
-				// a boundary
+				// reuse old advection instead of doing another one...
 				if (hasObstacle) {
-					// get interpolation weights
-					float s1 = xTrace - x0;
-					float s0 = 1.0f - s1;
-					float t1 = yTrace - y0;
-					float t0 = 1.0f - t1;
-					float u1 = zTrace - z0;
-					float u0 = 1.0f - u1;
-
-					const int i000 = x0 + y0 * sx + z0 * slabSize;
-					const int i010 = x0 + y1 * sx + z0 * slabSize;
-					const int i100 = x1 + y0 * sx + z0 * slabSize;
-					const int i110 = x1 + y1 * sx + z0 * slabSize;
-					const int i001 = x0 + y0 * sx + z1 * slabSize;
-					const int i011 = x0 + y1 * sx + z1 * slabSize;
-					const int i101 = x1 + y0 * sx + z1 * slabSize;
-					const int i111 = x1 + y1 * sx + z1 * slabSize;
-
-					// interpolate, (indices could be computed once)
-					newField[index] = u0 * (s0 * (
-								t0 * oldField[i000] +
-								t1 * oldField[i010]) +
-							s1 * (t0 * oldField[i100] +
-								t1 * oldField[i110])) +
-						u1 * (s0 * (t0 * oldField[i001] +
-									t1 * oldField[i011]) +
-								s1 * (t0 * oldField[i101] +
-									t1 * oldField[i111])); 
+					for (int f = 0; f < numFields; f++)
+						newFields[f][index] = oldAdvections[f][index];
+					continue;
+				}
+
+				// clamp to the neighbors the forward trace interpolated from
+				TRACE_SAMPLE sample;
+				traceSample(xTrace, yTrace, zTrace, res, sample);
+
+				for (int f = 0; f < numFields; f++)
+				{
+					const float *f0 = oldFields[f] + sample.i000;
+					const float *f1 = f0 + slabSize;
+					float minField = f0[0];
+					float maxField = f0[0];
+
+					minField = (f0[sx] < minField) ? f0[sx] : minField;
+					maxField = (f0[sx] > maxField) ? f0[sx] : maxField;
+
+					minField = (f0[1] < minField) ? f0[1] : minField;
+					maxField = (f0[1] > maxField) ? f0[1] : maxField;
+
+					minField = (f0[sx + 1] < minField) ? f0[sx + 1] : minField;
+					maxField = (f0[sx + 1] > maxField) ? f0[sx + 1] : maxField;
+
+					minField = (f1[0] < minField) ? f1[0] : minField;
+					maxField = (f1[0] > maxField) ? f1[0] : maxField;
+
+					minField = (f1[sx] < minField) ? f1[sx] : minField;
+					maxField = (f1[sx] > maxField) ? f1[sx] : maxField;
+
+					minField = (f1[1] < minField) ? f1[1] : minField;
+					maxField = (f1[1] > maxField) ? f1[1] : maxField;
+
+					minField = (f1[sx + 1] < minField) ? f1[sx + 1] : minField;
+					maxField = (f1[sx + 1] > maxField) ? f1[sx + 1] : maxField;
+
+					float *newField = newFields[f];
+					newField[index] = (newField[index] > maxField) ? maxField : newField[index];
+					newField[index] = (newField[index] < minField) ? minField : newField[index];
 				}
 			} // xyz
+		}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Number of blocks along each axis of a grid
+//////////////////////////////////////////////////////////////////////
+Vec3Int FLUID_3D::blockRes(Vec3Int res)
+{
+	return Vec3Int((res[0] + SMOKE_BLOCK_SIZE - 1) >> SMOKE_BLOCK_SHIFT,
+	               (res[1] + SMOKE_BLOCK_SIZE - 1) >> SMOKE_BLOCK_SHIFT,
+	               (res[2] + SMOKE_BLOCK_SIZE - 1) >> SMOKE_BLOCK_SHIFT);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Mark the blocks a MacCormack advection of 'fields' can write smoke to:
+// blocks holding any smoke, grown by the distance the forward and the
+// backward trace can reach with the fastest velocity in the grid
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::updateActiveBlocks(unsigned char *blocks, Vec3Int res, float **fields, int numFields,
+		const float dt, const float* velx, const float* vely, const float* velz)
+{
+	const Vec3Int bres = blockRes(res);
+	const int slabSize = res[0] * res[1];
+	const int blockSlab = bres[0] * bres[1];
+	const int totalBlocks = blockSlab * bres[2];
+	float *maxVel = new float[3 * bres[2]];
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int bz = 0; bz < bres[2]; bz++)
+	{
+		unsigned char *slab = blocks + bz * blockSlab;
+		const int zEnd = ((bz + 1) << SMOKE_BLOCK_SHIFT) < res[2] ? ((bz + 1) << SMOKE_BLOCK_SHIFT) : res[2];
+		float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+
+		memset(slab, 0, blockSlab);
+
+		for (int z = bz << SMOKE_BLOCK_SHIFT; z < zEnd; z++)
+			for (int y = 0; y < res[1]; y++)
+			{
+				unsigned char *row = slab + (y >> SMOKE_BLOCK_SHIFT) * bres[0];
+				const size_t index = (size_t)z * slabSize + (size_t)y * res[0];
+
+				for (int x = 0; x < res[0]; x++)
+				{
+					vx = (fabsf(velx[index + x]) > vx) ? fabsf(velx[index + x]) : vx;
+					vy = (fabsf(vely[index + x]) > vy) ? fabsf(vely[index + x]) : vy;
+					vz = (fabsf(velz[index + x]) > vz) ? fabsf(velz[index + x]) : vz;
+				}
+
+				for (int f = 0; f < numFields; f++)
+				{
+					const float *field = fields[f] + index;
+
+					for (int x = 0; x < res[0]; x++)
+						if (fabsf(field[x]) > SMOKE_BLOCK_EPSILON)
+							row[x >> SMOKE_BLOCK_SHIFT] = 1;
+				}
+			}
+
+		maxVel[3 * bz + 0] = vx;
+		maxVel[3 * bz + 1] = vy;
+		maxVel[3 * bz + 2] = vz;
+	}
+
+	// forward and backward trace, plus one cell for the interpolation
+	float reach[3] = {0.0f, 0.0f, 0.0f};
+	for (int bz = 0; bz < bres[2]; bz++)
+		for (int a = 0; a < 3; a++)
+			reach[a] = (maxVel[3 * bz + a] > reach[a]) ? maxVel[3 * bz + a] : reach[a];
+	delete[] maxVel;
+
+	// grow the marked blocks separately along each axis
+	unsigned char *temp = new unsigned char[totalBlocks];
+	const int stride[3] = {1, bres[0], blockSlab};
+
+	for (int a = 0; a < 3; a++)
+	{
+		const float cells = 2.0f * fabsf(dt) * reach[a] + 2.0f;
+		int margin = (cells < (float)res[a]) ? (int)ceilf(cells / SMOKE_BLOCK_SIZE) : bres[a];
+
+		if (margin >= bres[a])
+			margin = bres[a] - 1;
+		if (margin <= 0)
+			continue;
+
+		memcpy(temp, blocks, totalBlocks);
+
+		for (int i = 0; i < totalBlocks; i++)
+		{
+			const int pos = (i / stride[a]) % bres[a];
+			const int begin = (pos - margin < 0) ? -pos : -margin;
+			const int end = (pos + margin >= bres[a]) ? bres[a] - 1 - pos : margin;
+			unsigned char active = 0;
+
+			for (int o = begin; o <= end && !active; o++)
+				active = temp[i + o * stride[a]];
+
+			blocks[i] = active;
+		}
+	}
+
+	delete[] temp;
 }
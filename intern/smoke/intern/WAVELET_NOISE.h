@@ -102,7 +102,8 @@ static void downsampleZ(float *from, float *to, int n){
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
-// Wavelet downsampling -- Neumann boundary conditions
+// Wavelet downsampling -- Neumann boundary conditions,
+// the lines along the sampled axis are independent and split over the threads
 //////////////////////////////////////////////////////////////////////////////////////////
 static void downsampleNeumann(const float *from, float *to, int n, int stride)
 {
@@ -126,6 +127,9 @@ static void downsampleNeumann(const float *from, float *to, int n, int stride)
 	}
 }
 static void downsampleXNeumann(float* to, const float* from, int sx,int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int iy = 0; iy < sy; iy++) 
 		for (int iz = 0; iz < sz; iz++) {
 			const int i = iy * sx + iz*sx*sy;
@@ -133,6 +137,9 @@ static void downsampleXNeumann(float* to, const float* from, int sx,int sy, int
 		}
 }
 static void downsampleYNeumann(float* to, const float* from, int sx,int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int ix = 0; ix < sx; ix++) 
 		for (int iz = 0; iz < sz; iz++) {
 			const int i = ix + iz*sx*sy;
@@ -140,6 +147,9 @@ static void downsampleYNeumann(float* to, const float* from, int sx,int sy, int
     }
 }
 static void downsampleZNeumann(float* to, const float* from, int sx,int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int ix = 0; ix < sx; ix++) 
 		for (int iy = 0; iy < sy; iy++) {
 			const int i = ix + iy*sx;
@@ -198,6 +208,9 @@ static void upsampleNeumann(const float *from, float *to, int n, int stride) {
 	}
 }
 static void upsampleXNeumann(float* to, const float* from, int sx, int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int iy = 0; iy < sy; iy++) 
 		for (int iz = 0; iz < sz; iz++) {
 			const int i = iy * sx + iz*sx*sy;
@@ -205,6 +218,9 @@ static void upsampleXNeumann(float* to, const float* from, int sx, int sy, int s
 		}
 }
 static void upsampleYNeumann(float* to, const float* from, int sx, int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int ix = 0; ix < sx; ix++) 
 		for (int iz = 0; iz < sz; iz++) {
 			const int i = ix + iz*sx*sy;
@@ -212,6 +228,9 @@ static void upsampleYNeumann(float* to, const float* from, int sx, int sy, int s
 		}
 }
 static void upsampleZNeumann(float* to, const float* from, int sx, int sy, int sz) {
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
 	for (int ix = 0; ix < sx; ix++) 
 		for (int iy = 0; iy < sy; iy++) {
 			const int i = ix + iy*sx;
@@ -515,5 +534,56 @@ static inline float WNoiseDz(Vec3 p, float* data) {
   return result;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+// x, y and z derivatives of noise at once, same results as WNoiseDx/Dy/Dz
+// but the 27 tile lookups and the weights are shared between them
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline void WNoiseGradient(Vec3 p, float* data, float result[3]) { 
+  int mid[3], n = noiseTileSize;
+  float w[3][3], dw[3][3], t;
+
+  for (int i = 0; i < 3; i++)
+  {
+    mid[i] = (int)ceil(p[i] - 0.5f);
+    t = mid[i] - (p[i] - 0.5f);
+    // quadratic B-spline weights and their derivative
+    w[i][0] = t * t / 2; 
+    w[i][2] = (1 - t) * (1 - t) / 2;
+    w[i][1] = 1 - w[i][0] - w[i][2];
+    dw[i][0] = -t;
+    dw[i][2] = (1.f - t);
+    dw[i][1] = 2.0f * t - 1.0f;
+  }
+
+  // products of the x and y weights, multiplied in the same order as
+  // WNoiseDx/Dy/Dz so the results are bit identical
+  float wxy[3][9];
+  int offsetXY[9];
+  for (int y = -1; y <= 1; y++)
+    for (int x = -1; x <= 1; x++)
+    {
+      const int i = (y + 1) * 3 + x + 1;
+      wxy[0][i] = dw[0][x+1] * w[1][y+1];
+      wxy[1][i] = w[0][x+1] * dw[1][y+1];
+      wxy[2][i] = w[0][x+1] * w[1][y+1];
+      offsetXY[i] = modFast128(mid[1] + y) * n + modFast128(mid[0] + x);
+    }
+
+  result[0] = result[1] = result[2] = 0.0f;
+  for (int z = -1; z <= 1; z++)
+  {
+    const float *slab = data + modFast128(mid[2] + z) * n * n;
+    const float wz = w[2][z+1], dwz = dw[2][z+1];
+
+    for (int i = 0; i < 9; i++)
+    {
+      const float value = slab[offsetXY[i]];
+      result[0] += wxy[0][i] * wz * value;
+      result[1] += wxy[1][i] * wz * value;
+      result[2] += wxy[2][i] * dwz * value;
+    }
+  }
+}
+
 #endif
 
@@ -94,6 +94,9 @@ WTURBULENCE::WTURBULENCE(int xResSm, int yResSm, int zResSm, int amplify, int no
 		_densityBigOld[i] = 0.;
 	}
 
+	Vec3Int bresBig = FLUID_3D::blockRes(_resBig);
+	_activeBlocksBig = new unsigned char[bresBig[0] * bresBig[1] * bresBig[2]];
+
 	/* fire */
 	_flameBig = _fuelBig = _fuelBigOld = NULL;
 	_reactBig = _reactBigOld = NULL;
@@ -180,6 +183,7 @@ void WTURBULENCE::initColors(float init_r, float init_g, float init_b)
 WTURBULENCE::~WTURBULENCE() {
   delete[] _densityBig;
   delete[] _densityBigOld;
+  delete[] _activeBlocksBig;
   if (_flameBig) delete[] _flameBig;
   if (_fuelBig) delete[] _fuelBig;
   if (_fuelBigOld) delete[] _fuelBigOld;
@@ -347,35 +351,46 @@ static float minDz(int x, int y, int z, float* input, Vec3Int res)
 // handle texture coordinates (advection, reset, eigenvalues), 
 // Beware -- uses big density maccormack as temporary arrays
 ////////////////////////////////////////////////////////////////////// 
-void WTURBULENCE::advectTextureCoordinates (float dtOrg, float* xvel, float* yvel, float* zvel, float *tempBig1, float *tempBig2) {
+void WTURBULENCE::advectTextureCoordinates (float dtOrg, float* xvel, float* yvel, float* zvel, float *tempBig1) {
+  float **texCoords[3] = {&_tcU, &_tcV, &_tcW};
+  int stepParts = 1;
+  float partSize = (float)_zResSm;
+
+#if PARALLEL==1
+  // slabs of at least 4 cells, the borders are copied from the neighbor slab
+  stepParts = omp_get_max_threads();
+  partSize = (float)_zResSm/stepParts;
+  if (partSize < 4) {stepParts = (int)(ceil((float)_zResSm/4.0f));
+					partSize = (float)_zResSm/stepParts;}
+#endif
 
   // advection
-  SWAP_POINTERS(_tcTemp, _tcU);
-  FLUID_3D::copyBorderX(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderY(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderZ(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack1(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, tempBig1, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack2(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, _tcU, tempBig1, tempBig2, _resSm, NULL, 0 , _resSm[2]);
-
-  SWAP_POINTERS(_tcTemp, _tcV);
-  FLUID_3D::copyBorderX(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderY(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderZ(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack1(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, tempBig1, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack2(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, _tcV, tempBig1, tempBig2, _resSm, NULL, 0 , _resSm[2]);
-
-  SWAP_POINTERS(_tcTemp, _tcW);
-  FLUID_3D::copyBorderX(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderY(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::copyBorderZ(_tcTemp, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack1(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, tempBig1, _resSm, 0 , _resSm[2]);
-  FLUID_3D::advectFieldMacCormack2(dtOrg, xvel, yvel, zvel, 
-      _tcTemp, _tcW, tempBig1, tempBig2, _resSm, NULL, 0 , _resSm[2]);
+  for (int i = 0; i < 3; i++)
+  {
+    SWAP_POINTERS(_tcTemp, *texCoords[i]);
+    FLUID_3D::copyBorderX(_tcTemp, _resSm, 0 , _resSm[2]);
+    FLUID_3D::copyBorderY(_tcTemp, _resSm, 0 , _resSm[2]);
+    FLUID_3D::copyBorderZ(_tcTemp, _resSm, 0 , _resSm[2]);
+
+#if PARALLEL==1
+#pragma omp parallel
+#endif
+    {
+#if PARALLEL==1
+#pragma omp for schedule(static,1)
+#endif
+    for (int part = 0; part < stepParts; part++)
+      FLUID_3D::advectFieldMacCormack1(dtOrg, xvel, yvel, zvel, 
+          _tcTemp, tempBig1, _resSm, (int)((float)part*partSize + 0.5f), (int)((float)(part+1)*partSize + 0.5f));
+
+#if PARALLEL==1
+#pragma omp for schedule(static,1)
+#endif
+    for (int part = 0; part < stepParts; part++)
+      FLUID_3D::advectFieldMacCormack2(dtOrg, xvel, yvel, zvel, 
+          _tcTemp, *texCoords[i], tempBig1, _resSm, NULL, (int)((float)part*partSize + 0.5f), (int)((float)(part+1)*partSize + 0.5f));
+    }
+  }
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -438,6 +453,9 @@ void WTURBULENCE::resetTextureCoordinates(float *_eigMin, float *_eigMax)
   const float dy = 1.0f/(float)(_resSm[1]);
   const float dz = 1.0f/(float)(_resSm[2]);
 
+#if PARALLEL==1
+#pragma omp parallel for schedule(static) reduction(+:resets)
+#endif
   for (int z = 1; z < _zResSm-1; z++)
     for (int y = 1; y < _yResSm-1; y++)
       for (int x = 1; x < _xResSm-1; x++)
@@ -476,9 +494,12 @@ void WTURBULENCE::decomposeEnergy(float *_energy, float *_highFreqEnergy)
 
   // subtract the down and upsampled field from the original field -- 
   // what should be left over is solely the high frequency component
-	int index = 0;
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
   for (int z = 0; z < _zResSm; z++) 
     for (int y = 0; y < _yResSm; y++) {
+      int index = y * _xResSm + z * _slabSizeSm;
       for (int x = 0; x < _xResSm; x++, index++) {
         // brute force reset of boundaries
         if(z >= _zResSm - 1 || x >= _xResSm - 1 || y >= _yResSm - 1 || z <= 0 || y <= 0 || x <= 0) 
@@ -499,6 +520,9 @@ void WTURBULENCE::computeEnergy(float *_energy, float* xvel, float* yvel, float*
   memcpy(obstacles, origObstacles, sizeof(unsigned char) * _totalCellsSm);
 
   // compute everywhere
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
   for (int x = 0; x < _totalCellsSm; x++) 
     _energy[x] = 0.5f * (xvel[x] * xvel[x] + yvel[x] * yvel[x] + zvel[x] * zvel[x]);
 
@@ -511,13 +535,16 @@ void WTURBULENCE::computeEnergy(float *_energy, float* xvel, float* yvel, float*
   // propagating the values in by 4 should be sufficient
   int index;
 
-  // iterate
+  // iterate, cells are only marched from cells retired in a previous
+  // iteration, so the slabs can be done in parallel
   for (int iter = 0; iter < 4; iter++)
   {
-    index = _slabSizeSm + _xResSm + 1;
-    for (int z = 1; z < _zResSm - 1; z++, index += 2 * _xResSm)
-      for (int y = 1; y < _yResSm - 1; y++, index += 2)
-        for (int x = 1; x < _xResSm - 1; x++, index++)
+#if PARALLEL==1
+#pragma omp parallel for schedule(static)
+#endif
+    for (int z = 1; z < _zResSm - 1; z++)
+      for (int y = 1; y < _yResSm - 1; y++)
+        for (int x = 1, index = z * _slabSizeSm + y * _xResSm + 1; x < _xResSm - 1; x++, index++)
           if (obstacles[index] && obstacles[index] != RETIRED)
           {
             float sum = 0.0f;
@@ -613,23 +640,17 @@ Vec3 WTURBULENCE::WVelocityWithJacobian(Vec3 orgPos, float* xUnwarped, float* yU
   const Vec3 p3 = orgPos + Vec3(0,0,NOISE_TILE_SIZE/2.0);
 
   Vec3 final;
-  final[0] = WNoiseDx(p1, _noiseTile);
-  final[1] = WNoiseDy(p1, _noiseTile);
-  final[2] = WNoiseDz(p1, _noiseTile);
+  WNoiseGradient(p1, _noiseTile, &final[0]);
   // UNUSED const float f1x = xUnwarped[0] * final[0] + xUnwarped[1] * final[1] + xUnwarped[2] * final[2];
   const float f1y = yUnwarped[0] * final[0] + yUnwarped[1] * final[1] + yUnwarped[2] * final[2];
   const float f1z = zUnwarped[0] * final[0] + zUnwarped[1] * final[1] + zUnwarped[2] * final[2];
 
-  final[0] = WNoiseDx(p2, _noiseTile);
-  final[1] = WNoiseDy(p2, _noiseTile);
-  final[2] = WNoiseDz(p2, _noiseTile);
+  WNoiseGradient(p2, _noiseTile, &final[0]);
   const float f2x = xUnwarped[0] * final[0] + xUnwarped[1] * final[1] + xUnwarped[2] * final[2];
   // UNUSED const float f2y = yUnwarped[0] * final[0] + yUnwarped[1] * final[1] + yUnwarped[2] * final[2];
   const float f2z = zUnwarped[0] * final[0] + zUnwarped[1] * final[1] + zUnwarped[2] * final[2];
 
-  final[0] = WNoiseDx(p3, _noiseTile);
-  final[1] = WNoiseDy(p3, _noiseTile);
-  final[2] = WNoiseDz(p3, _noiseTile);
+  WNoiseGradient(p3, _noiseTile, &final[0]);
   const float f3x = xUnwarped[0] * final[0] + xUnwarped[1] * final[1] + xUnwarped[2] * final[2];
   const float f3y = yUnwarped[0] * final[0] + yUnwarped[1] * final[1] + yUnwarped[2] * final[2];
   // UNUSED const float f3z = zUnwarped[0] * final[0] + zUnwarped[1] * final[1] + zUnwarped[2] * final[2];
@@ -822,7 +843,6 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 	float *tempFuelBig = NULL, *tempReactBig = NULL;
 	float *tempColor_rBig = NULL, *tempColor_gBig = NULL, *tempColor_bBig = NULL;
 	float *tempDensityBig = (float *)calloc(_totalCellsBig, sizeof(float));
-	float *tempBig = (float *)calloc(_totalCellsBig, sizeof(float));
 	float *bigUx = (float *)calloc(_totalCellsBig, sizeof(float));
 	float *bigUy = (float *)calloc(_totalCellsBig, sizeof(float));
 	float *bigUz = (float *)calloc(_totalCellsBig, sizeof(float)); 
@@ -845,7 +865,7 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 
 
 	// prepare textures
-	advectTextureCoordinates(dtOrg, xvel,yvel,zvel, tempDensityBig, tempBig);
+	advectTextureCoordinates(dtOrg, xvel,yvel,zvel, tempDensityBig);
 
 	// do wavelet decomposition of energy
 	computeEnergy(_energy, xvel, yvel, zvel, obstacles);
@@ -886,9 +906,10 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
     const int id  = omp_get_thread_num(); /*, num = omp_get_num_threads(); */
 #endif
 
-  // vector noise main loop
+  // vector noise main loop, the cost of a slab depends on how much
+  // of it is above the culling threshold
 #if PARALLEL==1
-#pragma omp for schedule(static,1)
+#pragma omp for schedule(dynamic,1)
 #endif
   for (int zSmall = 0; zSmall < _zResSm; zSmall++)
   {
@@ -1084,6 +1105,21 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
   // do the MacCormack advection, with substepping if necessary
   for(int substep = 0; substep < totalSubsteps; substep++)
   {
+	// all fields are advected in a single pass along the big velocity
+	float *oldFields[6], *newFields[6], *tempFields[6];
+	int numFields = 0;
+
+	oldFields[numFields] = _densityBigOld; newFields[numFields] = _densityBig; tempFields[numFields++] = tempDensityBig;
+	if (_fuelBig) {
+		oldFields[numFields] = _fuelBigOld; newFields[numFields] = _fuelBig; tempFields[numFields++] = tempFuelBig;
+		oldFields[numFields] = _reactBigOld; newFields[numFields] = _reactBig; tempFields[numFields++] = tempReactBig;
+	}
+	if (_color_rBig) {
+		oldFields[numFields] = _color_rBigOld; newFields[numFields] = _color_rBig; tempFields[numFields++] = tempColor_rBig;
+		oldFields[numFields] = _color_gBigOld; newFields[numFields] = _color_gBig; tempFields[numFields++] = tempColor_gBig;
+		oldFields[numFields] = _color_bBigOld; newFields[numFields] = _color_bBig; tempFields[numFields++] = tempColor_bBig;
+	}
+	FLUID_3D::updateActiveBlocks(_activeBlocksBig, _resBig, oldFields, numFields, dtSubdiv, bigUx, bigUy, bigUz);
 
 #if PARALLEL==1
 	#pragma omp parallel
@@ -1095,22 +1131,8 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 		int zBegin = (int)((float)i*partSize + 0.5f);
 		int zEnd = (int)((float)(i+1)*partSize + 0.5f);
 #endif
-		FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-		    _densityBigOld, tempDensityBig, _resBig, zBegin, zEnd);
-		if (_fuelBig) {
-			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_fuelBigOld, tempFuelBig, _resBig, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_reactBigOld, tempReactBig, _resBig, zBegin, zEnd);
-		}
-		if (_color_rBig) {
-			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_rBigOld, tempColor_rBig, _resBig, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_gBigOld, tempColor_gBig, _resBig, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_bBigOld, tempColor_bBig, _resBig, zBegin, zEnd);
-		}
+		FLUID_3D::advectFieldsMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
+		    oldFields, tempFields, numFields, _resBig, zBegin, zEnd, _activeBlocksBig);
 #if PARALLEL==1
 	}
 
@@ -1122,22 +1144,8 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 		int zBegin = (int)((float)i*partSize + 0.5f);
 		int zEnd = (int)((float)(i+1)*partSize + 0.5f);
 #endif
-		FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-		    _densityBigOld, _densityBig, tempDensityBig, tempBig, _resBig, NULL, zBegin, zEnd);
-		if (_fuelBig) {
-			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_fuelBigOld, _fuelBig, tempFuelBig, tempBig, _resBig, NULL, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_reactBigOld, _reactBig, tempReactBig, tempBig, _resBig, NULL, zBegin, zEnd);
-		}
-		if (_color_rBig) {
-			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_rBigOld, _color_rBig, tempColor_rBig, tempBig, _resBig, NULL, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_gBigOld, _color_gBig, tempColor_gBig, tempBig, _resBig, NULL, zBegin, zEnd);
-			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_bBigOld, _color_bBig, tempColor_bBig, tempBig, _resBig, NULL, zBegin, zEnd);
-		}
+		FLUID_3D::advectFieldsMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
+		    oldFields, newFields, tempFields, numFields, _resBig, NULL, zBegin, zEnd, _activeBlocksBig);
 #if PARALLEL==1
 	}
 	}
@@ -1159,7 +1167,6 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
   if (tempColor_rBig) free(tempColor_rBig);
   if (tempColor_gBig) free(tempColor_gBig);
   if (tempColor_bBig) free(tempColor_bBig);
-  free(tempBig);
   free(bigUx);
   free(bigUy);
   free(bigUz);
@@ -55,7 +55,7 @@ struct WTURBULENCE
 		void stepTurbulenceFull(float dt, float* xvel, float* yvel, float* zvel, unsigned char *obstacles);
 	
 		// texcoord functions
-		void advectTextureCoordinates(float dtOrg, float* xvel, float* yvel, float* zvel, float *tempBig1, float *tempBig2);
+		void advectTextureCoordinates(float dtOrg, float* xvel, float* yvel, float* zvel, float *tempBig1);
 		void resetTextureCoordinates(float *_eigMin, float *_eigMax);
 
 		void computeEnergy(float *energy, float* xvel, float* yvel, float* zvel, unsigned char *obstacles);
@@ -129,6 +129,9 @@ struct WTURBULENCE
 		float* _color_bBig;
 		float* _color_bBigOld;
 
+		// blocks touched by the high resolution advection
+		unsigned char* _activeBlocksBig;
+
 		// texture coordinates for noise
 		float* _tcU;
 		float* _tcV;
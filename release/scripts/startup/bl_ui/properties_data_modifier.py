@@ -156,6 +156,13 @@ class DATA_PT_modifiers(ModifierButtonsPanel, Panel):
         col.label(text="Object:")
         col.prop(md, "object", text="")
 
+        split = layout.split()
+        split.column().label(text="Solver:")
+        split.column().prop(md, "solver", text="")
+
+        if md.solver == 'BMESH':
+            layout.prop(md, "double_threshold")
+
     def BUILD(self, layout, ob, md):
         split = layout.split()
 
@@ -63,6 +63,8 @@ class PHYSICS_PT_smoke(PhysicButtonsPanel, Panel):
             col.prop(domain, "time_scale", text="Scale")
             col.label(text="Border Collisions:")
             col.prop(domain, "collision_extents", text="")
+            col.label(text="Pressure Solver:")
+            col.prop(domain, "pressure_solver", text="")
 
             col = split.column()
             col.label(text="Behavior:")
@@ -709,6 +709,10 @@ DerivedMesh *mesh_create_derived_physics(
         struct Scene *scene, struct Object *ob, float (*vertCos)[3],
         CustomDataMask dataMask);
 
+/* frees the cached intermediate modifier stack results */
+void DM_modifier_cache_clear(void);
+void DM_modifier_cache_set_limit(size_t mem_limit);
+
 DerivedMesh *editbmesh_get_derived_base(
         struct Object *, struct BMEditMesh *em);
 DerivedMesh *editbmesh_get_derived_cage(
@@ -80,6 +80,13 @@ DerivedMesh *CDDM_from_curve_displist(struct Object *ob, struct ListBase *dispba
 struct DerivedMesh *CDDM_copy(struct DerivedMesh *dm);
 struct DerivedMesh *CDDM_copy_from_tessface(struct DerivedMesh *dm);
 
+/* Same as CDDM_copy, but layers of a CDDerivedMesh are shared with the source
+ * until either one writes to them, which has to be done through
+ * CustomData_duplicate_referenced_layer(). Layers the source only references
+ * (e.g. Mesh data) are copied, so the result doesn't depend on their owner.
+ */
+struct DerivedMesh *CDDM_copy_shared(struct DerivedMesh *dm);
+
 /* creates a CDDerivedMesh with the same layer stack configuration as the
  * given DerivedMesh and containing the requested numbers of elements.
  * elements are initialized to all zeros
@@ -144,6 +144,8 @@ typedef struct ClothSpring {
 	
 	/* angular bending spring target and derivatives */
 	float target[3];
+	
+	int block;		/* first off-diagonal solver matrix block of the spring, -1 if it has none */
 }
 ClothSpring;
 
@@ -64,6 +64,7 @@ typedef struct EffectedPoint {
 	int index;
 
 	struct ParticleSystem *psys;  /* particle system the point belongs to */
+	struct RNG *rng;  /* random stream of the point, when NULL the effector's own is used */
 } EffectedPoint;
 
 typedef struct GuideEffectorData {
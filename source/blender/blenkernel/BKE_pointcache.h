@@ -59,6 +59,7 @@
 #define PTCACHE_FILE_READ   0
 #define PTCACHE_FILE_WRITE  1
 #define PTCACHE_FILE_UPDATE 2
+#define PTCACHE_FILE_WRITE_ASYNC 3
 
 /* PTCacheID types */
 #define PTCACHE_TYPE_SOFTBODY           0
@@ -89,6 +90,7 @@ struct Object;
 struct ParticleKey;
 struct ParticleSystem;
 struct PointCache;
+struct PTCachePack;
 struct Scene;
 struct SmokeModifierData;
 struct SoftBody;
@@ -108,6 +110,12 @@ typedef struct PTCacheData {
 
 typedef struct PTCacheFile {
 	FILE *fp;
+	struct PTCacheWriteFrame *async; /* set when the frame is written in the background */
+
+	/* frame read from a packed cache, used instead of fp */
+	const unsigned char *mem;
+	size_t mem_len, mem_pos;
+	struct PTCachePack *pack;  /* the mapped pack 'mem' points into, NULL when 'mem' is owned */
 
 	int frame, old_format;
 	unsigned int totpoint, type;
@@ -322,6 +330,10 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Move the frames of a baked disk cache into one file (PTCACHE_DISK_PACK) and back. */
+void BKE_ptcache_disk_pack(struct PTCacheID *pid);
+void BKE_ptcache_disk_unpack(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid, const char *name_src, const char *name_dst);
 
@@ -334,4 +346,12 @@ void BKE_ptcache_validate(struct PointCache *cache, int framenr);
 /* Set correct flags after unsuccessful simulation step */
 void BKE_ptcache_invalidate(struct PointCache *cache);
 
+/********************** Background writing *********************/
+
+/* Wait until all cache frames queued for background writing are on disk. */
+void BKE_ptcache_flush_writes(void);
+
+/* Flush pending writes, free the writer's task pool and unmap packed caches, on exit. */
+void BKE_ptcache_exit(void);
+
 #endif
@@ -76,6 +76,8 @@ static CCGVert *_vert_new(CCGVertHDL vHDL, CCGSubSurf *ss)
 	v->numEdges = v->numFaces = 0;
 	v->flags = 0;
 
+	ss->topologyChanged = 1;
+
 	userData = ccgSubSurf_getVertUserData(ss, v);
 	memset(userData, 0, ss->meshIFC.vertUserSize);
 	if (ss->useAgeCounts) *((int *) &userData[ss->vertUserAgeOffset]) = ss->currentAge;
@@ -135,6 +137,7 @@ static void _vert_free(CCGVert *v, CCGSubSurf *ss)
 		CCGSUBSURF_free(ss, v->faces);
 	}
 
+	ss->topologyChanged = 1;
 	CCGSUBSURF_free(ss, v);
 }
 
@@ -157,6 +160,7 @@ static CCGEdge *_edge_new(CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float creas
 	e->numFaces = 0;
 	e->flags = 0;
 	_vert_addEdge(v0, e, ss);
+	ss->topologyChanged = 1;
 	_vert_addEdge(v1, e, ss);
 
 	userData = ccgSubSurf_getEdgeUserData(ss, e);
@@ -197,6 +201,7 @@ static void _edge_free(CCGEdge *e, CCGSubSurf *ss)
 		CCGSUBSURF_free(ss, e->faces);
 	}
 
+	ss->topologyChanged = 1;
 	CCGSUBSURF_free(ss, e);
 }
 static void _edge_unlinkMarkAndFree(CCGEdge *e, CCGSubSurf *ss)
@@ -226,6 +231,8 @@ static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int
 	f->fHDL = fHDL;
 	f->flags = 0;
 
+	ss->topologyChanged = 1;
+
 	for (i = 0; i < numVerts; i++) {
 		FACE_getVerts(f)[i] = verts[i];
 		FACE_getEdges(f)[i] = edges[i];
@@ -241,6 +248,7 @@ static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int
 }
 static void _face_free(CCGFace *f, CCGSubSurf *ss)
 {
+	ss->topologyChanged = 1;
 	CCGSUBSURF_free(ss, f);
 }
 static void _face_unlinkMarkAndFree(CCGFace *f, CCGSubSurf *ss)
@@ -304,6 +312,12 @@ CCGSubSurf *ccgSubSurf_new(CCGMeshIFC *ifc, int subdivLevels, CCGAllocatorIFC *a
 		ss->tempVerts = NULL;
 		ss->tempEdges = NULL;
 
+		ss->useStencils = 0;
+		ss->stencils = NULL;
+		ss->topologyChanged = 1;
+		ss->stencilBuildFailed = 0;
+		ss->stencilLevelsStale = 0;
+
 #ifdef WITH_OPENSUBDIV
 		ss->osd_evaluator = NULL;
 		ss->osd_mesh = NULL;
@@ -357,6 +371,8 @@ void ccgSubSurf_free(CCGSubSurf *ss)
 		MEM_freeN(ss->tempEdges);
 	}
 
+	ccgSubSurf__stencils_invalidate(ss);
+
 	CCGSUBSURF_free(ss, ss->r);
 	CCGSUBSURF_free(ss, ss->q);
 	if (ss->defaultEdgeUserData) CCGSUBSURF_free(ss, ss->defaultEdgeUserData);
@@ -408,6 +424,7 @@ CCGError ccgSubSurf_setSubdivisionLevels(CCGSubSurf *ss, int subdivisionLevels)
 	else if (subdivisionLevels != ss->subdivLevels) {
 		ss->numGrids = 0;
 		ss->subdivLevels = subdivisionLevels;
+		ccgSubSurf__stencils_invalidate(ss);
 		ccg_ehash_free(ss->vMap, (EHEntryFreeFP) _vert_free, ss);
 		ccg_ehash_free(ss->eMap, (EHEntryFreeFP) _edge_free, ss);
 		ccg_ehash_free(ss->fMap, (EHEntryFreeFP) _face_free, ss);
@@ -479,9 +496,30 @@ void ccgSubSurf_setAllocMask(CCGSubSurf *ss, int allocMask, int maskOffset)
 
 void ccgSubSurf_setNumLayers(CCGSubSurf *ss, int numLayers)
 {
+	if (ss->meshIFC.numLayers != numLayers) {
+		ccgSubSurf__stencils_invalidate(ss);
+	}
 	ss->meshIFC.numLayers = numLayers;
 }
 
+/**
+ * Evaluate the final level as precomputed weighted sums of base vertices
+ * when only vertex coordinates change between syncs (deforming meshes).
+ * Levels between the base and the final one are not kept up to date then.
+ */
+void ccgSubSurf_setUseStencils(CCGSubSurf *ss, int useStencils)
+{
+	if (!useStencils) {
+		ccgSubSurf__stencils_invalidate(ss);
+	}
+	ss->useStencils = useStencils;
+}
+
+int ccgSubSurf_getUseStencils(const CCGSubSurf *ss)
+{
+	return ss->useStencils;
+}
+
 /***/
 
 CCGError ccgSubSurf_initFullSync(CCGSubSurf *ss)
@@ -113,6 +113,9 @@ void		ccgSubSurf_setAllocMask				(CCGSubSurf *ss, int allocMask, int maskOffset)
 
 void		ccgSubSurf_setNumLayers				(CCGSubSurf *ss, int numLayers);
 
+void		ccgSubSurf_setUseStencils			(CCGSubSurf *ss, int useStencils);
+int			ccgSubSurf_getUseStencils			(const CCGSubSurf *ss);
+
 /***/
 
 int			ccgSubSurf_getNumVerts				(const CCGSubSurf *ss);
@@ -166,6 +166,8 @@ typedef enum {
 #endif
 } SyncState;
 
+typedef struct CCGStencilTable CCGStencilTable;
+
 struct CCGSubSurf {
 	EHash *vMap;   /* map of CCGVertHDL -> Vert */
 	EHash *eMap;   /* map of CCGEdgeHDL -> Edge */
@@ -207,6 +209,18 @@ struct CCGSubSurf {
 	CCGVert **tempVerts;
 	CCGEdge **tempEdges;
 
+	/* Final level as weighted sums of base vertices,
+	 * valid for as long as topology doesn't change.
+	 */
+	int useStencils;
+	CCGStencilTable *stencils;
+	/* Elements were added or removed since the last sync. */
+	int topologyChanged;
+	/* Stencils aren't supported for the current topology. */
+	int stencilBuildFailed;
+	/* Only the final level was evaluated, levels in between are garbage. */
+	int stencilLevelsStale;
+
 #ifdef WITH_OPENSUBDIV
 	/* Skip grids means no CCG geometry is created and subsurf is possible
 	 * to be completely done on GPU.
@@ -299,6 +313,19 @@ void ccgSubSurf__effectedFaceNeighbours(CCGSubSurf *ss,
 
 void ccgSubSurf__sync_legacy(CCGSubSurf *ss);
 
+/* * CCGSubSurf_stencil.c * */
+
+CCGStencilTable *ccgSubSurf__stencils_build(
+        CCGSubSurf *ss,
+        CCGVert **verts, CCGEdge **edges, CCGFace **faces,
+        int numVerts, int numEdges, int numFaces,
+        void (*subdivide_fn)(CCGSubSurf *ss,
+                             CCGVert **verts, CCGEdge **edges, CCGFace **faces,
+                             int numVerts, int numEdges, int numFaces));
+void ccgSubSurf__stencils_evaluate(CCGSubSurf *ss, const CCGStencilTable *stencils);
+void ccgSubSurf__stencils_free(CCGStencilTable *stencils);
+void ccgSubSurf__stencils_invalidate(CCGSubSurf *ss);
+
 /* * CCGSubSurf_opensubdiv.c * */
 
 void ccgSubSurf__sync_opensubdiv(CCGSubSurf *ss);
@@ -322,6 +322,53 @@ static void ccgSubSurf__calcVertNormals(CCGSubSurf *ss,
 	}
 }
 
+/* Copy points shared between elements from the element which computes them. */
+static void ccgSubSurf__copyDownLevel(CCGSubSurf *ss,
+                                      CCGEdge **effectedE, CCGFace **effectedF,
+                                      int numEffectedE, int numEffectedF, int nextLvl)
+{
+	int subdivLevels = ss->subdivLevels;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	int edgeSize, gridSize, cornerIdx, i;
+
+	edgeSize = ccg_edgesize(nextLvl);
+	gridSize = ccg_gridsize(nextLvl);
+	cornerIdx = gridSize - 1;
+
+#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
+	for (i = 0; i < numEffectedE; i++) {
+		CCGEdge *e = effectedE[i];
+		VertDataCopy(EDGE_getCo(e, nextLvl, 0), VERT_getCo(e->v0, nextLvl), ss);
+		VertDataCopy(EDGE_getCo(e, nextLvl, edgeSize - 1), VERT_getCo(e->v1, nextLvl), ss);
+	}
+
+#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
+	for (i = 0; i < numEffectedF; i++) {
+		CCGFace *f = effectedF[i];
+		int S, x;
+
+		for (S = 0; S < f->numVerts; S++) {
+			CCGEdge *e = FACE_getEdges(f)[S];
+			CCGEdge *prevE = FACE_getEdges(f)[(S + f->numVerts - 1) % f->numVerts];
+
+			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 0), (float *)FACE_getCenterData(f), ss);
+			VertDataCopy(FACE_getIECo(f, nextLvl, S, 0), (float *)FACE_getCenterData(f), ss);
+			VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, cornerIdx), VERT_getCo(FACE_getVerts(f)[S], nextLvl), ss);
+			VertDataCopy(FACE_getIECo(f, nextLvl, S, cornerIdx), EDGE_getCo(FACE_getEdges(f)[S], nextLvl, cornerIdx), ss);
+			for (x = 1; x < gridSize - 1; x++) {
+				float *co = FACE_getIECo(f, nextLvl, S, x);
+				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, 0), co, ss);
+				VertDataCopy(FACE_getIFCo(f, nextLvl, (S + 1) % f->numVerts, 0, x), co, ss);
+			}
+			for (x = 0; x < gridSize - 1; x++) {
+				int eI = gridSize - 1 - x;
+				VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, x), _edge_getCoVert(e, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
+				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, cornerIdx), _edge_getCoVert(prevE, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
+			}
+		}
+	}
+}
+
 static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
                                         CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
                                         int numEffectedV, int numEffectedE, int numEffectedF, int curLvl)
@@ -330,7 +377,7 @@ static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
 	int edgeSize = ccg_edgesize(curLvl);
 	int gridSize = ccg_gridsize(curLvl);
 	int nextLvl = curLvl + 1;
-	int ptrIdx, cornerIdx, i;
+	int ptrIdx;
 	int vertDataSize = ss->meshIFC.vertDataSize;
 	float *q = ss->q, *r = ss->r;
 
@@ -789,86 +836,20 @@ static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
 		}
 	}
 
-	/* copy down */
-	edgeSize = ccg_edgesize(nextLvl);
-	gridSize = ccg_gridsize(nextLvl);
-	cornerIdx = gridSize - 1;
-
-#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
-	for (i = 0; i < numEffectedE; i++) {
-		CCGEdge *e = effectedE[i];
-		VertDataCopy(EDGE_getCo(e, nextLvl, 0), VERT_getCo(e->v0, nextLvl), ss);
-		VertDataCopy(EDGE_getCo(e, nextLvl, edgeSize - 1), VERT_getCo(e->v1, nextLvl), ss);
-	}
-
-#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
-	for (i = 0; i < numEffectedF; i++) {
-		CCGFace *f = effectedF[i];
-		int S, x;
-
-		for (S = 0; S < f->numVerts; S++) {
-			CCGEdge *e = FACE_getEdges(f)[S];
-			CCGEdge *prevE = FACE_getEdges(f)[(S + f->numVerts - 1) % f->numVerts];
-
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, cornerIdx), VERT_getCo(FACE_getVerts(f)[S], nextLvl), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, cornerIdx), EDGE_getCo(FACE_getEdges(f)[S], nextLvl, cornerIdx), ss);
-			for (x = 1; x < gridSize - 1; x++) {
-				float *co = FACE_getIECo(f, nextLvl, S, x);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, 0), co, ss);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, (S + 1) % f->numVerts, 0, x), co, ss);
-			}
-			for (x = 0; x < gridSize - 1; x++) {
-				int eI = gridSize - 1 - x;
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, x), _edge_getCoVert(e, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, cornerIdx), _edge_getCoVert(prevE, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
-			}
-		}
-	}
+	ccgSubSurf__copyDownLevel(ss, effectedE, effectedF, numEffectedE, numEffectedF, nextLvl);
 }
 
-void ccgSubSurf__sync_legacy(CCGSubSurf *ss)
+/* Compute all levels of the effected elements from the base data. */
+static void ccgSubSurf__subdivide(CCGSubSurf *ss,
+                                  CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                  int numEffectedV, int numEffectedE, int numEffectedF)
 {
-	CCGVert **effectedV;
-	CCGEdge **effectedE;
-	CCGFace **effectedF;
-	int numEffectedV, numEffectedE, numEffectedF;
 	int subdivLevels = ss->subdivLevels;
 	int vertDataSize = ss->meshIFC.vertDataSize;
-	int i, j, ptrIdx, S;
+	int i, ptrIdx;
 	int curLvl, nextLvl;
 	void *q = ss->q, *r = ss->r;
 
-	effectedV = MEM_mallocN(sizeof(*effectedV) * ss->vMap->numEntries, "CCGSubsurf effectedV");
-	effectedE = MEM_mallocN(sizeof(*effectedE) * ss->eMap->numEntries, "CCGSubsurf effectedE");
-	effectedF = MEM_mallocN(sizeof(*effectedF) * ss->fMap->numEntries, "CCGSubsurf effectedF");
-	numEffectedV = numEffectedE = numEffectedF = 0;
-	for (i = 0; i < ss->vMap->curSize; i++) {
-		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
-		for (; v; v = v->next) {
-			if (v->flags & Vert_eEffected) {
-				effectedV[numEffectedV++] = v;
-
-				for (j = 0; j < v->numEdges; j++) {
-					CCGEdge *e = v->edges[j];
-					if (!(e->flags & Edge_eEffected)) {
-						effectedE[numEffectedE++] = e;
-						e->flags |= Edge_eEffected;
-					}
-				}
-
-				for (j = 0; j < v->numFaces; j++) {
-					CCGFace *f = v->faces[j];
-					if (!(f->flags & Face_eEffected)) {
-						effectedF[numEffectedF++] = f;
-						f->flags |= Face_eEffected;
-					}
-				}
-			}
-		}
-	}
-
 	curLvl = 0;
 	nextLvl = curLvl + 1;
 
@@ -1044,6 +1025,135 @@ void ccgSubSurf__sync_legacy(CCGSubSurf *ss)
 		/* vert flags cleared later */
 	}
 
+	ccgSubSurf__copyDownLevel(ss, effectedE, effectedF, numEffectedE, numEffectedF, nextLvl);
+
+	for (curLvl = nextLvl; curLvl < subdivLevels; curLvl++)
+		ccgSubSurf__calcSubdivLevel(ss,
+		                            effectedV, effectedE, effectedF,
+		                            numEffectedV, numEffectedE, numEffectedF, curLvl);
+
+}
+
+static bool ccgSubSurf__anyVertEffected(CCGSubSurf *ss)
+{
+	int i;
+
+	for (i = 0; i < ss->vMap->curSize; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
+		for (; v; v = v->next) {
+			if (v->flags & Vert_eEffected) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/* Evaluate the final level from the stencils, returns false when they can't be used. */
+static bool ccgSubSurf__subdivide_stencils(CCGSubSurf *ss,
+                                           CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                           int numEffectedV, int numEffectedE, int numEffectedF)
+{
+	int i;
+
+	for (i = 0; i < numEffectedV; i++) {
+		if (effectedV[i]->flags & Vert_eSeam) {
+			ccgSubSurf__stencils_invalidate(ss);
+			ss->stencilBuildFailed = 1;
+			return false;
+		}
+	}
+
+	if (ss->stencils == NULL) {
+		ss->stencils = ccgSubSurf__stencils_build(ss,
+		                                          effectedV, effectedE, effectedF,
+		                                          numEffectedV, numEffectedE, numEffectedF,
+		                                          ccgSubSurf__subdivide);
+		if (ss->stencils == NULL) {
+			ss->stencilBuildFailed = 1;
+			return false;
+		}
+	}
+
+	ccgSubSurf__stencils_evaluate(ss, ss->stencils);
+	ccgSubSurf__copyDownLevel(ss, effectedE, effectedF, numEffectedE, numEffectedF, ss->subdivLevels);
+
+	for (i = 0; i < numEffectedF; i++) {
+		effectedF[i]->flags = 0;
+	}
+
+	ss->stencilLevelsStale = 1;
+
+	return true;
+}
+
+void ccgSubSurf__sync_legacy(CCGSubSurf *ss)
+{
+	CCGVert **effectedV;
+	CCGEdge **effectedE;
+	CCGFace **effectedF;
+	int numEffectedV, numEffectedE, numEffectedF;
+	int i, j, ptrIdx;
+	bool use_stencils = false;
+
+	if (ss->topologyChanged) {
+		ccgSubSurf__stencils_invalidate(ss);
+	}
+
+	if ((ss->useStencils || ss->stencilLevelsStale) && ccgSubSurf__anyVertEffected(ss)) {
+		use_stencils = ss->useStencils && !ss->topologyChanged && !ss->stencilBuildFailed;
+
+		/* stencils write the whole final level at once, and after them
+		 * the levels in between have to be computed again for all elements */
+		for (i = 0; i < ss->vMap->curSize; i++) {
+			CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
+			for (; v; v = v->next) {
+				v->flags |= Vert_eEffected;
+			}
+		}
+	}
+
+	effectedV = MEM_mallocN(sizeof(*effectedV) * ss->vMap->numEntries, "CCGSubsurf effectedV");
+	effectedE = MEM_mallocN(sizeof(*effectedE) * ss->eMap->numEntries, "CCGSubsurf effectedE");
+	effectedF = MEM_mallocN(sizeof(*effectedF) * ss->fMap->numEntries, "CCGSubsurf effectedF");
+	numEffectedV = numEffectedE = numEffectedF = 0;
+	for (i = 0; i < ss->vMap->curSize; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
+		for (; v; v = v->next) {
+			if (v->flags & Vert_eEffected) {
+				effectedV[numEffectedV++] = v;
+
+				for (j = 0; j < v->numEdges; j++) {
+					CCGEdge *e = v->edges[j];
+					if (!(e->flags & Edge_eEffected)) {
+						effectedE[numEffectedE++] = e;
+						e->flags |= Edge_eEffected;
+					}
+				}
+
+				for (j = 0; j < v->numFaces; j++) {
+					CCGFace *f = v->faces[j];
+					if (!(f->flags & Face_eEffected)) {
+						effectedF[numEffectedF++] = f;
+						f->flags |= Face_eEffected;
+					}
+				}
+			}
+		}
+	}
+
+	if (!use_stencils ||
+	    !ccgSubSurf__subdivide_stencils(ss,
+	                                    effectedV, effectedE, effectedF,
+	                                    numEffectedV, numEffectedE, numEffectedF))
+	{
+		ccgSubSurf__subdivide(ss,
+		                      effectedV, effectedE, effectedF,
+		                      numEffectedV, numEffectedE, numEffectedF);
+		ss->stencilLevelsStale = 0;
+	}
+
 	if (ss->useAgeCounts) {
 		for (i = 0; i < numEffectedV; i++) {
 			CCGVert *v = effectedV[i];
@@ -1064,37 +1174,13 @@ void ccgSubSurf__sync_legacy(CCGSubSurf *ss)
 		}
 	}
 
-	for (i = 0; i < numEffectedE; i++) {
-		CCGEdge *e = effectedE[i];
-		VertDataCopy(EDGE_getCo(e, nextLvl, 0), VERT_getCo(e->v0, nextLvl), ss);
-		VertDataCopy(EDGE_getCo(e, nextLvl, 2), VERT_getCo(e->v1, nextLvl), ss);
-	}
-	for (i = 0; i < numEffectedF; i++) {
-		CCGFace *f = effectedF[i];
-		for (S = 0; S < f->numVerts; S++) {
-			CCGEdge *e = FACE_getEdges(f)[S];
-			CCGEdge *prevE = FACE_getEdges(f)[(S + f->numVerts - 1) % f->numVerts];
-
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 1, 1), VERT_getCo(FACE_getVerts(f)[S], nextLvl), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, 1), EDGE_getCo(FACE_getEdges(f)[S], nextLvl, 1), ss);
-
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 1, 0), _edge_getCoVert(e, FACE_getVerts(f)[S], nextLvl, 1, vertDataSize), ss);
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 1), _edge_getCoVert(prevE, FACE_getVerts(f)[S], nextLvl, 1, vertDataSize), ss);
-		}
-	}
-
-	for (curLvl = 1; curLvl < subdivLevels; curLvl++)
-		ccgSubSurf__calcSubdivLevel(ss,
-		                            effectedV, effectedE, effectedF,
-		                            numEffectedV, numEffectedE, numEffectedF, curLvl);
-
 	if (ss->calcVertNormals)
 		ccgSubSurf__calcVertNormals(ss,
 		                            effectedV, effectedE, effectedF,
 		                            numEffectedV, numEffectedE, numEffectedF);
 
+	ss->topologyChanged = 0;
+
 	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
 		CCGVert *v = effectedV[ptrIdx];
 		v->flags = 0;
@@ -0,0 +1,539 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/CCGSubSurf_stencil.c
+ *  \ingroup bke
+ *
+ * Subdivision stencils for the legacy CCG evaluation.
+ *
+ * Subdivision is linear in the base mesh coordinates, so every point of the
+ * final level is a fixed weighted sum of base vertices, as long as topology
+ * and creases don't change. The weights are found once per topology
+ * and after that each evaluation is a sparse matrix-vector product.
+ *
+ * Weights are found by running the regular subdivision on impulse data:
+ * base vertices are colored so no two vertices of the same color influence
+ * the same final point, then each data layer carries the impulse of one color.
+ * This way all special cases (boundaries, creases, n-gons) are handled
+ * by the same code which is used for regular evaluation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "MEM_guardedalloc.h"
+#include "BLI_sys_types.h" // for intptr_t support
+
+#include "BLI_utildefines.h" /* for BLI_assert */
+#include "BLI_ghash.h"
+#include "BLI_math.h"
+
+#include "CCGSubSurf.h"
+#include "CCGSubSurf_intern.h"
+
+struct CCGStencilTable {
+	int numRows, numCols;
+
+	/* Final level coordinate each row is written to. */
+	float **rowData;
+	/* numRows + 1 offsets into colIndex & weights. */
+	size_t *rowOffset;
+	int *colIndex;
+	float *weights;
+
+	/* Base mesh vertex of each column. */
+	CCGVert **colVerts;
+};
+
+typedef struct StencilEntry {
+	int row, col;
+	float weight;
+} StencilEntry;
+
+typedef struct StencilBuild {
+	CCGSubSurf *ss;
+	int numVerts;
+	CCGVert **verts;
+
+	/* Vertices which can influence points around each vertex:
+	 * itself, vertices it shares an edge or a face with. */
+	int *nbrOffset;
+	int *nbrIndex;
+
+	int *color;
+	int numColors;
+
+	StencilEntry *entries;
+	size_t numEntries, allocEntries;
+} StencilBuild;
+
+static void stencil_build_neighbors(StencilBuild *sb, GHash *vert_index)
+{
+	int *stamp = MEM_mallocN(sizeof(*stamp) * (size_t)sb->numVerts, __func__);
+	int i, j, k, tot = 0, alloc = sb->numVerts * 8;
+
+	sb->nbrOffset = MEM_mallocN(sizeof(*sb->nbrOffset) * (size_t)(sb->numVerts + 1), __func__);
+	sb->nbrIndex = MEM_mallocN(sizeof(*sb->nbrIndex) * (size_t)alloc, __func__);
+	copy_vn_i(stamp, sb->numVerts, -1);
+
+#define NBR_ADD(_v) \
+	{ \
+		const int _index = GET_INT_FROM_POINTER(BLI_ghash_lookup(vert_index, _v)); \
+		if (stamp[_index] != i) { \
+			stamp[_index] = i; \
+			if (UNLIKELY(tot == alloc)) { \
+				alloc *= 2; \
+				sb->nbrIndex = MEM_reallocN(sb->nbrIndex, sizeof(*sb->nbrIndex) * (size_t)alloc); \
+			} \
+			sb->nbrIndex[tot++] = _index; \
+		} \
+	} (void)0
+
+	for (i = 0; i < sb->numVerts; i++) {
+		CCGVert *v = sb->verts[i];
+
+		sb->nbrOffset[i] = tot;
+		NBR_ADD(v);
+		for (j = 0; j < v->numEdges; j++) {
+			NBR_ADD(v->edges[j]->v0);
+			NBR_ADD(v->edges[j]->v1);
+		}
+		for (j = 0; j < v->numFaces; j++) {
+			CCGFace *f = v->faces[j];
+			for (k = 0; k < f->numVerts; k++) {
+				NBR_ADD(FACE_getVerts(f)[k]);
+			}
+		}
+	}
+	sb->nbrOffset[i] = tot;
+
+#undef NBR_ADD
+
+	MEM_freeN(stamp);
+}
+
+/**
+ * Points of an element depend on the neighbors of its vertices (N).
+ * Two vertices may only share a color when no element depends on both,
+ * so color them apart when one is within N(N(N(v))) of the other.
+ */
+static void stencil_build_colors(StencilBuild *sb)
+{
+	int *used = MEM_mallocN(sizeof(*used) * (size_t)(sb->numVerts + 1), __func__);
+	int i;
+
+	sb->color = MEM_mallocN(sizeof(*sb->color) * (size_t)sb->numVerts, __func__);
+	copy_vn_i(sb->color, sb->numVerts, -1);
+	copy_vn_i(used, sb->numVerts + 1, -1);
+	sb->numColors = 0;
+
+	for (i = 0; i < sb->numVerts; i++) {
+		int a, b, c, col;
+
+		for (a = sb->nbrOffset[i]; a < sb->nbrOffset[i + 1]; a++) {
+			const int va = sb->nbrIndex[a];
+			for (b = sb->nbrOffset[va]; b < sb->nbrOffset[va + 1]; b++) {
+				const int vb = sb->nbrIndex[b];
+				for (c = sb->nbrOffset[vb]; c < sb->nbrOffset[vb + 1]; c++) {
+					const int vc_color = sb->color[sb->nbrIndex[c]];
+					if (vc_color != -1) {
+						used[vc_color] = i;
+					}
+				}
+			}
+		}
+
+		for (col = 0; used[col] == i; col++) {
+			/* pass */
+		}
+		sb->color[i] = col;
+		sb->numColors = max_ii(sb->numColors, col + 1);
+	}
+
+	MEM_freeN(used);
+}
+
+/**
+ * Map colors to the vertices which can influence an element with vertices \a elem_verts.
+ */
+static void stencil_build_color_map(
+        const StencilBuild *sb, GHash *vert_index,
+        CCGVert **elem_verts, int elem_verts_len,
+        int color_first, int color_len, int *r_color_vert)
+{
+	int i, j;
+
+	copy_vn_i(r_color_vert, color_len, -1);
+
+	for (i = 0; i < elem_verts_len; i++) {
+		const int index = GET_INT_FROM_POINTER(BLI_ghash_lookup(vert_index, elem_verts[i]));
+		for (j = sb->nbrOffset[index]; j < sb->nbrOffset[index + 1]; j++) {
+			const int nbr = sb->nbrIndex[j];
+			const int col = sb->color[nbr] - color_first;
+			if (col >= 0 && col < color_len) {
+				BLI_assert(ELEM(r_color_vert[col], -1, nbr));
+				r_color_vert[col] = nbr;
+			}
+		}
+	}
+}
+
+static bool stencil_build_add_row(
+        StencilBuild *sb, int row, const float *data,
+        const int *color_vert, int color_len)
+{
+	int i;
+
+	for (i = 0; i < color_len; i++) {
+		if (data[i] != 0.0f) {
+			StencilEntry *entry;
+
+			if (UNLIKELY(color_vert[i] == -1)) {
+				/* should never happen, influence outside the expected neighborhood */
+				BLI_assert(0);
+				continue;
+			}
+
+			if (UNLIKELY(sb->numEntries == sb->allocEntries)) {
+				sb->allocEntries *= 2;
+				sb->entries = MEM_reallocN(sb->entries, sizeof(*sb->entries) * sb->allocEntries);
+				if (sb->entries == NULL) {
+					/* out of memory, fall back to regular subdivision */
+					sb->numEntries = sb->allocEntries = 0;
+					return false;
+				}
+			}
+
+			entry = &sb->entries[sb->numEntries++];
+			entry->row = row;
+			entry->col = color_vert[i];
+			entry->weight = data[i];
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Iterate over all final level points which are computed (not copied from neighbors)
+ * by the subdivision, the order defines the rows of the table.
+ */
+typedef void (*StencilRowFn)(void *userdata, int row, float *co, CCGVert **elem_verts, int elem_verts_len);
+
+static void stencil_rows_foreach(
+        CCGSubSurf *ss,
+        CCGVert **verts, CCGEdge **edges, CCGFace **faces,
+        int numVerts, int numEdges, int numFaces,
+        StencilRowFn fn, void *userdata)
+{
+	const int lvl = ss->subdivLevels;
+	const int vertDataSize = ss->meshIFC.vertDataSize;
+	const int edgeSize = ccg_edgesize(lvl);
+	const int gridSize = ccg_gridsize(lvl);
+	int row = 0;
+	int i, S, x, y;
+
+	for (i = 0; i < numVerts; i++) {
+		CCGVert *v = verts[i];
+		fn(userdata, row++, ccg_vert_getCo(v, lvl, vertDataSize), &v, 1);
+	}
+
+	for (i = 0; i < numEdges; i++) {
+		CCGEdge *e = edges[i];
+		CCGVert *e_verts[2] = {e->v0, e->v1};
+		for (x = 1; x < edgeSize - 1; x++) {
+			fn(userdata, row++, ccg_edge_getCo(e, lvl, x, vertDataSize), e_verts, 2);
+		}
+	}
+
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = faces[i];
+		CCGVert **f_verts = FACE_getVerts(f);
+
+		fn(userdata, row++, (float *)FACE_getCenterData(f), f_verts, f->numVerts);
+		for (S = 0; S < f->numVerts; S++) {
+			for (x = 1; x < gridSize - 1; x++) {
+				fn(userdata, row++, ccg_face_getIECo(f, lvl, S, x, lvl, vertDataSize), f_verts, f->numVerts);
+			}
+			for (y = 1; y < gridSize - 1; y++) {
+				for (x = 1; x < gridSize - 1; x++) {
+					fn(userdata, row++, ccg_face_getIFCo(f, lvl, S, x, y, lvl, vertDataSize), f_verts, f->numVerts);
+				}
+			}
+		}
+	}
+}
+
+typedef struct StencilProbeData {
+	StencilBuild *sb;
+	GHash *vert_index;
+	int *color_vert;
+	int color_first;
+	bool ok;
+} StencilProbeData;
+
+static void stencil_probe_row_cb(void *userdata, int row, float *co, CCGVert **elem_verts, int elem_verts_len)
+{
+	StencilProbeData *data = userdata;
+	const int numLayers = data->sb->ss->meshIFC.numLayers;
+
+	if (data->ok) {
+		stencil_build_color_map(
+		        data->sb, data->vert_index, elem_verts, elem_verts_len,
+		        data->color_first, numLayers, data->color_vert);
+		data->ok = stencil_build_add_row(data->sb, row, co, data->color_vert, numLayers);
+	}
+}
+
+static void stencil_row_data_cb(void *userdata, int row, float *co, CCGVert **UNUSED(elem_verts), int UNUSED(elem_verts_len))
+{
+	CCGStencilTable *stencils = userdata;
+	stencils->rowData[row] = co;
+}
+
+static size_t stencil_count_rows(CCGSubSurf *ss, CCGFace **faces, int numVerts, int numEdges, int numFaces)
+{
+	const size_t edgeSize = (size_t)ccg_edgesize(ss->subdivLevels);
+	const size_t gridSize = (size_t)ccg_gridsize(ss->subdivLevels);
+	size_t numRows = (size_t)numVerts + (size_t)numEdges * (edgeSize - 2) + (size_t)numFaces;
+	int i;
+
+	for (i = 0; i < numFaces; i++) {
+		numRows += (size_t)faces[i]->numVerts * (gridSize - 2) * (gridSize - 1);
+	}
+
+	return numRows;
+}
+
+/**
+ * Build the stencils for the current topology,
+ * the base coordinates are restored afterwards but all other levels are overwritten.
+ *
+ * \param subdivide_fn: Evaluates all levels from the base data.
+ * \return NULL when the mesh isn't supported or there isn't enough memory for the table.
+ */
+CCGStencilTable *ccgSubSurf__stencils_build(
+        CCGSubSurf *ss,
+        CCGVert **verts, CCGEdge **edges, CCGFace **faces,
+        int numVerts, int numEdges, int numFaces,
+        void (*subdivide_fn)(CCGSubSurf *ss,
+                             CCGVert **verts, CCGEdge **edges, CCGFace **faces,
+                             int numVerts, int numEdges, int numFaces))
+{
+	const int numLayers = ss->meshIFC.numLayers;
+	const int vertDataSize = ss->meshIFC.vertDataSize;
+	CCGStencilTable *stencils = NULL;
+	StencilBuild sb = {NULL};
+	StencilProbeData probe;
+	GHash *vert_index;
+	float *base_data;
+	int *color_vert;
+	size_t numRows, e;
+	int i, color_first;
+	bool ok = true;
+
+	for (i = 0; i < numVerts; i++) {
+		/* seams depend on data, not only topology */
+		if (verts[i]->flags & Vert_eSeam) {
+			return NULL;
+		}
+	}
+
+	/* rows are int indices while building */
+	numRows = stencil_count_rows(ss, faces, numVerts, numEdges, numFaces);
+	if (numVerts == 0 || numRows > INT_MAX) {
+		return NULL;
+	}
+
+	sb.ss = ss;
+	sb.numVerts = numVerts;
+	sb.verts = verts;
+
+	vert_index = BLI_ghash_ptr_new_ex(__func__, (unsigned int)numVerts);
+	for (i = 0; i < numVerts; i++) {
+		BLI_ghash_insert(vert_index, verts[i], SET_INT_IN_POINTER(i));
+	}
+
+	stencil_build_neighbors(&sb, vert_index);
+	stencil_build_colors(&sb);
+
+	/* rows mostly depend on the neighbors of their element's vertices,
+	 * start from the average neighborhood size and grow as needed */
+	sb.allocEntries = numRows * (size_t)max_ii(sb.nbrOffset[numVerts] / numVerts, 1);
+	sb.entries = MEM_mallocN(sizeof(*sb.entries) * sb.allocEntries, __func__);
+	ok = (sb.entries != NULL);
+
+	/* keep the base data, impulses are written in its place */
+	base_data = MEM_mallocN(sizeof(*base_data) * (size_t)(numVerts * numLayers), __func__);
+	for (i = 0; i < numVerts; i++) {
+		memcpy(&base_data[i * numLayers], ccg_vert_getCo(verts[i], 0, vertDataSize), sizeof(float) * (size_t)numLayers);
+	}
+
+	color_vert = MEM_mallocN(sizeof(*color_vert) * (size_t)numLayers, __func__);
+
+	/* one impulse per layer, subdivide and read back the influence of each color */
+	probe.sb = &sb;
+	probe.vert_index = vert_index;
+	probe.color_vert = color_vert;
+	probe.ok = true;
+
+	for (color_first = 0; ok && (color_first < sb.numColors); color_first += numLayers) {
+		for (i = 0; i < numVerts; i++) {
+			float *co = ccg_vert_getCo(verts[i], 0, vertDataSize);
+			const int col = sb.color[i] - color_first;
+			int l;
+			for (l = 0; l < numLayers; l++) {
+				co[l] = (col == l) ? 1.0f : 0.0f;
+			}
+		}
+
+		subdivide_fn(ss, verts, edges, faces, numVerts, numEdges, numFaces);
+
+		probe.color_first = color_first;
+		stencil_rows_foreach(ss, verts, edges, faces, numVerts, numEdges, numFaces, stencil_probe_row_cb, &probe);
+		ok = probe.ok;
+	}
+
+	for (i = 0; i < numVerts; i++) {
+		memcpy(ccg_vert_getCo(verts[i], 0, vertDataSize), &base_data[i * numLayers], sizeof(float) * (size_t)numLayers);
+	}
+
+	if (ok) {
+		stencils = MEM_callocN(sizeof(*stencils), __func__);
+		stencils->numRows = (int)numRows;
+		stencils->numCols = numVerts;
+		stencils->rowData = MEM_mallocN(sizeof(*stencils->rowData) * numRows, __func__);
+		stencils->rowOffset = MEM_callocN(sizeof(*stencils->rowOffset) * (numRows + 1), __func__);
+		stencils->colIndex = MEM_mallocN(sizeof(*stencils->colIndex) * sb.numEntries, __func__);
+		stencils->weights = MEM_mallocN(sizeof(*stencils->weights) * sb.numEntries, __func__);
+		stencils->colVerts = MEM_mallocN(sizeof(*stencils->colVerts) * (size_t)numVerts, __func__);
+		memcpy(stencils->colVerts, verts, sizeof(*verts) * (size_t)numVerts);
+
+		stencil_rows_foreach(ss, verts, edges, faces, numVerts, numEdges, numFaces, stencil_row_data_cb, stencils);
+
+		/* entries are in order of colors, sort them into rows */
+		for (e = 0; e < sb.numEntries; e++) {
+			stencils->rowOffset[sb.entries[e].row + 1]++;
+		}
+		for (i = 0; i < stencils->numRows; i++) {
+			stencils->rowOffset[i + 1] += stencils->rowOffset[i];
+		}
+		{
+			size_t *fill = MEM_mallocN(sizeof(*fill) * numRows, __func__);
+			memcpy(fill, stencils->rowOffset, sizeof(*fill) * numRows);
+			for (e = 0; e < sb.numEntries; e++) {
+				const size_t dst = fill[sb.entries[e].row]++;
+				stencils->colIndex[dst] = sb.entries[e].col;
+				stencils->weights[dst] = sb.entries[e].weight;
+			}
+			MEM_freeN(fill);
+		}
+	}
+
+	MEM_freeN(color_vert);
+	MEM_freeN(base_data);
+	if (sb.entries) {
+		MEM_freeN(sb.entries);
+	}
+	MEM_freeN(sb.color);
+	MEM_freeN(sb.nbrOffset);
+	MEM_freeN(sb.nbrIndex);
+	BLI_ghash_free(vert_index, NULL, NULL);
+
+	return stencils;
+}
+
+/**
+ * Write all computed points of the final level from the base coordinates,
+ * points shared between elements still need to be copied afterwards.
+ */
+void ccgSubSurf__stencils_evaluate(CCGSubSurf *ss, const CCGStencilTable *stencils)
+{
+	const int numLayers = ss->meshIFC.numLayers;
+	const int vertDataSize = ss->meshIFC.vertDataSize;
+	const int numCols = stencils->numCols;
+	float *base_co;
+	int i;
+
+	/* gather base coordinates, one array per layer */
+	base_co = MEM_mallocN(sizeof(*base_co) * (size_t)(numCols * numLayers), __func__);
+	for (i = 0; i < numCols; i++) {
+		const float *co = ccg_vert_getCo(stencils->colVerts[i], 0, vertDataSize);
+		int l;
+		for (l = 0; l < numLayers; l++) {
+			base_co[l * numCols + i] = co[l];
+		}
+	}
+
+#pragma omp parallel for schedule(static) if (stencils->numRows >= CCG_OMP_LIMIT / 16)
+	for (i = 0; i < stencils->numRows; i++) {
+		const int *col = &stencils->colIndex[stencils->rowOffset[i]];
+		const float *weight = &stencils->weights[stencils->rowOffset[i]];
+		const int col_len = (int)(stencils->rowOffset[i + 1] - stencils->rowOffset[i]);
+		float *co = stencils->rowData[i];
+		int j, l;
+
+		if (numLayers == 3) {
+			const float *base_x = base_co, *base_y = &base_co[numCols], *base_z = &base_co[numCols * 2];
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			for (j = 0; j < col_len; j++) {
+				x += weight[j] * base_x[col[j]];
+				y += weight[j] * base_y[col[j]];
+				z += weight[j] * base_z[col[j]];
+			}
+			co[0] = x;
+			co[1] = y;
+			co[2] = z;
+		}
+		else {
+			for (l = 0; l < numLayers; l++) {
+				const float *base_l = &base_co[l * numCols];
+				float sum = 0.0f;
+				for (j = 0; j < col_len; j++) {
+					sum += weight[j] * base_l[col[j]];
+				}
+				co[l] = sum;
+			}
+		}
+	}
+
+	MEM_freeN(base_co);
+}
+
+void ccgSubSurf__stencils_free(CCGStencilTable *stencils)
+{
+	MEM_freeN(stencils->rowData);
+	MEM_freeN(stencils->rowOffset);
+	MEM_freeN(stencils->colIndex);
+	MEM_freeN(stencils->weights);
+	MEM_freeN(stencils->colVerts);
+	MEM_freeN(stencils);
+}
+
+/* Drop the stencils so they're built again on the next sync. */
+void ccgSubSurf__stencils_invalidate(CCGSubSurf *ss)
+{
+	if (ss->stencils) {
+		ccgSubSurf__stencils_free(ss->stencils);
+		ss->stencils = NULL;
+	}
+	ss->stencilBuildFailed = 0;
+}
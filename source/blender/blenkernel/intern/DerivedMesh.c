@@ -35,11 +35,14 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
 #include "DNA_cloth_types.h"
 #include "DNA_key_types.h"
 #include "DNA_material_types.h"
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
@@ -48,6 +51,9 @@
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_threads.h"
 
 #include "BKE_cdderivedmesh.h"
 #include "BKE_editmesh.h"
@@ -61,6 +67,8 @@
 #include "BKE_paint.h"
 #include "BKE_texture.h"
 #include "BKE_multires.h"
+#include "BKE_scene.h"
+#include "BKE_subsurf.h"
 #include "BKE_bvhutils.h"
 #include "BKE_deform.h"
 #include "BKE_global.h" /* For debug flag, DM_update_tessface_data() func. */
@@ -1258,6 +1266,10 @@ static void add_orco_dm(
 			DM_add_vert_layer(dm, layer, CD_CALLOC, NULL);
 			layerorco = DM_get_vert_data_layer(dm, layer);
 		}
+		else {
+			/* the layer may be shared with another derived mesh */
+			layerorco = CustomData_duplicate_referenced_layer(&dm->vertData, layer, totvert);
+		}
 
 		memcpy(layerorco, orco, sizeof(float) * 3 * totvert);
 		if (free) MEM_freeN(orco);
@@ -1687,6 +1699,495 @@ static void dm_ensure_display_normals(DerivedMesh *dm)
 	}
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Modifier Stack Result Cache
+ *
+ * Intermediate results of the modifier stack are kept in a global cache so
+ * re-evaluating an object whose upstream inputs didn't change (scrubbing back
+ * to a frame, tweaking the last modifier of a stack) can skip the modifiers
+ * that would produce the same result again.
+ *
+ * Entries are content addressed: the key of a result is a hash chained from
+ * the base mesh data through the settings of every modifier applied since,
+ * so objects sharing the same data share entries too.
+ * Only constructive modifiers which don't reference other data-blocks are
+ * cached, anything else ends caching for the remainder of the stack. So do
+ * deformed coordinates and animated or time dependent modifiers, results
+ * depending on those are unlikely to be asked for again.
+ *
+ * The memory budget is set from the user preferences, see
+ * #DM_modifier_cache_set_limit, least recently used entries go first.
+ * \{ */
+
+typedef struct ModifierCacheKey {
+	unsigned int hash[2];
+} ModifierCacheKey;
+
+typedef struct ModifierCacheEntry {
+	struct ModifierCacheEntry *next, *prev;
+
+	ModifierCacheKey key;
+	DerivedMesh *dm;
+	size_t mem_size;
+	/* entries being copied out of the cache can't be evicted */
+	int users;
+} ModifierCacheEntry;
+
+static struct {
+	GHash *entries;
+	ListBase lru;  /* most recently used first */
+	size_t mem_size;
+	size_t mem_limit;  /* zero disables the cache */
+} modifier_cache = {NULL};
+
+static ThreadMutex modifier_cache_lock = BLI_MUTEX_INITIALIZER;
+
+/* Two independently seeded hashes make up the 64 bit key. */
+typedef struct ModifierCacheHash {
+	BLI_HashMurmur2A mm2[2];
+} ModifierCacheHash;
+
+static void modifier_cache_hash_init(ModifierCacheHash *h, const ModifierCacheKey *parent)
+{
+	BLI_hash_mm2a_init(&h->mm2[0], parent ? parent->hash[0] : 0x1f351b2cu);
+	BLI_hash_mm2a_init(&h->mm2[1], parent ? parent->hash[1] : 0x7e94a6d3u);
+}
+
+static void modifier_cache_hash_add(ModifierCacheHash *h, const void *data, size_t len)
+{
+	BLI_hash_mm2a_add(&h->mm2[0], data, len);
+	BLI_hash_mm2a_add(&h->mm2[1], data, len);
+}
+
+static void modifier_cache_hash_add_int(ModifierCacheHash *h, int data)
+{
+	BLI_hash_mm2a_add_int(&h->mm2[0], data);
+	BLI_hash_mm2a_add_int(&h->mm2[1], data);
+}
+
+static void modifier_cache_hash_add_str(ModifierCacheHash *h, const char *str)
+{
+	modifier_cache_hash_add(h, str, strlen(str));
+}
+
+static void modifier_cache_hash_end(ModifierCacheHash *h, ModifierCacheKey *r_key)
+{
+	r_key->hash[0] = BLI_hash_mm2a_end(&h->mm2[0]);
+	r_key->hash[1] = BLI_hash_mm2a_end(&h->mm2[1]);
+}
+
+static void modifier_cache_hash_customdata(
+        ModifierCacheHash *h, const CustomData *data, int totelem, CustomDataMask mask)
+{
+	int i, j;
+
+	modifier_cache_hash_add_int(h, totelem);
+
+	for (i = 0; i < data->totlayer; i++) {
+		const CustomDataLayer *layer = &data->layers[i];
+
+		if (!(CD_TYPE_AS_MASK(layer->type) & mask)) {
+			continue;
+		}
+
+		modifier_cache_hash_add_int(h, layer->type);
+		modifier_cache_hash_add_str(h, layer->name);
+
+		if (layer->data == NULL) {
+			continue;
+		}
+
+		/* layers referencing their own allocations need their contents hashed */
+		switch (layer->type) {
+			case CD_MDEFORMVERT:
+			{
+				const MDeformVert *dvert = layer->data;
+				for (j = 0; j < totelem; j++, dvert++) {
+					modifier_cache_hash_add_int(h, dvert->totweight);
+					if (dvert->dw) {
+						modifier_cache_hash_add(h, dvert->dw, sizeof(*dvert->dw) * dvert->totweight);
+					}
+				}
+				break;
+			}
+			default:
+				modifier_cache_hash_add(h, layer->data, (size_t)CustomData_sizeof(layer->type) * totelem);
+				break;
+		}
+	}
+}
+
+/**
+ * Key of the mesh the stack starts from.
+ *
+ * Only layers which can end up in a cached result are hashed, that is the ones
+ * kept by #CDDM_copy_shared. For vertices, edges and faces these are further
+ * limited to the layers the modifier stack asks for with \a mask, since
+ * #DM_set_only_copy drops the others.
+ */
+static void modifier_cache_key_from_mesh(
+        Scene *scene, Object *ob, Mesh *me,
+        const bool useRenderParams, const int useDeform, const bool need_mapping,
+        CustomDataMask dataMask, CustomDataMask mask, ModifierApplyFlag app_flags,
+        ModifierCacheKey *r_key)
+{
+	const CustomDataMask geom_mask = (CD_MASK_MVERT | CD_MASK_MEDGE | CD_MASK_MFACE |
+	                                  CD_MASK_MLOOP | CD_MASK_MPOLY);
+	const CustomDataMask elem_mask = (mask & CD_MASK_DERIVEDMESH) | geom_mask;
+	const CustomDataMask corner_mask = CD_MASK_DERIVEDMESH | geom_mask;
+	ModifierCacheHash h;
+	bDeformGroup *dg;
+
+	modifier_cache_hash_init(&h, NULL);
+
+	modifier_cache_hash_customdata(&h, &me->vdata, me->totvert, elem_mask);
+	modifier_cache_hash_customdata(&h, &me->edata, me->totedge, elem_mask);
+	modifier_cache_hash_customdata(&h, &me->fdata, me->totface, elem_mask);
+	modifier_cache_hash_customdata(&h, &me->ldata, me->totloop, corner_mask);
+	modifier_cache_hash_customdata(&h, &me->pdata, me->totpoly, corner_mask);
+	modifier_cache_hash_add_int(&h, me->cd_flag);
+
+	/* modifiers look up vertex groups and materials through the object */
+	for (dg = ob->defbase.first; dg; dg = dg->next) {
+		modifier_cache_hash_add_str(&h, dg->name);
+	}
+	modifier_cache_hash_add_int(&h, ob->totcol);
+
+	modifier_cache_hash_add_int(&h, useRenderParams);
+	modifier_cache_hash_add_int(&h, useDeform);
+	modifier_cache_hash_add_int(&h, need_mapping);
+	modifier_cache_hash_add(&h, &dataMask, sizeof(dataMask));
+	modifier_cache_hash_add_int(&h, app_flags);
+
+	/* levels of some modifiers depend on scene simplification */
+	modifier_cache_hash_add_int(&h, scene->r.mode & R_SIMPLIFY);
+	modifier_cache_hash_add_int(&h, scene->r.simplify_subsurf);
+	modifier_cache_hash_add_int(&h, scene->r.simplify_subsurf_render);
+
+	modifier_cache_hash_end(&h, r_key);
+}
+
+/**
+ * Key of the result of applying \a md to the result identified by \a key.
+ */
+static void modifier_cache_key_chain(
+        ModifierData *md, CustomDataMask mask, CustomDataMask nextmask, ModifierCacheKey *key)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	size_t settings_end = (size_t)mti->structSize;
+	ModifierCacheHash h;
+
+	/* leave out runtime data stored with the settings */
+	switch (md->type) {
+		case eModifierType_Decimate:
+			settings_end = offsetof(DecimateModifierData, face_count);
+			break;
+	}
+
+	modifier_cache_hash_init(&h, key);
+
+	modifier_cache_hash_add_int(&h, md->type);
+	modifier_cache_hash_add(&h, (const char *)md + sizeof(ModifierData), settings_end - sizeof(ModifierData));
+	modifier_cache_hash_add(&h, &mask, sizeof(mask));
+	modifier_cache_hash_add(&h, &nextmask, sizeof(nextmask));
+
+	modifier_cache_hash_end(&h, key);
+}
+
+/**
+ * Whether any setting of \a md is animated or driven, a key hashed from its
+ * current values would hardly ever be looked up again.
+ */
+static bool modifier_cache_is_animated(Object *ob, ModifierData *md)
+{
+	AnimData *adt = ob->adt;
+	char name_esc[sizeof(md->name) * 2];
+	char path[sizeof(name_esc) + 16];
+	size_t path_len;
+	FCurve *fcu;
+
+	if (adt == NULL) {
+		return false;
+	}
+
+	/* not worth resolving what strips animate, assume the worst */
+	if (adt->nla_tracks.first) {
+		return true;
+	}
+
+	BLI_strescape(name_esc, md->name, sizeof(name_esc));
+	path_len = BLI_snprintf(path, sizeof(path), "modifiers[\"%s\"]", name_esc);
+
+	if (adt->action) {
+		for (fcu = adt->action->curves.first; fcu; fcu = fcu->next) {
+			if (fcu->rna_path && STREQLEN(fcu->rna_path, path, path_len)) {
+				return true;
+			}
+		}
+	}
+
+	for (fcu = adt->drivers.first; fcu; fcu = fcu->next) {
+		if (fcu->rna_path && STREQLEN(fcu->rna_path, path, path_len)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void modifier_cache_id_walk(void *userData, Object *UNUSED(ob), ID **idpoin)
+{
+	if (*idpoin) {
+		*((bool *)userData) = true;
+	}
+}
+
+static void modifier_cache_object_walk(void *userData, Object *UNUSED(ob), Object **obpoin)
+{
+	if (*obpoin) {
+		*((bool *)userData) = true;
+	}
+}
+
+/**
+ * Whether the result of \a md only depends on its input and own settings.
+ */
+static bool modifier_cache_supported(Object *ob, ModifierData *md)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	bool has_links = false;
+
+	/* Subsurf isn't cached, its CCGDM result would have to be converted to a
+	 * CDDM for the cache which costs about as much as subdividing again. */
+	switch (md->type) {
+		case eModifierType_Mirror:
+		case eModifierType_Array:
+		case eModifierType_Solidify:
+		case eModifierType_Bevel:
+		case eModifierType_Decimate:
+		case eModifierType_EdgeSplit:
+		case eModifierType_Triangulate:
+		case eModifierType_Remesh:
+		case eModifierType_Skin:
+		case eModifierType_Wireframe:
+		case eModifierType_Screw:
+		case eModifierType_Build:
+		case eModifierType_Mask:
+			break;
+		default:
+			return false;
+	}
+
+	if (mti->foreachIDLink) {
+		mti->foreachIDLink(md, ob, modifier_cache_id_walk, &has_links);
+	}
+	else if (mti->foreachObjectLink) {
+		mti->foreachObjectLink(md, ob, modifier_cache_object_walk, &has_links);
+	}
+
+	return !has_links;
+}
+
+static unsigned int modifier_cache_key_hash(const void *key)
+{
+	return ((const ModifierCacheKey *)key)->hash[0];
+}
+
+static bool modifier_cache_key_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, sizeof(ModifierCacheKey)) != 0;
+}
+
+static size_t customdata_mem_size(const CustomData *data, int totelem)
+{
+	size_t mem_size = 0;
+	int i;
+
+	for (i = 0; i < data->totlayer; i++) {
+		mem_size += (size_t)CustomData_sizeof(data->layers[i].type) * totelem;
+	}
+
+	return mem_size;
+}
+
+/* true when a layer points to data owned elsewhere, e.g. by the Mesh */
+static bool customdata_has_referenced_layers(const CustomData *data)
+{
+	int i;
+
+	for (i = 0; i < data->totlayer; i++) {
+		if ((data->layers[i].flag & (CD_FLAG_NOFREE | CD_FLAG_SHARED)) == CD_FLAG_NOFREE) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void modifier_cache_entry_free(ModifierCacheEntry *entry)
+{
+	BLI_ghash_remove(modifier_cache.entries, &entry->key, NULL, NULL);
+	BLI_remlink(&modifier_cache.lru, entry);
+	modifier_cache.mem_size -= entry->mem_size;
+
+	entry->dm->release(entry->dm);
+	MEM_freeN(entry);
+}
+
+/**
+ * Find the cached result for \a key, the entry stays valid until
+ * #modifier_cache_release is called.
+ */
+static ModifierCacheEntry *modifier_cache_acquire(const ModifierCacheKey *key)
+{
+	ModifierCacheEntry *entry = NULL;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+
+	if (modifier_cache.entries) {
+		entry = BLI_ghash_lookup(modifier_cache.entries, key);
+		if (entry) {
+			entry->users++;
+			BLI_remlink(&modifier_cache.lru, entry);
+			BLI_addhead(&modifier_cache.lru, entry);
+		}
+	}
+
+	BLI_mutex_unlock(&modifier_cache_lock);
+
+	return entry;
+}
+
+static void modifier_cache_release(ModifierCacheEntry *entry)
+{
+	BLI_mutex_lock(&modifier_cache_lock);
+	entry->users--;
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+/**
+ * Copy of the cached result, the copy itself is made outside of the lock
+ * since only the users count of the entry is touched concurrently.
+ * Layers are shared with the cached result until written to.
+ */
+static DerivedMesh *modifier_cache_copy_and_release(ModifierCacheEntry *entry)
+{
+	DerivedMesh *dm = CDDM_copy_shared(entry->dm);
+
+	modifier_cache_release(entry);
+
+	return dm;
+}
+
+/* free least recently used entries until the cache fits its budget */
+static void modifier_cache_evict_locked(void)
+{
+	ModifierCacheEntry *entry, *entry_prev;
+
+	for (entry = modifier_cache.lru.last;
+	     entry && modifier_cache.mem_size > modifier_cache.mem_limit;
+	     entry = entry_prev)
+	{
+		entry_prev = entry->prev;
+		if (entry->users == 0) {
+			modifier_cache_entry_free(entry);
+		}
+	}
+}
+
+static void modifier_cache_store(const ModifierCacheKey *key, DerivedMesh *dm)
+{
+	ModifierCacheEntry *entry;
+	DerivedMesh *cache_dm;
+	size_t mem_size;
+
+	mem_size = customdata_mem_size(&dm->vertData, dm->getNumVerts(dm)) +
+	           customdata_mem_size(&dm->edgeData, dm->getNumEdges(dm)) +
+	           customdata_mem_size(&dm->faceData, dm->getNumTessFaces(dm)) +
+	           customdata_mem_size(&dm->loopData, dm->getNumLoops(dm)) +
+	           customdata_mem_size(&dm->polyData, dm->getNumPolys(dm));
+
+	if (mem_size > modifier_cache.mem_limit / 4) {
+		return;
+	}
+
+	/* the Mesh may be freed and rebuilt with the same data (edit-mode toggle, undo)
+	 * while the entry is kept, so it must not reference any of its arrays */
+	cache_dm = CDDM_copy_shared(dm);
+
+	if (customdata_has_referenced_layers(&cache_dm->vertData) ||
+	    customdata_has_referenced_layers(&cache_dm->edgeData) ||
+	    customdata_has_referenced_layers(&cache_dm->faceData) ||
+	    customdata_has_referenced_layers(&cache_dm->loopData) ||
+	    customdata_has_referenced_layers(&cache_dm->polyData))
+	{
+		BLI_assert(0);
+		cache_dm->release(cache_dm);
+		return;
+	}
+
+	entry = MEM_callocN(sizeof(*entry), __func__);
+	entry->key = *key;
+	entry->dm = cache_dm;
+	entry->mem_size = mem_size;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+
+	if (modifier_cache.entries == NULL) {
+		modifier_cache.entries = BLI_ghash_new(modifier_cache_key_hash, modifier_cache_key_cmp, __func__);
+	}
+
+	if (BLI_ghash_haskey(modifier_cache.entries, key)) {
+		/* another thread evaluated the same data */
+		BLI_mutex_unlock(&modifier_cache_lock);
+		cache_dm->release(cache_dm);
+		MEM_freeN(entry);
+		return;
+	}
+
+	BLI_ghash_insert(modifier_cache.entries, &entry->key, entry);
+	BLI_addhead(&modifier_cache.lru, entry);
+	modifier_cache.mem_size += mem_size;
+
+	modifier_cache_evict_locked();
+
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+/**
+ * Set the memory budget of the modifier result cache in bytes, zero disables it.
+ */
+void DM_modifier_cache_set_limit(size_t mem_limit)
+{
+	BLI_mutex_lock(&modifier_cache_lock);
+	modifier_cache.mem_limit = mem_limit;
+	modifier_cache_evict_locked();
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+void DM_modifier_cache_clear(void)
+{
+	ModifierCacheEntry *entry, *entry_next;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+
+	for (entry = modifier_cache.lru.first; entry; entry = entry_next) {
+		entry_next = entry->next;
+		if (entry->users == 0) {
+			modifier_cache_entry_free(entry);
+		}
+	}
+
+	if (modifier_cache.entries && BLI_listbase_is_empty(&modifier_cache.lru)) {
+		BLI_ghash_free(modifier_cache.entries, NULL, NULL);
+		modifier_cache.entries = NULL;
+	}
+
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+/** \} */
+
 /**
  * new value for useDeform -1  (hack for the gameengine):
  *
@@ -1739,6 +2240,10 @@ static void mesh_calc_modifiers(
 	ModifierApplyFlag app_flags = useRenderParams ? MOD_APPLY_RENDER : 0;
 	ModifierApplyFlag deform_app_flags = app_flags;
 
+	/* modifier stack result cache, the key identifies the current result */
+	bool use_mod_cache;
+	ModifierCacheKey mod_cache_key;
+	ModifierCacheEntry *mod_cache_pending = NULL;
 
 	if (useCache)
 		app_flags |= MOD_APPLY_USECACHE;
@@ -1777,6 +2282,19 @@ static void mesh_calc_modifiers(
 	}
 
 	datamasks = modifiers_calcDataMasks(scene, ob, md, dataMask, required_mode, previewmd, previewmask);
+
+	/* orco layers are built by applying the stack a second time, they aren't cached,
+	 * neither are weight previews */
+	use_mod_cache = ((modifier_cache.mem_limit != 0) &&
+	                 (index == -1) && !sculpt_mode && !do_mod_wmcol && !build_shapekey_layers &&
+	                 !(dataMask & (CD_MASK_ORCO | CD_MASK_CLOTH_ORCO)) &&
+	                 !(me->adt && (me->adt->action || me->adt->drivers.first)));
+	for (curr = datamasks; curr && use_mod_cache; curr = curr->next) {
+		if (curr->mask & (CD_MASK_ORCO | CD_MASK_CLOTH_ORCO)) {
+			use_mod_cache = false;
+		}
+	}
+
 	curr = datamasks;
 
 	if (r_deform) {
@@ -1850,6 +2368,7 @@ static void mesh_calc_modifiers(
 
 	for (; md; md = md->next, curr = curr->next) {
 		const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+		bool mod_cache_step;
 
 		md->scene = scene;
 
@@ -1861,7 +2380,7 @@ static void mesh_calc_modifiers(
 			continue;
 		}
 
-		if ((mti->flags & eModifierTypeFlag_RequiresOriginalData) && dm) {
+		if ((mti->flags & eModifierTypeFlag_RequiresOriginalData) && (dm || mod_cache_pending)) {
 			modifier_setError(md, "Modifier requires original data, bad stack position");
 			continue;
 		}
@@ -1906,6 +2425,27 @@ static void mesh_calc_modifiers(
 			continue;
 		}
 
+		if (use_mod_cache && (mti->type != eModifierTypeType_OnlyDeform)) {
+			/* Deformed coordinates (unless these are just the ones of the mesh) and animated
+			 * settings change from one evaluation to the next, stop caching from here on. */
+			if ((deformedVerts && (useDeform || inputVertexCos)) ||
+			    (mti->dependsOnTime && mti->dependsOnTime(md)) ||
+			    modifier_cache_is_animated(ob, md))
+			{
+				use_mod_cache = false;
+			}
+		}
+
+		mod_cache_step = (use_mod_cache &&
+		                  (mti->type != eModifierTypeType_OnlyDeform) &&
+		                  modifier_cache_supported(ob, md));
+
+		/* a cached result is only copied once a modifier needs it as input */
+		if (mod_cache_pending && !mod_cache_step) {
+			dm = modifier_cache_copy_and_release(mod_cache_pending);
+			mod_cache_pending = NULL;
+		}
+
 		/* add an orco layer if needed by this modifier */
 		if (mti->requiredDataMask)
 			mask = mti->requiredDataMask(ob, md);
@@ -1958,10 +2498,54 @@ static void mesh_calc_modifiers(
 			else
 				nextmask = dataMask;
 
+			if (mod_cache_step) {
+				ModifierCacheEntry *entry;
+
+				if (!dm && !mod_cache_pending) {
+					modifier_cache_key_from_mesh(
+					        scene, ob, me,
+					        useRenderParams, useDeform, need_mapping, dataMask, curr->mask | append_mask, app_flags,
+					        &mod_cache_key);
+				}
+				modifier_cache_key_chain(md, curr->mask | append_mask, nextmask, &mod_cache_key);
+
+				entry = modifier_cache_acquire(&mod_cache_key);
+
+				if (entry) {
+					/* skip the modifier, the cached result replaces everything so far */
+					if (mod_cache_pending) {
+						modifier_cache_release(mod_cache_pending);
+					}
+					mod_cache_pending = entry;
+
+					if (dm) {
+						dm->release(dm);
+						dm = NULL;
+					}
+					if (deformedVerts) {
+						if (deformedVerts != inputVertexCos)
+							MEM_freeN(deformedVerts);
+
+						deformedVerts = NULL;
+					}
+
+					isPrevDeform = false;
+					continue;
+				}
+				else if (mod_cache_pending) {
+					dm = modifier_cache_copy_and_release(mod_cache_pending);
+					mod_cache_pending = NULL;
+				}
+			}
+			else {
+				/* the result of this modifier can't be keyed, neither can anything after it */
+				use_mod_cache = false;
+			}
+
 			/* apply vertex coordinates or build a DerivedMesh as necessary */
 			if (dm) {
 				if (deformedVerts) {
-					DerivedMesh *tdm = CDDM_copy(dm);
+					DerivedMesh *tdm = CDDM_copy_shared(dm);
 					dm->release(dm);
 					dm = tdm;
 
@@ -2044,6 +2628,10 @@ static void mesh_calc_modifiers(
 				}
 			}
 
+			if (mod_cache_step) {
+				modifier_cache_store(&mod_cache_key, dm);
+			}
+
 			/* create an orco derivedmesh in parallel */
 			if (nextmask & CD_MASK_ORCO) {
 				if (!orcodm)
@@ -2106,6 +2694,11 @@ static void mesh_calc_modifiers(
 		}
 	}
 
+	if (mod_cache_pending) {
+		dm = modifier_cache_copy_and_release(mod_cache_pending);
+		mod_cache_pending = NULL;
+	}
+
 	for (md = firstmd; md; md = md->next)
 		modifier_freeTemporaryData(md);
 
@@ -2114,7 +2707,7 @@ static void mesh_calc_modifiers(
 	 * DerivedMesh then we need to build one.
 	 */
 	if (dm && deformedVerts) {
-		finaldm = CDDM_copy(dm);
+		finaldm = CDDM_copy_shared(dm);
 
 		dm->release(dm);
 
@@ -2349,7 +2942,7 @@ static void editbmesh_calc_modifiers(
 			/* apply vertex coordinates or build a DerivedMesh as necessary */
 			if (dm) {
 				if (deformedVerts) {
-					DerivedMesh *tdm = CDDM_copy(dm);
+					DerivedMesh *tdm = CDDM_copy_shared(dm);
 					if (!(r_cage && dm == *r_cage)) {
 						dm->release(dm);
 					}
@@ -2440,7 +3033,7 @@ static void editbmesh_calc_modifiers(
 
 		if (r_cage && i == cageIndex) {
 			if (dm && deformedVerts) {
-				*r_cage = CDDM_copy(dm);
+				*r_cage = CDDM_copy_shared(dm);
 				CDDM_apply_vert_coords(*r_cage, deformedVerts);
 			}
 			else if (dm) {
@@ -2461,7 +3054,7 @@ static void editbmesh_calc_modifiers(
 	 * then we need to build one.
 	 */
 	if (dm && deformedVerts) {
-		*r_final = CDDM_copy(dm);
+		*r_final = CDDM_copy_shared(dm);
 
 		if (!(r_cage && dm == *r_cage)) {
 			dm->release(dm);
@@ -66,6 +66,7 @@
 #include "BKE_bpath.h"
 #include "BKE_brush.h"
 #include "BKE_context.h"
+#include "BKE_DerivedMesh.h"
 #include "BKE_depsgraph.h"
 #include "BKE_global.h"
 #include "BKE_idprop.h"
@@ -127,6 +128,7 @@ void free_blender(void)
 
 	BKE_sequencer_cache_destruct();
 	IMB_moviecache_destruct();
+	DM_modifier_cache_clear();
 	
 	free_nodesystem();
 }
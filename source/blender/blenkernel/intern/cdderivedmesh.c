@@ -2416,6 +2416,42 @@ DerivedMesh *CDDM_copy_from_tessface(DerivedMesh *source)
 	return cddm_copy_ex(source, 1);
 }
 
+DerivedMesh *CDDM_copy_shared(DerivedMesh *source)
+{
+	CDDerivedMesh *cddm;
+	DerivedMesh *dm;
+	const CustomDataMask mask = CD_MASK_DERIVEDMESH | CD_MASK_MVERT | CD_MASK_MEDGE | CD_MASK_MFACE |
+	                            CD_MASK_MLOOP | CD_MASK_MPOLY;
+
+	/* other types don't store all their data in layers */
+	if (source->type != DM_TYPE_CDDM) {
+		return cddm_copy_ex(source, 0);
+	}
+
+	cddm = cdDM_create(__func__);
+	dm = &cddm->dm;
+
+	DM_init(dm, DM_TYPE_CDDM, source->numVertData, source->numEdgeData, source->numTessFaceData,
+	        source->numLoopData, source->numPolyData);
+	dm->deformedOnly = source->deformedOnly;
+	dm->cd_flag = source->cd_flag;
+	dm->dirty = source->dirty;
+
+	CustomData_merge(&source->vertData, &dm->vertData, mask, CD_SHARE, dm->numVertData);
+	CustomData_merge(&source->edgeData, &dm->edgeData, mask, CD_SHARE, dm->numEdgeData);
+	CustomData_merge(&source->faceData, &dm->faceData, mask, CD_SHARE, dm->numTessFaceData);
+	CustomData_merge(&source->loopData, &dm->loopData, mask, CD_SHARE, dm->numLoopData);
+	CustomData_merge(&source->polyData, &dm->polyData, mask, CD_SHARE, dm->numPolyData);
+
+	cddm->mvert = CustomData_get_layer(&dm->vertData, CD_MVERT);
+	cddm->medge = CustomData_get_layer(&dm->edgeData, CD_MEDGE);
+	cddm->mface = CustomData_get_layer(&dm->faceData, CD_MFACE);
+	cddm->mloop = CustomData_get_layer(&dm->loopData, CD_MLOOP);
+	cddm->mpoly = CustomData_get_layer(&dm->polyData, CD_MPOLY);
+
+	return dm;
+}
+
 /* note, the CD_ORIGINDEX layers are all 0, so if there is a direct
  * relationship between mesh data this needs to be set by the caller. */
 DerivedMesh *CDDM_from_template(
@@ -2504,10 +2540,10 @@ void CDDM_calc_normals_mapping_ex(DerivedMesh *dm, const bool only_face_normals)
 	 * no need to duplicate verts.
 	 * WATCH THIS, bmesh only change!,
 	 * need to take care of the side effects here - campbell */
-#if 0
-	/* we don't want to overwrite any referenced layers */
-	cddm->mvert = CustomData_duplicate_referenced_layer(&dm->vertData, CD_MVERT, dm->numVertData);
-#endif
+	if (!only_face_normals) {
+		/* we don't want to overwrite any referenced layers (shared with another derived mesh) */
+		cddm->mvert = CustomData_duplicate_referenced_layer(&dm->vertData, CD_MVERT, dm->numVertData);
+	}
 
 #if 0
 	if (dm->numTessFaceData == 0) {
@@ -2597,7 +2633,7 @@ void CDDM_calc_loop_normals(DerivedMesh *dm, const bool use_split_normals, const
 void CDDM_calc_loop_normals_spacearr(
         DerivedMesh *dm, const bool use_split_normals, const float split_angle, MLoopNorSpaceArray *r_lnors_spacearr)
 {
-	MVert *mverts = dm->getVertArray(dm);
+	MVert *mverts;
 	MEdge *medges = dm->getEdgeArray(dm);
 	MLoop *mloops = dm->getLoopArray(dm);
 	MPoly *mpolys = dm->getPolyArray(dm);
@@ -2613,6 +2649,12 @@ void CDDM_calc_loop_normals_spacearr(
 	const int numLoops = dm->getNumLoops(dm);
 	const int numPolys = dm->getNumPolys(dm);
 
+	if ((dm->dirty & DM_DIRTY_NORMALS) && (dm->type == DM_TYPE_CDDM)) {
+		/* vertex normals are written below, we don't want to overwrite any referenced layers */
+		((CDDerivedMesh *)dm)->mvert = CustomData_duplicate_referenced_layer(&dm->vertData, CD_MVERT, numVerts);
+	}
+	mverts = dm->getVertArray(dm);
+
 	ldata = dm->getLoopDataLayout(dm);
 	if (CustomData_has_layer(ldata, CD_NORMAL)) {
 		lnors = CustomData_get_layer(ldata, CD_NORMAL);
@@ -39,6 +39,7 @@
 #include "BLI_math.h"
 #include "BLI_edgehash.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 
 #include "BKE_cdderivedmesh.h"
 #include "BKE_cloth.h"
@@ -212,47 +213,74 @@ static BVHTree *bvhtree_build_from_cloth (ClothModifierData *clmd, float epsilon
 	return bvhtree;
 }
 
+/* refitting is done in parallel when there are at least this many leaves */
+#define CLOTH_BVH_UPDATE_PARALLEL_THRESHOLD 1024
+
+typedef struct ClothBVHUpdateData {
+	BVHTree *bvhtree;
+	const ClothVertex *verts;
+	const MVertTri *tri;
+	bool moving;
+} ClothBVHUpdateData;
+
+static void bvhtree_update_from_cloth_task(void *userdata, int i)
+{
+	const ClothBVHUpdateData *data = userdata;
+	const ClothVertex *verts = data->verts;
+	const MVertTri *vt = &data->tri[i];
+	float co[3][3], co_moving[3][3];
+
+	copy_v3_v3(co[0], verts[vt->tri[0]].txold);
+	copy_v3_v3(co[1], verts[vt->tri[1]].txold);
+	copy_v3_v3(co[2], verts[vt->tri[2]].txold);
+
+	/* copy new locations into array */
+	if (data->moving) {
+		/* update moving positions */
+		copy_v3_v3(co_moving[0], verts[vt->tri[0]].tx);
+		copy_v3_v3(co_moving[1], verts[vt->tri[1]].tx);
+		copy_v3_v3(co_moving[2], verts[vt->tri[2]].tx);
+
+		BLI_bvhtree_update_node(data->bvhtree, i, co[0], co_moving[0], 3);
+	}
+	else {
+		BLI_bvhtree_update_node(data->bvhtree, i, co[0], NULL, 3);
+	}
+}
+
+static void bvhselftree_update_from_cloth_task(void *userdata, int i)
+{
+	const ClothBVHUpdateData *data = userdata;
+	const ClothVertex *vert = &data->verts[i];
+
+	/* copy new locations into array */
+	if (data->moving) {
+		/* update moving positions */
+		BLI_bvhtree_update_node(data->bvhtree, i, vert->txold, vert->tx, 1);
+	}
+	else {
+		BLI_bvhtree_update_node(data->bvhtree, i, vert->txold, NULL, 1);
+	}
+}
+
 void bvhtree_update_from_cloth(ClothModifierData *clmd, bool moving)
 {	
-	unsigned int i = 0;
 	Cloth *cloth = clmd->clothObject;
 	BVHTree *bvhtree = cloth->bvhtree;
-	ClothVertex *verts = cloth->verts;
-	const MVertTri *vt;
+	ClothBVHUpdateData data;
 	
 	if (!bvhtree)
 		return;
 	
-	vt = cloth->tri;
-	
-	/* update vertex position in bvh tree */
-	if (verts && vt) {
-		for (i = 0; i < cloth->tri_num; i++, vt++) {
-			float co[3][3], co_moving[3][3];
-			bool ret;
-
-			copy_v3_v3(co[0], verts[vt->tri[0]].txold);
-			copy_v3_v3(co[1], verts[vt->tri[1]].txold);
-			copy_v3_v3(co[2], verts[vt->tri[2]].txold);
-
-			/* copy new locations into array */
-			if (moving) {
-				/* update moving positions */
-				copy_v3_v3(co_moving[0], verts[vt->tri[0]].tx);
-				copy_v3_v3(co_moving[1], verts[vt->tri[1]].tx);
-				copy_v3_v3(co_moving[2], verts[vt->tri[2]].tx);
-
-				ret = BLI_bvhtree_update_node(bvhtree, i, co[0], co_moving[0], 3);
-			}
-			else {
-				ret = BLI_bvhtree_update_node(bvhtree, i, co[0], NULL, 3);
-			}
-			
-			/* check if tree is already full */
-			if (ret == false) {
-				break;
-			}
-		}
+	/* update vertex position in bvh tree, leaves are independent so they are refitted in parallel */
+	if (cloth->verts && cloth->tri) {
+		data.bvhtree = bvhtree;
+		data.verts = cloth->verts;
+		data.tri = cloth->tri;
+		data.moving = moving;
+
+		BLI_task_parallel_range_ex(0, (int)cloth->tri_num, &data, bvhtree_update_from_cloth_task,
+		                           CLOTH_BVH_UPDATE_PARALLEL_THRESHOLD, false);
 		
 		BLI_bvhtree_update_tree(bvhtree);
 	}
@@ -260,40 +288,22 @@ void bvhtree_update_from_cloth(ClothModifierData *clmd, bool moving)
 
 void bvhselftree_update_from_cloth(ClothModifierData *clmd, bool moving)
 {	
-	unsigned int i = 0;
 	Cloth *cloth = clmd->clothObject;
 	BVHTree *bvhtree = cloth->bvhselftree;
-	ClothVertex *verts = cloth->verts;
-	const MVertTri *vt;
+	ClothBVHUpdateData data;
 	
 	if (!bvhtree)
 		return;
 
-	vt = cloth->tri;
-
 	/* update vertex position in bvh tree */
-	if (verts && vt) {
-		for (i = 0; i < cloth->mvert_num; i++, verts++) {
-			const float *co, *co_moving;
-			bool ret;
-
-			co = verts->txold;
-
-			/* copy new locations into array */
-			if (moving) {
-				/* update moving positions */
-				co_moving = verts->tx;
-				ret = BLI_bvhtree_update_node(bvhtree, i, co, co_moving, 1);
-			}
-			else {
-				ret = BLI_bvhtree_update_node(bvhtree, i, co, NULL, 1);
-			}
-
-			/* check if tree is already full */
-			if (ret == false) {
-				break;
-			}
-		}
+	if (cloth->verts && cloth->tri) {
+		data.bvhtree = bvhtree;
+		data.verts = cloth->verts;
+		data.tri = cloth->tri;
+		data.moving = moving;
+
+		BLI_task_parallel_range_ex(0, (int)cloth->mvert_num, &data, bvhselftree_update_from_cloth_task,
+		                           CLOTH_BVH_UPDATE_PARALLEL_THRESHOLD, false);
 		
 		BLI_bvhtree_update_tree(bvhtree);
 	}
@@ -44,6 +44,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_edgehash.h"
+#include "BLI_task.h"
 
 #include "BKE_cloth.h"
 #include "BKE_effect.h"
@@ -61,6 +62,9 @@
 #endif
 
 
+/* refitting and near checks are done in parallel when there are at least this many elements */
+#define COLLISION_PARALLEL_THRESHOLD 1024
+
 /***********************************
 Collision modifier code start
 ***********************************/
@@ -111,14 +115,47 @@ BVHTree *bvhtree_build_from_mvert(
 	return tree;
 }
 
+typedef struct BVHTreeUpdateData {
+	BVHTree *bvhtree;
+	const MVert *mvert, *mvert_moving;
+	const MVertTri *tri;
+	bool moving;
+} BVHTreeUpdateData;
+
+static void bvhtree_update_from_mvert_task(void *userdata, int i)
+{
+	const BVHTreeUpdateData *data = userdata;
+	const MVert *mvert = data->mvert;
+	const MVertTri *vt = &data->tri[i];
+	float co[3][3];
+
+	copy_v3_v3(co[0], mvert[vt->tri[0]].co);
+	copy_v3_v3(co[1], mvert[vt->tri[1]].co);
+	copy_v3_v3(co[2], mvert[vt->tri[2]].co);
+
+	/* copy new locations into array */
+	if (data->moving) {
+		const MVert *mvert_moving = data->mvert_moving;
+		float co_moving[3][3];
+		/* update moving positions */
+		copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
+		copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
+		copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
+
+		BLI_bvhtree_update_node(data->bvhtree, i, &co[0][0], &co_moving[0][0], 3);
+	}
+	else {
+		BLI_bvhtree_update_node(data->bvhtree, i, &co[0][0], NULL, 3);
+	}
+}
+
 void bvhtree_update_from_mvert(
         BVHTree *bvhtree,
         const MVert *mvert, const MVert *mvert_moving,
         const MVertTri *tri, int tri_num,
         bool moving)
 {
-	const MVertTri *vt;
-	int i;
+	BVHTreeUpdateData data;
 
 	if ((bvhtree == NULL) || (mvert == NULL)) {
 		return;
@@ -128,33 +165,15 @@ void bvhtree_update_from_mvert(
 		moving = false;
 	}
 
-	for (i = 0, vt = tri; i < tri_num; i++, vt++) {
-		float co[3][3];
-		bool ret;
+	data.bvhtree = bvhtree;
+	data.mvert = mvert;
+	data.mvert_moving = mvert_moving;
+	data.tri = tri;
+	data.moving = moving;
 
-		copy_v3_v3(co[0], mvert[vt->tri[0]].co);
-		copy_v3_v3(co[1], mvert[vt->tri[1]].co);
-		copy_v3_v3(co[2], mvert[vt->tri[2]].co);
-
-		/* copy new locations into array */
-		if (moving) {
-			float co_moving[3][3];
-			/* update moving positions */
-			copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
-			copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
-			copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
-
-			ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], &co_moving[0][0], 3);
-		}
-		else {
-			ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], NULL, 3);
-		}
-
-		/* check if tree is already full */
-		if (ret == false) {
-			break;
-		}
-	}
+	/* leaves are independent, only the final refit of the inner nodes is serial */
+	BLI_task_parallel_range_ex(0, tri_num, &data, bvhtree_update_from_mvert_task,
+	                           COLLISION_PARALLEL_THRESHOLD, false);
 
 	BLI_bvhtree_update_tree(bvhtree);
 }
@@ -604,18 +623,67 @@ void free_collider_cache(ListBase **colliders)
 }
 
 
-static void cloth_bvh_objcollisions_nearcheck ( ClothModifierData * clmd, CollisionModifierData *collmd,
-	CollPair **collisions, CollPair **collisions_index, int numresult, BVHTreeOverlap *overlap, double dt)
+/* Every overlap yields at most one collision pair, so each overlap gets its own slot in the
+ * collision array and the near checks run in parallel. The found pairs are then compacted
+ * in overlap order, which keeps the result identical to checking the overlaps one by one. */
+typedef struct CollisionNearcheckData {
+	ClothModifierData *clmd;
+	CollisionModifierData *collmd;
+	BVHTreeOverlap *overlap;
+	CollPair *collisions;
+	bool *found;
+	float epsilon;
+	double dt;
+} CollisionNearcheckData;
+
+static void cloth_bvh_objcollisions_nearcheck_task(void *userdata, int i)
+{
+	CollisionNearcheckData *data = userdata;
+	CollPair *collpair = &data->collisions[i];
+
+	data->found[i] = (cloth_collision((ModifierData *)data->clmd, (ModifierData *)data->collmd,
+	                                  data->overlap + i, collpair, data->dt) != collpair);
+}
+
+/* move the found pairs to the front of the array, returns the end of the found pairs */
+static CollPair *collision_pairs_compact(CollPair *collisions, const bool *found, int numresult)
 {
+	CollPair *collpair = collisions;
 	int i;
-	
-	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult * 4, "collision array" ); // * 4 since cloth_collision_static can return more than 1 collision
-	*collisions_index = *collisions;
 
-	for ( i = 0; i < numresult; i++ ) {
-		*collisions_index = cloth_collision((ModifierData *)clmd, (ModifierData *)collmd,
-		                                    overlap+i, *collisions_index, dt);
+	for (i = 0; i < numresult; i++) {
+		if (found[i]) {
+			if (collpair != &collisions[i]) {
+				*collpair = collisions[i];
+			}
+			collpair++;
+		}
 	}
+
+	return collpair;
+}
+
+static void cloth_bvh_objcollisions_nearcheck ( ClothModifierData * clmd, CollisionModifierData *collmd,
+	CollPair **collisions, CollPair **collisions_index, int numresult, BVHTreeOverlap *overlap, double dt)
+{
+	CollisionNearcheckData data;
+
+	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult, "collision array" );
+
+	data.clmd = clmd;
+	data.collmd = collmd;
+	data.overlap = overlap;
+	data.collisions = *collisions;
+	data.found = MEM_mallocN(sizeof(bool) * numresult, "collision found");
+	data.epsilon = 0.0f;
+	data.dt = dt;
+
+	BLI_task_parallel_range_ex(0, numresult, &data, cloth_bvh_objcollisions_nearcheck_task,
+	                           COLLISION_PARALLEL_THRESHOLD, false);
+
+	*collisions_index = collision_pairs_compact(*collisions, data.found, numresult);
+
+	MEM_freeN(data.found);
 }
 
 static int cloth_bvh_objcollisions_resolve ( ClothModifierData * clmd, CollisionModifierData *collmd, CollPair *collisions, CollPair *collisions_index)
@@ -660,6 +728,30 @@ static int cloth_bvh_objcollisions_resolve ( ClothModifierData * clmd, Collision
 	return ret;
 }
 
+/* Rejects self collision pairs of pinned or excluded vertices while the tree overlap is traversed,
+ * so this filtering runs in the threads of BLI_bvhtree_overlap. Only reads vertex flags. */
+static bool cloth_selfcollision_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+{
+	ClothModifierData *clmd = userdata;
+	const ClothVertex *verts = clmd->clothObject->verts;
+
+	if (clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_GOAL) {
+		if ((verts[index_a].flags & CLOTH_VERT_FLAG_PINNED) &&
+		    (verts[index_b].flags & CLOTH_VERT_FLAG_PINNED))
+		{
+			return false;
+		}
+	}
+
+	if ((verts[index_a].flags & CLOTH_VERT_FLAG_NOSELFCOLL) ||
+	    (verts[index_b].flags & CLOTH_VERT_FLAG_NOSELFCOLL))
+	{
+		return false;
+	}
+
+	return true;
+}
+
 // cloth - object collisions
 int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, float dt )
 {
@@ -785,7 +877,8 @@ int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, floa
 	
 				if ( cloth->bvhselftree ) {
 					// search for overlapping collision pairs
-					overlap = BLI_bvhtree_overlap(cloth->bvhselftree, cloth->bvhselftree, &result, NULL, NULL);
+					overlap = BLI_bvhtree_overlap(cloth->bvhselftree, cloth->bvhselftree, &result,
+					                              cloth_selfcollision_overlap_cb, clmd);
 	
 	// #pragma omp parallel for private(k, i, j) schedule(static)
 					for ( k = 0; k < result; k++ ) {
@@ -798,20 +891,7 @@ int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, floa
 	
 						mindistance = clmd->coll_parms->selfepsilon* ( cloth->verts[i].avg_spring_len + cloth->verts[j].avg_spring_len );
 	
-						if ( clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_GOAL ) {
-							if ( ( cloth->verts [i].flags & CLOTH_VERT_FLAG_PINNED ) &&
-							     ( cloth->verts [j].flags & CLOTH_VERT_FLAG_PINNED ) )
-							{
-								continue;
-							}
-						}
-
-						if ((cloth->verts[i].flags & CLOTH_VERT_FLAG_NOSELFCOLL) ||
-						    (cloth->verts[j].flags & CLOTH_VERT_FLAG_NOSELFCOLL))
-						{
-							continue;
-						}
-	
+						/* pinned and excluded pairs are already skipped in the overlap callback */
 						sub_v3_v3v3(temp, verts[i].tx, verts[j].tx);
 	
 						if ( ( ABS ( temp[0] ) > mindistance ) || ( ABS ( temp[1] ) > mindistance ) || ( ABS ( temp[2] ) > mindistance ) ) continue;
@@ -1132,20 +1212,37 @@ static CollPair *cloth_point_collision(
 	return collpair;
 }
 
+static void cloth_points_objcollisions_nearcheck_task(void *userdata, int i)
+{
+	CollisionNearcheckData *data = userdata;
+	CollPair *collpair = &data->collisions[i];
+
+	data->found[i] = (cloth_point_collision((ModifierData *)data->clmd, (ModifierData *)data->collmd,
+	                                        data->overlap + i, data->epsilon, collpair, data->dt) != collpair);
+}
+
 static void cloth_points_objcollisions_nearcheck(ClothModifierData * clmd, CollisionModifierData *collmd,
                                                      CollPair **collisions, CollPair **collisions_index,
                                                      int numresult, BVHTreeOverlap *overlap, float epsilon, double dt)
 {
-	int i;
-	
-	/* can return 2 collisions in total */
-	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult * 2, "collision array" );
-	*collisions_index = *collisions;
+	CollisionNearcheckData data;
 
-	for ( i = 0; i < numresult; i++ ) {
-		*collisions_index = cloth_point_collision((ModifierData *)clmd, (ModifierData *)collmd,
-		                                          overlap+i, epsilon, *collisions_index, dt);
-	}
+	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult, "collision array" );
+
+	data.clmd = clmd;
+	data.collmd = collmd;
+	data.overlap = overlap;
+	data.collisions = *collisions;
+	data.found = MEM_mallocN(sizeof(bool) * numresult, "collision found");
+	data.epsilon = epsilon;
+	data.dt = dt;
+
+	BLI_task_parallel_range_ex(0, numresult, &data, cloth_points_objcollisions_nearcheck_task,
+	                           COLLISION_PARALLEL_THRESHOLD, false);
+
+	*collisions_index = collision_pairs_compact(*collisions, data.found, numresult);
+
+	MEM_freeN(data.found);
 }
 
 static int cloth_points_objcollisions_resolve(ClothModifierData * clmd, CollisionModifierData *collmd, PartDeflect *pd,
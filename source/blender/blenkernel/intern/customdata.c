@@ -50,6 +50,8 @@
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
+#include "BLI_ghash.h"
+#include "BLI_threads.h"
 
 #include "BLT_translation.h"
 
@@ -1403,6 +1405,106 @@ void customData_mask_layers__print(CustomDataMask mask)
 	}
 }
 
+/********************* Shared layers *********************/
+
+/* Layers copied with CD_SHARE use the same data as the layer they're copied
+ * from, the last layer using it frees it. Shared layers are flagged
+ * CD_FLAG_NOFREE as well, so code writing to a layer that may be referenced
+ * already makes its own copy first, see CustomData_duplicate_referenced_layer.
+ */
+typedef struct CustomDataShared {
+	int users;
+	/* number of elements to free, layers may have lowered their own count */
+	int totelem;
+} CustomDataShared;
+
+static GHash *customdata_shared = NULL;  /* layer data -> CustomDataShared */
+static ThreadMutex customdata_shared_lock = BLI_MUTEX_INITIALIZER;
+
+/**
+ * Count a new user of the data of \a layer,
+ * which must own its data or be shared already.
+ */
+static void customData_shared_add_user(CustomDataLayer *layer, int totelem)
+{
+	CustomDataShared *shared;
+
+	BLI_assert(!(layer->flag & CD_FLAG_NOFREE) || (layer->flag & CD_FLAG_SHARED));
+
+	BLI_mutex_lock(&customdata_shared_lock);
+
+	if (layer->flag & CD_FLAG_SHARED) {
+		shared = BLI_ghash_lookup(customdata_shared, layer->data);
+		shared->users++;
+	}
+	else {
+		if (customdata_shared == NULL) {
+			customdata_shared = BLI_ghash_ptr_new(__func__);
+		}
+
+		shared = MEM_mallocN(sizeof(*shared), __func__);
+		shared->users = 2;
+		shared->totelem = totelem;
+		BLI_ghash_insert(customdata_shared, layer->data, shared);
+
+		layer->flag |= CD_FLAG_NOFREE | CD_FLAG_SHARED;
+	}
+
+	BLI_mutex_unlock(&customdata_shared_lock);
+}
+
+/**
+ * Stop using the data of a shared layer.
+ * \return the number of elements to free when this was the last user, otherwise -1.
+ */
+static int customData_shared_remove_user(CustomDataLayer *layer)
+{
+	CustomDataShared *shared;
+	int totelem = -1;
+
+	BLI_mutex_lock(&customdata_shared_lock);
+
+	shared = BLI_ghash_lookup(customdata_shared, layer->data);
+	if (--shared->users == 0) {
+		totelem = shared->totelem;
+		BLI_ghash_remove(customdata_shared, layer->data, NULL, MEM_freeN);
+
+		if (BLI_ghash_size(customdata_shared) == 0) {
+			BLI_ghash_free(customdata_shared, NULL, NULL);
+			customdata_shared = NULL;
+		}
+	}
+
+	BLI_mutex_unlock(&customdata_shared_lock);
+
+	layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
+
+	return totelem;
+}
+
+/**
+ * Take over the data of a shared layer if no other layer uses it anymore.
+ */
+static bool customData_shared_take_ownership(CustomDataLayer *layer)
+{
+	CustomDataShared *shared;
+	bool is_single_user;
+
+	BLI_mutex_lock(&customdata_shared_lock);
+
+	shared = BLI_ghash_lookup(customdata_shared, layer->data);
+	is_single_user = (shared->users == 1);
+
+	BLI_mutex_unlock(&customdata_shared_lock);
+
+	if (is_single_user) {
+		/* no other layer can add a user now, the lock is only needed to remove the entry */
+		customData_shared_remove_user(layer);
+	}
+
+	return is_single_user;
+}
+
 /********************* CustomData functions *********************/
 static void customData_update_offsets(CustomData *data);
 
@@ -1474,6 +1576,7 @@ bool CustomData_merge(const struct CustomData *source, struct CustomData *dest,
 			case CD_ASSIGN:
 			case CD_REFERENCE:
 			case CD_DUPLICATE:
+			case CD_SHARE:
 				data = layer->data;
 				break;
 			default:
@@ -1483,6 +1586,22 @@ bool CustomData_merge(const struct CustomData *source, struct CustomData *dest,
 
 		if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
 			newlayer = customData_add_layer__internal(dest, type, CD_REFERENCE, data, totelem, layer->name);
+			if (newlayer) {
+				/* the user of shared data moves along with the layer */
+				newlayer->flag |= flag & CD_FLAG_SHARED;
+			}
+		}
+		else if ((alloctype == CD_SHARE) && (flag & CD_FLAG_NOFREE) && !(flag & CD_FLAG_SHARED)) {
+			/* the data is owned elsewhere (e.g. by the Mesh) and may be freed while
+			 * the copy is still around, only data owned by the layer can be shared */
+			newlayer = customData_add_layer__internal(dest, type, CD_DUPLICATE, data, totelem, layer->name);
+		}
+		else if (alloctype == CD_SHARE) {
+			newlayer = customData_add_layer__internal(dest, type, CD_REFERENCE, data, totelem, layer->name);
+			if (newlayer && data && (newlayer->data == data)) {
+				customData_shared_add_user(layer, totelem);
+				newlayer->flag |= CD_FLAG_SHARED;
+			}
 		}
 		else {
 			newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
@@ -1519,6 +1638,14 @@ static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
 	const LayerTypeInfo *typeInfo;
 
+	if (layer->flag & CD_FLAG_SHARED) {
+		/* only the last user frees the data */
+		totelem = customData_shared_remove_user(layer);
+		if (totelem == -1) {
+			return;
+		}
+	}
+
 	if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
 		typeInfo = layerType_getInfo(layer->type);
 
@@ -2020,22 +2147,31 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data, const
 
 	layer = &data->layers[layer_index];
 
-	if (layer->flag & CD_FLAG_NOFREE) {
+	if ((layer->flag & CD_FLAG_SHARED) && customData_shared_take_ownership(layer)) {
+		/* no other layer uses the data anymore, no need to copy */
+	}
+	else if (layer->flag & CD_FLAG_NOFREE) {
 		/* MEM_dupallocN won't work in case of complex layers, like e.g.
 		 * CD_MDEFORMVERT, which has pointers to allocated data...
 		 * So in case a custom copy function is defined, use it!
 		 */
 		const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+		void *dst_data;
 
 		if (typeInfo->copy) {
-			void *dst_data = MEM_mallocN(totelem * typeInfo->size, "CD duplicate ref layer");
+			dst_data = MEM_mallocN(totelem * typeInfo->size, "CD duplicate ref layer");
 			typeInfo->copy(layer->data, dst_data, totelem);
-			layer->data = dst_data;
 		}
 		else {
-			layer->data = MEM_dupallocN(layer->data);
+			dst_data = MEM_dupallocN(layer->data);
+		}
+
+		if (layer->flag & CD_FLAG_SHARED) {
+			/* the copy is made first, other users may release the data meanwhile */
+			customData_free_layer__internal(layer, totelem);
 		}
 
+		layer->data = dst_data;
 		layer->flag &= ~CD_FLAG_NOFREE;
 	}
 
@@ -2084,7 +2220,8 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
 	layer = &data->layers[layer_index];
 
-	return (layer->flag & CD_FLAG_NOFREE) != 0;
+	/* shared layers own their data together with their other users */
+	return (layer->flag & (CD_FLAG_NOFREE | CD_FLAG_SHARED)) == CD_FLAG_NOFREE;
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -2737,9 +2874,12 @@ void CustomData_bmesh_free_block_data(CustomData *data, void *block)
 		memset(block, 0, data->totsize);
 }
 
-static void CustomData_bmesh_alloc_block(CustomData *data, void **block)
+/**
+ * Allocate a block from the layer pool without initializing it,
+ * so callers can reserve blocks serially and fill them in afterwards.
+ */
+void CustomData_bmesh_alloc_block(CustomData *data, void **block)
 {
-
 	if (*block)
 		CustomData_bmesh_free_block(data, block);
 
@@ -343,6 +343,7 @@ void pd_point_from_particle(ParticleSimulationData *sim, ParticleData *pa, Parti
 		point->ave = point->rot = NULL;
 
 	point->psys = sim->psys;
+	point->rng = NULL;
 }
 
 void pd_point_from_loc(Scene *scene, float *loc, float *vel, int index, EffectedPoint *point)
@@ -359,6 +360,7 @@ void pd_point_from_loc(Scene *scene, float *loc, float *vel, int index, Effected
 
 	point->ave = point->rot = NULL;
 	point->psys = NULL;
+	point->rng = NULL;
 }
 void pd_point_from_soft(Scene *scene, float *loc, float *vel, int index, EffectedPoint *point)
 {
@@ -375,6 +377,7 @@ void pd_point_from_soft(Scene *scene, float *loc, float *vel, int index, Effecte
 	point->ave = point->rot = NULL;
 
 	point->psys = NULL;
+	point->rng = NULL;
 }
 /************************************************/
 /*			Effectors		*/
@@ -814,7 +817,7 @@ static void do_texture_effector(EffectorCache *eff, EffectorData *efd, EffectedP
 static void do_physical_effector(EffectorCache *eff, EffectorData *efd, EffectedPoint *point, float *total_force)
 {
 	PartDeflect *pd = eff->pd;
-	RNG *rng = pd->rng;
+	RNG *rng = point->rng ? point->rng : pd->rng;
 	float force[3] = {0, 0, 0};
 	float temp[3];
 	float fac;
@@ -40,6 +40,7 @@
 #include "BLI_listbase.h"
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -365,6 +366,12 @@ typedef struct LatticeDeformData {
 	Object *object;
 	float *latticedata;
 	float latmat[4][4];
+
+	/* Looked up once so calc_latt_deform() doesn't have to do it for
+	 * every point, and can be called from multiple threads. */
+	Lattice *lt;
+	MDeformVert *dvert;
+	int defgrp_index;
 } LatticeDeformData;
 
 LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
@@ -427,29 +434,33 @@ LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
 	lattice_deform_data->object = oblatt;
 	copy_m4_m4(lattice_deform_data->latmat, latmat);
 
+	/* vgroup influence */
+	lattice_deform_data->lt = lt;
+	lattice_deform_data->dvert = BKE_lattice_deform_verts_get(oblatt);
+	lattice_deform_data->defgrp_index = -1;
+	if (lt->vgroup[0] && lattice_deform_data->dvert) {
+		lattice_deform_data->defgrp_index = defgroup_name_index(oblatt, lt->vgroup);
+	}
+
 	return lattice_deform_data;
 }
 
 void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float weight)
 {
-	Object *ob = lattice_deform_data->object;
-	Lattice *lt = ob->data;
+	const Lattice *lt = lattice_deform_data->lt;
 	float u, v, w, tu[4], tv[4], tw[4];
 	float vec[3];
 	int idx_w, idx_v, idx_u;
 	int ui, vi, wi, uu, vv, ww;
 
 	/* vgroup influence */
-	int defgrp_index = -1;
+	const int defgrp_index = lattice_deform_data->defgrp_index;
+	const MDeformVert *dvert = lattice_deform_data->dvert;
 	float co_prev[3], weight_blend = 0.0f;
-	MDeformVert *dvert = BKE_lattice_deform_verts_get(ob);
 
-
-	if (lt->editlatt) lt = lt->editlatt->latt;
 	if (lattice_deform_data->latticedata == NULL) return;
 
-	if (lt->vgroup[0] && dvert) {
-		defgrp_index = defgroup_name_index(ob, lt->vgroup);
+	if (defgrp_index != -1) {
 		copy_v3_v3(co_prev, co);
 	}
 
@@ -727,6 +738,43 @@ static bool calc_curve_deform(Scene *scene, Object *par, float co[3],
 	return false;
 }
 
+typedef struct CurveDeformUserdata {
+	Scene *scene;
+	Object *cuOb;
+	CurveDeform *cd;
+	float (*vertexCos)[3];
+	MDeformVert *dvert;
+	int defgrp_index;
+	short defaxis;
+	bool use_curvespace;  /* vertexCos are not in 'cd->curvespace' yet */
+} CurveDeformUserdata;
+
+static void curve_deform_vert_task(void *userdata, int a)
+{
+	CurveDeformUserdata *data = userdata;
+	float *co = data->vertexCos[a];
+
+	if (data->dvert) {
+		const float weight = defvert_find_weight(data->dvert + a, data->defgrp_index);
+		float vec[3];
+
+		if (weight > 0.0f) {
+			if (data->use_curvespace)
+				mul_m4_v3(data->cd->curvespace, co);
+			copy_v3_v3(vec, co);
+			calc_curve_deform(data->scene, data->cuOb, vec, data->defaxis, data->cd, NULL);
+			interp_v3_v3v3(co, co, vec, weight);
+			mul_m4_v3(data->cd->objectspace, co);
+		}
+	}
+	else {
+		if (data->use_curvespace)
+			mul_m4_v3(data->cd->curvespace, co);
+		calc_curve_deform(data->scene, data->cuOb, co, data->defaxis, data->cd, NULL);
+		mul_m4_v3(data->cd->objectspace, co);
+	}
+}
+
 void curve_deform_verts(
         Scene *scene, Object *cuOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
         int numVerts, const char *vgroup, short defaxis)
@@ -734,6 +782,7 @@ void curve_deform_verts(
 	Curve *cu;
 	int a;
 	CurveDeform cd;
+	CurveDeformUserdata data;
 	MDeformVert *dvert = NULL;
 	int defgrp_index = -1;
 	const bool is_neg_axis = (defaxis > 2);
@@ -776,26 +825,12 @@ void curve_deform_verts(
 		}
 	}
 
-	if (dvert) {
-		MDeformVert *dvert_iter;
-		float vec[3];
+	if ((cu->flag & CU_DEFORM_BOUNDS_OFF) == 0) {
+		/* set mesh min/max bounds */
+		INIT_MINMAX(cd.dmin, cd.dmax);
 
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
-
-				if (weight > 0.0f) {
-					mul_m4_v3(cd.curvespace, vertexCos[a]);
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-		else {
-			/* set mesh min/max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
+		if (dvert) {
+			MDeformVert *dvert_iter;
 
 			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
 				if (defvert_find_weight(dvert_iter, defgrp_index) > 0.0f) {
@@ -803,44 +838,35 @@ void curve_deform_verts(
 					minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 				}
 			}
-
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
-
-				if (weight > 0.0f) {
-					/* already in 'cd.curvespace', prev for loop */
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-	}
-	else {
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0; a < numVerts; a++) {
-				mul_m4_v3(cd.curvespace, vertexCos[a]);
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 		else {
-			/* set mesh min max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
-				
 			for (a = 0; a < numVerts; a++) {
 				mul_m4_v3(cd.curvespace, vertexCos[a]);
 				minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 			}
-	
-			for (a = 0; a < numVerts; a++) {
-				/* already in 'cd.curvespace', prev for loop */
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 	}
+
+	/* calc_curve_deform() can't build the curve from the threads */
+#ifdef CYCLIC_DEPENDENCY_WORKAROUND
+	if (cuOb->curve_cache == NULL) {
+		BKE_displist_make_curveTypes(scene, cuOb, false);
+	}
+#endif
+
+	data.scene = scene;
+	data.cuOb = cuOb;
+	data.cd = &cd;
+	data.vertexCos = vertexCos;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.defaxis = defaxis;
+	/* with bounds, the verts were already moved to 'cd.curvespace' by the loop above */
+	data.use_curvespace = (cu->flag & CU_DEFORM_BOUNDS_OFF) != 0;
+
+	if (numVerts > 0) {
+		BLI_task_parallel_range(0, numVerts, &data, curve_deform_vert_task);
+	}
 }
 
 /* input vec and orco = local coord in armature space */
@@ -878,11 +904,34 @@ void curve_deform_vector(Scene *scene, Object *cuOb, Object *target,
 
 }
 
+typedef struct LatticeDeformUserdata {
+	LatticeDeformData *lattice_deform_data;
+	float (*vertexCos)[3];
+	MDeformVert *dvert;
+	int defgrp_index;
+	float fac;
+} LatticeDeformUserdata;
+
+static void lattice_deform_vert_task(void *userdata, int index)
+{
+	LatticeDeformUserdata *data = userdata;
+
+	if (data->dvert) {
+		const float weight = defvert_find_weight(data->dvert + index, data->defgrp_index);
+
+		if (weight > 0.0f)
+			calc_latt_deform(data->lattice_deform_data, data->vertexCos[index], weight * data->fac);
+	}
+	else {
+		calc_latt_deform(data->lattice_deform_data, data->vertexCos[index], data->fac);
+	}
+}
+
 void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
                           float (*vertexCos)[3], int numVerts, const char *vgroup, float fac)
 {
 	LatticeDeformData *lattice_deform_data;
-	int a;
+	LatticeDeformUserdata data = {NULL};
 	bool use_vgroups;
 
 	if (laOb->type != OB_LATTICE)
@@ -908,29 +957,30 @@ void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
 		use_vgroups = false;
 	}
 	
+	data.lattice_deform_data = lattice_deform_data;
+	data.vertexCos = vertexCos;
+	data.fac = fac;
+
 	if (vgroup && vgroup[0] && use_vgroups) {
 		Mesh *me = target->data;
 		const int defgrp_index = defgroup_name_index(target, vgroup);
-		float weight;
 
-		if (defgrp_index >= 0 && (me->dvert || dm)) {
-			MDeformVert *dvert = me->dvert;
-			
-			for (a = 0; a < numVerts; a++, dvert++) {
-				if (dm) dvert = dm->getVertData(dm, a, CD_MDEFORMVERT);
-
-				weight = defvert_find_weight(dvert, defgrp_index);
+		if (defgrp_index >= 0) {
+			data.dvert = dm ? dm->getVertDataArray(dm, CD_MDEFORMVERT) : me->dvert;
+			data.defgrp_index = defgrp_index;
+		}
 
-				if (weight > 0.0f)
-					calc_latt_deform(lattice_deform_data, vertexCos[a], weight * fac);
-			}
+		if (data.dvert == NULL) {
+			/* vertex group or its weights don't exist, nothing is deformed,
+			 * the task would deform everything at full influence otherwise */
+			numVerts = 0;
 		}
 	}
-	else {
-		for (a = 0; a < numVerts; a++) {
-			calc_latt_deform(lattice_deform_data, vertexCos[a], fac);
-		}
+
+	if (numVerts > 0) {
+		BLI_task_parallel_range(0, numVerts, &data, lattice_deform_vert_task);
 	}
+
 	end_latt_deform(lattice_deform_data);
 }
 
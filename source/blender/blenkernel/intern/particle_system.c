@@ -105,7 +105,7 @@
 
 #endif // WITH_MOD_FLUID
 
-static ThreadRWMutex psys_bvhtree_rwlock = BLI_RWLOCK_INITIALIZER;
+static ThreadRWMutex psys_sph_grid_rwlock = BLI_RWLOCK_INITIALIZER;
 
 /************************************************/
 /*			Reacting to system events			*/
@@ -1221,40 +1221,225 @@ void psys_get_pointcache_start_end(Scene *scene, ParticleSystem *psys, int *sfra
 /************************************************/
 /*			Effectors							*/
 /************************************************/
-static void psys_update_particle_bvhtree(ParticleSystem *psys, float cfra)
+/* Uniform grid used for SPH neighbor queries. Particles are counting-sorted by
+ * cell, locations are stored in cell order so a query reads them sequentially. */
+typedef struct SPHGrid {
+	float min[3];
+	float cell_size, cell_size_inv;
+	int res[3];
+	int totcell, totpoint;
+
+	int *cell_start;    /* first point of every cell, totcell + 1 items */
+	int *index;         /* particle index of every point */
+	float (*co)[3];     /* location of every point */
+} SPHGrid;
+
+/* at most this many cells per point, sparse systems get larger cells instead */
+#define SPH_GRID_CELLS_PER_POINT 8
+
+static void sph_grid_cell_size(SPHGrid *grid, const float max[3], float cell_size)
 {
-	if (psys) {
-		PARTICLE_P;
-		int totpart = 0;
-		bool need_rebuild;
+	const double cell_max = (double)max_ii(grid->totpoint * SPH_GRID_CELLS_PER_POINT, 64);
+	double totcell = cell_max + 1.0;
+	int i, iter;
+
+	/* growing the cells converges in a few steps, unless the extent overflows */
+	for (iter = 0; iter < 64 && isfinite(cell_size); iter++) {
+		totcell = 1.0;
+		for (i = 0; i < 3; i++) {
+			totcell *= floor((double)((max[i] - grid->min[i]) / cell_size)) + 1.0;
+		}
+		if (!isfinite(totcell) || totcell <= cell_max) {
+			break;
+		}
+		cell_size *= 1.01f * (float)pow(totcell / cell_max, 1.0 / 3.0);
+	}
 
-		BLI_rw_mutex_lock(&psys_bvhtree_rwlock, THREAD_LOCK_READ);
-		need_rebuild = !psys->bvhtree || psys->bvhtree_frame != cfra;
-		BLI_rw_mutex_unlock(&psys_bvhtree_rwlock);
-		
-		if (need_rebuild) {
-			LOOP_SHOWN_PARTICLES {
-				totpart++;
+	if (!(totcell <= cell_max) || !isfinite(cell_size)) {
+		/* extent too large to divide, put all points in a single cell */
+		grid->cell_size = FLT_MAX;
+		grid->cell_size_inv = 0.0f;
+		grid->res[0] = grid->res[1] = grid->res[2] = 1;
+		grid->totcell = 1;
+		return;
+	}
+
+	grid->cell_size = cell_size;
+	grid->cell_size_inv = 1.0f / cell_size;
+	for (i = 0; i < 3; i++) {
+		grid->res[i] = (int)((max[i] - grid->min[i]) * grid->cell_size_inv) + 1;
+	}
+	grid->totcell = grid->res[0] * grid->res[1] * grid->res[2];
+}
+
+BLI_INLINE int sph_grid_cell_axis(const SPHGrid *grid, float co, int axis)
+{
+	/* clamp as float, locations far outside the grid don't fit in an int */
+	const float c = floorf((co - grid->min[axis]) * grid->cell_size_inv);
+	if (!(c > 0.0f)) {
+		return 0;
+	}
+	return (c < (float)grid->res[axis]) ? (int)c : grid->res[axis] - 1;
+}
+
+BLI_INLINE int sph_grid_cell_index(const SPHGrid *grid, const float co[3])
+{
+	return (sph_grid_cell_axis(grid, co[2], 2) * grid->res[1] +
+	        sph_grid_cell_axis(grid, co[1], 1)) * grid->res[0] +
+	        sph_grid_cell_axis(grid, co[0], 0);
+}
+
+BLI_INLINE const float *sph_grid_particle_co(ParticleData *pa, float cfra)
+{
+	return (pa->state.time == cfra) ? pa->prev_state.co : pa->state.co;
+}
+
+static SPHGrid *sph_grid_build(ParticleSystem *psys, float cfra)
+{
+	SPHGrid *grid = MEM_callocN(sizeof(SPHGrid), "SPHGrid");
+	SPHFluidSettings *fluid = psys->part->fluid;
+	ParticleData *particles = psys->particles;
+	int *point_pa, *point_cell, *cell_fill;
+	float max[3], cell_size;
+	int i, totpoint = 0, totfinite = 0;
+	PARTICLE_P;
+
+	point_pa = MEM_mallocN(sizeof(int) * (size_t)max_ii(psys->totpart, 1), "SPHGrid point_pa");
+
+	INIT_MINMAX(grid->min, max);
+	LOOP_SHOWN_PARTICLES {
+		if (pa->alive == PARS_ALIVE) {
+			const float *co = sph_grid_particle_co(pa, cfra);
+			/* exploded particles must not stretch the grid, they are clamped into border cells */
+			if (isfinite(co[0]) && isfinite(co[1]) && isfinite(co[2])) {
+				minmax_v3v3_v3(grid->min, max, co);
+				totfinite++;
 			}
-			
-			BLI_rw_mutex_lock(&psys_bvhtree_rwlock, THREAD_LOCK_WRITE);
-			
-			BLI_bvhtree_free(psys->bvhtree);
-			psys->bvhtree = BLI_bvhtree_new(totpart, 0.0, 4, 6);
-			
-			LOOP_SHOWN_PARTICLES {
-				if (pa->alive == PARS_ALIVE) {
-					if (pa->state.time == cfra)
-						BLI_bvhtree_insert(psys->bvhtree, p, pa->prev_state.co, 1);
-					else
-						BLI_bvhtree_insert(psys->bvhtree, p, pa->state.co, 1);
+			point_pa[totpoint++] = p;
+		}
+	}
+	grid->totpoint = totpoint;
+
+	if (totfinite == 0) {
+		zero_v3(grid->min);
+		zero_v3(max);
+	}
+
+	/* cells as large as the interaction radius keep queries to 3x3x3 cells */
+	if (fluid) {
+		cell_size = fluid->radius * (fluid->flag & SPH_FAC_RADIUS ? 4.0f * psys->part->size : 1.0f);
+	}
+	else {
+		cell_size = 0.0f;
+	}
+	if (!(cell_size > FLT_EPSILON)) {
+		/* not a fluid, aim for about one particle per cell */
+		cell_size = len_v3v3(grid->min, max) / max_ff(cbrtf((float)totpoint), 1.0f);
+		if (!(cell_size > FLT_EPSILON)) {
+			cell_size = 1.0f;
+		}
+	}
+	sph_grid_cell_size(grid, max, cell_size);
+
+	grid->cell_start = MEM_callocN(sizeof(int) * (size_t)(grid->totcell + 1), "SPHGrid cell_start");
+	grid->index = MEM_mallocN(sizeof(int) * (size_t)max_ii(totpoint, 1), "SPHGrid index");
+	grid->co = MEM_mallocN(sizeof(float[3]) * (size_t)max_ii(totpoint, 1), "SPHGrid co");
+	point_cell = MEM_mallocN(sizeof(int) * (size_t)max_ii(totpoint, 1), "SPHGrid point_cell");
+
+#pragma omp parallel for schedule(static) if (totpoint > 10000)
+	for (i = 0; i < totpoint; i++) {
+		point_cell[i] = sph_grid_cell_index(grid, sph_grid_particle_co(particles + point_pa[i], cfra));
+	}
+
+	/* counting sort, keeps particles in index order within a cell */
+	for (i = 0; i < totpoint; i++) {
+		grid->cell_start[point_cell[i] + 1]++;
+	}
+	for (i = 0; i < grid->totcell; i++) {
+		grid->cell_start[i + 1] += grid->cell_start[i];
+	}
+	cell_fill = MEM_mallocN(sizeof(int) * (size_t)grid->totcell, "SPHGrid cell_fill");
+	memcpy(cell_fill, grid->cell_start, sizeof(int) * (size_t)grid->totcell);
+	for (i = 0; i < totpoint; i++) {
+		grid->index[cell_fill[point_cell[i]]++] = point_pa[i];
+	}
+	MEM_freeN(cell_fill);
+
+#pragma omp parallel for schedule(static) if (totpoint > 10000)
+	for (i = 0; i < totpoint; i++) {
+		copy_v3_v3(grid->co[i], sph_grid_particle_co(particles + grid->index[i], cfra));
+	}
+
+	MEM_freeN(point_cell);
+	MEM_freeN(point_pa);
+
+	return grid;
+}
+
+void psys_sph_grid_free(SPHGrid *grid)
+{
+	if (grid) {
+		MEM_freeN(grid->cell_start);
+		MEM_freeN(grid->index);
+		MEM_freeN(grid->co);
+		MEM_freeN(grid);
+	}
+}
+
+/* Same as #BLI_bvhtree_range_query, calls \a callback for every particle closer than \a radius to \a co. */
+static void sph_grid_range_query(const SPHGrid *grid, const float co[3], float radius,
+                                 BVHTree_RangeQuery callback, void *userdata)
+{
+	const float radius_sq = radius * radius;
+	int lo[3], hi[3];
+	int y, z, i, j;
+
+	for (i = 0; i < 3; i++) {
+		if (co[i] + radius < grid->min[i] ||
+		    co[i] - radius > grid->min[i] + grid->cell_size * (float)grid->res[i])
+		{
+			return;
+		}
+		lo[i] = sph_grid_cell_axis(grid, co[i] - radius, i);
+		hi[i] = sph_grid_cell_axis(grid, co[i] + radius, i);
+	}
+
+	for (z = lo[2]; z <= hi[2]; z++) {
+		for (y = lo[1]; y <= hi[1]; y++) {
+			const int row = (z * grid->res[1] + y) * grid->res[0];
+			/* cells along x are consecutive in memory */
+			const int start = grid->cell_start[row + lo[0]];
+			const int end = grid->cell_start[row + hi[0] + 1];
+
+			for (j = start; j < end; j++) {
+				const float dist_sq = len_squared_v3v3(co, grid->co[j]);
+				if (dist_sq < radius_sq) {
+					callback(userdata, grid->index[j], dist_sq);
 				}
 			}
-			BLI_bvhtree_balance(psys->bvhtree);
-			
-			psys->bvhtree_frame = cfra;
-			
-			BLI_rw_mutex_unlock(&psys_bvhtree_rwlock);
+		}
+	}
+}
+
+static void psys_update_sph_grid(ParticleSystem *psys, float cfra)
+{
+	if (psys) {
+		bool need_rebuild;
+
+		BLI_rw_mutex_lock(&psys_sph_grid_rwlock, THREAD_LOCK_READ);
+		need_rebuild = !psys->sph_grid || psys->sph_grid_frame != cfra;
+		BLI_rw_mutex_unlock(&psys_sph_grid_rwlock);
+
+		if (need_rebuild) {
+			SPHGrid *grid = sph_grid_build(psys, cfra);
+
+			BLI_rw_mutex_lock(&psys_sph_grid_rwlock, THREAD_LOCK_WRITE);
+
+			psys_sph_grid_free(psys->sph_grid);
+			psys->sph_grid = grid;
+			psys->sph_grid_frame = cfra;
+
+			BLI_rw_mutex_unlock(&psys_sph_grid_rwlock);
 		}
 	}
 }
@@ -1572,11 +1757,13 @@ static void sph_evaluate_func(BVHTree *tree, ParticleSystem **psys, float co[3],
 			break;
 		}
 		else {
-			BLI_rw_mutex_lock(&psys_bvhtree_rwlock, THREAD_LOCK_READ);
-			
-			BLI_bvhtree_range_query(psys[i]->bvhtree, co, interaction_radius, callback, pfr);
-			
-			BLI_rw_mutex_unlock(&psys_bvhtree_rwlock);
+			BLI_rw_mutex_lock(&psys_sph_grid_rwlock, THREAD_LOCK_READ);
+
+			if (psys[i]->sph_grid) {
+				sph_grid_range_query(psys[i]->sph_grid, co, interaction_radius, callback, pfr);
+			}
+
+			BLI_rw_mutex_unlock(&psys_sph_grid_rwlock);
 		}
 	}
 }
@@ -2030,10 +2217,18 @@ static void sph_integrate(ParticleSimulationData *sim, ParticleData *pa, float d
 /************************************************/
 /*			Basic physics						*/
 /************************************************/
+/* Random numbers for dynamics, from the particle's own stream when stepping
+ * in parallel so results don't depend on the order particles are handled in. */
+BLI_INLINE float psys_dynamics_frand(RNG *rng)
+{
+	return rng ? BLI_rng_get_float(rng) : BLI_frand();
+}
+
 typedef struct EfData {
 	ParticleTexture ptex;
 	ParticleSimulationData *sim;
 	ParticleData *pa;
+	RNG *rng;
 } EfData;
 static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, float *impulse)
 {
@@ -2045,6 +2240,7 @@ static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, flo
 
 	/* add effectors */
 	pd_point_from_particle(efdata->sim, efdata->pa, state, &epoint);
+	epoint.rng = efdata->rng;
 	if (part->type != PART_HAIR || part->effector_weights->flag & EFF_WEIGHT_DO_HAIR)
 		pdDoEffectors(sim->psys->effectors, sim->colliders, part->effector_weights, &epoint, force, impulse);
 
@@ -2057,16 +2253,17 @@ static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, flo
 
 	/* brownian force */
 	if (part->brownfac != 0.0f) {
-		force[0] += (BLI_frand()-0.5f) * part->brownfac;
-		force[1] += (BLI_frand()-0.5f) * part->brownfac;
-		force[2] += (BLI_frand()-0.5f) * part->brownfac;
+		force[0] += (psys_dynamics_frand(efdata->rng) - 0.5f) * part->brownfac;
+		force[1] += (psys_dynamics_frand(efdata->rng) - 0.5f) * part->brownfac;
+		force[2] += (psys_dynamics_frand(efdata->rng) - 0.5f) * part->brownfac;
 	}
 
 	if (part->flag & PART_ROT_DYN && epoint.ave)
 		copy_v3_v3(pa->state.ave, epoint.ave);
 }
-/* gathers all forces that effect particles and calculates a new state for the particle */
-static void basic_integrate(ParticleSimulationData *sim, int p, float dfra, float cfra)
+/* gathers all forces that effect particles and calculates a new state for the particle,
+ * \a rng is the particle's random stream (NULL uses the global one, not thread safe) */
+static void basic_integrate(ParticleSimulationData *sim, int p, float dfra, float cfra, RNG *rng)
 {
 	ParticleSettings *part = sim->psys->part;
 	ParticleData *pa = sim->psys->particles + p;
@@ -2079,6 +2276,7 @@ static void basic_integrate(ParticleSimulationData *sim, int p, float dfra, floa
 
 	efdata.pa = pa;
 	efdata.sim = sim;
+	efdata.rng = rng;
 
 	/* add global acceleration (gravitation) */
 	if (psys_uses_gravity(sim) &&
@@ -2622,7 +2820,7 @@ static int collision_detect(ParticleData *pa, ParticleCollision *col, BVHTreeRay
 
 	return hit->index >= 0;
 }
-static int collision_response(ParticleData *pa, ParticleCollision *col, BVHTreeRayHit *hit, int kill, int dynamic_rotation)
+static int collision_response(ParticleData *pa, ParticleCollision *col, BVHTreeRayHit *hit, int kill, int dynamic_rotation, RNG *rng)
 {
 	ParticleCollisionElement *pce = &col->pce;
 	PartDeflect *pd = col->hit->pd;
@@ -2631,7 +2829,7 @@ static int collision_response(ParticleData *pa, ParticleCollision *col, BVHTreeR
 	float f = col->f + x * (1.0f - col->f);				/* time factor of collision between timestep */
 	float dt1 = (f - col->f) * col->total_time;			/* time since previous collision (in seconds) */
 	float dt2 = (1.0f - f) * col->total_time;			/* time left after collision (in seconds) */
-	int through = (BLI_frand() < pd->pdef_perm) ? 1 : 0; /* did particle pass through the collision surface? */
+	int through = (psys_dynamics_frand(rng) < pd->pdef_perm) ? 1 : 0; /* did particle pass through the collision surface? */
 
 	/* calculate exact collision location */
 	interp_v3_v3v3(co, col->co1, col->co2, x);
@@ -2656,8 +2854,8 @@ static int collision_response(ParticleData *pa, ParticleCollision *col, BVHTreeR
 		float v0_tan[3];/* tangential component of v0 */
 		float vc_tan[3];/* tangential component of collision surface velocity */
 		float v0_dot, vc_dot;
-		float damp = pd->pdef_damp + pd->pdef_rdamp * 2 * (BLI_frand() - 0.5f);
-		float frict = pd->pdef_frict + pd->pdef_rfrict * 2 * (BLI_frand() - 0.5f);
+		float damp = pd->pdef_damp + pd->pdef_rdamp * 2 * (psys_dynamics_frand(rng) - 0.5f);
+		float frict = pd->pdef_frict + pd->pdef_rfrict * 2 * (psys_dynamics_frand(rng) - 0.5f);
 		float distance, nor[3], dot;
 
 		CLAMP(damp,0.0f, 1.0f);
@@ -2818,7 +3016,7 @@ static void collision_fail(ParticleData *pa, ParticleCollision *col)
  * -uses Newton-Rhapson iteration to find the collisions
  * -handles spherical particles and (nearly) point like particles
  */
-static void collision_check(ParticleSimulationData *sim, int p, float dfra, float cfra)
+static void collision_check(ParticleSimulationData *sim, int p, float dfra, float cfra, RNG *rng)
 {
 	ParticleSettings *part = sim->psys->part;
 	ParticleData *pa = sim->psys->particles + p;
@@ -2865,7 +3063,7 @@ static void collision_check(ParticleSimulationData *sim, int p, float dfra, floa
 
 			if (collision_count == COLLISION_MAX_COLLISIONS)
 				collision_fail(pa, &col);
-			else if (collision_response(pa, &col, &hit, part->flag & PART_DIE_ON_COL, part->flag & PART_ROT_DYN)==0)
+			else if (collision_response(pa, &col, &hit, part->flag & PART_DIE_ON_COL, part->flag & PART_ROT_DYN, rng)==0)
 				return;
 		}
 		else
@@ -3331,6 +3529,100 @@ static float update_timestep(ParticleSystem *psys, ParticleSimulationData *sim,
 /*			System Core							*/
 /************************************************/
 /* unbaked particles are calculated dynamically */
+static void dynamics_step_newton_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	ParticleTask *task = taskdata;
+	ParticleSimulationData *sim = &task->ctx->sim;
+	ParticleSystem *psys = sim->psys;
+	ParticleSettings *part = psys->part;
+	const float cfra = task->ctx->cfra;
+	const float timestep = psys_get_timestep(sim);
+	const unsigned int seed = 31415926 + (int)cfra + psys->seed;
+	ParticleData *pa;
+	int p;
+
+	for (p = task->begin, pa = psys->particles + p; p < task->end; p++, pa++) {
+		if (pa->state.time <= 0.0f)
+			continue;
+
+		/* per particle stream, so results don't depend on how particles are split over threads */
+		BLI_rng_srandom(task->rng, seed + (unsigned int)p * 7919u);
+
+		/* do global forces & effectors */
+		basic_integrate(sim, p, pa->state.time, cfra, task->rng);
+
+		/* deflection, colliders are only read from here */
+		if (sim->colliders)
+			collision_check(sim, p, pa->state.time, cfra, task->rng);
+
+		/* rotations */
+		basic_rotate(part, pa, pa->state.time, timestep);
+	}
+}
+
+/* a system that is its own effector reads the state of other particles during the step */
+static bool psys_is_self_effecting(ParticleSimulationData *sim)
+{
+	EffectorCache *eff;
+
+	if (sim->psys->effectors) {
+		for (eff = sim->psys->effectors->first; eff; eff = eff->next) {
+			if (eff->psys == sim->psys)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/* Newtonian particles don't interact with each other, integrate them in parallel */
+static void dynamics_step_newton(ParticleSimulationData *sim, float cfra)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParticleThreadContext ctx;
+	ParticleTask *tasks;
+	int i, numtasks;
+
+	if (sim->psys->totpart == 0)
+		return;
+
+	memset(&ctx, 0, sizeof(ParticleThreadContext));
+	ctx.sim = *sim;
+	ctx.cfra = cfra;
+
+	if (psys_is_self_effecting(sim)) {
+		/* particles interact through the effector, integrate them in order */
+		ParticleTask task;
+
+		memset(&task, 0, sizeof(ParticleTask));
+		task.ctx = &ctx;
+		task.begin = 0;
+		task.end = sim->psys->totpart;
+		task.rng = BLI_rng_new(0);
+
+		dynamics_step_newton_task(NULL, &task, 0);
+
+		BLI_rng_free(task.rng);
+		return;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+	task_pool = BLI_task_pool_create(task_scheduler, &ctx);
+
+	psys_tasks_create(&ctx, 0, sim->psys->totpart, &tasks, &numtasks);
+	for (i = 0; i < numtasks; ++i) {
+		ParticleTask *task = &tasks[i];
+
+		task->rng = BLI_rng_new(0);
+		BLI_task_pool_push(task_pool, dynamics_step_newton_task, task, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(task_pool);
+
+	BLI_task_pool_free(task_pool);
+	psys_tasks_free(tasks, numtasks);
+}
+
 static void dynamics_step(ParticleSimulationData *sim, float cfra)
 {
 	ParticleSystem *psys = sim->psys;
@@ -3396,11 +3688,11 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 		case PART_PHYS_FLUID:
 		{
 			ParticleTarget *pt = psys->targets.first;
-			psys_update_particle_bvhtree(psys, cfra);
+			psys_update_sph_grid(psys, cfra);
 			
-			for (; pt; pt=pt->next) {  /* Updating others systems particle tree for fluid-fluid interaction */
+			for (; pt; pt=pt->next) {  /* Updating others systems particle grid for fluid-fluid interaction */
 				if (pt->ob)
-					psys_update_particle_bvhtree(BLI_findlink(&pt->ob->particlesystem, pt->psys-1), cfra);
+					psys_update_sph_grid(BLI_findlink(&pt->ob->particlesystem, pt->psys-1), cfra);
 			}
 			break;
 		}
@@ -3451,17 +3743,7 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 	switch (part->phystype) {
 		case PART_PHYS_NEWTON:
 		{
-			LOOP_DYNAMIC_PARTICLES {
-				/* do global forces & effectors */
-				basic_integrate(sim, p, pa->state.time, cfra);
-	
-				/* deflection */
-				if (sim->colliders)
-					collision_check(sim, p, pa->state.time, cfra);
-
-				/* rotations */
-				basic_rotate(part, pa, pa->state.time, timestep);
-			}
+			dynamics_step_newton(sim, cfra);
 			break;
 		}
 		case PART_PHYS_BOIDS:
@@ -3476,7 +3758,7 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 
 					/* deflection */
 					if (sim->colliders)
-						collision_check(sim, p, pa->state.time, cfra);
+						collision_check(sim, p, pa->state.time, cfra, NULL);
 				}
 			}
 			break;
@@ -3493,13 +3775,13 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 #pragma omp parallel for firstprivate (sphdata) private (pa) schedule(dynamic,5)
 				LOOP_DYNAMIC_PARTICLES {
 					/* do global forces & effectors */
-					basic_integrate(sim, p, pa->state.time, cfra);
+					basic_integrate(sim, p, pa->state.time, cfra, NULL);
 
 					/* actual fluids calculations */
 					sph_integrate(sim, pa, pa->state.time, &sphdata);
 
 					if (sim->colliders)
-						collision_check(sim, p, pa->state.time, cfra);
+						collision_check(sim, p, pa->state.time, cfra, NULL);
 
 					/* SPH particles are not physical particles, just interpolation
 					 * particles,  thus rotation has not a direct sense for them */
@@ -3521,7 +3803,7 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 
 #pragma omp parallel for private (pa) schedule(dynamic,5)
 				LOOP_DYNAMIC_PARTICLES {
-					basic_integrate(sim, p, pa->state.time, cfra);
+					basic_integrate(sim, p, pa->state.time, cfra, NULL);
 				}
 
 				/* calculate summation density */
@@ -3537,7 +3819,7 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 					sph_integrate(sim, pa, pa->state.time, &sphdata);
 
 					if (sim->colliders)
-						collision_check(sim, p, pa->state.time, cfra);
+						collision_check(sim, p, pa->state.time, cfra, NULL);
 				
 					/* SPH particles are not physical particles, just interpolation
 					 * particles,  thus rotation has not a direct sense for them */
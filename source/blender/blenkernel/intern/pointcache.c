@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -47,6 +48,7 @@
 #include "DNA_smoke_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
@@ -83,6 +85,8 @@
 #include "smoke_API.h"
 #endif
 
+#include "atomic_ops.h"
+
 #ifdef WITH_LZO
 #  ifdef WITH_SYSTEM_LZO
 #    include <lzo/lzo1x.h>
@@ -106,6 +110,15 @@
 #  include "BLI_winstuff.h"
 #endif
 
+/* needed for packed caches */
+#ifndef WIN32
+#  include <unistd.h>
+#  include <sys/mman.h>
+#else
+#  include <io.h>
+#  include "mmap_win.h"
+#endif
+
 #define PTCACHE_DATA_FROM(data, type, from)  \
 	if (data[type]) { \
 		memcpy(data[type], from, ptcache_data_size[type]); \
@@ -140,6 +153,10 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode);
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size);
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size);
+static struct PTCacheWriteFrame *ptcache_writer_frame_new(const char *filename);
+static void ptcache_writer_submit(struct PTCacheWriteFrame *frame);
+static bool ptcache_writer_pending(const char *filename);
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin);
 
 /* Common functions */
 static int ptcache_basic_header_read(PTCacheFile *pf)
@@ -147,10 +164,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 	int error=0;
 
 	/* Custom functions should read these basic elements too! */
-	if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		error = 1;
 	
-	if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		error = 1;
 
 	return !error;
@@ -158,10 +175,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
 	/* Custom functions should write these basic elements too! */
-	if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		return 0;
 	
-	if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		return 0;
 
 	return 1;
@@ -779,7 +796,7 @@ static int ptcache_smoke_read(PTCacheFile *pf, void *smoke_v)
 	if (!STREQLEN(version, SMOKE_CACHE_VERSION, 4))
 	{
 		/* reset file pointer */
-		fseek(pf->fp, -4, SEEK_CUR);
+		ptcache_file_seek(pf, -4, SEEK_CUR);
 		return ptcache_smoke_read_old(pf, smoke_v);
 	}
 
@@ -1529,6 +1546,505 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
 	return len; /* make sure the above string is always 16 chars */
 }
 
+/* Packed disk caches
+ *
+ * With PTCACHE_DISK_PACK a finished disk bake is moved into one file per cache,
+ * "<name>_<index>_packed.bphys": a header, an index of the frames sorted by frame number
+ * and the unchanged frame files back to back, each still compressed per data channel.
+ * A pack is memory mapped on first use and stays mapped, so reading a frame is an index
+ * lookup instead of opening a file. Packs that can't be mapped are read frame by frame.
+ *
+ * A pack only exists while the cache is baked, clearing or freeing the bake moves
+ * the frames back to frame files, see BKE_ptcache_disk_unpack. */
+
+#define PTCACHE_PACK_ID       "BPHYSPAK"
+#define PTCACHE_PACK_VERSION  1
+
+/* larger packs are read with lseek/read instead of being mapped,
+ * mmap_win passes the length as a 32 bit DWORD */
+#ifdef WIN32
+#  define PTCACHE_PACK_MAP_MAX  ((uint64_t)0xffffffff)
+#else
+#  define PTCACHE_PACK_MAP_MAX  ((uint64_t)(SIZE_MAX / 2))
+#endif
+
+typedef struct PTCachePackHeader {
+	char id[8];
+	unsigned int version;
+	unsigned int totframe;
+} PTCachePackHeader;
+
+typedef struct PTCachePackFrame {
+	int frame;
+	unsigned int pad;
+	uint64_t offset, size;  /* frame file location, from the start of the pack */
+} PTCachePackFrame;
+
+typedef struct PTCachePack {
+	struct PTCachePack *next, *prev;
+	char filename[MAX_PTCACHE_FILE];
+
+	/* to notice the file being replaced */
+	int64_t mtime;
+	uint64_t size;
+
+	unsigned char *mem;              /* the mapped file, NULL when frames are read from the file */
+	const PTCachePackFrame *frames;  /* points into mem, or allocated when not mapped */
+	unsigned int totframe;
+
+	/* ptcache_packs holds one user, readers hold one while they use the pack,
+	 * so a pack closed by another thread is only unmapped once they are done */
+	int users;
+} PTCachePack;
+
+static ListBase ptcache_packs = {NULL, NULL};  /* open packs */
+static ThreadMutex ptcache_pack_lock = BLI_MUTEX_INITIALIZER;
+
+static bool ptcache_pack_filename(PTCacheID *pid, char *filename)
+{
+	int len = ptcache_filename(pid, filename, 0, 1, 0);
+
+	if (len == 0)
+		return false;
+
+	BLI_snprintf(filename + len, MAX_PTCACHE_FILE - len, "_%02u_packed"PTCACHE_EXT, pid->stack_index);
+	return true;
+}
+/* read 'size' bytes at 'offset' of an open file, lseek is 64 bit on all platforms (see BLI_winstuff.h),
+ * the offset is passed as int64_t since off_t is only 32 bit with MSVC */
+static bool ptcache_pack_file_read(int file, uint64_t offset, void *buf, uint64_t size)
+{
+	unsigned char *pos = buf;
+
+	if (lseek(file, (int64_t)offset, SEEK_SET) < 0)
+		return false;
+
+	while (size > 0) {
+		unsigned int chunk = (unsigned int)MIN2(size, (uint64_t)(1 << 30));
+
+		if (read(file, pos, chunk) != (int)chunk)
+			return false;
+
+		pos += chunk;
+		size -= chunk;
+	}
+
+	return true;
+}
+static PTCachePack *ptcache_pack_open(const char *filename, const BLI_stat_t *st)
+{
+	PTCachePack *pack;
+	PTCachePackHeader header;
+	PTCachePackFrame *frames = NULL;
+	unsigned char *mem = NULL;
+	uint64_t size = (uint64_t)st->st_size;
+	unsigned int i;
+	bool valid;
+	int file;
+
+	if (size < sizeof(PTCachePackHeader))
+		return NULL;
+
+	file = BLI_open(filename, O_BINARY | O_RDONLY, 0);
+	if (file == -1)
+		return NULL;
+
+	if (size <= PTCACHE_PACK_MAP_MAX) {
+		mem = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, file, 0);
+		if (mem == (unsigned char *) -1)
+			mem = NULL;
+	}
+
+	/* the header and index are read either way, the mapping only serves the frames */
+	if (mem) {
+		memcpy(&header, mem, sizeof(header));
+	}
+	else if (!ptcache_pack_file_read(file, 0, &header, sizeof(header))) {
+		close(file);
+		return NULL;
+	}
+
+	valid = STREQLEN(header.id, PTCACHE_PACK_ID, 8) && header.version == PTCACHE_PACK_VERSION &&
+	        sizeof(PTCachePackHeader) + (uint64_t)header.totframe * sizeof(PTCachePackFrame) <= size;
+
+	if (valid && mem == NULL) {
+		frames = MEM_mallocN(sizeof(PTCachePackFrame) * header.totframe, "PTCachePackFrame");
+		valid = ptcache_pack_file_read(file, sizeof(PTCachePackHeader), frames,
+		                               (uint64_t)header.totframe * sizeof(PTCachePackFrame));
+	}
+	else if (valid) {
+		frames = (PTCachePackFrame *)(mem + sizeof(PTCachePackHeader));
+	}
+
+	close(file);  /* the mapping stays valid */
+
+	for (i = 0; valid && i < header.totframe; i++)
+		valid = (frames[i].offset <= size && frames[i].size <= size - frames[i].offset);
+
+	if (!valid) {
+		if (G.debug & G_DEBUG)
+			printf("Invalid packed point cache '%s'\n", filename);
+		if (mem)
+			munmap(mem, (size_t)size);
+		else if (frames)
+			MEM_freeN(frames);
+		return NULL;
+	}
+
+	pack = MEM_callocN(sizeof(PTCachePack), "PTCachePack");
+	BLI_strncpy(pack->filename, filename, sizeof(pack->filename));
+	pack->mtime = (int64_t)st->st_mtime;
+	pack->size = size;
+	pack->mem = mem;
+	pack->frames = frames;
+	pack->totframe = header.totframe;
+	pack->users = 1;
+	BLI_addtail(&ptcache_packs, pack);
+
+	return pack;
+}
+/* drop a user of the pack, call with ptcache_pack_lock held */
+static void ptcache_pack_release_locked(PTCachePack *pack)
+{
+	BLI_assert(pack->users > 0);
+
+	if (--pack->users == 0) {
+		if (pack->mem)
+			munmap(pack->mem, (size_t)pack->size);
+		else
+			MEM_freeN((void *)pack->frames);
+		MEM_freeN(pack);
+	}
+}
+static void ptcache_pack_release(PTCachePack *pack)
+{
+	BLI_mutex_lock(&ptcache_pack_lock);
+	ptcache_pack_release_locked(pack);
+	BLI_mutex_unlock(&ptcache_pack_lock);
+}
+/* forget an open pack, it's freed once the last reader releases it */
+static void ptcache_pack_unlink_locked(PTCachePack *pack)
+{
+	BLI_remlink(&ptcache_packs, pack);
+	ptcache_pack_release_locked(pack);
+}
+/* close a pack before the file is replaced, renamed or removed */
+static void ptcache_pack_close(const char *filename)
+{
+	PTCachePack *pack;
+
+	BLI_mutex_lock(&ptcache_pack_lock);
+	pack = BLI_findstring(&ptcache_packs, filename, offsetof(PTCachePack, filename));
+	if (pack)
+		ptcache_pack_unlink_locked(pack);
+	BLI_mutex_unlock(&ptcache_pack_lock);
+}
+static void ptcache_pack_close_all(void)
+{
+	BLI_mutex_lock(&ptcache_pack_lock);
+	while (ptcache_packs.first)
+		ptcache_pack_unlink_locked(ptcache_packs.first);
+	BLI_mutex_unlock(&ptcache_pack_lock);
+}
+/* the pack stored at 'filename' with a user added, NULL when there is none */
+static PTCachePack *ptcache_pack_acquire_file(const char *filename)
+{
+	PTCachePack *pack;
+	BLI_stat_t st;
+
+	BLI_mutex_lock(&ptcache_pack_lock);
+
+	pack = BLI_findstring(&ptcache_packs, filename, offsetof(PTCachePack, filename));
+
+	if (BLI_stat(filename, &st) != 0) {
+		if (pack)
+			ptcache_pack_unlink_locked(pack);
+		pack = NULL;
+	}
+	else {
+		if (pack && (pack->mtime != (int64_t)st.st_mtime || pack->size != (uint64_t)st.st_size)) {
+			ptcache_pack_unlink_locked(pack);
+			pack = NULL;
+		}
+		if (pack == NULL)
+			pack = ptcache_pack_open(filename, &st);
+	}
+
+	if (pack)
+		pack->users++;
+
+	BLI_mutex_unlock(&ptcache_pack_lock);
+
+	return pack;
+}
+/* the pack of a cache, NULL when the cache isn't packed, release with ptcache_pack_release */
+static PTCachePack *ptcache_pack_acquire(PTCacheID *pid)
+{
+	char filename[MAX_PTCACHE_FILE];
+
+	if ((pid->cache->flag & PTCACHE_DISK_PACK) == 0 || (pid->cache->flag & PTCACHE_EXTERNAL))
+		return NULL;
+
+	if (!ptcache_pack_filename(pid, filename))
+		return NULL;
+
+	return ptcache_pack_acquire_file(filename);
+}
+static const PTCachePackFrame *ptcache_pack_find(const PTCachePack *pack, int cfra)
+{
+	int low = 0, high = (int)pack->totframe - 1;
+
+	while (low <= high) {
+		int mid = (low + high) / 2;
+
+		if (pack->frames[mid].frame < cfra)
+			low = mid + 1;
+		else if (pack->frames[mid].frame > cfra)
+			high = mid - 1;
+		else
+			return &pack->frames[mid];
+	}
+
+	return NULL;
+}
+/* the frame file stored in an unmapped pack, free with MEM_freeN */
+static unsigned char *ptcache_pack_frame_read(const PTCachePack *pack, const PTCachePackFrame *frame)
+{
+	unsigned char *buf;
+	int file;
+	bool ok;
+
+	if (frame->size > (uint64_t)(SIZE_MAX / 2))
+		return NULL;
+
+	file = BLI_open(pack->filename, O_BINARY | O_RDONLY, 0);
+	if (file == -1)
+		return NULL;
+
+	buf = MEM_mallocN(MAX2((size_t)frame->size, 1), "ptcache pack frame");
+	ok = ptcache_pack_file_read(file, frame->offset, buf, frame->size);
+	close(file);
+
+	if (!ok) {
+		MEM_freeN(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+static void ptcache_pack_remove(PTCacheID *pid)
+{
+	char filename[MAX_PTCACHE_FILE];
+
+	if (ptcache_pack_filename(pid, filename)) {
+		ptcache_pack_close(filename);
+		if (BLI_exists(filename))
+			BLI_delete(filename, false, false);
+	}
+}
+static int ptcache_frame_cmp(const void *a, const void *b)
+{
+	const int fa = *(const int *)a, fb = *(const int *)b;
+	return (fa > fb) - (fa < fb);
+}
+/* Move the frame files of a baked disk cache into its pack. */
+void BKE_ptcache_disk_pack(PTCacheID *pid)
+{
+	DIR *dir;
+	struct dirent *de;
+	char path[MAX_PTCACHE_PATH];
+	char filename[MAX_PTCACHE_FILE];
+	char path_full[MAX_PTCACHE_FILE];
+	char ext[MAX_PTCACHE_PATH];
+	char pack_filename[MAX_PTCACHE_FILE];
+	char pack_filename_tmp[MAX_PTCACHE_FILE + 4];
+	PTCachePackHeader header;
+	PTCachePackFrame *frames;
+	unsigned char *buf = NULL;
+	size_t buf_len = 0;
+	uint64_t offset;
+	int *framenrs = NULL;
+	int i, totframe = 0, maxframe = 0;
+	unsigned int len;
+	bool ok = true;
+	FILE *fp;
+
+	if (pid->cache->flag & PTCACHE_EXTERNAL)
+		return;
+
+	/* the cache index may have been assigned while baking, after this pid was made */
+	pid->stack_index = pid->cache->index;
+
+	if (!ptcache_pack_filename(pid, pack_filename))
+		return;
+
+	BKE_ptcache_flush_writes();
+
+	/* the frames of an earlier pack are packed again along with the frame files */
+	BKE_ptcache_disk_unpack(pid);
+
+	/* collect the frames on disk */
+	ptcache_path(pid, path);
+	len = ptcache_filename(pid, filename, 0, 0, 0); /* no path */
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	/* append underscore terminator to avoid matching caches of other objects, see BKE_ptcache_id_clear */
+	if (len < sizeof(filename) - 2) {
+		BLI_strncpy(filename + len, "_", sizeof(filename) - 2 - len);
+		len += 1;
+	}
+
+	BLI_snprintf(ext, sizeof(ext), "_%02u"PTCACHE_EXT, pid->stack_index);
+
+	while ((de = readdir(dir)) != NULL) {
+		if (strstr(de->d_name, ext) && STREQLEN(filename, de->d_name, len)) {
+			unsigned int len2 = (int)strlen(de->d_name);
+			char num[7];
+
+			if (len2 > 15) {
+				BLI_strncpy(num, de->d_name + (len2 - 15), sizeof(num));
+
+				if (totframe == maxframe) {
+					maxframe = maxframe ? maxframe * 2 : 256;
+					framenrs = MEM_reallocN(framenrs, sizeof(int) * maxframe);
+				}
+				framenrs[totframe++] = atoi(num);
+			}
+		}
+	}
+	closedir(dir);
+
+	if (totframe == 0)
+		return;
+
+	qsort(framenrs, totframe, sizeof(int), ptcache_frame_cmp);
+
+	/* index */
+	frames = MEM_callocN(sizeof(PTCachePackFrame) * totframe, "PTCachePackFrame");
+	offset = sizeof(PTCachePackHeader) + sizeof(PTCachePackFrame) * totframe;
+
+	for (i = 0; ok && i < totframe; i++) {
+		ptcache_filename(pid, path_full, framenrs[i], 1, 1);
+		frames[i].frame = framenrs[i];
+		frames[i].offset = offset;
+		frames[i].size = BLI_file_size(path_full);
+		ok = (frames[i].size != (uint64_t)(size_t)-1);
+		offset += frames[i].size;
+	}
+
+	memcpy(header.id, PTCACHE_PACK_ID, 8);
+	header.version = PTCACHE_PACK_VERSION;
+	header.totframe = totframe;
+
+	BLI_snprintf(pack_filename_tmp, sizeof(pack_filename_tmp), "%s.tmp", pack_filename);
+	fp = ok ? BLI_fopen(pack_filename_tmp, "wb") : NULL;
+	ok = (fp != NULL);
+
+	if (ok) {
+		ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+		     (fwrite(frames, sizeof(PTCachePackFrame), totframe, fp) == totframe);
+
+		/* the frame files, as they are */
+		for (i = 0; ok && i < totframe; i++) {
+			size_t size = (size_t)frames[i].size;
+			FILE *fp_frame;
+
+			if (size > buf_len) {
+				buf_len = size;
+				if (buf)
+					MEM_freeN(buf);
+				buf = MEM_mallocN(buf_len, "ptcache pack frame");
+			}
+
+			ptcache_filename(pid, path_full, framenrs[i], 1, 1);
+			fp_frame = BLI_fopen(path_full, "rb");
+			ok = (fp_frame != NULL);
+
+			if (ok) {
+				ok = (fread(buf, 1, size, fp_frame) == size) && (fwrite(buf, 1, size, fp) == size);
+				fclose(fp_frame);
+			}
+		}
+
+		ok = (fclose(fp) == 0) && ok;
+
+		if (ok) {
+			ptcache_pack_close(pack_filename);
+			ok = (BLI_rename(pack_filename_tmp, pack_filename) == 0);
+		}
+		if (!ok)
+			BLI_delete(pack_filename_tmp, false, false);
+	}
+
+	/* the pack replaces the frame files */
+	if (ok) {
+		for (i = 0; i < totframe; i++) {
+			ptcache_filename(pid, path_full, framenrs[i], 1, 1);
+			BLI_delete(path_full, false, false);
+		}
+	}
+	else if (G.debug & G_DEBUG) {
+		printf("Error packing disk cache\n");
+	}
+
+	if (buf)
+		MEM_freeN(buf);
+	MEM_freeN(frames);
+	MEM_freeN(framenrs);
+}
+
+/* Move the frames of a disk cache pack back to frame files and remove the pack,
+ * for caches that stop being baked or are cleared. */
+void BKE_ptcache_disk_unpack(PTCacheID *pid)
+{
+	char pack_filename[MAX_PTCACHE_FILE];
+	char path_full[MAX_PTCACHE_FILE];
+	PTCachePack *pack;
+	unsigned int i;
+	bool ok = true;
+
+	if (pid->cache->flag & PTCACHE_EXTERNAL)
+		return;
+
+	if (!ptcache_pack_filename(pid, pack_filename) || !BLI_exists(pack_filename))
+		return;
+
+	/* regardless of PTCACHE_DISK_PACK, the option may have been turned off since baking */
+	pack = ptcache_pack_acquire_file(pack_filename);
+
+	if (pack) {
+		for (i = 0; ok && i < pack->totframe; i++) {
+			const PTCachePackFrame *frame = &pack->frames[i];
+			unsigned char *buf = pack->mem ? pack->mem + frame->offset : ptcache_pack_frame_read(pack, frame);
+			FILE *fp;
+
+			ptcache_filename(pid, path_full, frame->frame, 1, 1);
+			BLI_make_existing_file(path_full);
+			fp = buf ? BLI_fopen(path_full, "wb") : NULL;
+			ok = (fp != NULL);
+
+			if (ok) {
+				ok = (fwrite(buf, 1, (size_t)frame->size, fp) == (size_t)frame->size);
+				ok = (fclose(fp) == 0) && ok;
+			}
+
+			if (buf && !pack->mem)
+				MEM_freeN(buf);
+		}
+
+		ptcache_pack_release(pack);
+	}
+
+	/* a pack that can't be read has no frames to lose */
+	if (ok)
+		ptcache_pack_remove(pid);
+	else if (G.debug & G_DEBUG)
+		printf("Error unpacking disk cache\n");
+}
+
 /* youll need to close yourself after! */
 static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 {
@@ -1545,7 +2061,46 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 	
 	ptcache_filename(pid, filename, cfra, 1, 1);
 
+	/* a frame still being written in the background has to land on disk first */
+	if (mode != PTCACHE_FILE_WRITE_ASYNC && ptcache_writer_pending(filename))
+		BKE_ptcache_flush_writes();
+
 	if (mode==PTCACHE_FILE_READ) {
+		PTCachePack *pack = ptcache_pack_acquire(pid);
+		const PTCachePackFrame *frame = pack ? ptcache_pack_find(pack, cfra) : NULL;
+
+		if (frame) {
+			pf= MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+			pf->fp= NULL;
+			pf->async= NULL;
+			pf->mem_len= (size_t)frame->size;
+			pf->mem_pos= 0;
+			pf->old_format = 0;
+			pf->frame = cfra;
+
+			if (pack->mem) {
+				/* read straight from the mapped pack, the file keeps a user of it */
+				pf->mem= pack->mem + frame->offset;
+				pf->pack= pack;
+			}
+			else {
+				pf->mem= ptcache_pack_frame_read(pack, frame);
+				pf->pack= NULL;
+				ptcache_pack_release(pack);
+
+				if (pf->mem == NULL) {
+					MEM_freeN(pf);
+					return NULL;
+				}
+			}
+
+			return pf;
+		}
+
+		/* frames missing from the pack may still be stored as frame files */
+		if (pack)
+			ptcache_pack_release(pack);
+
 		if (!BLI_exists(filename)) {
 			return NULL;
 		}
@@ -1559,12 +2114,29 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 		BLI_make_existing_file(filename);
 		fp = BLI_fopen(filename, "rb+");
 	}
+	else if (mode==PTCACHE_FILE_WRITE_ASYNC) {
+		/* writes are only recorded, the file is created by ptcache_file_close */
+		BLI_make_existing_file(filename);
+
+		pf= MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+		pf->fp= NULL;
+		pf->async= ptcache_writer_frame_new(filename);
+		pf->mem= NULL;
+		pf->pack= NULL;
+		pf->old_format = 0;
+		pf->frame = cfra;
+
+		return pf;
+	}
 
 	if (!fp)
 		return NULL;
 
 	pf= MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
 	pf->fp= fp;
+	pf->async= NULL;
+	pf->mem= NULL;
+	pf->pack= NULL;
 	pf->old_format = 0;
 	pf->frame = cfra;
 
@@ -1573,7 +2145,14 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 static void ptcache_file_close(PTCacheFile *pf)
 {
 	if (pf) {
-		fclose(pf->fp);
+		if (pf->async)
+			ptcache_writer_submit(pf->async);
+		else if (pf->fp)
+			fclose(pf->fp);
+		else if (pf->pack)
+			ptcache_pack_release(pf->pack);
+		else if (pf->mem)
+			MEM_freeN((void *)pf->mem);
 		MEM_freeN(pf);
 	}
 }
@@ -1625,66 +2204,110 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 
 	return r;
 }
-static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+/* Compress a field for a stream cache, 'out' must hold LZO_OUT_LEN(in_len) bytes.
+ * Returns the compression actually used, 0 when the field is stored as is. */
+static unsigned char ptcache_compress(unsigned char *in, unsigned int in_len, unsigned char *out, size_t *r_out_len,
+                                      unsigned char *props, size_t *r_props_len, int mode)
 {
-	int r = 0;
 	unsigned char compressed = 0;
-	size_t out_len= 0;
-	unsigned char *props = MEM_callocN(16 * sizeof(char), "tmp");
-	size_t sizeOfIt = 5;
 
-	(void)mode; /* unused when building w/o compression */
+	(void)in; (void)props; (void)r_props_len; /* unused when building w/o compression */
+
+	*r_out_len = LZO_OUT_LEN(in_len);
 
 #ifdef WITH_LZO
-	out_len= LZO_OUT_LEN(in_len);
 	if (mode == 1) {
+		int r;
 		LZO_HEAP_ALLOC(wrkmem, LZO1X_MEM_COMPRESS);
 		
-		r = lzo1x_1_compress(in, (lzo_uint)in_len, out, (lzo_uint *)&out_len, wrkmem);
-		if (!(r == LZO_E_OK) || (out_len >= in_len))
-			compressed = 0;
-		else
+		r = lzo1x_1_compress(in, (lzo_uint)in_len, out, (lzo_uint *)r_out_len, wrkmem);
+		if (r == LZO_E_OK && *r_out_len < in_len)
 			compressed = 1;
 	}
 #endif
 #ifdef WITH_LZMA
 	if (mode == 2) {
+		int r;
 		
-		r = LzmaCompress(out, &out_len, in, in_len, //assume sizeof(char)==1....
-		                 props, &sizeOfIt, 5, 1 << 24, 3, 0, 2, 32, 2);
+		r = LzmaCompress(out, r_out_len, in, in_len, //assume sizeof(char)==1....
+		                 props, r_props_len, 5, 1 << 24, 3, 0, 2, 32, 2);
 
-		if (!(r == SZ_OK) || (out_len >= in_len))
-			compressed = 0;
-		else
+		if (r == SZ_OK && *r_out_len < in_len)
 			compressed = 2;
 	}
 #endif
-	
-	ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
+
+	return compressed;
+}
+static int ptcache_file_compressed_record_write(PTCacheFile *pf, unsigned char compressed,
+                                                unsigned char *in, unsigned int in_len,
+                                                unsigned char *out, size_t out_len,
+                                                unsigned char *props, size_t props_len)
+{
+	int ok = ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
+
 	if (compressed) {
 		unsigned int size = out_len;
-		ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
-		ptcache_file_write(pf, out, out_len, sizeof(unsigned char));
+		ok = ok && ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
+		ok = ok && ptcache_file_write(pf, out, out_len, sizeof(unsigned char));
 	}
 	else
-		ptcache_file_write(pf, in, in_len, sizeof(unsigned char));
+		ok = ok && ptcache_file_write(pf, in, in_len, sizeof(unsigned char));
 
 	if (compressed == 2) {
-		unsigned int size = sizeOfIt;
-		ptcache_file_write(pf, &sizeOfIt, 1, sizeof(unsigned int));
-		ptcache_file_write(pf, props, size, sizeof(unsigned char));
+		unsigned int size = props_len;
+		ok = ok && ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
+		ok = ok && ptcache_file_write(pf, props, size, sizeof(unsigned char));
 	}
 
-	MEM_freeN(props);
+	return ok;
+}
+static void ptcache_writer_add_field(struct PTCacheWriteFrame *frame, unsigned char *in, unsigned int in_len, int mode);
+static void ptcache_writer_add_bytes(struct PTCacheWriteFrame *frame, const void *f, size_t len);
 
-	return r;
+static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+{
+	unsigned char compressed;
+	unsigned char props[16];
+	size_t out_len, props_len = 5;
+
+	if (pf->async) {
+		/* compressed later on a worker thread */
+		ptcache_writer_add_field(pf->async, in, in_len, mode);
+		return 1;
+	}
+
+	compressed = ptcache_compress(in, in_len, out, &out_len, props, &props_len, mode);
+
+	return ptcache_file_compressed_record_write(pf, compressed, in, in_len, out, out_len, props, props_len);
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->mem) {
+		size_t len = (size_t)tot * size;
+
+		if (pf->mem_pos + len > pf->mem_len)
+			return 0;
+
+		memcpy(f, pf->mem + pf->mem_pos, len);
+		pf->mem_pos += len;
+		return 1;
+	}
 	return (fread(f, size, tot, pf->fp) == tot);
 }
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin)
+{
+	if (pf->mem)
+		pf->mem_pos = (size_t)((origin == SEEK_SET ? 0 : (long)pf->mem_pos) + offset);
+	else
+		fseek(pf->fp, offset, origin);
+}
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->async) {
+		ptcache_writer_add_bytes(pf->async, f, (size_t)tot * size);
+		return 1;
+	}
 	return (fwrite(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_data_read(PTCacheFile *pf)
@@ -1717,13 +2340,13 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	pf->data_types = 0;
 	
-	if (fread(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_read(pf, bphysics, 8, sizeof(char)))
 		error = 1;
 	
 	if (!error && !STREQLEN(bphysics, "BPHYSICS", 8))
 		error = 1;
 
-	if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int)))
 		error = 1;
 
 	pf->type = (typeflag & PTCACHE_TYPEFLAG_TYPEMASK);
@@ -1731,7 +2354,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	/* if there was an error set file as it was */
 	if (error)
-		fseek(pf->fp, 0, SEEK_SET);
+		ptcache_file_seek(pf, 0, SEEK_SET);
 
 	return !error;
 }
@@ -1740,15 +2363,267 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
 	const char *bphysics = "BPHYSICS";
 	unsigned int typeflag = pf->type + pf->flag;
 	
-	if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_write(pf, bphysics, 8, sizeof(char)))
 		return 0;
 
-	if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int)))
 		return 0;
 	
 	return 1;
 }
 
+/* Background writing of stream caches
+ *
+ * Smoke and dynamic paint frames opened with PTCACHE_FILE_WRITE_ASYNC only record their writes.
+ * On close the frame is handed to the task scheduler: every compressed field becomes a task of
+ * its own, and the task finishing last writes the frame to a temporary file which is then renamed,
+ * so a frame file only ever appears complete. The simulation meanwhile continues with the next step.
+ * The file layout is exactly the one of the direct writer. */
+
+/* frames allowed in flight before the simulation waits for the writer */
+#define PTCACHE_WRITER_MAX_FRAMES 4
+
+typedef struct PTCacheWriteChunk {
+	struct PTCacheWriteFrame *frame;
+
+	unsigned char *data;  /* plain bytes, or a copy of the field to compress */
+	size_t len, alloc_len;
+	int mode;             /* compression mode, 0 for plain bytes */
+
+	/* compression result */
+	unsigned char compressed;
+	unsigned char *out;
+	size_t out_len;
+	unsigned char props[16];
+	size_t props_len;
+} PTCacheWriteChunk;
+
+typedef struct PTCacheWriteFrame {
+	struct PTCacheWriteFrame *next, *prev;
+	char filename[FILE_MAX * 2];
+
+	PTCacheWriteChunk *chunks;
+	int totchunk, maxchunk;
+
+	uint32_t remaining;  /* tasks left before the frame can be written, atomic */
+} PTCacheWriteFrame;
+
+static struct {
+	TaskPool *pool;
+	ListBase frames;  /* PTCacheWriteFrame's not on disk yet */
+	int totframe;
+} ptcache_writer = {NULL};
+
+static ThreadMutex ptcache_writer_lock = BLI_MUTEX_INITIALIZER;
+
+static PTCacheWriteFrame *ptcache_writer_frame_new(const char *filename)
+{
+	PTCacheWriteFrame *frame = MEM_callocN(sizeof(PTCacheWriteFrame), "PTCacheWriteFrame");
+	BLI_strncpy(frame->filename, filename, sizeof(frame->filename));
+	return frame;
+}
+static void ptcache_writer_frame_free(PTCacheWriteFrame *frame)
+{
+	int i;
+
+	for (i = 0; i < frame->totchunk; i++) {
+		if (frame->chunks[i].data)
+			MEM_freeN(frame->chunks[i].data);
+		if (frame->chunks[i].out)
+			MEM_freeN(frame->chunks[i].out);
+	}
+	if (frame->chunks)
+		MEM_freeN(frame->chunks);
+	MEM_freeN(frame);
+}
+static PTCacheWriteChunk *ptcache_writer_chunk_add(PTCacheWriteFrame *frame, int mode)
+{
+	PTCacheWriteChunk *chunk;
+
+	if (frame->totchunk == frame->maxchunk) {
+		frame->maxchunk = frame->maxchunk ? frame->maxchunk * 2 : 16;
+		frame->chunks = MEM_reallocN(frame->chunks, sizeof(PTCacheWriteChunk) * frame->maxchunk);
+	}
+
+	chunk = &frame->chunks[frame->totchunk++];
+	memset(chunk, 0, sizeof(PTCacheWriteChunk));
+	chunk->frame = frame;
+	chunk->mode = mode;
+
+	return chunk;
+}
+static void ptcache_writer_add_bytes(PTCacheWriteFrame *frame, const void *f, size_t len)
+{
+	PTCacheWriteChunk *chunk = frame->totchunk ? &frame->chunks[frame->totchunk - 1] : NULL;
+
+	/* consecutive plain writes share a chunk */
+	if (chunk == NULL || chunk->mode != 0)
+		chunk = ptcache_writer_chunk_add(frame, 0);
+
+	if (chunk->len + len > chunk->alloc_len) {
+		chunk->alloc_len = MAX2(chunk->alloc_len * 2, chunk->len + len);
+		chunk->data = chunk->data ? MEM_reallocN(chunk->data, chunk->alloc_len) :
+		                            MEM_mallocN(chunk->alloc_len, "PTCacheWriteChunk bytes");
+	}
+
+	memcpy(chunk->data + chunk->len, f, len);
+	chunk->len += len;
+}
+static void ptcache_writer_add_field(PTCacheWriteFrame *frame, unsigned char *in, unsigned int in_len, int mode)
+{
+	PTCacheWriteChunk *chunk;
+
+	if (mode == 0) {
+		/* stored as is, same record as ptcache_file_compressed_record_write */
+		unsigned char compressed = 0;
+		ptcache_writer_add_bytes(frame, &compressed, 1);
+		ptcache_writer_add_bytes(frame, in, in_len);
+		return;
+	}
+
+	/* the simulation owns 'in', keep a copy for the worker */
+	chunk = ptcache_writer_chunk_add(frame, mode);
+	chunk->data = MEM_mallocN(MAX2(in_len, 1), "PTCacheWriteChunk field");
+	memcpy(chunk->data, in, in_len);
+	chunk->len = chunk->alloc_len = in_len;
+}
+static void ptcache_writer_frame_write(PTCacheWriteFrame *frame)
+{
+	PTCacheFile pf = {NULL};
+	char filename_tmp[FILE_MAX * 2 + 4];
+	int i, ok;
+
+	BLI_snprintf(filename_tmp, sizeof(filename_tmp), "%s.tmp", frame->filename);
+
+	pf.fp = BLI_fopen(filename_tmp, "wb");
+	ok = (pf.fp != NULL);
+
+	for (i = 0; ok && i < frame->totchunk; i++) {
+		PTCacheWriteChunk *chunk = &frame->chunks[i];
+
+		if (chunk->mode == 0)
+			ok = ptcache_file_write(&pf, chunk->data, chunk->len, sizeof(unsigned char));
+		else
+			ok = ptcache_file_compressed_record_write(&pf, chunk->compressed, chunk->data, chunk->len,
+			                                          chunk->out, chunk->out_len, chunk->props, chunk->props_len);
+	}
+
+	if (pf.fp) {
+		ok = (fclose(pf.fp) == 0) && ok;
+
+		if (ok)
+			ok = (BLI_rename(filename_tmp, frame->filename) == 0);
+		if (!ok)
+			BLI_delete(filename_tmp, false, false);
+	}
+
+	if (!ok && G.debug & G_DEBUG)
+		printf("Error writing to disk cache\n");
+
+	BLI_mutex_lock(&ptcache_writer_lock);
+	BLI_remlink(&ptcache_writer.frames, frame);
+	ptcache_writer.totframe--;
+	BLI_mutex_unlock(&ptcache_writer_lock);
+
+	ptcache_writer_frame_free(frame);
+}
+static void ptcache_writer_frame_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	ptcache_writer_frame_write(taskdata);
+}
+static void ptcache_writer_field_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	PTCacheWriteChunk *chunk = taskdata;
+	PTCacheWriteFrame *frame = chunk->frame;
+
+	chunk->out = MEM_mallocN(LZO_OUT_LEN(chunk->len), "pointcache_lzo_buffer");
+	chunk->props_len = 5;
+	chunk->compressed = ptcache_compress(chunk->data, chunk->len, chunk->out, &chunk->out_len,
+	                                     chunk->props, &chunk->props_len, chunk->mode);
+
+	/* last field done writes the frame */
+	if (atomic_sub_uint32(&frame->remaining, 1) == 0)
+		ptcache_writer_frame_write(frame);
+}
+static void ptcache_writer_submit(PTCacheWriteFrame *frame)
+{
+	PTCacheWriteChunk **fields;
+	int i, totfield = 0;
+	bool wait;
+
+	BLI_mutex_lock(&ptcache_writer_lock);
+	wait = (ptcache_writer.totframe >= PTCACHE_WRITER_MAX_FRAMES);
+	BLI_mutex_unlock(&ptcache_writer_lock);
+
+	/* don't let a fast simulation pile up frames in memory */
+	if (wait)
+		BKE_ptcache_flush_writes();
+
+	fields = MEM_mallocN(sizeof(PTCacheWriteChunk *) * MAX2(frame->totchunk, 1), "PTCacheWriteChunk fields");
+	for (i = 0; i < frame->totchunk; i++) {
+		if (frame->chunks[i].mode != 0)
+			fields[totfield++] = &frame->chunks[i];
+	}
+
+	BLI_mutex_lock(&ptcache_writer_lock);
+	if (ptcache_writer.pool == NULL)
+		ptcache_writer.pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+	BLI_addtail(&ptcache_writer.frames, frame);
+	ptcache_writer.totframe++;
+	BLI_mutex_unlock(&ptcache_writer_lock);
+
+	if (totfield == 0) {
+		BLI_task_pool_push(ptcache_writer.pool, ptcache_writer_frame_task, frame, false, TASK_PRIORITY_LOW);
+	}
+	else {
+		/* the frame may be freed as soon as the last field task is pushed,
+		 * so only the local array is touched from here on */
+		frame->remaining = totfield;
+		for (i = 0; i < totfield; i++)
+			BLI_task_pool_push(ptcache_writer.pool, ptcache_writer_field_task, fields[i], false, TASK_PRIORITY_LOW);
+	}
+
+	MEM_freeN(fields);
+}
+static bool ptcache_writer_pending(const char *filename)
+{
+	PTCacheWriteFrame *frame;
+	bool found = false;
+
+	BLI_mutex_lock(&ptcache_writer_lock);
+	for (frame = ptcache_writer.frames.first; frame; frame = frame->next) {
+		if (STREQ(frame->filename, filename)) {
+			found = true;
+			break;
+		}
+	}
+	BLI_mutex_unlock(&ptcache_writer_lock);
+
+	return found;
+}
+void BKE_ptcache_flush_writes(void)
+{
+	TaskPool *pool;
+
+	BLI_mutex_lock(&ptcache_writer_lock);
+	pool = ptcache_writer.pool;
+	BLI_mutex_unlock(&ptcache_writer_lock);
+
+	if (pool)
+		BLI_task_pool_work_and_wait(pool);
+}
+void BKE_ptcache_exit(void)
+{
+	BKE_ptcache_flush_writes();
+
+	if (ptcache_writer.pool) {
+		BLI_task_pool_free(ptcache_writer.pool);
+		ptcache_writer.pool = NULL;
+	}
+
+	ptcache_pack_close_all();
+}
+
 /* Data pointer handling */
 int BKE_ptcache_data_size(int data_type)
 {
@@ -2351,7 +3226,8 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
 	
 	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
 
-	pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, cfra);
+	/* compression and disk access overlap with the next simulation step */
+	pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE_ASYNC, cfra);
 
 	if (pf==NULL) {
 		if (G.debug & G_DEBUG)
@@ -2573,6 +3449,14 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 	case PTCACHE_CLEAR_BEFORE:
 	case PTCACHE_CLEAR_AFTER:
 		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+			BKE_ptcache_flush_writes();
+
+			/* the pack can't be cleared partially, its frames go back to frame files first */
+			if (mode == PTCACHE_CLEAR_ALL)
+				ptcache_pack_remove(pid);
+			else
+				BKE_ptcache_disk_unpack(pid);
+
 			ptcache_path(pid, path);
 			
 			dir = opendir(path);
@@ -2664,8 +3548,12 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 		
 	case PTCACHE_CLEAR_FRAME:
 		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+			BKE_ptcache_disk_unpack(pid);
+
 			if (BKE_ptcache_id_exist(pid, cfra)) {
 				ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
+				if (ptcache_writer_pending(filename))
+					BKE_ptcache_flush_writes();
 				BLI_delete(filename, false, false);
 			}
 		}
@@ -2700,11 +3588,19 @@ int  BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 		return 0;
 	
 	if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		PTCachePack *pack = ptcache_pack_acquire(pid);
 		char filename[MAX_PTCACHE_FILE];
+
+		if (pack) {
+			const bool found = (ptcache_pack_find(pack, cfra) != NULL);
+			ptcache_pack_release(pack);
+			if (found)
+				return 1;
+		}
 		
 		ptcache_filename(pid, filename, cfra, 1, 1);
 
-		return BLI_exists(filename);
+		return ptcache_writer_pending(filename) || BLI_exists(filename);
 	}
 	else {
 		PTCacheMem *pm = pid->cache->mem_cache.first;
@@ -2774,9 +3670,24 @@ void BKE_ptcache_id_time(PTCacheID *pid, Scene *scene, float cfra, int *startfra
 	if (cache->cached_frames==NULL && cache->endframe > cache->startframe) {
 		unsigned int sta=cache->startframe;
 		unsigned int end=cache->endframe;
+		PTCachePack *pack;
 
 		cache->cached_frames = MEM_callocN(sizeof(char) * (cache->endframe-cache->startframe+1), "cached frames array");
 
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && (pack = ptcache_pack_acquire(pid))) {
+			unsigned int i;
+
+			for (i = 0; i < pack->totframe; i++) {
+				int frame = pack->frames[i].frame;
+
+				if (frame >= (int)sta && frame <= (int)end)
+					cache->cached_frames[frame-sta] = 1;
+			}
+
+			ptcache_pack_release(pack);
+		}
+
+		/* frame files, also next to a pack */
 		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			/* mode is same as fopen's modes */
 			DIR *dir; 
@@ -2786,6 +3697,8 @@ void BKE_ptcache_id_time(PTCacheID *pid, Scene *scene, float cfra, int *startfra
 			char ext[MAX_PTCACHE_PATH];
 			unsigned int len; /* store the length of the string */
 
+			BKE_ptcache_flush_writes();
+
 			ptcache_path(pid, path);
 			
 			len = ptcache_filename(pid, filename, (int)cfra, 0, 0); /* no path */
@@ -2966,6 +3879,9 @@ void BKE_ptcache_remove(void)
 	char path_full[MAX_PTCACHE_PATH];
 	int rmdir = 1;
 	
+	BKE_ptcache_flush_writes();
+	ptcache_pack_close_all();
+
 	ptcache_path(NULL, path);
 
 	if (BLI_exists(path)) {
@@ -3271,6 +4187,8 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 				thread_data.endframe = MIN2(thread_data.endframe, cache->endframe);
 			}
 
+			if (cache->flag & PTCACHE_BAKED)
+				BKE_ptcache_disk_unpack(pid);
 			cache->flag &= ~PTCACHE_BAKED;
 		}
 	}
@@ -3356,6 +4274,10 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 
 		BLI_end_threads(&threads);
 	}
+
+	/* a bake is done only once all its frames are on disk */
+	BKE_ptcache_flush_writes();
+
 	/* clear baking flag */
 	if (pid) {
 		cache->flag &= ~(PTCACHE_BAKING|PTCACHE_REDO_NEEDED);
@@ -3363,8 +4285,11 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 		if (bake) {
 			cache->flag |= PTCACHE_BAKED;
 			/* write info file */
-			if (cache->flag & PTCACHE_DISK_CACHE)
+			if (cache->flag & PTCACHE_DISK_CACHE) {
 				BKE_ptcache_write(pid, 0);
+				if (cache->flag & PTCACHE_DISK_PACK)
+					BKE_ptcache_disk_pack(pid);
+			}
 		}
 	}
 	else {
@@ -3387,8 +4312,11 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 
 				if (bake) {
 					cache->flag |= PTCACHE_BAKED;
-					if (cache->flag & PTCACHE_DISK_CACHE)
+					if (cache->flag & PTCACHE_DISK_CACHE) {
 						BKE_ptcache_write(pid, 0);
+						if (cache->flag & PTCACHE_DISK_PACK)
+							BKE_ptcache_disk_pack(pid);
+					}
 				}
 			}
 			BLI_freelistN(&pidlist);
@@ -3522,6 +4450,17 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
 
 	len = ptcache_filename(pid, old_filename, 0, 0, 0); /* no path */
 
+	BKE_ptcache_flush_writes();
+
+	/* the pack isn't matched by the frame file scan below */
+	if (ptcache_pack_filename(pid, old_path_full) && BLI_exists(old_path_full)) {
+		ptcache_pack_close(old_path_full);
+		BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+		if (ptcache_pack_filename(pid, new_path_full))
+			BLI_rename(old_path_full, new_path_full);
+		BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
+	}
+
 	ptcache_path(pid, path);
 	dir = opendir(path);
 	if (dir==NULL) {
@@ -3576,6 +4515,8 @@ void BKE_ptcache_load_external(PTCacheID *pid)
 	if (!cache)
 		return;
 
+	BKE_ptcache_flush_writes();
+
 	ptcache_path(pid, path);
 	
 	len = ptcache_filename(pid, filename, 1, 0, 0); /* no path */
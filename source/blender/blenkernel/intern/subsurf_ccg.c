@@ -4661,8 +4661,19 @@ struct DerivedMesh *subsurf_make_derived_from_derived(
 			                           useSubsurfUv, dm, false);
 		}
 		else {
-			CCGFlags ccg_flags = useSimple | CCG_USE_ARENA | CCG_CALC_NORMALS;
+			CCGFlags ccg_flags = useSimple | CCG_CALC_NORMALS;
 			CCGSubSurf *prevSS = NULL;
+			/* Final result of a mesh which only deforms is evaluated from
+			 * stencils, keep the cache for as long as topology doesn't change.
+			 * Not using arena for it, since it'd grow on every topology change.
+			 */
+			bool use_stencils = (flags & SUBSURF_IS_FINAL_CALC) &&
+			                    !(flags & SUBSURF_ALLOC_PAINT_MASK) &&
+			                    !use_gpu_backend;
+
+			if (!use_stencils) {
+				ccg_flags |= CCG_USE_ARENA;
+			}
 
 			if (smd->mCache && (flags & SUBSURF_IS_FINAL_CALC)) {
 #ifdef WITH_OPENSUBDIV
@@ -4680,7 +4691,10 @@ struct DerivedMesh *subsurf_make_derived_from_derived(
 				}
 				else
 #endif
-				{
+				if (use_stencils && ccgSubSurf_getUseStencils(smd->mCache)) {
+					prevSS = smd->mCache;
+				}
+				else {
 					ccgSubSurf_free(smd->mCache);
 					smd->mCache = NULL;
 				}
@@ -4694,6 +4708,9 @@ struct DerivedMesh *subsurf_make_derived_from_derived(
 #ifdef WITH_OPENSUBDIV
 			ccgSubSurf_setSkipGrids(ss, use_gpu_backend);
 #endif
+			if (use_stencils) {
+				ccgSubSurf_setUseStencils(ss, 1);
+			}
 			ss_sync_from_derivedmesh(ss, dm, vertCos, useSimple);
 
 			result = getCCGDerivedMesh(ss, drawInteriorEdges, useSubsurfUv, dm, use_gpu_backend);
@@ -73,6 +73,11 @@ enum {
 	 * Terminate reading (no data).
 	 */
 	ENDB = BLEND_MAKE_ID('E', 'N', 'D', 'B'),
+	/**
+	 * Index of the #ID blocks, written after #ENDB
+	 * (used to read single ID's from libraries without reading the whole file).
+	 */
+	INDX = BLEND_MAKE_ID('I', 'N', 'D', 'X'),
 };
 
 #endif  /* __BLO_BLEND_DEFS_H__ */
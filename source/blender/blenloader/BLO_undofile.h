@@ -33,17 +33,24 @@
  *  \ingroup blenloader
  */
 
+struct GHash;
+
 typedef struct {
 	void *next, *prev;
 	
+	/* shared (user counted) between chunks with the same contents */
 	char *buf;
 	unsigned int ident, size;
+	/* hash of 'buf', to find chunks with the same contents */
+	unsigned int hash;
 	
 } MemFileChunk;
 
 typedef struct MemFile {
 	ListBase chunks;
 	unsigned int size;
+	/* all chunks, looked up by contents when writing the next undo step */
+	struct GHash *chunk_hash;
 } MemFile;
 
 /* actually only used writefile.c */
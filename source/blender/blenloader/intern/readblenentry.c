@@ -127,6 +127,21 @@ LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh, int ofblocktype,
 	BHead *bhead;
 	int tot = 0;
 
+	if (fd->bhead_index) {
+		/* names are in the index, no need to read the blocks */
+		int i;
+
+		for (i = 0; i < fd->bhead_index_len; i++) {
+			if (fd->bhead_index[i].code == ofblocktype) {
+				BLI_linklist_prepend(&names, strdup(fd->bhead_index[i].name + 2));
+				tot++;
+			}
+		}
+
+		*tot_names = tot;
+		return names;
+	}
+
 	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (bhead->code == ofblocktype) {
 			const char *idname = bhead_id_name(fd, bhead);
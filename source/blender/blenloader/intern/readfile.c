@@ -231,6 +231,7 @@ static void direct_link_modifiers(FileData *fd, ListBase *lb);
 static void convert_tface_mt(FileData *fd, Main *main);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
+static int64_t fd_data_size(FileData *fd);
 
 /* this function ensures that reports are printed,
  * in the case of libraray linking errors this is important!
@@ -547,9 +548,11 @@ static void read_file_version(FileData *fd, Main *main)
 				main->minsubversionfile= fg->minsubversion;
 				MEM_freeN(fg);
 			}
-			else if (bhead->code == ENDB)
-				break;
+			/* there is only one, stop before reading the rest of the file */
+			break;
 		}
+		else if (bhead->code == ENDB)
+			break;
 	}
 }
 
@@ -563,6 +566,23 @@ static void read_file_bhead_idname_map_create(FileData *fd)
 	int code_prev = ENDB;
 	unsigned int reserve = 0;
 
+	if (fd->bhead_index) {
+		/* maps names to index entries, blocks are only read when they're looked up */
+		int i;
+
+		BLI_assert(fd->bhead_idname_hash == NULL);
+
+		fd->bhead_idname_hash = BLI_ghash_str_new_ex(__func__, fd->bhead_index_len);
+
+		for (i = 0; i < fd->bhead_index_len; i++) {
+			const BHeadIndexEntry *entry = &fd->bhead_index[i];
+			if (BKE_idcode_is_linkable(entry->code)) {
+				BLI_ghash_insert(fd->bhead_idname_hash, (void *)entry->name, (void *)entry);
+			}
+		}
+		return;
+	}
+
 	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (code_prev != bhead->code) {
 			code_prev = bhead->code;
@@ -704,6 +724,7 @@ static BHeadN *get_bhead(FileData *fd)
 	
 	if (fd) {
 		if (!fd->eof) {
+			const int64_t offset = fd->seek;
 			/* initializing to zero isn't strictly needed but shuts valgrind up
 			 * since uninitialized memory gets compared */
 			BHead8 bhead8 = {0};
@@ -770,6 +791,7 @@ static BHeadN *get_bhead(FileData *fd)
 				new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
 				if (new_bhead) {
 					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->offset = offset;
 					new_bhead->bhead = bhead;
 					
 					readsize = fd->read(fd, new_bhead + 1, bhead.len);
@@ -797,17 +819,166 @@ static BHeadN *get_bhead(FileData *fd)
 	return(new_bhead);
 }
 
+/* ID block index, see: BHeadIndexEntry */
+
+/* fd->bhead_offset_hash is keyed by BHeadN.offset, offsets don't fit in a pointer on 32 bit systems */
+static unsigned int bhead_offset_hash(const void *key)
+{
+	const int64_t offset = *(const int64_t *)key;
+	return BLI_ghashutil_uinthash((unsigned int)(offset ^ (offset >> 32)));
+}
+
+static bool bhead_offset_cmp(const void *a, const void *b)
+{
+	return (*(const int64_t *)a != *(const int64_t *)b);
+}
+
+/* read the block at 'offset' (or find it when it was read before) */
+static BHeadN *get_bhead_at_offset(FileData *fd, int64_t offset)
+{
+	BHeadN *new_bhead = BLI_ghash_lookup(fd->bhead_offset_hash, &offset);
+
+	if (new_bhead == NULL) {
+		if (blo_filedata_seek(fd, offset)) {
+			new_bhead = get_bhead(fd);
+			if (new_bhead) {
+				BLI_ghash_insert(fd->bhead_offset_hash, &new_bhead->offset, new_bhead);
+			}
+		}
+	}
+
+	return new_bhead;
+}
+
+/* size of a BHead as stored in the file */
+static int bhead_file_size(const FileData *fd)
+{
+	return (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) ? sizeof(BHead4) : sizeof(BHead8);
+}
+
+static BHead *bhead_index_entry_read(FileData *fd, const BHeadIndexEntry *entry)
+{
+	BHeadN *new_bhead = entry ? get_bhead_at_offset(fd, entry->offset) : NULL;
+	return new_bhead ? &new_bhead->bhead : NULL;
+}
+
+static const BHeadIndexEntry *bhead_index_find_offset(const FileData *fd, int64_t offset)
+{
+	int low = 0, high = fd->bhead_index_len - 1;
+
+	/* entries are written in file order */
+	while (low <= high) {
+		const int mid = (low + high) / 2;
+		if (offset < fd->bhead_index[mid].offset) {
+			high = mid - 1;
+		}
+		else if (offset > fd->bhead_index[mid].offset) {
+			low = mid + 1;
+		}
+		else {
+			return &fd->bhead_index[mid];
+		}
+	}
+
+	return NULL;
+}
+
+static int verg_bhead_index_old(const void *v1, const void *v2)
+{
+	const BHeadIndexEntry *x1 = *(const BHeadIndexEntry **)v1, *x2 = *(const BHeadIndexEntry **)v2;
+
+	if (x1->old > x2->old) return 1;
+	else if (x1->old < x2->old) return -1;
+	return 0;
+}
+
+static const BHeadIndexEntry *bhead_index_find_old(FileData *fd, const void *old)
+{
+	BHeadIndexEntry entry_s;
+	const BHeadIndexEntry *entry_p = &entry_s, **entry;
+
+	if (fd->bhead_index_old == NULL) {
+		int i;
+		fd->bhead_index_old = MEM_mallocN(sizeof(*fd->bhead_index_old) * fd->bhead_index_len, __func__);
+		for (i = 0; i < fd->bhead_index_len; i++) {
+			fd->bhead_index_old[i] = &fd->bhead_index[i];
+		}
+		qsort(fd->bhead_index_old, fd->bhead_index_len, sizeof(*fd->bhead_index_old), verg_bhead_index_old);
+	}
+
+	entry_s.old = (uint64_t)(intptr_t)old;
+	entry = bsearch(&entry_p, fd->bhead_index_old, fd->bhead_index_len, sizeof(*fd->bhead_index_old),
+	                verg_bhead_index_old);
+
+	return entry ? *entry : NULL;
+}
+
+/**
+ * Use the index of ID blocks at the end of the file (when there is one),
+ * from then on blocks are only read when they are accessed.
+ */
+static bool read_file_bhead_index(FileData *fd)
+{
+	BHeadIndexFooter footer;
+	BHeadN *new_bhead;
+	int64_t size;
+
+	/* offsets and old pointers are used as is */
+	if (fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS)) {
+		return false;
+	}
+
+	size = fd_data_size(fd);
+	if (size < SIZEOFBLENDERHEADER + (int64_t)sizeof(footer)) {
+		return false;
+	}
+
+	if ((blo_filedata_seek(fd, size - (int64_t)sizeof(footer)) == false) ||
+	    (fd->read(fd, &footer, sizeof(footer)) != sizeof(footer)) ||
+	    (memcmp(footer.magic, BHEAD_INDEX_MAGIC, sizeof(footer.magic)) != 0) ||
+	    (footer.index_offset < SIZEOFBLENDERHEADER) || (footer.index_offset >= size) ||
+	    (footer.entries_len < 0))
+	{
+		blo_filedata_seek(fd, SIZEOFBLENDERHEADER);
+		return false;
+	}
+
+	fd->bhead_offset_hash = BLI_ghash_new(bhead_offset_hash, bhead_offset_cmp, __func__);
+
+	new_bhead = get_bhead_at_offset(fd, footer.index_offset);
+	if ((new_bhead == NULL) || (new_bhead->bhead.code != INDX) ||
+	    (new_bhead->bhead.len != (int)(sizeof(BHeadIndexEntry) * footer.entries_len + sizeof(footer))))
+	{
+		BLI_ghash_free(fd->bhead_offset_hash, NULL, NULL);
+		fd->bhead_offset_hash = NULL;
+		BLI_freelistN(&fd->listbase);
+		blo_filedata_seek(fd, SIZEOFBLENDERHEADER);
+		return false;
+	}
+
+	/* entries point into the block data, freed along with fd->listbase */
+	fd->bhead_index = (const BHeadIndexEntry *)(new_bhead + 1);
+	fd->bhead_index_len = footer.entries_len;
+
+	return true;
+}
+
 BHead *blo_firstbhead(FileData *fd)
 {
 	BHeadN *new_bhead;
 	BHead *bhead = NULL;
 	
-	/* Rewind the file
-	 * Read in a new block if necessary
-	 */
-	new_bhead = fd->listbase.first;
-	if (new_bhead == NULL) {
-		new_bhead = get_bhead(fd);
+	if (fd->bhead_index) {
+		new_bhead = get_bhead_at_offset(fd, SIZEOFBLENDERHEADER);
+	}
+	else {
+		/* Rewind the file
+		 * Read in a new block if necessary
+		 */
+		new_bhead = fd->listbase.first;
+		if (new_bhead == NULL) {
+			new_bhead = get_bhead(fd);
+		}
 	}
 	
 	if (new_bhead) {
@@ -817,11 +988,15 @@ BHead *blo_firstbhead(FileData *fd)
 	return(bhead);
 }
 
-BHead *blo_prevbhead(FileData *UNUSED(fd), BHead *thisblock)
+/* not supported when reading blocks on demand, see: BHeadIndexEntry */
+BHead *blo_prevbhead(FileData *fd, BHead *thisblock)
 {
 	BHeadN *bheadn = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
 	BHeadN *prev = bheadn->prev;
 	
+	BLI_assert(fd->bhead_index == NULL);
+	UNUSED_VARS_NDEBUG(fd);
+
 	return (prev) ? &prev->bhead : NULL;
 }
 
@@ -835,10 +1010,16 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 		 * We calculate the BHeadN pointer from the BHead pointer below */
 		new_bhead = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
 		
-		/* get the next BHeadN. If it doesn't exist we read in the next one */
-		new_bhead = new_bhead->next;
-		if (new_bhead == NULL) {
-			new_bhead = get_bhead(fd);
+		if (fd->bhead_index) {
+			/* blocks in fd->listbase are not in file order */
+			new_bhead = get_bhead_at_offset(fd, new_bhead->offset + bhead_file_size(fd) + thisblock->len);
+		}
+		else {
+			/* get the next BHeadN. If it doesn't exist we read in the next one */
+			new_bhead = new_bhead->next;
+			if (new_bhead == NULL) {
+				new_bhead = get_bhead(fd);
+			}
 		}
 	}
 	
@@ -897,7 +1078,16 @@ static int read_file_dna(FileData *fd)
 {
 	BHead *bhead;
 	
-	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+	if (read_file_bhead_index(fd)) {
+		const BHeadIndexFooter *footer = (const BHeadIndexFooter *)(fd->bhead_index + fd->bhead_index_len);
+		BHeadN *new_bhead = get_bhead_at_offset(fd, footer->dna_offset);
+		bhead = new_bhead ? &new_bhead->bhead : NULL;
+	}
+	else {
+		bhead = blo_firstbhead(fd);
+	}
+
+	for (; bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (bhead->code == DNA1) {
 			const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
 			
@@ -945,6 +1135,234 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, unsigned int
 	return (readsize);
 }
 
+/* ------------- block compressed files, see: BLEND_GZIP_BLOCK_SIZE ------------- */
+
+typedef struct GzipBlock {
+	off_t file_offset;      /* offset of the gzip member in the file */
+	int64_t offset;         /* offset of the first uncompressed byte */
+	unsigned int file_len;  /* size of the gzip member */
+	unsigned int len;       /* uncompressed size */
+} GzipBlock;
+
+typedef struct GzipBlockReader {
+	/* blocks found so far, extended on demand while reading or seeking */
+	GzipBlock *blocks;
+	int blocks_len, blocks_alloc;
+	off_t file_offset_next;
+	bool file_end;
+
+	/* the last decompressed block */
+	int block_cache;
+	char *buf, *buf_file;
+	unsigned int buf_file_alloc;
+} GzipBlockReader;
+
+static unsigned int gzblock_get_u16(const unsigned char *buf)
+{
+	return (unsigned int)buf[0] | ((unsigned int)buf[1] << 8);
+}
+
+static unsigned int gzblock_get_u32(const unsigned char *buf)
+{
+	return ((unsigned int)buf[0]) | ((unsigned int)buf[1] << 8) |
+	       ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+}
+
+/* check the header of a gzip member, return false when it's not written as a block */
+static bool gzblock_header_decode(const unsigned char header[BLEND_GZIP_BLOCK_HEADER_SIZE],
+                                  unsigned int *r_file_len, unsigned int *r_len)
+{
+	if ((header[0] == 0x1f) && (header[1] == 0x8b) && (header[2] == 0x08) && (header[3] == 0x04) &&
+	    (gzblock_get_u16(&header[10]) == BLEND_GZIP_BLOCK_XLEN) &&
+	    (header[12] == 'B') && (header[13] == 'L') && (gzblock_get_u16(&header[14]) == 8))
+	{
+		*r_file_len = gzblock_get_u32(&header[16]);
+		*r_len = gzblock_get_u32(&header[20]);
+
+		return ((*r_file_len > BLEND_GZIP_BLOCK_HEADER_SIZE + BLEND_GZIP_BLOCK_TRAILER_SIZE) &&
+		        (*r_len <= BLEND_GZIP_BLOCK_SIZE));
+	}
+
+	return false;
+}
+
+/* read headers of the following gzip members, until the block containing 'offset' is known */
+static int gzblock_find(FileData *fd, int64_t offset)
+{
+	GzipBlockReader *gzb = fd->gzblocks;
+	int low, high;
+
+	/* the common case, sequential reading */
+	if (gzb->block_cache != -1) {
+		const GzipBlock *block = &gzb->blocks[gzb->block_cache];
+		if (offset >= block->offset && offset < block->offset + (int64_t)block->len) {
+			return gzb->block_cache;
+		}
+	}
+
+	while (!gzb->file_end &&
+	       ((gzb->blocks_len == 0) ||
+	        (offset >= gzb->blocks[gzb->blocks_len - 1].offset + (int64_t)gzb->blocks[gzb->blocks_len - 1].len)))
+	{
+		unsigned char header[BLEND_GZIP_BLOCK_HEADER_SIZE];
+		GzipBlock *block;
+		unsigned int file_len, len;
+
+		if ((lseek(fd->filedes, gzb->file_offset_next, SEEK_SET) == -1) ||
+		    (read(fd->filedes, header, sizeof(header)) != sizeof(header)) ||
+		    (gzblock_header_decode(header, &file_len, &len) == false))
+		{
+			gzb->file_end = true;
+			break;
+		}
+
+		if (gzb->blocks_len == gzb->blocks_alloc) {
+			gzb->blocks_alloc = gzb->blocks_alloc ? gzb->blocks_alloc * 2 : 256;
+			gzb->blocks = MEM_reallocN(gzb->blocks, sizeof(*gzb->blocks) * gzb->blocks_alloc);
+		}
+
+		block = &gzb->blocks[gzb->blocks_len];
+		block->file_offset = gzb->file_offset_next;
+		block->file_len = file_len;
+		block->len = len;
+		block->offset = gzb->blocks_len ? gzb->blocks[gzb->blocks_len - 1].offset + (int64_t)gzb->blocks[gzb->blocks_len - 1].len : 0;
+
+		gzb->blocks_len++;
+		gzb->file_offset_next += file_len;
+	}
+
+	/* binary search, blocks are sorted by offset */
+	low = 0;
+	high = gzb->blocks_len - 1;
+	while (low <= high) {
+		const int mid = (low + high) / 2;
+		const GzipBlock *block = &gzb->blocks[mid];
+
+		if (offset < block->offset) {
+			high = mid - 1;
+		}
+		else if (offset >= block->offset + (int64_t)block->len) {
+			low = mid + 1;
+		}
+		else {
+			return mid;
+		}
+	}
+
+	return -1;
+}
+
+static bool gzblock_decompress(FileData *fd, int index)
+{
+	GzipBlockReader *gzb = fd->gzblocks;
+	const GzipBlock *block = &gzb->blocks[index];
+	const unsigned char *trailer;
+	z_stream strm = {NULL};
+	int err;
+
+	if (gzb->block_cache == index) {
+		return true;
+	}
+	gzb->block_cache = -1;
+
+	if (block->file_len > gzb->buf_file_alloc) {
+		gzb->buf_file_alloc = block->file_len;
+		gzb->buf_file = MEM_reallocN(gzb->buf_file, gzb->buf_file_alloc);
+	}
+
+	if ((lseek(fd->filedes, block->file_offset, SEEK_SET) == -1) ||
+	    (read(fd->filedes, gzb->buf_file, block->file_len) != (int)block->file_len))
+	{
+		return false;
+	}
+
+	if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+		return false;
+	}
+
+	strm.next_in = (Bytef *)gzb->buf_file + BLEND_GZIP_BLOCK_HEADER_SIZE;
+	strm.avail_in = block->file_len - (BLEND_GZIP_BLOCK_HEADER_SIZE + BLEND_GZIP_BLOCK_TRAILER_SIZE);
+	strm.next_out = (Bytef *)gzb->buf;
+	strm.avail_out = block->len;
+
+	err = inflate(&strm, Z_FINISH);
+	inflateEnd(&strm);
+
+	trailer = (const unsigned char *)gzb->buf_file + block->file_len - BLEND_GZIP_BLOCK_TRAILER_SIZE;
+
+	if ((err != Z_STREAM_END) || (strm.total_out != block->len) ||
+	    (gzblock_get_u32(trailer) != (unsigned int)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)gzb->buf, block->len)))
+	{
+		printf("%s: zlib error in block %d\n", __func__, index);
+		return false;
+	}
+
+	gzb->block_cache = index;
+	return true;
+}
+
+static int fd_read_gzip_blocks_from_file(FileData *filedata, void *buffer, unsigned int size)
+{
+	GzipBlockReader *gzb = filedata->gzblocks;
+	unsigned int totread = 0;
+
+	while (totread < size) {
+		const int index = gzblock_find(filedata, filedata->seek);
+		const GzipBlock *block;
+		unsigned int blockoffset, readsize;
+
+		if (index == -1 || !gzblock_decompress(filedata, index)) {
+			break;
+		}
+
+		block = &gzb->blocks[index];
+		blockoffset = (unsigned int)(filedata->seek - block->offset);
+		readsize = MIN2(size - totread, block->len - blockoffset);
+
+		memcpy(POINTER_OFFSET(buffer, totread), gzb->buf + blockoffset, readsize);
+		totread += readsize;
+		filedata->seek += readsize;
+	}
+
+	return (int)totread;
+}
+
+static bool fd_read_gzip_blocks_test(int file)
+{
+	unsigned char header[BLEND_GZIP_BLOCK_HEADER_SIZE];
+	unsigned int file_len, len;
+
+	return ((read(file, header, sizeof(header)) == sizeof(header)) &&
+	        (gzblock_header_decode(header, &file_len, &len)));
+}
+
+/* takes ownership of 'file' */
+static void fd_read_gzip_blocks_init(FileData *fd, int file)
+{
+	GzipBlockReader *gzb = MEM_callocN(sizeof(*gzb), __func__);
+
+	gzb->block_cache = -1;
+	gzb->buf = MEM_mallocN(BLEND_GZIP_BLOCK_SIZE, "gzblock buf");
+
+	fd->filedes = file;
+	fd->gzblocks = gzb;
+	fd->read = fd_read_gzip_blocks_from_file;
+}
+
+static void fd_read_gzip_blocks_free(FileData *fd)
+{
+	GzipBlockReader *gzb = fd->gzblocks;
+
+	MEM_SAFE_FREE(gzb->blocks);
+	MEM_SAFE_FREE(gzb->buf_file);
+	MEM_freeN(gzb->buf);
+	MEM_freeN(gzb);
+
+	fd->gzblocks = NULL;
+}
+
+/* ------------- end block compressed files ------------- */
+
 static int fd_read_from_memory(FileData *filedata, void *buffer, unsigned int size)
 {
 	/* don't read more bytes then there are available in the buffer */
@@ -1060,6 +1478,23 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 {
 	gzFile gzfile;
+	int file;
+
+	/* block compressed files support seeking, so read them without zlib's stream */
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file != -1) {
+		if (fd_read_gzip_blocks_test(file)) {
+			FileData *fd = filedata_new();
+			fd_read_gzip_blocks_init(fd, file);
+
+			/* needed for library_append and read_libraries */
+			BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+			return blo_decode_and_check(fd, reports);
+		}
+		close(file);
+	}
+
 	errno = 0;
 	gzfile = BLI_gzopen(filepath, "rb");
 	
@@ -1084,12 +1519,23 @@ static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, unsigned i
 {
 	int err;
 
+	/* zlib can't make progress without output space (ENDB has no data) */
+	if (size == 0) return 0;
+
 	filedata->strm.next_out = (Bytef *) buffer;
 	filedata->strm.avail_out = size;
 
 	// Inflate another chunk.
 	err = inflate (&filedata->strm, Z_SYNC_FLUSH);
 
+	/* block compressed files are concatenated gzip members, continue with the next one */
+	while ((err == Z_STREAM_END) && (filedata->strm.avail_in != 0)) {
+		err = inflateReset(&filedata->strm);
+		if ((err == Z_OK) && (filedata->strm.avail_out != 0)) {
+			err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+		}
+	}
+
 	if (err == Z_STREAM_END) {
 		return 0;
 	}
@@ -1167,6 +1613,64 @@ FileData *blo_openblendermemfile(MemFile *memfile, ReportList *reports)
 }
 
 
+/* size of the (uncompressed) file data, -1 when it can't be found without reading the whole file */
+static int64_t fd_data_size(FileData *fd)
+{
+	if (fd->gzblocks) {
+		const GzipBlockReader *gzb = fd->gzblocks;
+		gzblock_find(fd, INT64_MAX);
+		return gzb->blocks_len ? gzb->blocks[gzb->blocks_len - 1].offset + (int64_t)gzb->blocks[gzb->blocks_len - 1].len : -1;
+	}
+	else if (fd->gzfiledes && gzdirect(fd->gzfiledes)) {
+		const size_t size = BLI_file_size(fd->relabase);
+		return (size != (size_t)-1) ? (int64_t)size : -1;
+	}
+
+	return -1;
+}
+
+/**
+ * Move the read position to \a offset in the (uncompressed) file data,
+ * the following #get_bhead calls continue reading from there.
+ *
+ * \return false when the data can't be seeked.
+ */
+bool blo_filedata_seek(FileData *fd, int64_t offset)
+{
+	if (offset < 0) {
+		return false;
+	}
+
+	if (fd->gzblocks) {
+		if (gzblock_find(fd, offset) == -1) {
+			return false;
+		}
+	}
+	else if (fd->gzfiledes) {
+		/* cheap for uncompressed files, gzip streams are decompressed up to 'offset',
+		 * fails for offsets zlib can't represent (z_off_t is 32 bit on some platforms) */
+		if (((int64_t)(z_off_t)offset != offset) ||
+		    (gzseek(fd->gzfiledes, (z_off_t)offset, SEEK_SET) != (z_off_t)offset))
+		{
+			return false;
+		}
+	}
+	else if (fd->read == fd_read_from_memory) {
+		if (offset > fd->buffersize) {
+			return false;
+		}
+	}
+	else if (fd->read != fd_read_from_memfile) {
+		/* gzip from memory, or runtimes (which start at an offset in the file) */
+		return false;
+	}
+
+	fd->seek = offset;
+	fd->eof = 0;
+
+	return true;
+}
+
 void blo_freefiledata(FileData *fd)
 {
 	if (fd) {
@@ -1178,6 +1682,10 @@ void blo_freefiledata(FileData *fd)
 			gzclose(fd->gzfiledes);
 		}
 		
+		if (fd->gzblocks != NULL) {
+			fd_read_gzip_blocks_free(fd);
+		}
+		
 		if (fd->strm.next_in) {
 			if (inflateEnd (&fd->strm) != Z_OK) {
 				printf("close gzip stream error\n");
@@ -1216,6 +1724,11 @@ void blo_freefiledata(FileData *fd)
 		if (fd->bheadmap)
 			MEM_freeN(fd->bheadmap);
 		
+		if (fd->bhead_index_old)
+			MEM_freeN((void *)fd->bhead_index_old);
+		if (fd->bhead_offset_hash)
+			BLI_ghash_free(fd->bhead_offset_hash, NULL, NULL);
+		
 #ifdef USE_GHASH_BHEAD
 		if (fd->bhead_idname_hash) {
 			BLI_ghash_free(fd->bhead_idname_hash, NULL, NULL);
@@ -4131,7 +4644,7 @@ static void direct_link_particlesystems(FileData *fd, ListBase *particles)
 		}
 
 		psys->tree = NULL;
-		psys->bvhtree = NULL;
+		psys->sph_grid = NULL;
 	}
 	return;
 }
@@ -4348,7 +4861,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
 		if (layer->flag & CD_FLAG_EXTERNAL)
 			layer->flag &= ~CD_FLAG_IN_MEMORY;
 
-		layer->flag &= ~CD_FLAG_NOFREE;
+		layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
 		
 		if (CustomData_verify_versions(data, i)) {
 			layer->data = newdataadr(fd, layer->data);
@@ -8287,6 +8800,20 @@ static BHead *find_previous_lib(FileData *fd, BHead *bhead)
 	if (fd->memfile)
 		return NULL;
 
+	if (fd->bhead_index) {
+		const BHeadN *bheadn = (const BHeadN *)POINTER_OFFSET(bhead, -offsetof(BHeadN, bhead));
+		const BHeadIndexEntry *entry = bhead_index_find_offset(fd, bheadn->offset);
+
+		if (entry) {
+			for (; entry >= fd->bhead_index; entry--) {
+				if (entry->code == ID_LI) {
+					return bhead_index_entry_read(fd, entry);
+				}
+			}
+		}
+		return NULL;
+	}
+
 	for (; bhead; bhead = blo_prevbhead(fd, bhead)) {
 		if (bhead->code == ID_LI)
 			break;
@@ -8305,6 +8832,10 @@ static BHead *find_bhead(FileData *fd, void *old)
 	if (!old)
 		return NULL;
 
+	if (fd->bhead_index) {
+		return bhead_index_entry_read(fd, bhead_index_find_old(fd, old));
+	}
+
 	if (fd->bheadmap == NULL)
 		sort_bhead_old_map(fd);
 	
@@ -8333,6 +8864,10 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 	*((short *)idname_full) = idcode;
 	BLI_strncpy(idname_full + 2, name, sizeof(idname_full) - 2);
 
+	if (fd->bhead_index) {
+		return bhead_index_entry_read(fd, BLI_ghash_lookup(fd->bhead_idname_hash, idname_full));
+	}
+
 	return BLI_ghash_lookup(fd->bhead_idname_hash, idname_full);
 
 #else
@@ -8357,6 +8892,10 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname)
 {
 #ifdef USE_GHASH_BHEAD
+	if (fd->bhead_index) {
+		return bhead_index_entry_read(fd, BLI_ghash_lookup(fd->bhead_idname_hash, idname));
+	}
+
 	return BLI_ghash_lookup(fd->bhead_idname_hash, idname);
 #else
 	return find_bhead_from_code_name(fd, GS(idname), idname + 2);
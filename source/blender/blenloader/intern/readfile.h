@@ -43,6 +43,7 @@ struct Object;
 struct PartEff;
 struct View3D;
 struct Key;
+struct GzipBlockReader;
 
 typedef struct FileData {
 	// linked list of BHeadN's
@@ -50,7 +51,7 @@ typedef struct FileData {
 	int flags;
 	int eof;
 	int buffersize;
-	int seek;
+	int64_t seek;
 	int (*read)(struct FileData *filedata, void *buffer, unsigned int size);
 
 	// variables needed for reading from memory / stream
@@ -61,6 +62,8 @@ typedef struct FileData {
 	// variables needed for reading from file
 	int filedes;
 	gzFile gzfiledes;
+	// random access reading of block compressed files, see: BLEND_GZIP_BLOCK_SIZE
+	struct GzipBlockReader *gzblocks;
 
 	// now only in use for library appending
 	char relabase[FILE_MAX];
@@ -94,6 +97,13 @@ typedef struct FileData {
 
 	/* see: USE_GHASH_BHEAD */
 	struct GHash *bhead_idname_hash;
+
+	/* when the file has an index of ID blocks, these are read on demand
+	 * (in any order), see: BHeadIndexEntry */
+	const struct BHeadIndexEntry *bhead_index;
+	int bhead_index_len;
+	const struct BHeadIndexEntry **bhead_index_old;  /* sorted by BHeadIndexEntry.old */
+	struct GHash *bhead_offset_hash;
 	
 	ListBase *mainlist;
 	
@@ -106,6 +116,7 @@ typedef struct FileData {
 
 typedef struct BHeadN {
 	struct BHeadN *next, *prev;
+	int64_t offset;  /* position in the file */
 	struct BHead bhead;
 } BHeadN;
 
@@ -119,6 +130,52 @@ typedef struct BHeadN {
 
 #define SIZEOFBLENDERHEADER 12
 
+/* Block compressed files.
+ *
+ * The file is a sequence of gzip members, each holding an independently deflated
+ * block of at most BLEND_GZIP_BLOCK_SIZE bytes, so any gzip reader can still read it
+ * as a single stream. Every member header stores an extra field (subfield 'B' 'L')
+ * with the compressed member size and uncompressed block size, which allows blocks
+ * to be compressed in parallel and located without decompressing the whole file.
+ *
+ * Member layout (all integers little endian):
+ * - gzip header:      1f 8b 08 04, mtime (4), xfl (1), os (1)
+ * - extra length:     uint16, BLEND_GZIP_BLOCK_XLEN
+ * - extra subfield:   'B' 'L', uint16 length 8, uint32 member size, uint32 block size
+ * - deflate data
+ * - gzip trailer:     uint32 crc32, uint32 block size
+ */
+#define BLEND_GZIP_BLOCK_SIZE          (1 << 18)
+#define BLEND_GZIP_BLOCK_XLEN          12
+#define BLEND_GZIP_BLOCK_HEADER_SIZE   (12 + BLEND_GZIP_BLOCK_XLEN)
+#define BLEND_GZIP_BLOCK_TRAILER_SIZE  8
+
+/* ID block index, stored in the #INDX block after #ENDB.
+ *
+ * Lists the file offset of every ID block (the ID's direct data follows it),
+ * so the ID's needed from a library can be read without reading the whole file.
+ * Integers use the endianness and the offsets the layout of the file,
+ * #BHeadIndexFooter is at the end of the block (and the file).
+ * Offsets are 64 bit so files over 2GB can be indexed too. */
+typedef struct BHeadIndexEntry {
+	int code;
+	int _pad0;
+	int64_t offset;
+	uint64_t old;
+	char name[66];  /* MAX_ID_NAME */
+	char _pad[6];
+} BHeadIndexEntry;
+
+typedef struct BHeadIndexFooter {
+	int64_t index_offset;  /* offset of the #INDX block */
+	int64_t dna_offset;    /* offset of the #DNA1 block */
+	int entries_len;
+	int _pad;
+	char magic[8];
+} BHeadIndexFooter;
+
+#define BHEAD_INDEX_MAGIC "BLENDIX2"
+
 /***/
 struct Main;
 void blo_join_main(ListBase *mainlist);
@@ -147,6 +204,8 @@ BHead *blo_firstbhead(FileData *fd);
 BHead *blo_nextbhead(FileData *fd, BHead *thisblock);
 BHead *blo_prevbhead(FileData *fd, BHead *thisblock);
 
+bool blo_filedata_seek(FileData *fd, int64_t offset);
+
 const char *bhead_id_name(const FileData *fd, const BHead *bhead);
 
 /* do versions stuff */
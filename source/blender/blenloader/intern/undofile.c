@@ -40,19 +40,63 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_undofile.h"
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* Chunk buffers are shared by all chunks with the same contents, in the same
+ * or other undo steps, so they're freed when the last chunk using it is. */
+typedef struct MemFileChunkBuf {
+	unsigned int users;
+	unsigned int _pad;
+} MemFileChunkBuf;
+
+#define CHUNK_BUF_HEADER(buf) ((MemFileChunkBuf *)(buf) - 1)
+
+static char *memfile_chunk_buf_new(const char *buf, unsigned int size)
+{
+	MemFileChunkBuf *chunk_buf = MEM_mallocN(sizeof(MemFileChunkBuf) + size, "Chunk buffer");
+	chunk_buf->users = 1;
+	memcpy(chunk_buf + 1, buf, size);
+	return (char *)(chunk_buf + 1);
+}
+
+static void memfile_chunk_buf_free(char *buf)
+{
+	MemFileChunkBuf *chunk_buf = CHUNK_BUF_HEADER(buf);
+	if (--chunk_buf->users == 0) {
+		MEM_freeN(chunk_buf);
+	}
+}
+
+static unsigned int memfile_chunk_hash(const void *key)
+{
+	return ((const MemFileChunk *)key)->hash;
+}
+
+static bool memfile_chunk_cmp(const void *a, const void *b)
+{
+	const MemFileChunk *chunk_a = a, *chunk_b = b;
+	return ((chunk_a->hash != chunk_b->hash) ||
+	        (chunk_a->size != chunk_b->size) ||
+	        (memcmp(chunk_a->buf, chunk_b->buf, chunk_a->size) != 0));
+}
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
 	MemFileChunk *chunk;
 	
+	if (memfile->chunk_hash) {
+		BLI_ghash_free(memfile->chunk_hash, NULL, NULL);
+		memfile->chunk_hash = NULL;
+	}
+
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->ident == 0)
-			MEM_freeN(chunk->buf);
+		memfile_chunk_buf_free(chunk->buf);
 		MEM_freeN(chunk);
 	}
 	memfile->size = 0;
@@ -62,75 +106,86 @@ void BLO_memfile_free(MemFile *memfile)
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-	MemFileChunk *fc, *sc;
-	
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->ident) {
-				sc->ident = 0;
-				fc->ident = 1;
-			}
-		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
-	}
-	
+	/* buffers shared with 'second' stay, since it holds its own users */
+	UNUSED_VARS(second);
+
 	BLO_memfile_free(first);
 }
 
-static int my_memcmp(const int *mem1, const int *mem2, const int len)
+/* find a chunk with the same contents as 'chunk_test' */
+static MemFileChunk *memfile_chunk_find(MemFile *memfile, const MemFileChunk *chunk_test)
 {
-	register int a = len;
-	register const int *mema = mem1;
-	register const int *memb = mem2;
-	
-	while (a--) {
-		if (*mema != *memb) return 1;
-		mema++;
-		memb++;
-	}
-	return 0;
+	return memfile->chunk_hash ? BLI_ghash_lookup(memfile->chunk_hash, chunk_test) : NULL;
 }
 
+/**
+ * Add a chunk to \a current, sharing its buffer with a chunk that has the same contents.
+ *
+ * Chunks are first compared with the chunk at the same position in the previous undo step
+ * (the common case, only some ID's changed), then looked up by contents in the previous
+ * and current step, so inserted or removed data doesn't prevent sharing the chunks after it.
+ */
 void memfile_chunk_add(MemFile *compare, MemFile *current, const char *buf, unsigned int size)
 {
+	static MemFile *compfile = NULL;
 	static MemFileChunk *compchunk = NULL;
-	MemFileChunk *curchunk;
+	MemFileChunk *curchunk, *samechunk = NULL;
 	
 	/* this function inits when compare != NULL or when current == NULL  */
 	if (compare) {
+		compfile = compare;
 		compchunk = compare->chunks.first;
 		return;
 	}
 	if (current == NULL) {
+		compfile = NULL;
 		compchunk = NULL;
 		return;
 	}
 	
 	curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
 	curchunk->size = size;
-	curchunk->buf = NULL;
+	curchunk->buf = (char *)buf;
 	curchunk->ident = 0;
 	BLI_addtail(&current->chunks, curchunk);
 	
-	/* we compare compchunk with buf */
+	/* we compare compchunk with buf, avoids hashing when nothing changed */
 	if (compchunk) {
-		if (compchunk->size == curchunk->size) {
-			if (my_memcmp((int *)compchunk->buf, (const int *)buf, size / 4) == 0) {
-				curchunk->buf = compchunk->buf;
-				curchunk->ident = 1;
-			}
+		if ((compchunk->size == size) && (memcmp(compchunk->buf, buf, size) == 0)) {
+			samechunk = compchunk;
+			curchunk->hash = compchunk->hash;
 		}
 		compchunk = compchunk->next;
 	}
+
+	if (samechunk == NULL) {
+		curchunk->hash = BLI_hash_mm2((const unsigned char *)buf, size, 0);
+
+		samechunk = memfile_chunk_find(current, curchunk);
+		if ((samechunk == NULL) && compfile) {
+			samechunk = memfile_chunk_find(compfile, curchunk);
+		}
+	}
 	
-	/* not equal... */
-	if (curchunk->buf == NULL) {
-		curchunk->buf = MEM_mallocN(size, "Chunk buffer");
-		memcpy(curchunk->buf, buf, size);
+	if (samechunk) {
+		curchunk->buf = samechunk->buf;
+		curchunk->ident = 1;
+		CHUNK_BUF_HEADER(curchunk->buf)->users++;
+	}
+	else {
+		/* not equal... */
+		curchunk->buf = memfile_chunk_buf_new(buf, size);
 		current->size += size;
 	}
-}
 
+	/* for lookups from the next undo step (keeps the first chunk with these contents) */
+	if (current->chunk_hash == NULL) {
+		current->chunk_hash = BLI_ghash_new(memfile_chunk_hash, memfile_chunk_cmp, __func__);
+	}
+	{
+		void **val_p;
+		if (!BLI_ghash_ensure_p(current->chunk_hash, curchunk, &val_p)) {
+			*val_p = curchunk;
+		}
+	}
+}
@@ -143,6 +143,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender.h"
@@ -150,6 +151,7 @@
 #include "BKE_curve.h"
 #include "BKE_constraint.h"
 #include "BKE_global.h" // for G
+#include "BKE_idcode.h"
 #include "BKE_library.h" // for  set_listbasepointers
 #include "BKE_main.h"
 #include "BKE_node.h"
@@ -188,8 +190,15 @@
 typedef enum {
 	WW_WRAP_NONE = 1,
 	WW_WRAP_ZLIB,
+	WW_WRAP_ZLIB_BLOCKS,
 } eWriteWrapType;
 
+/* Compress files as independent blocks on worker threads, see: BLEND_GZIP_BLOCK_SIZE.
+ * The result is still a valid gzip stream, comment out to write a single gzip stream. */
+#define USE_WRITE_ZLIB_BLOCKS
+
+struct WriteWrapBlocks;
+
 typedef struct WriteWrap WriteWrap;
 struct WriteWrap {
 	/* callbacks */
@@ -201,6 +210,7 @@ struct WriteWrap {
 	union {
 		int file_handle;
 		gzFile gz_handle;
+		struct WriteWrapBlocks *blocks;
 	} _user_data;
 };
 
@@ -260,6 +270,241 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* zlib blocks */
+#define FILE_HANDLE(ww) \
+	(ww)->_user_data.blocks
+
+/* number of blocks compressed at once, per thread */
+#define WW_BLOCKS_PER_THREAD 4
+
+typedef struct WriteWrapBlock {
+	char *buf_in;   /* uncompressed data, BLEND_GZIP_BLOCK_SIZE */
+	char *buf_out;  /* complete gzip member */
+	size_t in_len, out_len;
+	bool error;
+} WriteWrapBlock;
+
+typedef struct WriteWrapBlocks {
+	int file_handle;
+	TaskPool *task_pool;
+
+	/* Two batches of blocks: one is filled while the other one is compressed,
+	 * so writing the file overlaps with compression. */
+	WriteWrapBlock *batch[2];
+	int batch_size;
+	int batch_used[2];
+	int batch_active;
+	bool batch_pending;
+
+	bool error;
+} WriteWrapBlocks;
+
+static void ww_block_put_u16(unsigned char *buf, unsigned int value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+}
+
+static void ww_block_put_u32(unsigned char *buf, unsigned int value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+	buf[2] = (unsigned char)((value >> 16) & 0xff);
+	buf[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+static void ww_block_compress_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	WriteWrapBlock *block = taskdata;
+	unsigned char *out = (unsigned char *)block->buf_out;
+	z_stream strm = {NULL};
+	size_t deflate_len;
+	uLong crc;
+
+	/* raw deflate, the gzip header and trailer are written here */
+	if (deflateInit2(&strm, 1, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		block->error = true;
+		return;
+	}
+
+	strm.next_in = (Bytef *)block->buf_in;
+	strm.avail_in = (uInt)block->in_len;
+	strm.next_out = out + BLEND_GZIP_BLOCK_HEADER_SIZE;
+	strm.avail_out = (uInt)compressBound(BLEND_GZIP_BLOCK_SIZE);
+
+	if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&strm);
+		block->error = true;
+		return;
+	}
+
+	deflate_len = strm.total_out;
+	deflateEnd(&strm);
+
+	crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)block->buf_in, (uInt)block->in_len);
+
+	block->out_len = BLEND_GZIP_BLOCK_HEADER_SIZE + deflate_len + BLEND_GZIP_BLOCK_TRAILER_SIZE;
+
+	/* gzip header, with FEXTRA set */
+	out[0] = 0x1f;
+	out[1] = 0x8b;
+	out[2] = 0x08;
+	out[3] = 0x04;
+	ww_block_put_u32(&out[4], 0);
+	out[8] = 0;
+	out[9] = 0xff;
+	ww_block_put_u16(&out[10], BLEND_GZIP_BLOCK_XLEN);
+	out[12] = 'B';
+	out[13] = 'L';
+	ww_block_put_u16(&out[14], 8);
+	ww_block_put_u32(&out[16], (unsigned int)block->out_len);
+	ww_block_put_u32(&out[20], (unsigned int)block->in_len);
+
+	/* gzip trailer */
+	out += BLEND_GZIP_BLOCK_HEADER_SIZE + deflate_len;
+	ww_block_put_u32(&out[0], (unsigned int)crc);
+	ww_block_put_u32(&out[4], (unsigned int)block->in_len);
+}
+
+/* wait for the compressed batch and write it out in order */
+static void ww_blocks_write_pending(WriteWrapBlocks *wwb)
+{
+	WriteWrapBlock *batch;
+	int batch_index, i;
+
+	if (!wwb->batch_pending) {
+		return;
+	}
+
+	BLI_task_pool_work_and_wait(wwb->task_pool);
+	wwb->batch_pending = false;
+
+	batch_index = !wwb->batch_active;
+	batch = wwb->batch[batch_index];
+
+	for (i = 0; i < wwb->batch_used[batch_index]; i++) {
+		WriteWrapBlock *block = &batch[i];
+
+		if (block->error ||
+		    ((size_t)write(wwb->file_handle, block->buf_out, block->out_len) != block->out_len))
+		{
+			wwb->error = true;
+		}
+
+		block->in_len = 0;
+		block->out_len = 0;
+		block->error = false;
+	}
+
+	wwb->batch_used[batch_index] = 0;
+}
+
+/* hand the active batch over to the worker threads, and continue filling the other one */
+static void ww_blocks_compress_active(WriteWrapBlocks *wwb)
+{
+	const int batch_index = wwb->batch_active;
+	WriteWrapBlock *batch = wwb->batch[batch_index];
+	int i;
+
+	/* include the partially filled block */
+	if (wwb->batch_used[batch_index] < wwb->batch_size && batch[wwb->batch_used[batch_index]].in_len) {
+		wwb->batch_used[batch_index]++;
+	}
+
+	ww_blocks_write_pending(wwb);
+
+	for (i = 0; i < wwb->batch_used[batch_index]; i++) {
+		BLI_task_pool_push(wwb->task_pool, ww_block_compress_task, &batch[i], false, TASK_PRIORITY_HIGH);
+	}
+
+	wwb->batch_pending = true;
+	wwb->batch_active = !batch_index;
+}
+
+static bool ww_open_zlib_blocks(WriteWrap *ww, const char *filepath)
+{
+	WriteWrapBlocks *wwb;
+	TaskScheduler *task_scheduler;
+	int file, i, j;
+
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+	if (file == -1) {
+		return false;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+
+	wwb = MEM_callocN(sizeof(*wwb), __func__);
+	wwb->file_handle = file;
+	wwb->task_pool = BLI_task_pool_create(task_scheduler, NULL);
+	wwb->batch_size = BLI_task_scheduler_num_threads(task_scheduler) * WW_BLOCKS_PER_THREAD;
+
+	for (i = 0; i < 2; i++) {
+		wwb->batch[i] = MEM_callocN(sizeof(WriteWrapBlock) * wwb->batch_size, __func__);
+		for (j = 0; j < wwb->batch_size; j++) {
+			WriteWrapBlock *block = &wwb->batch[i][j];
+			block->buf_in = MEM_mallocN(BLEND_GZIP_BLOCK_SIZE, "ww_block_in");
+			block->buf_out = MEM_mallocN(
+			        BLEND_GZIP_BLOCK_HEADER_SIZE + compressBound(BLEND_GZIP_BLOCK_SIZE) + BLEND_GZIP_BLOCK_TRAILER_SIZE,
+			        "ww_block_out");
+		}
+	}
+
+	FILE_HANDLE(ww) = wwb;
+	return true;
+}
+static bool ww_close_zlib_blocks(WriteWrap *ww)
+{
+	WriteWrapBlocks *wwb = FILE_HANDLE(ww);
+	bool ok;
+	int i, j;
+
+	ww_blocks_compress_active(wwb);
+	ww_blocks_write_pending(wwb);
+
+	BLI_task_pool_free(wwb->task_pool);
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < wwb->batch_size; j++) {
+			MEM_freeN(wwb->batch[i][j].buf_in);
+			MEM_freeN(wwb->batch[i][j].buf_out);
+		}
+		MEM_freeN(wwb->batch[i]);
+	}
+
+	ok = (close(wwb->file_handle) != -1) && !wwb->error;
+
+	MEM_freeN(wwb);
+	FILE_HANDLE(ww) = NULL;
+
+	return ok;
+}
+static size_t ww_write_zlib_blocks(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+	WriteWrapBlocks *wwb = FILE_HANDLE(ww);
+	size_t written = 0;
+
+	while (written < buf_len) {
+		WriteWrapBlock *block = &wwb->batch[wwb->batch_active][wwb->batch_used[wwb->batch_active]];
+		const size_t len = MIN2(buf_len - written, BLEND_GZIP_BLOCK_SIZE - block->in_len);
+
+		memcpy(block->buf_in + block->in_len, buf + written, len);
+		block->in_len += len;
+		written += len;
+
+		if (block->in_len == BLEND_GZIP_BLOCK_SIZE) {
+			if (++wwb->batch_used[wwb->batch_active] == wwb->batch_size) {
+				ww_blocks_compress_active(wwb);
+			}
+		}
+	}
+
+	/* errors from previous batches */
+	return wwb->error ? 0 : written;
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -274,6 +519,13 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 			r_ww->write = ww_write_zlib;
 			break;
 		}
+		case WW_WRAP_ZLIB_BLOCKS:
+		{
+			r_ww->open  = ww_open_zlib_blocks;
+			r_ww->close = ww_close_zlib_blocks;
+			r_ww->write = ww_write_zlib_blocks;
+			break;
+		}
 		default:
 		{
 			r_ww->open  = ww_open_none;
@@ -295,13 +547,19 @@ typedef struct {
 	unsigned char *buf;
 	MemFile *compare, *current;
 	
-	int tot, count, error, memsize;
+	int64_t tot;  /* bytes written so far, the offsets of #BHeadIndexEntry */
+	int count, error, memsize;
 
 	/* Wrap writing, so we can use zlib or
 	 * other compression types later, see: G_FILE_COMPRESS
 	 * Will be NULL for UNDO. */
 	WriteWrap *ww;
 
+	/* offsets of ID blocks, written after ENDB, see: BHeadIndexEntry.
+	 * Will be NULL for UNDO. */
+	BHeadIndexEntry *bhead_index;
+	int bhead_index_len, bhead_index_alloc;
+
 #ifdef USE_BMESH_SAVE_AS_COMPAT
 	char use_mesh_compat; /* option to save with older mesh format */
 #endif
@@ -346,6 +604,10 @@ static void writedata_free(WriteData *wd)
 {
 	DNA_sdna_free(wd->sdna);
 
+	if (wd->bhead_index) {
+		MEM_freeN(wd->bhead_index);
+	}
+
 	MEM_freeN(wd->buf);
 	MEM_freeN(wd);
 }
@@ -422,6 +684,12 @@ static WriteData *bgnwrite(WriteWrap *ww, MemFile *compare, MemFile *current)
 	wd->current= current;
 	/* this inits comparing */
 	memfile_chunk_add(compare, NULL, NULL, 0);
+
+	/* the index is only useful for reading files from disk */
+	if (current == NULL) {
+		wd->bhead_index_alloc = 1024;
+		wd->bhead_index = MEM_mallocN(sizeof(*wd->bhead_index) * wd->bhead_index_alloc, "bhead_index");
+	}
 	
 	return wd;
 }
@@ -449,6 +717,48 @@ static int endwrite(WriteData *wd)
 
 /* ********** WRITE FILE ****************** */
 
+static void write_bhead_index_add(WriteData *wd, int filecode, const void *adr, const ID *id)
+{
+	BHeadIndexEntry *entry;
+
+	if (wd->bhead_index_len == wd->bhead_index_alloc) {
+		wd->bhead_index_alloc *= 2;
+		wd->bhead_index = MEM_reallocN(wd->bhead_index, sizeof(*wd->bhead_index) * wd->bhead_index_alloc);
+	}
+
+	entry = &wd->bhead_index[wd->bhead_index_len++];
+	memset(entry, 0, sizeof(*entry));
+	entry->code = filecode;
+	entry->offset = wd->tot;
+	entry->old = (uint64_t)(intptr_t)adr;
+	BLI_strncpy(entry->name, id->name, sizeof(entry->name));
+}
+
+/**
+ * Write the index of all ID blocks as a block after #ENDB,
+ * readers that don't know about it stop reading at #ENDB.
+ */
+static void write_bhead_index(WriteData *wd, int64_t dna_offset)
+{
+	BHeadIndexFooter footer = {0};
+	BHead bh;
+
+	footer.index_offset = wd->tot;
+	footer.dna_offset = dna_offset;
+	footer.entries_len = wd->bhead_index_len;
+	memcpy(footer.magic, BHEAD_INDEX_MAGIC, sizeof(footer.magic));
+
+	bh.code = INDX;
+	bh.old = NULL;
+	bh.nr = 1;
+	bh.SDNAnr = 0;
+	bh.len = (int)(sizeof(BHeadIndexEntry) * wd->bhead_index_len + sizeof(footer));
+
+	mywrite(wd, &bh, sizeof(BHead));
+	mywrite(wd, wd->bhead_index, (int)sizeof(BHeadIndexEntry) * wd->bhead_index_len);
+	mywrite(wd, &footer, sizeof(footer));
+}
+
 static void writestruct_at_address(WriteData *wd, int filecode, const char *structname, int nr, void *adr, void *data)
 {
 	BHead bh;
@@ -472,6 +782,17 @@ static void writestruct_at_address(WriteData *wd, int filecode, const char *stru
 
 	if (bh.len==0) return;
 
+	if ((filecode != DATA) && BKE_idcode_is_valid(filecode)) {
+		if (wd->bhead_index) {
+			write_bhead_index_add(wd, filecode, adr, data);
+		}
+		else if (wd->current) {
+			/* start each ID in a new undo chunk, so changing an ID
+			 * doesn't change the chunks of the ID's after it */
+			mywrite(wd, MYWRITE_FLUSH, 0);
+		}
+	}
+
 	mywrite(wd, &bh, sizeof(BHead));
 	mywrite(wd, data, bh.len);
 }
@@ -3705,6 +4026,7 @@ static int write_file_handle(
 	ListBase mainlist;
 	char buf[16];
 	WriteData *wd;
+	int64_t dna_offset;
 
 	blo_split_main(&mainlist, mainvar);
 
@@ -3772,6 +4094,7 @@ static int write_file_handle(
 	}
 							
 	/* dna as last, because (to be implemented) test for which structs are written */
+	dna_offset = wd->tot;
 	writedata(wd, DNA1, wd->sdna->datalen, wd->sdna->data);
 
 #ifdef USE_NODE_COMPAT_CUSTOMNODES
@@ -3790,6 +4113,10 @@ static int write_file_handle(
 	bhead.code= ENDB;
 	mywrite(wd, &bhead, sizeof(BHead));
 
+	if (wd->bhead_index) {
+		write_bhead_index(wd, dna_offset);
+	}
+
 	blo_join_main(&mainlist);
 
 	return endwrite(wd);
@@ -3846,7 +4173,11 @@ int BLO_write_file(Main *mainvar, const char *filepath, int write_flags, ReportL
 	BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
 	if (write_flags & G_FILE_COMPRESS) {
+#ifdef USE_WRITE_ZLIB_BLOCKS
+		ww_type = WW_WRAP_ZLIB_BLOCKS;
+#else
 		ww_type = WW_WRAP_ZLIB;
+#endif
 	}
 	else {
 		ww_type = WW_WRAP_NONE;
@@ -3897,7 +4228,9 @@ int BLO_write_file(Main *mainvar, const char *filepath, int write_flags, ReportL
 	/* actual file writing */
 	err = write_file_handle(mainvar, &ww, NULL, NULL, write_user_block, write_flags, thumb);
 
-	ww.close(&ww);
+	if (ww.close(&ww) == false) {
+		err = 1;
+	}
 
 	if (UNLIKELY(path_list_backup)) {
 		BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
@@ -40,6 +40,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_mempool.h"
+#include "BLI_bitmap.h"
 
 #include "BKE_customdata.h"
 
@@ -50,6 +51,27 @@
 #include "BLI_strict_flags.h"
 
 
+typedef struct {
+	float co[3];
+	short no[3];
+	char hflag;
+	float mask;
+} BMLogVert;
+
+typedef struct {
+	unsigned int v_ids[3];
+	char hflag;
+} BMLogFace;
+
+/* Compact storage for one of the GHashes of a BMLogEntry, elements
+ * and their IDs are stored in the same order */
+typedef struct {
+	/* BMLogVert or BMLogFace */
+	void *elems;
+	unsigned int *ids;
+	unsigned int len;
+} BMLogArray;
+
 struct BMLogEntry {
 	struct BMLogEntry *next, *prev;
 
@@ -72,6 +94,18 @@ struct BMLogEntry {
 	BLI_mempool *pool_verts;
 	BLI_mempool *pool_faces;
 
+	/* Once no more changes are recorded in the entry, the GHashes and
+	 * pools above are freed and their contents moved into these
+	 * arrays, which take far less memory and are faster to iterate
+	 * over on undo/redo. See BM_log_entry_compact(). */
+	BMLogArray c_deleted_verts;
+	BMLogArray c_deleted_faces;
+	BMLogArray c_added_verts;
+	BMLogArray c_added_faces;
+	BMLogArray c_modified_verts;
+	BMLogArray c_modified_faces;
+	bool is_compact;
+
 	/* This is only needed for dropping BMLogEntries while still in
 	 * dynamic-topology mode, as that should release vert/face IDs
 	 * back to the BMLog but no BMLog pointer is available at that
@@ -112,18 +146,6 @@ struct BMLog {
 	BMLogEntry *current_entry;
 };
 
-typedef struct {
-	float co[3];
-	short no[3];
-	char hflag;
-	float mask;
-} BMLogVert;
-
-typedef struct {
-	unsigned int v_ids[3];
-	char hflag;
-} BMLogFace;
-
 /************************* Get/set element IDs ************************/
 
 /* bypass actual hashing, the keys don't overlap */
@@ -247,16 +269,15 @@ static BMLogFace *bm_log_face_alloc(BMLog *log, BMFace *f)
 
 /************************ Helpers for undo/redo ***********************/
 
-static void bm_log_verts_unmake(BMesh *bm, BMLog *log, GHash *verts)
+static void bm_log_verts_unmake(BMesh *bm, BMLog *log, BMLogArray *verts)
 {
 	const int cd_vert_mask_offset = CustomData_get_offset(&bm->vdata, CD_PAINT_MASK);
+	BMLogVert *lverts = verts->elems;
+	unsigned int i;
 
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, verts) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		BMLogVert *lv = BLI_ghashIterator_getValue(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
-		BMVert *v = bm_log_vert_from_id(log, id);
+	for (i = 0; i < verts->len; i++) {
+		BMLogVert *lv = &lverts[i];
+		BMVert *v = bm_log_vert_from_id(log, verts->ids[i]);
 
 		/* Ensure the log has the final values of the vertex before
 		 * deleting it */
@@ -266,54 +287,54 @@ static void bm_log_verts_unmake(BMesh *bm, BMLog *log, GHash *verts)
 	}
 }
 
-static void bm_log_faces_unmake(BMesh *bm, BMLog *log, GHash *faces)
+static void bm_log_faces_unmake(BMesh *bm, BMLog *log, BMLogArray *faces)
 {
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, faces) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
-		BMFace *f = bm_log_face_from_id(log, id);
+	unsigned int i;
+
+	for (i = 0; i < faces->len; i++) {
+		BMFace *f = bm_log_face_from_id(log, faces->ids[i]);
 		BMEdge *e_tri[3];
 		BMLoop *l_iter;
-		int i;
+		int j;
 
 		l_iter = BM_FACE_FIRST_LOOP(f);
-		for (i = 0; i < 3; i++, l_iter = l_iter->next) {
-			e_tri[i] = l_iter->e;
+		for (j = 0; j < 3; j++, l_iter = l_iter->next) {
+			e_tri[j] = l_iter->e;
 		}
 
 		/* Remove any unused edges */
 		BM_face_kill(bm, f);
-		for (i = 0; i < 3; i++) {
-			if (BM_edge_is_wire(e_tri[i])) {
-				BM_edge_kill(bm, e_tri[i]);
+		for (j = 0; j < 3; j++) {
+			if (BM_edge_is_wire(e_tri[j])) {
+				BM_edge_kill(bm, e_tri[j]);
 			}
 		}
 	}
 }
 
-static void bm_log_verts_restore(BMesh *bm, BMLog *log, GHash *verts)
+static void bm_log_verts_restore(BMesh *bm, BMLog *log, BMLogArray *verts)
 {
 	const int cd_vert_mask_offset = CustomData_get_offset(&bm->vdata, CD_PAINT_MASK);
+	const BMLogVert *lverts = verts->elems;
+	unsigned int i;
 
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, verts) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		BMLogVert *lv = BLI_ghashIterator_getValue(&gh_iter);
+	for (i = 0; i < verts->len; i++) {
+		const BMLogVert *lv = &lverts[i];
 		BMVert *v = BM_vert_create(bm, lv->co, NULL, BM_CREATE_NOP);
 		vert_mask_set(v, lv->mask, cd_vert_mask_offset);
 		v->head.hflag = lv->hflag;
 		normal_short_to_float_v3(v->no, lv->no);
-		bm_log_vert_id_set(log, v, GET_UINT_FROM_POINTER(key));
+		bm_log_vert_id_set(log, v, verts->ids[i]);
 	}
 }
 
-static void bm_log_faces_restore(BMesh *bm, BMLog *log, GHash *faces)
+static void bm_log_faces_restore(BMesh *bm, BMLog *log, BMLogArray *faces)
 {
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, faces) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		BMLogFace *lf = BLI_ghashIterator_getValue(&gh_iter);
+	const BMLogFace *lfaces = faces->elems;
+	unsigned int i;
+
+	for (i = 0; i < faces->len; i++) {
+		const BMLogFace *lf = &lfaces[i];
 		BMVert *v[3] = {bm_log_vert_from_id(log, lf->v_ids[0]),
 		                bm_log_vert_from_id(log, lf->v_ids[1]),
 		                bm_log_vert_from_id(log, lf->v_ids[2])};
@@ -321,20 +342,19 @@ static void bm_log_faces_restore(BMesh *bm, BMLog *log, GHash *faces)
 
 		f = BM_face_create_verts(bm, v, 3, NULL, BM_CREATE_NOP, true);
 		f->head.hflag = lf->hflag;
-		bm_log_face_id_set(log, f, GET_UINT_FROM_POINTER(key));
+		bm_log_face_id_set(log, f, faces->ids[i]);
 	}
 }
 
-static void bm_log_vert_values_swap(BMesh *bm, BMLog *log, GHash *verts)
+static void bm_log_vert_values_swap(BMesh *bm, BMLog *log, BMLogArray *verts)
 {
 	const int cd_vert_mask_offset = CustomData_get_offset(&bm->vdata, CD_PAINT_MASK);
+	BMLogVert *lverts = verts->elems;
+	unsigned int i;
 
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, verts) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		BMLogVert *lv = BLI_ghashIterator_getValue(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
-		BMVert *v = bm_log_vert_from_id(log, id);
+	for (i = 0; i < verts->len; i++) {
+		BMLogVert *lv = &lverts[i];
+		BMVert *v = bm_log_vert_from_id(log, verts->ids[i]);
 		float mask;
 		short normal[3];
 
@@ -349,14 +369,14 @@ static void bm_log_vert_values_swap(BMesh *bm, BMLog *log, GHash *verts)
 	}
 }
 
-static void bm_log_face_values_swap(BMLog *log, GHash *faces)
+static void bm_log_face_values_swap(BMLog *log, BMLogArray *faces)
 {
-	GHashIterator gh_iter;
-	GHASH_ITER (gh_iter, faces) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		BMLogFace *lf = BLI_ghashIterator_getValue(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
-		BMFace *f = bm_log_face_from_id(log, id);
+	BMLogFace *lfaces = faces->elems;
+	unsigned int i;
+
+	for (i = 0; i < faces->len; i++) {
+		BMLogFace *lf = &lfaces[i];
+		BMFace *f = bm_log_face_from_id(log, faces->ids[i]);
 
 		SWAP(char, f->head.hflag, lf->hflag);
 	}
@@ -385,6 +405,89 @@ static void bm_log_assign_ids(BMesh *bm, BMLog *log)
 	}
 }
 
+/* Allocate storage for 'len' elements of 'elem_size' bytes and their
+ * IDs, in a single block */
+static void bm_log_array_alloc(BMLogArray *arr, const unsigned int len, const size_t elem_size)
+{
+	if (len) {
+		arr->elems = MEM_mallocN((elem_size + sizeof(*arr->ids)) * len, __func__);
+		arr->ids = (unsigned int *)((char *)arr->elems + elem_size * len);
+	}
+	else {
+		arr->elems = NULL;
+		arr->ids = NULL;
+	}
+	arr->len = 0;
+}
+
+static void bm_log_array_free(BMLogArray *arr)
+{
+	if (arr->elems) {
+		MEM_freeN(arr->elems);
+	}
+	arr->elems = NULL;
+	arr->ids = NULL;
+	arr->len = 0;
+}
+
+/* Append an element, the array must have been allocated large enough */
+BLI_INLINE void bm_log_array_append(BMLogArray *arr, const unsigned int id, const void *elem, const size_t elem_size)
+{
+	memcpy((char *)arr->elems + elem_size * arr->len, elem, elem_size);
+	arr->ids[arr->len] = id;
+	arr->len++;
+}
+
+BLI_INLINE const void *bm_log_array_elem(const BMLogArray *arr, const unsigned int i, const size_t elem_size)
+{
+	return (const char *)arr->elems + elem_size * i;
+}
+
+/* Reallocate the array to its exact length */
+static void bm_log_array_shrink(BMLogArray *arr, const unsigned int capacity, const size_t elem_size)
+{
+	if (arr->len != capacity) {
+		BMLogArray arr_new;
+		bm_log_array_alloc(&arr_new, arr->len, elem_size);
+		if (arr->len) {
+			memcpy(arr_new.elems, arr->elems, elem_size * arr->len);
+			memcpy(arr_new.ids, arr->ids, sizeof(*arr->ids) * arr->len);
+		}
+		arr_new.len = arr->len;
+		bm_log_array_free(arr);
+		*arr = arr_new;
+	}
+}
+
+static void bm_log_array_from_ghash(BMLogArray *arr, GHash *id_ghash, const size_t elem_size)
+{
+	GHashIterator gh_iter;
+
+	bm_log_array_alloc(arr, BLI_ghash_size(id_ghash), elem_size);
+
+	GHASH_ITER (gh_iter, id_ghash) {
+		void *key = BLI_ghashIterator_getKey(&gh_iter);
+		void *elem = BLI_ghashIterator_getValue(&gh_iter);
+		bm_log_array_append(arr, GET_UINT_FROM_POINTER(key), elem, elem_size);
+	}
+}
+
+static GHash *bm_log_array_to_ghash(BMLogArray *arr, BLI_mempool *pool, const size_t elem_size)
+{
+	GHash *id_ghash = BLI_ghash_new_ex(logkey_hash, logkey_cmp, __func__, arr->len);
+	unsigned int i;
+
+	for (i = 0; i < arr->len; i++) {
+		void *elem = BLI_mempool_alloc(pool);
+		memcpy(elem, bm_log_array_elem(arr, i, elem_size), elem_size);
+		BLI_ghash_insert(id_ghash, SET_UINT_IN_POINTER(arr->ids[i]), elem);
+	}
+
+	bm_log_array_free(arr);
+
+	return id_ghash;
+}
+
 /* Allocate an empty log entry */
 static BMLogEntry *bm_log_entry_create(void)
 {
@@ -403,10 +506,7 @@ static BMLogEntry *bm_log_entry_create(void)
 	return entry;
 }
 
-/* Free the data in a log entry
- *
- * Note: does not free the log entry itself */
-static void bm_log_entry_free(BMLogEntry *entry)
+static void bm_log_entry_ghash_free(BMLogEntry *entry)
 {
 	BLI_ghash_free(entry->deleted_verts, NULL, NULL);
 	BLI_ghash_free(entry->deleted_faces, NULL, NULL);
@@ -417,18 +517,95 @@ static void bm_log_entry_free(BMLogEntry *entry)
 
 	BLI_mempool_destroy(entry->pool_verts);
 	BLI_mempool_destroy(entry->pool_faces);
+
+	entry->deleted_verts = entry->deleted_faces = NULL;
+	entry->added_verts = entry->added_faces = NULL;
+	entry->modified_verts = entry->modified_faces = NULL;
+	entry->pool_verts = entry->pool_faces = NULL;
 }
 
-static void bm_log_id_ghash_retake(RangeTreeUInt *unused_ids, GHash *id_ghash)
+/* Move the GHash contents of an entry into arrays
+ *
+ * Done once an entry isn't recorded into anymore, undo/redo only
+ * needs to iterate over the elements. Recording into the entry again
+ * is still possible, but will expand it first. */
+void BM_log_entry_compact(BMLogEntry *entry)
 {
-	GHashIterator gh_iter;
+	if (entry->is_compact) {
+		return;
+	}
 
-	GHASH_ITER (gh_iter, id_ghash) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
+	bm_log_array_from_ghash(&entry->c_deleted_verts, entry->deleted_verts, sizeof(BMLogVert));
+	bm_log_array_from_ghash(&entry->c_deleted_faces, entry->deleted_faces, sizeof(BMLogFace));
+	bm_log_array_from_ghash(&entry->c_added_verts, entry->added_verts, sizeof(BMLogVert));
+	bm_log_array_from_ghash(&entry->c_added_faces, entry->added_faces, sizeof(BMLogFace));
+	bm_log_array_from_ghash(&entry->c_modified_verts, entry->modified_verts, sizeof(BMLogVert));
+	bm_log_array_from_ghash(&entry->c_modified_faces, entry->modified_faces, sizeof(BMLogFace));
+
+	bm_log_entry_ghash_free(entry);
+
+	entry->is_compact = true;
+}
 
-		range_tree_uint_retake(unused_ids, id);
+/* Inverse of BM_log_entry_compact(), needed when recording into an
+ * entry again */
+static void bm_log_entry_expand(BMLogEntry *entry)
+{
+	if (!entry->is_compact) {
+		return;
 	}
+
+	entry->pool_verts = BLI_mempool_create(sizeof(BMLogVert), 0, 64, BLI_MEMPOOL_NOP);
+	entry->pool_faces = BLI_mempool_create(sizeof(BMLogFace), 0, 64, BLI_MEMPOOL_NOP);
+
+	entry->deleted_verts = bm_log_array_to_ghash(&entry->c_deleted_verts, entry->pool_verts, sizeof(BMLogVert));
+	entry->deleted_faces = bm_log_array_to_ghash(&entry->c_deleted_faces, entry->pool_faces, sizeof(BMLogFace));
+	entry->added_verts = bm_log_array_to_ghash(&entry->c_added_verts, entry->pool_verts, sizeof(BMLogVert));
+	entry->added_faces = bm_log_array_to_ghash(&entry->c_added_faces, entry->pool_faces, sizeof(BMLogFace));
+	entry->modified_verts = bm_log_array_to_ghash(&entry->c_modified_verts, entry->pool_verts, sizeof(BMLogVert));
+	entry->modified_faces = bm_log_array_to_ghash(&entry->c_modified_faces, entry->pool_faces, sizeof(BMLogFace));
+
+	entry->is_compact = false;
+}
+
+/* Free the data in a log entry
+ *
+ * Note: does not free the log entry itself */
+static void bm_log_entry_free(BMLogEntry *entry)
+{
+	if (entry->is_compact) {
+		bm_log_array_free(&entry->c_deleted_verts);
+		bm_log_array_free(&entry->c_deleted_faces);
+		bm_log_array_free(&entry->c_added_verts);
+		bm_log_array_free(&entry->c_added_faces);
+		bm_log_array_free(&entry->c_modified_verts);
+		bm_log_array_free(&entry->c_modified_faces);
+	}
+	else {
+		bm_log_entry_ghash_free(entry);
+	}
+}
+
+static void bm_log_ids_retake(RangeTreeUInt *unused_ids, const BMLogArray *arr)
+{
+	unsigned int i;
+
+	for (i = 0; i < arr->len; i++) {
+		range_tree_uint_retake(unused_ids, arr->ids[i]);
+	}
+}
+
+/* Take all IDs used by the entry */
+static void bm_log_entry_ids_retake(RangeTreeUInt *unused_ids, BMLogEntry *entry)
+{
+	BM_log_entry_compact(entry);
+
+	bm_log_ids_retake(unused_ids, &entry->c_deleted_verts);
+	bm_log_ids_retake(unused_ids, &entry->c_deleted_faces);
+	bm_log_ids_retake(unused_ids, &entry->c_added_verts);
+	bm_log_ids_retake(unused_ids, &entry->c_added_faces);
+	bm_log_ids_retake(unused_ids, &entry->c_modified_verts);
+	bm_log_ids_retake(unused_ids, &entry->c_modified_faces);
 }
 
 static int uint_compare(const void *a_v, const void *b_v)
@@ -462,18 +639,128 @@ static GHash *bm_log_compress_ids_to_indices(unsigned int *ids, unsigned int tot
 	return map;
 }
 
-/* Release all ID keys in id_ghash */
-static void bm_log_id_ghash_release(BMLog *log, GHash *id_ghash)
+/* Release all IDs in the array */
+static void bm_log_ids_release(BMLog *log, const BMLogArray *arr)
 {
-	GHashIterator gh_iter;
+	unsigned int i;
 
-	GHASH_ITER (gh_iter, id_ghash) {
-		void *key = BLI_ghashIterator_getKey(&gh_iter);
-		unsigned int id = GET_UINT_FROM_POINTER(key);
-		range_tree_uint_release(log->unused_ids, id);
+	for (i = 0; i < arr->len; i++) {
+		range_tree_uint_release(log->unused_ids, arr->ids[i]);
 	}
 }
 
+static GHash *bm_log_array_id_index_map(const BMLogArray *arr)
+{
+	GHash *map = BLI_ghash_new_ex(logkey_hash, logkey_cmp, __func__, arr->len);
+	unsigned int i;
+
+	/* Store index + 1, so zero means not found */
+	for (i = 0; i < arr->len; i++) {
+		BLI_ghash_insert(map, SET_UINT_IN_POINTER(arr->ids[i]), SET_UINT_IN_POINTER(i + 1));
+	}
+
+	return map;
+}
+
+/* Merge the changes of two consecutive entries, for either vertices
+ * or faces. The result replaces the arrays of the newer entry 'b'.
+ *
+ * Both entries must be applied, so the arrays of deleted and modified
+ * elements hold the state from before each entry and the values of
+ * added elements are refreshed when they get unmade on undo. */
+static void bm_log_arrays_merge(
+        BMLog *log, const size_t elem_size,
+        BMLogArray *a_deleted, BMLogArray *a_added, BMLogArray *a_modified,
+        BMLogArray *b_deleted, BMLogArray *b_added, BMLogArray *b_modified)
+{
+	GHash *b_deleted_map = bm_log_array_id_index_map(b_deleted);
+	GHash *b_modified_map = bm_log_array_id_index_map(b_modified);
+	BLI_bitmap *b_deleted_skip = BLI_BITMAP_NEW(b_deleted->len, __func__);
+	BLI_bitmap *b_modified_skip = BLI_BITMAP_NEW(b_modified->len, __func__);
+	BMLogArray m_deleted, m_added, m_modified;
+	const unsigned int m_deleted_cap = a_deleted->len + a_modified->len + b_deleted->len;
+	const unsigned int m_added_cap = a_added->len + b_added->len;
+	const unsigned int m_modified_cap = a_modified->len + b_modified->len;
+	unsigned int i, index;
+
+	bm_log_array_alloc(&m_deleted, m_deleted_cap, elem_size);
+	bm_log_array_alloc(&m_added, m_added_cap, elem_size);
+	bm_log_array_alloc(&m_modified, m_modified_cap, elem_size);
+
+	for (i = 0; i < a_added->len; i++) {
+		const unsigned int id = a_added->ids[i];
+		void *key = SET_UINT_IN_POINTER(id);
+
+		if ((index = GET_UINT_FROM_POINTER(BLI_ghash_lookup(b_deleted_map, key)))) {
+			/* Added and deleted again, nothing is left to undo */
+			BLI_BITMAP_ENABLE(b_deleted_skip, index - 1);
+			range_tree_uint_release(log->unused_ids, id);
+		}
+		else {
+			if ((index = GET_UINT_FROM_POINTER(BLI_ghash_lookup(b_modified_map, key)))) {
+				BLI_BITMAP_ENABLE(b_modified_skip, index - 1);
+			}
+			bm_log_array_append(&m_added, id, bm_log_array_elem(a_added, i, elem_size), elem_size);
+		}
+	}
+
+	for (i = 0; i < a_deleted->len; i++) {
+		bm_log_array_append(&m_deleted, a_deleted->ids[i], bm_log_array_elem(a_deleted, i, elem_size), elem_size);
+	}
+
+	/* The state from before 'a' takes precedence over the state from before 'b' */
+	for (i = 0; i < a_modified->len; i++) {
+		const unsigned int id = a_modified->ids[i];
+		void *key = SET_UINT_IN_POINTER(id);
+		const void *elem = bm_log_array_elem(a_modified, i, elem_size);
+
+		if ((index = GET_UINT_FROM_POINTER(BLI_ghash_lookup(b_deleted_map, key)))) {
+			BLI_BITMAP_ENABLE(b_deleted_skip, index - 1);
+			bm_log_array_append(&m_deleted, id, elem, elem_size);
+		}
+		else {
+			if ((index = GET_UINT_FROM_POINTER(BLI_ghash_lookup(b_modified_map, key)))) {
+				BLI_BITMAP_ENABLE(b_modified_skip, index - 1);
+			}
+			bm_log_array_append(&m_modified, id, elem, elem_size);
+		}
+	}
+
+	for (i = 0; i < b_added->len; i++) {
+		bm_log_array_append(&m_added, b_added->ids[i], bm_log_array_elem(b_added, i, elem_size), elem_size);
+	}
+	for (i = 0; i < b_deleted->len; i++) {
+		if (!BLI_BITMAP_TEST(b_deleted_skip, i)) {
+			bm_log_array_append(&m_deleted, b_deleted->ids[i], bm_log_array_elem(b_deleted, i, elem_size), elem_size);
+		}
+	}
+	for (i = 0; i < b_modified->len; i++) {
+		if (!BLI_BITMAP_TEST(b_modified_skip, i)) {
+			bm_log_array_append(&m_modified, b_modified->ids[i], bm_log_array_elem(b_modified, i, elem_size), elem_size);
+		}
+	}
+
+	BLI_ghash_free(b_deleted_map, NULL, NULL);
+	BLI_ghash_free(b_modified_map, NULL, NULL);
+	MEM_freeN(b_deleted_skip);
+	MEM_freeN(b_modified_skip);
+
+	bm_log_array_shrink(&m_deleted, m_deleted_cap, elem_size);
+	bm_log_array_shrink(&m_added, m_added_cap, elem_size);
+	bm_log_array_shrink(&m_modified, m_modified_cap, elem_size);
+
+	bm_log_array_free(a_deleted);
+	bm_log_array_free(a_added);
+	bm_log_array_free(a_modified);
+	bm_log_array_free(b_deleted);
+	bm_log_array_free(b_added);
+	bm_log_array_free(b_modified);
+
+	*b_deleted = m_deleted;
+	*b_added = m_added;
+	*b_modified = m_modified;
+}
+
 /***************************** Public API *****************************/
 
 /* Allocate, initialize, and assign a new BMLog */
@@ -498,19 +785,14 @@ void BM_log_cleanup_entry(BMLogEntry *entry)
 
 	if (log) {
 		/* Take all used IDs */
-		bm_log_id_ghash_retake(log->unused_ids, entry->deleted_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->deleted_faces);
-		bm_log_id_ghash_retake(log->unused_ids, entry->added_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->added_faces);
-		bm_log_id_ghash_retake(log->unused_ids, entry->modified_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->modified_faces);
+		bm_log_entry_ids_retake(log->unused_ids, entry);
 
 		/* delete entries to avoid releasing ids in node cleanup */
-		BLI_ghash_clear(entry->deleted_verts, NULL, NULL);
-		BLI_ghash_clear(entry->deleted_faces, NULL, NULL);
-		BLI_ghash_clear(entry->added_verts, NULL, NULL);
-		BLI_ghash_clear(entry->added_faces, NULL, NULL);
-		BLI_ghash_clear(entry->modified_verts, NULL, NULL);
+		bm_log_array_free(&entry->c_deleted_verts);
+		bm_log_array_free(&entry->c_deleted_faces);
+		bm_log_array_free(&entry->c_added_verts);
+		bm_log_array_free(&entry->c_added_faces);
+		bm_log_array_free(&entry->c_modified_verts);
 	}
 }
 
@@ -551,12 +833,7 @@ BMLog *BM_log_from_existing_entries_create(BMesh *bm, BMLogEntry *entry)
 		entry->log = log;
 
 		/* Take all used IDs */
-		bm_log_id_ghash_retake(log->unused_ids, entry->deleted_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->deleted_faces);
-		bm_log_id_ghash_retake(log->unused_ids, entry->added_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->added_faces);
-		bm_log_id_ghash_retake(log->unused_ids, entry->modified_verts);
-		bm_log_id_ghash_retake(log->unused_ids, entry->modified_faces);
+		bm_log_entry_ids_retake(log->unused_ids, entry);
 	}
 
 	return log;
@@ -659,6 +936,9 @@ BMLogEntry *BM_log_entry_add(BMLog *log)
 	/* Delete any entries after the current one */
 	entry = log->current_entry;
 	if (entry) {
+		/* Nothing more gets recorded into the current entry */
+		BM_log_entry_compact(entry);
+
 		for (entry = entry->next; entry; entry = next) {
 			next = entry->next;
 			bm_log_entry_free(entry);
@@ -725,16 +1005,17 @@ void BM_log_entry_drop(BMLogEntry *entry)
 		 * Also, design wise, a first entry should not have any deleted vertices since it
 		 * should not have anything to delete them -from-
 		 */
-		//bm_log_id_ghash_release(log, entry->deleted_faces);
-		//bm_log_id_ghash_release(log, entry->deleted_verts);
+		//bm_log_ids_release(log, &entry->c_deleted_faces);
+		//bm_log_ids_release(log, &entry->c_deleted_verts);
 	}
 	else if (!entry->next) {
 		/* Release IDs of elements that are added by this entry. Since
 		 * the entry is at the end of the undo stack, and it's being
 		 * deleted, those elements can never be restored. Their IDs
 		 * can go back into the pool. */
-		bm_log_id_ghash_release(log, entry->added_faces);
-		bm_log_id_ghash_release(log, entry->added_verts);
+		BM_log_entry_compact(entry);
+		bm_log_ids_release(log, &entry->c_added_faces);
+		bm_log_ids_release(log, &entry->c_added_verts);
 	}
 	else {
 		BLI_assert(!"Cannot drop BMLogEntry from middle");
@@ -747,6 +1028,91 @@ void BM_log_entry_drop(BMLogEntry *entry)
 	BLI_freelinkN(&log->entries, entry);
 }
 
+static size_t bm_log_array_size(const BMLogArray *arr, const size_t elem_size)
+{
+	return (elem_size + sizeof(*arr->ids)) * arr->len;
+}
+
+/* Get the memory used by an entry, in bytes
+ *
+ * For entries that are still being recorded this is an estimate. */
+size_t BM_log_entry_size(const BMLogEntry *entry)
+{
+	size_t size = sizeof(*entry);
+
+	if (entry->is_compact) {
+		size += bm_log_array_size(&entry->c_deleted_verts, sizeof(BMLogVert));
+		size += bm_log_array_size(&entry->c_deleted_faces, sizeof(BMLogFace));
+		size += bm_log_array_size(&entry->c_added_verts, sizeof(BMLogVert));
+		size += bm_log_array_size(&entry->c_added_faces, sizeof(BMLogFace));
+		size += bm_log_array_size(&entry->c_modified_verts, sizeof(BMLogVert));
+		size += bm_log_array_size(&entry->c_modified_faces, sizeof(BMLogFace));
+	}
+	else {
+		/* GHash entry and bucket, plus the pool element */
+		const size_t ghash_elem_size = sizeof(void *) * 4;
+		const unsigned int totvert = (BLI_ghash_size(entry->deleted_verts) +
+		                              BLI_ghash_size(entry->added_verts) +
+		                              BLI_ghash_size(entry->modified_verts));
+		const unsigned int totface = (BLI_ghash_size(entry->deleted_faces) +
+		                              BLI_ghash_size(entry->added_faces) +
+		                              BLI_ghash_size(entry->modified_faces));
+
+		size += (ghash_elem_size + sizeof(BMLogVert)) * totvert;
+		size += (ghash_elem_size + sizeof(BMLogFace)) * totface;
+	}
+
+	return size;
+}
+
+/* Merge an entry into the one following it
+ *
+ * Undoing the resulting entry reverts the changes of both. Elements
+ * that were added by 'entry_prev' and removed by 'entry' are dropped
+ * completely, and elements changed by both are only stored once, so
+ * the merged entry is usually smaller than the two separate ones.
+ * 'entry_prev' is freed.
+ *
+ * Only possible while both entries are applied, returns false
+ * otherwise.
+ */
+bool BM_log_entry_merge(BMLogEntry *entry_prev, BMLogEntry *entry)
+{
+	BMLog *log = entry->log;
+	BMLogEntry *entry_iter;
+
+	if (!log || entry->prev != entry_prev || entry_prev == NULL) {
+		return false;
+	}
+
+	/* 'entry' has to be the current entry or come before it */
+	for (entry_iter = entry; entry_iter; entry_iter = entry_iter->next) {
+		if (entry_iter == log->current_entry) {
+			break;
+		}
+	}
+	if (entry_iter == NULL) {
+		return false;
+	}
+
+	BM_log_entry_compact(entry_prev);
+	BM_log_entry_compact(entry);
+
+	bm_log_arrays_merge(
+	        log, sizeof(BMLogVert),
+	        &entry_prev->c_deleted_verts, &entry_prev->c_added_verts, &entry_prev->c_modified_verts,
+	        &entry->c_deleted_verts, &entry->c_added_verts, &entry->c_modified_verts);
+	bm_log_arrays_merge(
+	        log, sizeof(BMLogFace),
+	        &entry_prev->c_deleted_faces, &entry_prev->c_added_faces, &entry_prev->c_modified_faces,
+	        &entry->c_deleted_faces, &entry->c_added_faces, &entry->c_modified_faces);
+
+	bm_log_entry_free(entry_prev);
+	BLI_freelinkN(&log->entries, entry_prev);
+
+	return true;
+}
+
 /* Undo one BMLogEntry
  *
  * Has no effect if there's nothing left to undo */
@@ -757,17 +1123,19 @@ void BM_log_undo(BMesh *bm, BMLog *log)
 	if (entry) {
 		log->current_entry = entry->prev;
 
+		BM_log_entry_compact(entry);
+
 		/* Delete added faces and verts */
-		bm_log_faces_unmake(bm, log, entry->added_faces);
-		bm_log_verts_unmake(bm, log, entry->added_verts);
+		bm_log_faces_unmake(bm, log, &entry->c_added_faces);
+		bm_log_verts_unmake(bm, log, &entry->c_added_verts);
 
 		/* Restore deleted verts and faces */
-		bm_log_verts_restore(bm, log, entry->deleted_verts);
-		bm_log_faces_restore(bm, log, entry->deleted_faces);
+		bm_log_verts_restore(bm, log, &entry->c_deleted_verts);
+		bm_log_faces_restore(bm, log, &entry->c_deleted_faces);
 
 		/* Restore vertex coordinates, mask, and hflag */
-		bm_log_vert_values_swap(bm, log, entry->modified_verts);
-		bm_log_face_values_swap(log, entry->modified_faces);
+		bm_log_vert_values_swap(bm, log, &entry->c_modified_verts);
+		bm_log_face_values_swap(log, &entry->c_modified_faces);
 	}
 }
 
@@ -794,17 +1162,19 @@ void BM_log_redo(BMesh *bm, BMLog *log)
 	log->current_entry = entry;
 
 	if (entry) {
+		BM_log_entry_compact(entry);
+
 		/* Re-delete previously deleted faces and verts */
-		bm_log_faces_unmake(bm, log, entry->deleted_faces);
-		bm_log_verts_unmake(bm, log, entry->deleted_verts);
+		bm_log_faces_unmake(bm, log, &entry->c_deleted_faces);
+		bm_log_verts_unmake(bm, log, &entry->c_deleted_verts);
 
 		/* Restore previously added verts and faces */
-		bm_log_verts_restore(bm, log, entry->added_verts);
-		bm_log_faces_restore(bm, log, entry->added_faces);
+		bm_log_verts_restore(bm, log, &entry->c_added_verts);
+		bm_log_faces_restore(bm, log, &entry->c_added_faces);
 
 		/* Restore vertex coordinates, mask, and hflag */
-		bm_log_vert_values_swap(bm, log, entry->modified_verts);
-		bm_log_face_values_swap(log, entry->modified_faces);
+		bm_log_vert_values_swap(bm, log, &entry->c_modified_verts);
+		bm_log_face_values_swap(log, &entry->c_modified_faces);
 	}
 }
 
@@ -839,6 +1209,8 @@ void BM_log_vert_before_modified(BMLog *log, BMVert *v, const int cd_vert_mask_o
 	void *key = SET_UINT_IN_POINTER(v_id);
 	void **val_p;
 
+	bm_log_entry_expand(entry);
+
 	/* Find or create the BMLogVert entry */
 	if ((lv = BLI_ghash_lookup(entry->added_verts, key))) {
 		bm_log_vert_bmvert_copy(lv, v, cd_vert_mask_offset);
@@ -862,6 +1234,8 @@ void BM_log_vert_added(BMLog *log, BMVert *v, const int cd_vert_mask_offset)
 	unsigned int v_id = range_tree_uint_take_any(log->unused_ids);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
+	bm_log_entry_expand(log->current_entry);
+
 	bm_log_vert_id_set(log, v, v_id);
 	lv = bm_log_vert_alloc(log, v, cd_vert_mask_offset);
 	BLI_ghash_insert(log->current_entry->added_verts, key, lv);
@@ -879,6 +1253,8 @@ void BM_log_face_modified(BMLog *log, BMFace *f)
 	unsigned int f_id = bm_log_face_id_get(log, f);
 	void *key = SET_UINT_IN_POINTER(f_id);
 
+	bm_log_entry_expand(log->current_entry);
+
 	lf = bm_log_face_alloc(log, f);
 	BLI_ghash_insert(log->current_entry->modified_faces, key, lf);
 }
@@ -898,6 +1274,8 @@ void BM_log_face_added(BMLog *log, BMFace *f)
 	/* Only triangles are supported for now */
 	BLI_assert(f->len == 3);
 
+	bm_log_entry_expand(log->current_entry);
+
 	bm_log_face_id_set(log, f, f_id);
 	lf = bm_log_face_alloc(log, f);
 	BLI_ghash_insert(log->current_entry->added_faces, key, lf);
@@ -925,6 +1303,8 @@ void BM_log_vert_removed(BMLog *log, BMVert *v, const int cd_vert_mask_offset)
 	unsigned int v_id = bm_log_vert_id_get(log, v);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
+	bm_log_entry_expand(entry);
+
 	/* if it has a key, it shouldn't be NULL */
 	BLI_assert(!!BLI_ghash_lookup(entry->added_verts, key) ==
 	           !!BLI_ghash_haskey(entry->added_verts, key));
@@ -966,6 +1346,8 @@ void BM_log_face_removed(BMLog *log, BMFace *f)
 	unsigned int f_id = bm_log_face_id_get(log, f);
 	void *key = SET_UINT_IN_POINTER(f_id);
 
+	bm_log_entry_expand(entry);
+
 	/* if it has a key, it shouldn't be NULL */
 	BLI_assert(!!BLI_ghash_lookup(entry->added_faces, key) ==
 	           !!BLI_ghash_haskey(entry->added_faces, key));
@@ -989,6 +1371,8 @@ void BM_log_all_added(BMesh *bm, BMLog *log)
 	BMVert *v;
 	BMFace *f;
 
+	bm_log_entry_expand(log->current_entry);
+
 	/* avoid unnecessary resizing on initialization */
 	if (BLI_ghash_size(log->current_entry->added_verts) == 0) {
 		BLI_ghash_reserve(log->current_entry->added_verts, (unsigned int)bm->totvert);
@@ -1038,7 +1422,7 @@ const float *BM_log_original_vert_co(BMLog *log, BMVert *v)
 	unsigned v_id = bm_log_vert_id_get(log, v);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
-	BLI_assert(entry);
+	BLI_assert(entry && !entry->is_compact);
 
 	BLI_assert(BLI_ghash_haskey(entry->modified_verts, key));
 
@@ -1056,7 +1440,7 @@ const short *BM_log_original_vert_no(BMLog *log, BMVert *v)
 	unsigned v_id = bm_log_vert_id_get(log, v);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
-	BLI_assert(entry);
+	BLI_assert(entry && !entry->is_compact);
 
 	BLI_assert(BLI_ghash_haskey(entry->modified_verts, key));
 
@@ -1074,7 +1458,7 @@ float BM_log_original_mask(BMLog *log, BMVert *v)
 	unsigned v_id = bm_log_vert_id_get(log, v);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
-	BLI_assert(entry);
+	BLI_assert(entry && !entry->is_compact);
 
 	BLI_assert(BLI_ghash_haskey(entry->modified_verts, key));
 
@@ -1091,7 +1475,7 @@ void BM_log_original_vert_data(
 	unsigned v_id = bm_log_vert_id_get(log, v);
 	void *key = SET_UINT_IN_POINTER(v_id);
 
-	BLI_assert(entry);
+	BLI_assert(entry && !entry->is_compact);
 
 	BLI_assert(BLI_ghash_haskey(entry->modified_verts, key));
 
@@ -57,6 +57,15 @@ void BM_log_cleanup_entry(BMLogEntry *entry);
 /* Remove an entry from the log */
 void BM_log_entry_drop(BMLogEntry *entry);
 
+/* Store an entry that is no longer recorded into compactly */
+void BM_log_entry_compact(BMLogEntry *entry);
+
+/* Get the memory used by an entry, in bytes */
+size_t BM_log_entry_size(const BMLogEntry *entry);
+
+/* Merge an entry into the one following it */
+bool BM_log_entry_merge(BMLogEntry *entry_prev, BMLogEntry *entry);
+
 /* Undo one BMLogEntry */
 void BM_log_undo(BMesh *bm, BMLog *log);
 
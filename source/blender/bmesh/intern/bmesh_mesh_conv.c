@@ -86,6 +86,7 @@
 #include "BLI_listbase.h"
 #include "BLI_alloca.h"
 #include "BLI_math_vector.h"
+#include "BLI_threads.h"
 
 #include "BKE_mesh.h"
 #include "BKE_customdata.h"
@@ -233,9 +234,10 @@ void BM_mesh_bm_from_me(
 	KeyBlock *actkey, *block;
 	BMVert *v, **vtable = NULL;
 	BMEdge *e, **etable = NULL;
-	BMFace *f;
+	BMFace *f, **ftable = NULL;
 	float (*keyco)[3] = NULL;
 	int totuv, totloops, i, j;
+	bool use_threading;
 
 	int cd_vert_bweight_offset;
 	int cd_edge_bweight_offset;
@@ -329,6 +331,8 @@ void BM_mesh_bm_from_me(
 	cd_edge_crease_offset  = CustomData_get_offset(&bm->edata, CD_CREASE);
 	cd_shape_keyindex_offset = me->key ? CustomData_get_offset(&bm->vdata, CD_SHAPE_KEYINDEX) : -1;
 
+	/* Topology is created serially since the element and customdata pools are not thread-safe,
+	 * customdata blocks are only reserved here and filled in by the parallel loops below. */
 	for (i = 0, mvert = me->mvert; i < me->totvert; i++, mvert++) {
 		v = vtable[i] = BM_vert_create(bm, keyco && set_key ? keyco[i] : mvert->co, NULL, BM_CREATE_SKIP_CD);
 		BM_elem_index_set(v, i); /* set_ok */
@@ -341,23 +345,40 @@ void BM_mesh_bm_from_me(
 			BM_vert_select_set(bm, v, true);
 		}
 
-		normal_short_to_float_v3(v->no, mvert->no);
+		CustomData_bmesh_alloc_block(&bm->vdata, &v->head.data);
+	}
+
+	use_threading = (me->totvert + me->totedge + me->totloop >= BM_OMP_LIMIT);
+	if (use_threading) {
+		/* layer copy callbacks may allocate (deform-weights, multires) */
+		BLI_begin_threaded_malloc();
+	}
+
+#pragma omp parallel for schedule(static) if (me->totvert >= BM_OMP_LIMIT)
+	for (i = 0; i < me->totvert; i++) {
+		const MVert *mv = &me->mvert[i];
+		BMVert *v_iter = vtable[i];
+
+		normal_short_to_float_v3(v_iter->no, mv->no);
 
 		/* Copy Custom Data */
-		CustomData_to_bmesh_block(&me->vdata, &bm->vdata, i, &v->head.data, true);
+		CustomData_to_bmesh_block(&me->vdata, &bm->vdata, i, &v_iter->head.data, true);
 
-		if (cd_vert_bweight_offset != -1) BM_ELEM_CD_SET_FLOAT(v, cd_vert_bweight_offset, (float)mvert->bweight / 255.0f);
+		if (cd_vert_bweight_offset != -1) BM_ELEM_CD_SET_FLOAT(v_iter, cd_vert_bweight_offset, (float)mv->bweight / 255.0f);
 
 		/* set shapekey data */
 		if (me->key) {
+			KeyBlock *kb;
+			int k;
+
 			/* set shape key original index */
-			if (cd_shape_keyindex_offset != -1) BM_ELEM_CD_SET_INT(v, cd_shape_keyindex_offset, i);
+			if (cd_shape_keyindex_offset != -1) BM_ELEM_CD_SET_INT(v_iter, cd_shape_keyindex_offset, i);
 
-			for (block = me->key->block.first, j = 0; block; block = block->next, j++) {
-				float *co = CustomData_bmesh_get_n(&bm->vdata, v->head.data, CD_SHAPEKEY, j);
+			for (kb = me->key->block.first, k = 0; kb; kb = kb->next, k++) {
+				float *co = CustomData_bmesh_get_n(&bm->vdata, v_iter->head.data, CD_SHAPEKEY, k);
 
 				if (co) {
-					copy_v3_v3(co, ((float *)block->data) + 3 * i);
+					copy_v3_v3(co, ((float *)kb->data) + 3 * i);
 				}
 			}
 		}
@@ -366,6 +387,9 @@ void BM_mesh_bm_from_me(
 	bm->elem_index_dirty &= ~BM_VERT; /* added in order, clear dirty flag */
 
 	if (!me->totedge) {
+		if (use_threading) {
+			BLI_end_threaded_malloc();
+		}
 		MEM_freeN(vtable);
 		return;
 	}
@@ -385,24 +409,34 @@ void BM_mesh_bm_from_me(
 			BM_edge_select_set(bm, e, true);
 		}
 
-		/* Copy Custom Data */
-		CustomData_to_bmesh_block(&me->edata, &bm->edata, i, &e->head.data, true);
+		CustomData_bmesh_alloc_block(&bm->edata, &e->head.data);
+	}
+
+#pragma omp parallel for schedule(static) if (me->totedge >= BM_OMP_LIMIT)
+	for (i = 0; i < me->totedge; i++) {
+		const MEdge *med = &me->medge[i];
+		BMEdge *e_iter = etable[i];
 
-		if (cd_edge_bweight_offset != -1) BM_ELEM_CD_SET_FLOAT(e, cd_edge_bweight_offset, (float)medge->bweight / 255.0f);
-		if (cd_edge_crease_offset  != -1) BM_ELEM_CD_SET_FLOAT(e, cd_edge_crease_offset,  (float)medge->crease  / 255.0f);
+		/* Copy Custom Data */
+		CustomData_to_bmesh_block(&me->edata, &bm->edata, i, &e_iter->head.data, true);
 
+		if (cd_edge_bweight_offset != -1) BM_ELEM_CD_SET_FLOAT(e_iter, cd_edge_bweight_offset, (float)med->bweight / 255.0f);
+		if (cd_edge_crease_offset  != -1) BM_ELEM_CD_SET_FLOAT(e_iter, cd_edge_crease_offset,  (float)med->crease  / 255.0f);
 	}
 
 	bm->elem_index_dirty &= ~BM_EDGE; /* added in order, clear dirty flag */
 
+	/* NULL entries are faces that failed to be created */
+	ftable = MEM_mallocN(sizeof(void **) * me->totpoly, "mesh to bmesh ftable");
+
 	mloop = me->mloop;
 	mp = me->mpoly;
 	for (i = 0, totloops = 0; i < me->totpoly; i++, mp++) {
 		BMLoop *l_iter;
 		BMLoop *l_first;
 
-		f = bm_face_create_from_mpoly(mp, mloop + mp->loopstart,
-		                              bm, vtable, etable);
+		f = ftable[i] = bm_face_create_from_mpoly(mp, mloop + mp->loopstart,
+		                                          bm, vtable, etable);
 
 		if (UNLIKELY(f == NULL)) {
 			printf("%s: Warning! Bad face in mesh"
@@ -425,24 +459,49 @@ void BM_mesh_bm_from_me(
 		f->mat_nr = mp->mat_nr;
 		if (i == me->act_face) bm->act_face = f;
 
-		j = mp->loopstart;
 		l_iter = l_first = BM_FACE_FIRST_LOOP(f);
 		do {
 			/* don't use 'j' since we may have skipped some faces, hence some loops. */
 			BM_elem_index_set(l_iter, totloops++); /* set_ok */
 
+			CustomData_bmesh_alloc_block(&bm->ldata, &l_iter->head.data);
+		} while ((l_iter = l_iter->next) != l_first);
+
+		CustomData_bmesh_alloc_block(&bm->pdata, &f->head.data);
+	}
+
+#pragma omp parallel for schedule(static) if (me->totloop >= BM_OMP_LIMIT)
+	for (i = 0; i < me->totpoly; i++) {
+		BMFace *f_iter = ftable[i];
+		BMLoop *l_iter;
+		BMLoop *l_first;
+		int k;
+
+		if (f_iter == NULL) {
+			continue;
+		}
+
+		k = me->mpoly[i].loopstart;
+		l_iter = l_first = BM_FACE_FIRST_LOOP(f_iter);
+		do {
 			/* Save index of correspsonding MLoop */
-			CustomData_to_bmesh_block(&me->ldata, &bm->ldata, j++, &l_iter->head.data, true);
+			CustomData_to_bmesh_block(&me->ldata, &bm->ldata, k++, &l_iter->head.data, true);
 		} while ((l_iter = l_iter->next) != l_first);
 
 		/* Copy Custom Data */
-		CustomData_to_bmesh_block(&me->pdata, &bm->pdata, i, &f->head.data, true);
+		CustomData_to_bmesh_block(&me->pdata, &bm->pdata, i, &f_iter->head.data, true);
 
 		if (calc_face_normal) {
-			BM_face_normal_update(f);
+			BM_face_normal_update(f_iter);
 		}
 	}
 
+	if (use_threading) {
+		BLI_end_threaded_malloc();
+	}
+
+	MEM_freeN(ftable);
+
 	bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP); /* added in order, clear dirty flag */
 
 	if (me->mselect && me->totselect != 0) {
@@ -573,12 +632,12 @@ void BM_mesh_bm_to_me(BMesh *bm, Mesh *me, bool do_tessface)
 	MLoop *mloop;
 	MPoly *mpoly;
 	MVert *mvert, *oldverts;
-	MEdge *med, *medge;
-	BMVert *v, *eve;
-	BMEdge *e;
+	MEdge *medge;
+	BMVert *eve;
 	BMFace *f;
 	BMIter iter;
 	int i, j, ototvert;
+	bool use_threading;
 
 	const int cd_vert_bweight_offset = CustomData_get_offset(&bm->vdata, CD_BWEIGHT);
 	const int cd_edge_bweight_offset = CustomData_get_offset(&bm->edata, CD_BWEIGHT);
@@ -644,83 +703,104 @@ void BM_mesh_bm_to_me(BMesh *bm, Mesh *me, bool do_tessface)
 	/* this is called again, 'dotess' arg is used there */
 	BKE_mesh_update_customdata_pointers(me, 0);
 
-	i = 0;
-	BM_ITER_MESH (v, &iter, bm, BM_VERTS_OF_MESH) {
-		copy_v3_v3(mvert->co, v->co);
-		normal_float_to_short_v3(mvert->no, v->no);
+	BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
 
-		mvert->flag = BM_vert_flag_to_mflag(v);
+	use_threading = (bm->totvert + bm->totedge + bm->totloop >= BM_OMP_LIMIT);
+	if (use_threading) {
+		/* layer copy callbacks may allocate (deform-weights, multires) */
+		BLI_begin_threaded_malloc();
+	}
 
-		BM_elem_index_set(v, i); /* set_inline */
+#pragma omp parallel for schedule(static) if (bm->totvert >= BM_OMP_LIMIT)
+	for (i = 0; i < bm->totvert; i++) {
+		BMVert *v_iter = bm->vtable[i];
+		MVert *mv = &mvert[i];
 
-		/* copy over customdat */
-		CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v->head.data, i);
+		copy_v3_v3(mv->co, v_iter->co);
+		normal_float_to_short_v3(mv->no, v_iter->no);
+
+		mv->flag = BM_vert_flag_to_mflag(v_iter);
 
-		if (cd_vert_bweight_offset != -1) mvert->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, cd_vert_bweight_offset);
+		BM_elem_index_set(v_iter, i); /* set_inline */
 
-		i++;
-		mvert++;
+		/* copy over customdat */
+		CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v_iter->head.data, i);
+
+		if (cd_vert_bweight_offset != -1) mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v_iter, cd_vert_bweight_offset);
 
-		BM_CHECK_ELEMENT(v);
+		BM_CHECK_ELEMENT(v_iter);
 	}
 	bm->elem_index_dirty &= ~BM_VERT;
 
-	med = medge;
-	i = 0;
-	BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
-		med->v1 = BM_elem_index_get(e->v1);
-		med->v2 = BM_elem_index_get(e->v2);
+	/* edges read the vertex indices set above */
+#pragma omp parallel for schedule(static) if (bm->totedge >= BM_OMP_LIMIT)
+	for (i = 0; i < bm->totedge; i++) {
+		BMEdge *e_iter = bm->etable[i];
+		MEdge *med = &medge[i];
+
+		med->v1 = BM_elem_index_get(e_iter->v1);
+		med->v2 = BM_elem_index_get(e_iter->v2);
 
-		med->flag = BM_edge_flag_to_mflag(e);
+		med->flag = BM_edge_flag_to_mflag(e_iter);
 
-		BM_elem_index_set(e, i); /* set_inline */
+		BM_elem_index_set(e_iter, i); /* set_inline */
 
 		/* copy over customdata */
-		CustomData_from_bmesh_block(&bm->edata, &me->edata, e->head.data, i);
+		CustomData_from_bmesh_block(&bm->edata, &me->edata, e_iter->head.data, i);
 
-		bmesh_quick_edgedraw_flag(med, e);
+		bmesh_quick_edgedraw_flag(med, e_iter);
 
-		if (cd_edge_crease_offset  != -1) med->crease  = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_crease_offset);
-		if (cd_edge_bweight_offset != -1) med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_bweight_offset);
+		if (cd_edge_crease_offset  != -1) med->crease  = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e_iter, cd_edge_crease_offset);
+		if (cd_edge_bweight_offset != -1) med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e_iter, cd_edge_bweight_offset);
 
-		i++;
-		med++;
-		BM_CHECK_ELEMENT(e);
+		BM_CHECK_ELEMENT(e_iter);
 	}
 	bm->elem_index_dirty &= ~BM_EDGE;
 
-	i = 0;
-	j = 0;
-	BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
+	/* loop offsets are a prefix sum, so they're computed up-front */
+	for (i = 0, j = 0; i < bm->totface; i++) {
+		f = bm->ftable[i];
+		mpoly[i].loopstart = j;
+		mpoly[i].totloop = f->len;
+		j += f->len;
+
+		if (f == bm->act_face) me->act_face = i;
+	}
+
+#pragma omp parallel for schedule(static) if (bm->totloop >= BM_OMP_LIMIT)
+	for (i = 0; i < bm->totface; i++) {
+		BMFace *f_iter = bm->ftable[i];
+		MPoly *mp = &mpoly[i];
+		MLoop *ml = &mloop[mp->loopstart];
 		BMLoop *l_iter, *l_first;
-		mpoly->loopstart = j;
-		mpoly->totloop = f->len;
-		mpoly->mat_nr = f->mat_nr;
-		mpoly->flag = BM_face_flag_to_mflag(f);
+		int k = mp->loopstart;
 
-		l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+		mp->mat_nr = f_iter->mat_nr;
+		mp->flag = BM_face_flag_to_mflag(f_iter);
+
+		l_iter = l_first = BM_FACE_FIRST_LOOP(f_iter);
 		do {
-			mloop->e = BM_elem_index_get(l_iter->e);
-			mloop->v = BM_elem_index_get(l_iter->v);
+			ml->e = BM_elem_index_get(l_iter->e);
+			ml->v = BM_elem_index_get(l_iter->v);
 
 			/* copy over customdata */
-			CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
+			CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, k);
 
-			j++;
-			mloop++;
+			k++;
+			ml++;
 			BM_CHECK_ELEMENT(l_iter);
 			BM_CHECK_ELEMENT(l_iter->e);
 			BM_CHECK_ELEMENT(l_iter->v);
 		} while ((l_iter = l_iter->next) != l_first);
 
-		if (f == bm->act_face) me->act_face = i;
-
 		/* copy over customdata */
-		CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f->head.data, i);
+		CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f_iter->head.data, i);
+
+		BM_CHECK_ELEMENT(f_iter);
+	}
 
-		i++;
-		mpoly++;
-		BM_CHECK_ELEMENT(f);
+	if (use_threading) {
+		BLI_end_threaded_malloc();
 	}
 
 	/* patch hook indices and vertex parents */
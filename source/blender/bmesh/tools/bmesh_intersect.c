@@ -23,7 +23,8 @@
  *
  * Cut meshes along intersections.
  *
- * Boolean-like modeling operation (without calculating inside/outside).
+ * Boolean-like modeling operation, optionally removing faces
+ * that are inside/outside the other mesh (see \a boolean_mode).
  *
  * Supported:
  * - Concave faces.
@@ -45,6 +46,7 @@
 
 #include "BLI_linklist_stack.h"
 #include "BLI_stackdefines.h"
+#include "BLI_buffer.h"
 #ifndef NDEBUG
 #  include "BLI_array_utils.h"
 #endif
@@ -76,6 +78,11 @@
 /* use accelerated overlap check */
 #define USE_BVH
 
+/* cut the boundary of overlapping co-planar triangles into both faces */
+#define USE_COPLANAR
+/* classify face regions as inside/outside by ray-casting (needs USE_BVH) */
+#define USE_BOOLEAN_RAYCAST
+
 
 static void tri_v3_scale(
         float v1[3], float v2[3], float v3[3],
@@ -461,6 +468,277 @@ static BMVert *bm_isect_edge_tri(
 	return NULL;
 }
 
+#ifdef USE_COPLANAR
+/**
+ * Intersect two edges which are known to be on the same plane,
+ * the resulting vertex is shared with #bm_isect_edge_tri (same cache keys).
+ */
+static BMVert *bm_isect_edge_edge(
+        struct ISectState *s,
+        BMVert *e_v0, BMVert *e_v1,
+        BMVert *t_v0, BMVert *t_v1)
+{
+	const struct ISectEpsilon *eps = &s->epsilon;
+	int k[4] = {
+		BM_elem_index_get(e_v0), BM_elem_index_get(e_v1),
+		BM_elem_index_get(t_v0), BM_elem_index_get(t_v1),
+	};
+	float e_dir[3], t_dir[3];
+	float ix_pair[2][3];
+	float fac;
+	int ix_pair_type;
+	BMVert *iv;
+	BMEdge *e;
+
+	/* order each pair, then the pairs (see KEY_EDGE_TRI_ORDER) */
+	if (k[0] > k[1]) {
+		SWAP(int, k[0], k[1]);
+	}
+	if (k[2] > k[3]) {
+		SWAP(int, k[2], k[3]);
+	}
+	if (k[0] > k[2]) {
+		SWAP(int, k[0], k[2]);
+		SWAP(int, k[1], k[3]);
+	}
+
+	iv = BLI_ghash_lookup(s->edgetri_cache, k);
+	if (iv) {
+		return iv;
+	}
+
+	sub_v3_v3v3(e_dir, e_v0->co, e_v1->co);
+	sub_v3_v3v3(t_dir, t_v0->co, t_v1->co);
+	normalize_v3(e_dir);
+	normalize_v3(t_dir);
+	if (fabsf(dot_v3v3(e_dir, t_dir)) >= 1.0f - eps->eps) {
+		/* co-linear, overlapping verts are handled as vert-edge */
+		return NULL;
+	}
+
+	ix_pair_type = isect_line_line_epsilon_v3(e_v0->co, e_v1->co, t_v0->co, t_v1->co, ix_pair[0], ix_pair[1], 0.0f);
+	if (ix_pair_type == 0) {
+		return NULL;
+	}
+	if (ix_pair_type == 1) {
+		copy_v3_v3(ix_pair[1], ix_pair[0]);
+	}
+	else if (len_squared_v3v3(ix_pair[0], ix_pair[1]) > eps->eps_margin_sq) {
+		return NULL;
+	}
+
+	fac = line_point_factor_v3(ix_pair[1], t_v0->co, t_v1->co);
+	if ((fac < eps->eps_margin) || (fac > 1.0f - eps->eps_margin)) {
+		return NULL;
+	}
+	fac = line_point_factor_v3(ix_pair[0], e_v0->co, e_v1->co);
+	if ((fac < eps->eps_margin) || (fac > 1.0f - eps->eps_margin)) {
+		return NULL;
+	}
+
+	iv = BM_vert_create(s->bm, ix_pair[0], NULL, 0);
+
+	if ((e = BM_edge_exists(e_v0, e_v1))) {
+		edge_verts_add(s, e, iv, false);
+	}
+	if ((e = BM_edge_exists(t_v0, t_v1))) {
+		edge_verts_add(s, e, iv, false);
+	}
+
+	{
+		int *k_store = BLI_memarena_alloc(s->mem_arena, sizeof(int[4]));
+		memcpy(k_store, k, sizeof(int[4]));
+		BLI_ghash_insert(s->edgetri_cache, k_store, iv);
+	}
+
+	return iv;
+}
+
+/**
+ * Add the parts of the edges of \a fv_o which are inside triangle \a fv_t,
+ * as edges to cut \a f_t with.
+ *
+ * Needed since co-planar triangles don't cross at a single line,
+ * instead the boundary of their overlapping region has to be cut into both faces.
+ */
+static void bm_isect_tri_tri_coplanar_side(
+        struct ISectState *s,
+        BMFace *f_t, BMVert *fv_t[3],
+        BMVert *fv_o[3])
+{
+	float t_scale[3][3];
+	unsigned int i_o_e0;
+
+	copy_v3_v3(t_scale[0], fv_t[0]->co);
+	copy_v3_v3(t_scale[1], fv_t[1]->co);
+	copy_v3_v3(t_scale[2], fv_t[2]->co);
+	tri_v3_scale(UNPACK3(t_scale), 1.0f - s->epsilon.eps2x);
+
+	for (i_o_e0 = 0; i_o_e0 < 3; i_o_e0++) {
+		const unsigned int i_o_e1 = (i_o_e0 + 1) % 3;
+		BMVert *o_v0 = fv_o[i_o_e0];
+		BMVert *o_v1 = fv_o[i_o_e1];
+		/* edge end-points, vertices of the triangle on the edge & edge-edge intersections */
+		struct vert_sort_t points[8];
+		unsigned int points_len = 0;
+		unsigned int i;
+
+		/* tessellation edges are inside the face, only cut along the boundary */
+		if (BM_edge_exists(o_v0, o_v1) == NULL) {
+			continue;
+		}
+
+		points[points_len].val = 0.0f;
+		points[points_len++].v = o_v0;
+		points[points_len].val = 1.0f;
+		points[points_len++].v = o_v1;
+
+		for (i = 0; i < 3; i++) {
+			BMVert *t_v = fv_t[i];
+			const float fac = line_point_factor_v3(t_v->co, o_v0->co, o_v1->co);
+			if ((fac > 0.0f) && (fac < 1.0f)) {
+				float ix[3];
+				interp_v3_v3v3(ix, o_v0->co, o_v1->co, fac);
+				if (len_squared_v3v3(ix, t_v->co) <= s->epsilon.eps2x_sq) {
+					points[points_len].val = fac;
+					points[points_len++].v = t_v;
+				}
+			}
+		}
+
+		for (i = 0; i < 3; i++) {
+			BMVert *iv = bm_isect_edge_edge(s, o_v0, o_v1, fv_t[i], fv_t[(i + 1) % 3]);
+			if (iv) {
+				points[points_len].val = line_point_factor_v3(iv->co, o_v0->co, o_v1->co);
+				points[points_len++].v = iv;
+			}
+		}
+
+		BLI_assert(points_len <= ARRAY_SIZE(points));
+		qsort(points, points_len, sizeof(*points), BLI_sortutil_cmp_float);
+
+		for (i = 1; i < points_len; i++) {
+			BMVert *v_a = points[i - 1].v;
+			BMVert *v_b = points[i].v;
+			float mid[3], ix[3];
+			BMEdge *ie;
+			bool ie_exists;
+
+			if ((v_a == v_b) || (len_squared_v3v3(v_a->co, v_b->co) <= s->epsilon.eps2x_sq)) {
+				continue;
+			}
+
+			mid_v3_v3v3(mid, v_a->co, v_b->co);
+			if (!isect_point_tri_v3(mid, UNPACK3(t_scale), ix)) {
+				continue;
+			}
+
+			ie = BM_edge_exists(v_a, v_b);
+			if (ie == NULL) {
+				ie_exists = false;
+				ie = BM_edge_create(s->bm, v_a, v_b, NULL, 0);
+				BLI_gset_insert(s->wire_edges, ie);
+			}
+			else {
+				ie_exists = true;
+				BLI_gset_add(s->wire_edges, ie);
+
+				if (BM_edge_in_face(ie, f_t)) {
+					continue;
+				}
+			}
+
+			face_edges_add(s, BM_elem_index_get(f_t), ie, ie_exists);
+		}
+	}
+}
+
+static BMEdge *edge_remap_lookup(GHash *edge_remap, BMEdge *e)
+{
+	BMEdge *e_dst;
+	while ((e_dst = BLI_ghash_lookup(edge_remap, e))) {
+		e = e_dst;
+	}
+	return e;
+}
+
+/**
+ * Splicing overlapping co-linear edges leaves two edges between the same vertices,
+ * merge these so faces from both sides share their cut edges.
+ *
+ * Edges referenced by #ISectState.face_edges & #ISectState.wire_edges are re-mapped to the edge they merge into.
+ */
+static void bm_isect_edge_doubles_merge(
+        BMesh *bm, struct ISectState *s,
+        LinkNode *vert_double)
+{
+	GHash *edge_remap = BLI_ghash_ptr_new(__func__);
+	LinkNode *node;
+
+	for (node = vert_double; node; node = node->next) {
+		BMVert *v = node->link;
+		BMEdge *e_iter, *e_first;
+
+		if (v->e == NULL) {
+			continue;
+		}
+
+restart:
+		e_iter = e_first = v->e;
+		do {
+			BMVert *v_other = BM_edge_other_vert(e_iter, v);
+			BMEdge *e_other = BM_DISK_EDGE_NEXT(e_iter, v);
+			while (e_other != e_iter) {
+				if (BM_vert_in_edge(e_other, v_other)) {
+					BLI_ghash_insert(edge_remap, e_other, e_iter);
+					if (BLI_gset_remove(s->wire_edges, e_other, NULL)) {
+						BLI_gset_add(s->wire_edges, e_iter);
+					}
+					BM_edge_splice(bm, e_iter, e_other);
+					goto restart;
+				}
+				e_other = BM_DISK_EDGE_NEXT(e_other, v);
+			}
+		} while ((e_iter = BM_DISK_EDGE_NEXT(e_iter, v)) != e_first);
+	}
+
+	if (BLI_ghash_size(edge_remap)) {
+		GHashIterator gh_iter;
+
+		GHASH_ITER (gh_iter, s->face_edges) {
+			const int f_index = GET_INT_FROM_POINTER(BLI_ghashIterator_getKey(&gh_iter));
+			BMFace *f = bm->ftable[f_index];
+			struct LinkBase *e_ls_base = BLI_ghashIterator_getValue(&gh_iter);
+			LinkNode **node_prev_p = &e_ls_base->list;
+
+			for (node = e_ls_base->list; node; node = node->next) {
+				BMEdge *e = edge_remap_lookup(edge_remap, node->link);
+				LinkNode *node_test;
+
+				/* remove duplicates & edges merged into the face boundary,
+				 * allocated by arena, don't free */
+				for (node_test = e_ls_base->list; node_test != node; node_test = node_test->next) {
+					if (node_test->link == e) {
+						break;
+					}
+				}
+
+				if ((node_test != node) || BM_edge_in_face(e, f)) {
+					*node_prev_p = node->next;
+					e_ls_base->list_len--;
+				}
+				else {
+					node->link = e;
+					node_prev_p = &node->next;
+				}
+			}
+		}
+	}
+
+	BLI_ghash_free(edge_remap, NULL, NULL);
+}
+#endif  /* USE_COPLANAR */
+
 /**
  * Return true if we have any intersections.
  */
@@ -480,6 +758,9 @@ static void bm_isect_tri_tri(
 	int a_mask = 0;
 	int b_mask = 0;
 	unsigned int i;
+#ifdef USE_COPLANAR
+	bool is_coplanar = false;
+#endif
 
 
 	/* should be enough but may need to bump */
@@ -671,6 +952,28 @@ static void bm_isect_tri_tri(
 		}
 	}
 
+	normal_tri_v3(f_a_nor, UNPACK3(f_a_cos));
+	normal_tri_v3(f_b_nor, UNPACK3(f_b_cos));
+
+#ifdef USE_COPLANAR
+	if (fabsf(dot_v3v3(f_a_nor, f_b_nor)) >= 1.0f - s->epsilon.eps) {
+		float plane_a[4];
+		plane_from_point_normal_v3(plane_a, f_a_cos[0], f_a_nor);
+		is_coplanar = ((dist_to_plane_v3(f_b_cos[0], plane_a) <= s->epsilon.eps2x) &&
+		               (dist_to_plane_v3(f_b_cos[1], plane_a) <= s->epsilon.eps2x) &&
+		               (dist_to_plane_v3(f_b_cos[2], plane_a) <= s->epsilon.eps2x));
+	}
+
+	if (is_coplanar) {
+#ifdef USE_DUMP
+		printf("# COPLANAR\n");
+#endif
+		bm_isect_tri_tri_coplanar_side(s, f_a, fv_a, fv_b);
+		bm_isect_tri_tri_coplanar_side(s, f_b, fv_b, fv_a);
+		return;
+	}
+#endif
+
 	if ((STACK_SIZE(iv_ls_a) >= 3) &&
 	    (STACK_SIZE(iv_ls_b) >= 3))
 	{
@@ -680,9 +983,6 @@ static void bm_isect_tri_tri(
 		return;
 	}
 
-	normal_tri_v3(f_a_nor, UNPACK3(f_a_cos));
-	normal_tri_v3(f_b_nor, UNPACK3(f_b_cos));
-
 	/* edge-tri & edge-edge
 	 * -------------------- */
 	{
@@ -774,17 +1074,384 @@ static void bm_isect_tri_tri(
 	}
 }
 
+#ifdef USE_BVH
+
+struct ISectOverlapData {
+	BMLoop *(*looptris)[3];
+	float eps_margin;
+};
+
+/**
+ * Return true when all points of \a b are on one side of the plane of \a a.
+ */
+static bool isect_tri_tri_plane_separated(BMLoop **a, BMLoop **b, const float eps)
+{
+	float no[3];
+	float side[3];
+	unsigned int i;
+
+	if (normal_tri_v3(no, UNPACK3_EX(, a, ->v->co)) == 0.0f) {
+		return false;
+	}
+
+	for (i = 0; i < 3; i++) {
+		float dir[3];
+		sub_v3_v3v3(dir, b[i]->v->co, a[0]->v->co);
+		side[i] = dot_v3v3(no, dir);
+	}
+
+	return (((side[0] > eps) && (side[1] > eps) && (side[2] > eps)) ||
+	        ((side[0] < -eps) && (side[1] < -eps) && (side[2] < -eps)));
+}
+
+/**
+ * Overlap callback, rejects triangle pairs whose bounds overlap but can't intersect.
+ *
+ * Runs from the threaded BVH traversal so only pairs which may actually touch
+ * are passed on to #bm_isect_tri_tri, which edits the mesh and can't run in parallel.
+ */
+static bool bm_isect_tri_tri_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+{
+	struct ISectOverlapData *data = userdata;
+	BMLoop **a = data->looptris[index_a];
+	BMLoop **b = data->looptris[index_b];
+
+	return !(isect_tri_tri_plane_separated(a, b, data->eps_margin) ||
+	         isect_tri_tri_plane_separated(b, a, data->eps_margin));
+}
+
+#endif  /* USE_BVH */
+
+#ifdef USE_BOOLEAN_RAYCAST
+
+struct RaycastData {
+	const float (*looptri_coords)[3][3];
+	BLI_Buffer *z_buffer;
+};
+
+static void raycast_callback(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *UNUSED(hit))
+{
+	struct RaycastData *raycast_data = userdata;
+	const float (*tri)[3] = raycast_data->looptri_coords[index];
+	float dist;
+
+	if (isect_ray_tri_v3(ray->origin, ray->direction, UNPACK3(tri), &dist, NULL)) {
+		BLI_buffer_append(raycast_data->z_buffer, float, dist);
+	}
+}
+
+/**
+ * Count how many times a ray from \a co crosses the surface in \a tree,
+ * hits at the same depth (shared edges & vertices) are only counted once.
+ */
+static int isect_bvhtree_point_v3(
+        BVHTree *tree, const float (*looptri_coords)[3][3],
+        const float co[3], const float dir[3], const float eps,
+        BLI_Buffer *z_buffer)
+{
+	struct RaycastData raycast_data = {looptri_coords, z_buffer};
+	int hits = 0;
+
+	BLI_buffer_empty(z_buffer);
+	BLI_bvhtree_ray_cast_all(tree, co, dir, 0.0f, raycast_callback, &raycast_data);
+
+	if (z_buffer->count) {
+		float *depths = z_buffer->data;
+		int i;
+
+		qsort(depths, (size_t)z_buffer->count, sizeof(float), BLI_sortutil_cmp_float);
+
+		hits = 1;
+		for (i = 1; i < z_buffer->count; i++) {
+			if (depths[i] - depths[i - 1] > eps) {
+				hits++;
+			}
+		}
+	}
+
+	return hits;
+}
+
+/**
+ * Test if \a co is inside the closed surface in \a tree.
+ *
+ * A single ray can graze an edge or run along coplanar faces and miscount,
+ * so cast along a few skewed directions and take the majority.
+ */
+static bool isect_bvhtree_point_inside(
+        BVHTree *tree, const float (*looptri_coords)[3][3],
+        const float co[3], const float eps)
+{
+	static const float dirs[3][3] = {
+		{1.0f, 2.0f, 3.0f},
+		{-4.0f, 1.0f, 2.0f},
+		{3.0f, -5.0f, -1.0f},
+	};
+	BLI_buffer_declare_static(float, z_buffer, BLI_BUFFER_NOP, 64);
+	unsigned int i, inside = 0;
+
+	for (i = 0; i < ARRAY_SIZE(dirs); i++) {
+		if (isect_bvhtree_point_v3(tree, looptri_coords, co, dirs[i], eps, &z_buffer) & 1) {
+			inside++;
+		}
+	}
+
+	BLI_buffer_free(&z_buffer);
+
+	return (inside >= 2);
+}
+
+#ifdef USE_COPLANAR
+static void nearest_callback(void *userdata, int index, const float co[3], BVHTreeNearest *nearest)
+{
+	const float (*looptri_coords)[3][3] = userdata;
+	const float (*tri)[3] = looptri_coords[index];
+	float co_tri[3];
+	float dist_sq;
+
+	closest_on_tri_to_point_v3(co_tri, co, UNPACK3(tri));
+	dist_sq = len_squared_v3v3(co, co_tri);
+
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, co_tri);
+		normal_tri_v3(nearest->no, UNPACK3(tri));
+	}
+}
+
+/**
+ * Check if \a co lies on the surface in \a tree (coincident faces),
+ * where ray-casting can't give a reliable inside/outside result.
+ *
+ * \return 0 when not on the surface, 1 when \a no points the same way as the surface, -1 otherwise.
+ */
+static int isect_bvhtree_point_on_surface(
+        BVHTree *tree, const float (*looptri_coords)[3][3],
+        const float co[3], const float no[3], const float eps)
+{
+	BVHTreeNearest nearest;
+
+	nearest.index = -1;
+	nearest.dist_sq = eps * eps;
+
+	if (BLI_bvhtree_find_nearest(tree, co, &nearest, nearest_callback, (void *)looptri_coords) == -1) {
+		return 0;
+	}
+
+	return (dot_v3v3(no, nearest.no) > 0.0f) ? 1 : -1;
+}
+#endif  /* USE_COPLANAR */
+
+/**
+ * Centroid of the largest triangle of the face's tessellation,
+ * (unlike the face center, always on the face itself, even for concave faces).
+ */
+static void bm_face_calc_point_in_face(const BMFace *f, float r_co[3])
+{
+	const unsigned int tot_tri = (unsigned int)f->len - 2;
+	BMLoop **loops = BLI_array_alloca(loops, (unsigned int)f->len);
+	unsigned int (*index)[3] = BLI_array_alloca(index, tot_tri);
+	float area_best = -1.0f;
+	unsigned int i;
+
+	BM_face_calc_tessellation(f, loops, index);
+
+	for (i = 0; i < tot_tri; i++) {
+		const float *v1 = loops[index[i][0]]->v->co;
+		const float *v2 = loops[index[i][1]]->v->co;
+		const float *v3 = loops[index[i][2]]->v->co;
+		const float area = area_tri_v3(v1, v2, v3);
+		if (area > area_best) {
+			area_best = area;
+			mid_v3_v3v3v3(r_co, v1, v2, v3);
+		}
+	}
+}
+
+struct LoopFilterWrap {
+	int (*test_fn)(BMFace *f, void *user_data);
+	void *user_data;
+};
+
+/**
+ * Face groups may only step over edges where all faces are from the same side,
+ * intersection edges are shared by both sides so they delimit the regions.
+ */
+static bool bm_edge_filter_fn(BMElem *ele, void *user_data)
+{
+	BMEdge *e = (BMEdge *)ele;
+	struct LoopFilterWrap *data = user_data;
+	BMLoop *l_iter = e->l;
+	const int face_side = data->test_fn(l_iter->f, data->user_data);
+
+	while ((l_iter = l_iter->radial_next) != e->l) {
+		const int face_side_other = data->test_fn(l_iter->f, data->user_data);
+		if ((face_side_other != -1) && (face_side_other != face_side)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Remove or flip face regions based on which side of the other mesh they're on.
+ *
+ * \return true when the mesh was changed.
+ */
+static bool bm_isect_boolean(
+        BMesh *bm, BVHTree *tree_pair[2], const float (*looptri_coords)[3][3],
+        int (*test_fn)(BMFace *f, void *user_data), void *user_data,
+        const int boolean_mode, const float eps)
+{
+	struct LoopFilterWrap user_data_wrap = {test_fn, user_data};
+	int *groups_array;
+	int (*group_index)[2];
+	/* per-group: bit 1 to remove, bit 2 to flip */
+	char *group_action;
+	int group_tot;
+	bool has_edit = false;
+	BMFace **ftable;
+	int i;
+
+	groups_array = MEM_mallocN(sizeof(*groups_array) * (size_t)bm->totface, __func__);
+	group_tot = BM_mesh_calc_face_groups(
+	        bm, groups_array, &group_index,
+	        bm_edge_filter_fn, &user_data_wrap,
+	        0, BM_EDGE);
+
+	BM_mesh_elem_table_init(bm, BM_FACE);
+	ftable = bm->ftable;
+
+	group_action = MEM_callocN(sizeof(*group_action) * (size_t)group_tot, __func__);
+
+#pragma omp parallel for schedule(dynamic) if (group_tot > 1)
+	for (i = 0; i < group_tot; i++) {
+		/* the faces of a region are entirely on one side, testing one face is enough */
+		BMFace *f = ftable[groups_array[group_index[i][0]]];
+		int side = test_fn(f, user_data);
+		bool is_inside;
+		float co[3];
+
+		if (side == -1) {
+			continue;
+		}
+		BLI_assert(ELEM(side, 0, 1));
+
+		bm_face_calc_point_in_face(f, co);
+
+#ifdef USE_COPLANAR
+		{
+			float no[3];
+			int on_surface;
+
+			BM_face_calc_normal(f, no);
+			on_surface = isect_bvhtree_point_on_surface(tree_pair[!side], looptri_coords, co, no, eps * 2.0f);
+
+			if (on_surface != 0) {
+				/* coincident with the other mesh, where both surfaces face the same way
+				 * keep a single copy (from the first side), otherwise the faces cancel out */
+				if (boolean_mode == BMESH_ISECT_BOOLEAN_DIFFERENCE) {
+					group_action[i] = ((side == 0) && (on_surface == -1)) ? 0 : 1;
+				}
+				else {
+					group_action[i] = ((side == 0) && (on_surface == 1)) ? 0 : 1;
+				}
+				continue;
+			}
+		}
+#endif
+
+		is_inside = isect_bvhtree_point_inside(tree_pair[!side], looptri_coords, co, eps);
+
+		switch (boolean_mode) {
+			case BMESH_ISECT_BOOLEAN_ISECT:
+				group_action[i] = is_inside ? 0 : 1;
+				break;
+			case BMESH_ISECT_BOOLEAN_UNION:
+				group_action[i] = is_inside ? 1 : 0;
+				break;
+			case BMESH_ISECT_BOOLEAN_DIFFERENCE:
+				if (side == 0) {
+					group_action[i] = is_inside ? 1 : 0;
+				}
+				else {
+					group_action[i] = is_inside ? 2 : 1;
+				}
+				break;
+		}
+	}
+
+	BM_mesh_elem_hflag_disable_all(bm, BM_VERT | BM_EDGE, BM_ELEM_TAG, false);
+
+	for (i = 0; i < group_tot; i++) {
+		int fg = group_index[i][0];
+		const int fg_end = group_index[i][1] + fg;
+
+		if (group_action[i] & 1) {
+			for (; fg != fg_end; fg++) {
+				BMFace *f = ftable[groups_array[fg]];
+				BMLoop *l_iter, *l_first;
+
+				l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+				do {
+					BM_elem_flag_enable(l_iter->e, BM_ELEM_TAG);
+					BM_elem_flag_enable(l_iter->v, BM_ELEM_TAG);
+				} while ((l_iter = l_iter->next) != l_first);
+
+				BM_face_kill(bm, f);
+			}
+		}
+		else if (group_action[i] & 2) {
+			for (; fg != fg_end; fg++) {
+				BM_face_normal_flip(bm, ftable[groups_array[fg]]);
+			}
+		}
+
+		has_edit |= (group_action[i] != 0);
+	}
+
+	if (has_edit) {
+		BMIter iter;
+		BMEdge *e, *e_next;
+		BMVert *v, *v_next;
+
+		/* remove loose geometry left by the removed faces */
+		BM_ITER_MESH_MUTABLE (e, e_next, &iter, bm, BM_EDGES_OF_MESH) {
+			if (BM_elem_flag_test(e, BM_ELEM_TAG) && (e->l == NULL)) {
+				BM_edge_kill(bm, e);
+			}
+		}
+		BM_ITER_MESH_MUTABLE (v, v_next, &iter, bm, BM_VERTS_OF_MESH) {
+			if (BM_elem_flag_test(v, BM_ELEM_TAG) && (v->e == NULL)) {
+				BM_vert_kill(bm, v);
+			}
+		}
+	}
+
+	MEM_freeN(group_action);
+	MEM_freeN(groups_array);
+	MEM_freeN(group_index);
+
+	return has_edit;
+}
+
+#endif  /* USE_BOOLEAN_RAYCAST */
+
 /**
  * Intersect tessellated faces
  * leaving the resulting edges tagged.
  *
  * \param test_fn Return value: -1: skip, 0: tree_a, 1: tree_b (use_self == false)
+ * \param boolean_mode  When not #BMESH_ISECT_BOOLEAN_NONE, remove the regions of each side
+ * which are inside/outside the other (both sides must be closed, use_self must be false).
  */
 bool BM_mesh_intersect(
         BMesh *bm,
         struct BMLoop *(*looptris)[3], const int looptris_tot,
         int (*test_fn)(BMFace *f, void *user_data), void *user_data,
         const bool use_self, const bool use_separate,
+        const int boolean_mode,
         const float eps)
 {
 	struct ISectState s;
@@ -795,6 +1462,11 @@ bool BM_mesh_intersect(
 	BVHTree *tree_a, *tree_b;
 	unsigned int tree_overlap_tot;
 	BVHTreeOverlap *overlap;
+	struct ISectOverlapData overlap_data;
+#ifdef USE_BOOLEAN_RAYCAST
+	/* copy since the triangles are freed while cutting */
+	float (*looptri_coords)[3][3] = NULL;
+#endif
 #else
 	int i_a, i_b;
 #endif
@@ -847,6 +1519,13 @@ bool BM_mesh_intersect(
 	printf("data = [\n");
 #endif
 
+#ifdef USE_BOOLEAN_RAYCAST
+	BLI_assert((boolean_mode == BMESH_ISECT_BOOLEAN_NONE) || (use_self == false));
+	if (boolean_mode != BMESH_ISECT_BOOLEAN_NONE) {
+		looptri_coords = MEM_mallocN(sizeof(*looptri_coords) * (size_t)looptris_tot, __func__);
+	}
+#endif
+
 #ifdef USE_BVH
 	{
 		int i;
@@ -860,6 +1539,11 @@ bool BM_mesh_intersect(
 				};
 
 				BLI_bvhtree_insert(tree_a, i, (const float *)t_cos, 3);
+#ifdef USE_BOOLEAN_RAYCAST
+				if (looptri_coords) {
+					memcpy(looptri_coords[i], t_cos, sizeof(*looptri_coords));
+				}
+#endif
 			}
 		}
 		BLI_bvhtree_balance(tree_a);
@@ -877,6 +1561,11 @@ bool BM_mesh_intersect(
 				};
 
 				BLI_bvhtree_insert(tree_b, i, (const float *)t_cos, 3);
+#ifdef USE_BOOLEAN_RAYCAST
+				if (looptri_coords) {
+					memcpy(looptri_coords[i], t_cos, sizeof(*looptri_coords));
+				}
+#endif
 			}
 		}
 		BLI_bvhtree_balance(tree_b);
@@ -885,7 +1574,9 @@ bool BM_mesh_intersect(
 		tree_b = tree_a;
 	}
 
-	overlap = BLI_bvhtree_overlap(tree_b, tree_a, &tree_overlap_tot, NULL, NULL);
+	overlap_data.looptris = looptris;
+	overlap_data.eps_margin = s.epsilon.eps_margin;
+	overlap = BLI_bvhtree_overlap(tree_b, tree_a, &tree_overlap_tot, bm_isect_tri_tri_overlap_cb, &overlap_data);
 
 	if (overlap) {
 		unsigned int i;
@@ -908,9 +1599,16 @@ bool BM_mesh_intersect(
 		}
 		MEM_freeN(overlap);
 	}
-	BLI_bvhtree_free(tree_a);
-	if (tree_a != tree_b) {
-		BLI_bvhtree_free(tree_b);
+
+#ifdef USE_BOOLEAN_RAYCAST
+	/* trees are needed for ray-casting once the faces are cut */
+	if (looptri_coords == NULL)
+#endif
+	{
+		BLI_bvhtree_free(tree_a);
+		if (tree_a != tree_b) {
+			BLI_bvhtree_free(tree_b);
+		}
 	}
 
 #else
@@ -958,6 +1656,9 @@ bool BM_mesh_intersect(
 #ifdef USE_SPLICE
 	{
 		GHashIterator gh_iter;
+#ifdef USE_COPLANAR
+		LinkNode *vert_double = NULL;
+#endif
 
 		GHASH_ITER (gh_iter, s.edge_verts) {
 			BMEdge *e = BLI_ghashIterator_getKey(&gh_iter);
@@ -998,6 +1699,11 @@ bool BM_mesh_intersect(
 				BMVert *vi = node->link;
 				const float fac = line_point_factor_v3(vi->co, e->v1->co, e->v2->co);
 
+				/* the same vertex may be added from multiple triangles */
+				if (BM_vert_in_edge(e, vi)) {
+					continue;
+				}
+
 				if (BM_vert_in_edge(e, v_prev)) {
 					v_prev = BM_edge_split(bm, e, v_prev, NULL, CLAMPIS(fac, 0.0f, 1.0f));
 					BLI_assert( BM_vert_in_edge(e, v_end));
@@ -1008,6 +1714,15 @@ bool BM_mesh_intersect(
 					{
 						BM_vert_splice(bm, vi, v_prev);
 					}
+#ifdef USE_COPLANAR
+					else if (!BM_edge_exists(v_prev, vi) &&
+					         !BM_vert_pair_share_face_check(v_prev, vi))
+					{
+						/* overlapping co-linear edges, splice and merge the doubles afterwards */
+						BM_vert_splice(bm, vi, v_prev);
+						BLI_linklist_prepend_arena(&vert_double, vi, s.mem_arena);
+					}
+#endif
 					else {
 						copy_v3_v3(v_prev->co, vi->co);
 					}
@@ -1018,6 +1733,12 @@ bool BM_mesh_intersect(
 				}
 			}
 		}
+
+#ifdef USE_COPLANAR
+		if (vert_double) {
+			bm_isect_edge_doubles_merge(bm, &s, vert_double);
+		}
+#endif
 	}
 #endif
 
@@ -1037,6 +1758,12 @@ bool BM_mesh_intersect(
 				if (!BM_vert_is_edge_pair(v)) {
 					BM_elem_flag_disable(v, BM_ELEM_TAG);
 				}
+#ifdef USE_COPLANAR
+				/* edges merged with face boundaries (co-planar), can't be dissolved */
+				else if (v->e->l || BM_DISK_EDGE_NEXT(v->e, v)->l) {
+					BM_elem_flag_disable(v, BM_ELEM_TAG);
+				}
+#endif
 			}
 		}
 
@@ -1270,6 +1997,29 @@ bool BM_mesh_intersect(
 #endif  /* USE_NET */
 	(void)totface_orig;
 
+	has_isect = (BLI_ghash_size(s.face_edges) != 0);
+
+#ifdef USE_BOOLEAN_RAYCAST
+	if (looptri_coords) {
+		BVHTree *tree_pair[2] = {tree_a, tree_b};
+
+		/* regions which don't touch the other mesh may still be removed (nested meshes) */
+		if (bm_isect_boolean(
+		        bm, tree_pair, (const float (*)[3][3])looptri_coords,
+		        test_fn, user_data,
+		        boolean_mode, s.epsilon.eps))
+		{
+			has_isect = true;
+		}
+
+		BLI_bvhtree_free(tree_a);
+		BLI_bvhtree_free(tree_b);
+		MEM_freeN(looptri_coords);
+	}
+#else
+	(void)boolean_mode;
+#endif  /* USE_BOOLEAN_RAYCAST */
+
 #ifdef USE_SEPARATE
 	if (use_separate) {
 		GSetIterator gs_iter;
@@ -1287,8 +2037,6 @@ bool BM_mesh_intersect(
 	(void)use_separate;
 #endif  /* USE_SEPARATE */
 
-	has_isect = (BLI_ghash_size(s.face_edges) != 0);
-
 	/* cleanup */
 	BLI_ghash_free(s.edgetri_cache, NULL, NULL);
 
@@ -90,6 +90,17 @@ void DEG_stats_simple(const struct Depsgraph *graph,
 
 void DEG_debug_graphviz(const struct Depsgraph *graph, FILE *stream, const char *label, bool show_eval);
 
+/* ************************************************ */
+/* Evaluation Trace */
+
+/* Start recording start/end time and thread of every evaluated operation. */
+void DEG_debug_trace_begin(void);
+
+/* Stop recording, writing the recorded operations to filepath (when not NULL)
+ * as a Chrome trace (chrome://tracing) JSON file.
+ */
+bool DEG_debug_trace_end(const char *filepath);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
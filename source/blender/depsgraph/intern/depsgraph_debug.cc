@@ -31,13 +31,18 @@
  */
 
 //#include <stdlib.h>
+#include <algorithm>
 #include <string.h>
 
+#include "PIL_time.h"
+
 extern "C" {
 #include "BLI_utildefines.h"
 #include "BLI_listbase.h"
+#include "BLI_fileops.h"
 #include "BLI_ghash.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 
 #include "DNA_scene_types.h"
 #include "DNA_userdef_types.h"
@@ -46,6 +51,8 @@ extern "C" {
 #include "DEG_depsgraph_debug.h"
 #include "DEG_depsgraph_build.h"
 
+#include "BKE_depsgraph.h"
+
 #include "WM_api.h"
 #include "WM_types.h"
 }  /* extern "C" */
@@ -391,6 +398,7 @@ static void deg_debug_graphviz_node_single(const DebugContext &ctx,
 	const char *shape = "box";
 	string name = node->identifier();
 	float priority = -1.0f;
+	double time = 0.0;
 	if (node->type == DEPSNODE_TYPE_ID_REF) {
 		IDDepsNode *id_node = (IDDepsNode *)node;
 		char buf[256];
@@ -399,15 +407,17 @@ static void deg_debug_graphviz_node_single(const DebugContext &ctx,
 	}
 	if (ctx.show_eval_priority && node->tclass == DEPSNODE_CLASS_OPERATION) {
 		priority = ((OperationDepsNode *)node)->eval_priority;
+		time = ((OperationDepsNode *)node)->eval_time;
 	}
 	deg_debug_fprintf(ctx, "// %s\n", name.c_str());
 	deg_debug_fprintf(ctx, "\"node_%p\"", node);
 	deg_debug_fprintf(ctx, "[");
 //	deg_debug_fprintf(ctx, "label=<<B>%s</B>>", name);
 	if (priority >= 0.0f) {
-		deg_debug_fprintf(ctx, "label=<%s<BR/>(<I>%.2f</I>)>",
+		deg_debug_fprintf(ctx, "label=<%s<BR/>(<I>%.2f</I>, %.3f ms)>",
 		                 name.c_str(),
-		                 priority);
+		                 priority,
+		                 time * 1000.0);
 	}
 	else {
 		deg_debug_fprintf(ctx, "label=<%s>", name.c_str());
@@ -785,16 +795,59 @@ static void times_add(DepsgraphStatsTimes &times, float time)
 	times.duration_last += time;
 }
 
+/* Evaluation trace, collects timing of all evaluated operations. */
+
+struct DepsgraphTraceEvent {
+	string name;        /* operation identifier, or label of the whole evaluation */
+	string category;    /* name of the ID which owns the operation */
+	int thread_id;
+	double start_time;
+	double end_time;
+};
+
+struct DepsgraphTrace {
+	vector<DepsgraphTraceEvent> events;
+	SpinLock lock;
+	double eval_start_time;
+};
+
+DepsgraphTrace *DepsgraphDebug::trace = NULL;
+
+static void trace_add_event(DepsgraphTrace *trace, const DepsgraphTraceEvent &event)
+{
+	BLI_spin_lock(&trace->lock);
+	trace->events.push_back(event);
+	BLI_spin_unlock(&trace->lock);
+}
+
 void DepsgraphDebug::eval_begin(const EvaluationContext *UNUSED(eval_ctx))
 {
 	/* TODO(sergey): Stats are currently globally disabled. */
 	/* verify_stats(); */
 	reset_stats();
+
+	if (trace) {
+		trace->eval_start_time = PIL_check_seconds_timer();
+	}
 }
 
-void DepsgraphDebug::eval_end(const EvaluationContext *UNUSED(eval_ctx))
+void DepsgraphDebug::eval_end(const EvaluationContext *eval_ctx)
 {
 	WM_main_add_notifier(NC_SPACE | ND_SPACE_INFO_REPORT, NULL);
+
+	if (trace) {
+		char name[64];
+		BLI_snprintf(name, sizeof(name), "Evaluate frame %.2f", eval_ctx->ctime);
+
+		DepsgraphTraceEvent event;
+		event.name = name;
+		event.category = "Depsgraph";
+		/* Evaluation is driven by the thread which waits on the task pool. */
+		event.thread_id = 0;
+		event.start_time = trace->eval_start_time;
+		event.end_time = PIL_check_seconds_timer();
+		trace_add_event(trace, event);
+	}
 }
 
 void DepsgraphDebug::eval_step(const EvaluationContext *UNUSED(eval_ctx),
@@ -855,6 +908,22 @@ void DepsgraphDebug::task_completed(Depsgraph *graph,
 	}
 }
 
+void DepsgraphDebug::task_trace(const OperationDepsNode *node,
+                                int thread_id,
+                                double start_time,
+                                double end_time)
+{
+	if (trace) {
+		DepsgraphTraceEvent event;
+		event.name = node->identifier();
+		event.category = node->owner->owner->name;
+		event.thread_id = thread_id;
+		event.start_time = start_time;
+		event.end_time = end_time;
+		trace_add_event(trace, event);
+	}
+}
+
 /* ********** */
 /* Statistics */
 
@@ -962,6 +1031,101 @@ DepsgraphStatsID *DEG_stats_id(ID *id)
 	return DepsgraphDebug::get_id_stats(id, false);
 }
 
+/* ------------------------------------------------ */
+
+void DEG_debug_trace_begin(void)
+{
+	if (DepsgraphDebug::trace == NULL) {
+		DepsgraphTrace *trace = OBJECT_GUARDED_NEW(DepsgraphTrace);
+		BLI_spin_init(&trace->lock);
+		trace->eval_start_time = 0.0;
+		DepsgraphDebug::trace = trace;
+	}
+	else {
+		DepsgraphDebug::trace->events.clear();
+	}
+}
+
+static void trace_fprint_string(FILE *f, const string &str)
+{
+	fputc('"', f);
+	for (string::const_iterator it = str.begin(); it != str.end(); ++it) {
+		const unsigned char c = *it;
+		if (c == '"' || c == '\\') {
+			fprintf(f, "\\%c", c);
+		}
+		else if (c < 0x20) {
+			fprintf(f, "\\u%04x", c);
+		}
+		else {
+			fputc(c, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static bool trace_write(const DepsgraphTrace *trace, const char *filepath)
+{
+	FILE *f = BLI_fopen(filepath, "w");
+	if (f == NULL) {
+		return false;
+	}
+
+	/* Times are written relative to the first event, in microseconds. */
+	double time_offset = 0.0;
+	if (!trace->events.empty()) {
+		time_offset = trace->events[0].start_time;
+		for (vector<DepsgraphTraceEvent>::const_iterator it = trace->events.begin();
+		     it != trace->events.end();
+		     ++it)
+		{
+			time_offset = std::min(time_offset, it->start_time);
+		}
+	}
+
+	fprintf(f, "{\"traceEvents\":[\n");
+	for (vector<DepsgraphTraceEvent>::const_iterator it = trace->events.begin();
+	     it != trace->events.end();
+	     ++it)
+	{
+		const DepsgraphTraceEvent &event = *it;
+		fprintf(f, "{\"name\":");
+		trace_fprint_string(f, event.name);
+		fprintf(f, ",\"cat\":");
+		trace_fprint_string(f, event.category);
+		fprintf(f, ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+		        event.thread_id,
+		        (event.start_time - time_offset) * 1e6,
+		        (event.end_time - event.start_time) * 1e6,
+		        (it + 1 != trace->events.end()) ? "," : "");
+	}
+	fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	const bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
+
+bool DEG_debug_trace_end(const char *filepath)
+{
+	DepsgraphTrace *trace = DepsgraphDebug::trace;
+	bool ok = false;
+
+	if (trace == NULL) {
+		return false;
+	}
+
+	if (filepath != NULL) {
+		ok = trace_write(trace, filepath);
+	}
+
+	DepsgraphDebug::trace = NULL;
+	BLI_spin_end(&trace->lock);
+	OBJECT_GUARDED_DELETE(trace, DepsgraphTrace);
+
+	return ok;
+}
+
 bool DEG_debug_compare(const struct Depsgraph *graph1,
                        const struct Depsgraph *graph2)
 {
@@ -38,6 +38,7 @@ extern "C" {
 }
 
 struct DepsgraphStats;
+struct DepsgraphTrace;
 struct DepsgraphStatsID;
 struct DepsgraphStatsComponent;
 struct DepsgraphSettings;
@@ -48,6 +49,7 @@ struct Depsgraph;
 
 struct DepsgraphDebug {
 	static DepsgraphStats *stats;
+	static DepsgraphTrace *trace;
 
 	static void stats_init();
 	static void stats_free();
@@ -64,6 +66,10 @@ struct DepsgraphDebug {
 	static void task_completed(Depsgraph *graph,
 	                           const OperationDepsNode *node,
 	                           double time);
+	static void task_trace(const OperationDepsNode *node,
+	                       int thread_id,
+	                       double start_time,
+	                       double end_time);
 
 	static DepsgraphStatsID *get_id_stats(ID *id, bool create);
 	static DepsgraphStatsComponent *get_component_stats(DepsgraphStatsID *id_stats,
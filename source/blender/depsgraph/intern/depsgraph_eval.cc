@@ -30,6 +30,8 @@
  * Evaluation engine entrypoints for Depsgraph Engine.
  */
 
+#include <algorithm>
+
 #include "MEM_guardedalloc.h"
 
 #include "PIL_time.h"
@@ -118,50 +120,80 @@ void DEG_evaluation_context_free(EvaluationContext *eval_ctx)
 /* ********************** */
 /* Evaluation Entrypoints */
 
-/* Forward declarations. */
-static void schedule_children(TaskPool *pool,
-                              Depsgraph *graph,
-                              OperationDepsNode *node,
-                              const int layers);
+/* Operations which took less than this (in seconds) when they were evaluated
+ * last time are run by the thread which made them ready, pushing a task for
+ * them costs more than evaluating them.
+ */
+#define DEG_EVAL_INLINE_TIME 1e-5
+
+/* Cost (in microseconds) of an operation which wasn't evaluated yet. */
+#define DEG_EVAL_DEFAULT_COST 10.0f
 
 struct DepsgraphEvalState {
 	EvaluationContext *eval_ctx;
 	Depsgraph *graph;
 	int layers;
+	/* Operations with a longer critical path are put in front of the queue. */
+	float high_priority_threshold;
 };
 
+/* Forward declarations. */
+static void schedule_children(TaskPool *pool,
+                              DepsgraphEvalState *state,
+                              OperationDepsNode *node,
+                              vector<OperationDepsNode *> &inline_stack);
+
+static void deg_evaluate_operation(DepsgraphEvalState *state,
+                                   OperationDepsNode *node,
+                                   int threadid)
+{
+	if (node->is_noop()) {
+		return;
+	}
+
+	/* Get context. */
+	// TODO: who initialises this? "Init" operations aren't able to initialise it!!!
+	/* TODO(sergey): Wedon't use component contexts at this moment. */
+	/* ComponentDepsNode *comp = node->owner; */
+	BLI_assert(node->owner != NULL);
+
+	/* Take note of current time. */
+	double start_time = PIL_check_seconds_timer();
+	DepsgraphDebug::task_started(state->graph, node);
+
+	/* Should only be the case for NOOPs, which never get to this point. */
+	BLI_assert(node->evaluate);
+
+	/* Perform operation. */
+	node->evaluate(state->eval_ctx);
+
+	/* Note how long this took. */
+	double end_time = PIL_check_seconds_timer();
+	node->eval_time = end_time - start_time;
+	DepsgraphDebug::task_completed(state->graph,
+	                               node,
+	                               end_time - start_time);
+	DepsgraphDebug::task_trace(node, threadid, start_time, end_time);
+}
+
 static void deg_task_run_func(TaskPool *pool,
                               void *taskdata,
-                              int UNUSED(threadid))
+                              int threadid)
 {
 	DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_userdata(pool);
-	OperationDepsNode *node = (OperationDepsNode *)taskdata;
-
-	if (!node->is_noop()) {
-		/* Get context. */
-		// TODO: who initialises this? "Init" operations aren't able to initialise it!!!
-		/* TODO(sergey): Wedon't use component contexts at this moment. */
-		/* ComponentDepsNode *comp = node->owner; */
-		BLI_assert(node->owner != NULL);
-
-		/* Take note of current time. */
-		double start_time = PIL_check_seconds_timer();
-		DepsgraphDebug::task_started(state->graph, node);
-
-		/* Should only be the case for NOOPs, which never get to this point. */
-		BLI_assert(node->evaluate);
-
-		/* Perform operation. */
-		node->evaluate(state->eval_ctx);
-
-		/* Note how long this took. */
-		double end_time = PIL_check_seconds_timer();
-		DepsgraphDebug::task_completed(state->graph,
-		                               node,
-		                               end_time - start_time);
+	/* Operations which became ready while running this task and which are
+	 * evaluated by this thread directly, without going through the pool.
+	 */
+	vector<OperationDepsNode *> inline_stack;
+
+	inline_stack.push_back((OperationDepsNode *)taskdata);
+	while (!inline_stack.empty()) {
+		OperationDepsNode *node = inline_stack.back();
+		inline_stack.pop_back();
+
+		deg_evaluate_operation(state, node, threadid);
+		schedule_children(pool, state, node, inline_stack);
 	}
-
-	schedule_children(pool, state->graph, node, state->layers);
 }
 
 static void calculate_pending_parents(Depsgraph *graph, int layers)
@@ -201,6 +233,10 @@ static void calculate_pending_parents(Depsgraph *graph, int layers)
 	}
 }
 
+/* Priority of a node is the length of the critical path starting at it,
+ * that is the cost of the most expensive chain of operations which can't
+ * start before this node is evaluated.
+ */
 static void calculate_eval_priority(OperationDepsNode *node)
 {
 	if (node->done) {
@@ -209,10 +245,20 @@ static void calculate_eval_priority(OperationDepsNode *node)
 	node->done = 1;
 
 	if (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) {
-		/* XXX standard cost of a node, could be estimated somewhat later on */
-		const float cost = 1.0f;
-		/* NOOP nodes have no cost */
-		node->eval_priority = node->is_noop() ? cost : 0.0f;
+		float cost, max_child_priority = 0.0f;
+
+		/* NOOP nodes have no cost, others cost as much as they took the
+		 * last time they were evaluated.
+		 */
+		if (node->is_noop()) {
+			cost = 0.0f;
+		}
+		else if (node->eval_time > 0.0) {
+			cost = (float)(node->eval_time * 1e6);
+		}
+		else {
+			cost = DEG_EVAL_DEFAULT_COST;
+		}
 
 		for (OperationDepsNode::Relations::const_iterator it = node->outlinks.begin();
 		     it != node->outlinks.end();
@@ -221,19 +267,41 @@ static void calculate_eval_priority(OperationDepsNode *node)
 			DepsRelation *rel = *it;
 			OperationDepsNode *to = (OperationDepsNode *)rel->to;
 			BLI_assert(to->type == DEPSNODE_TYPE_OPERATION);
+			if (rel->flag & DEPSREL_FLAG_CYCLIC) {
+				continue;
+			}
 			calculate_eval_priority(to);
-			node->eval_priority += to->eval_priority;
+			max_child_priority = std::max(max_child_priority, to->eval_priority);
 		}
+
+		node->eval_priority = cost + max_child_priority;
 	}
 	else {
 		node->eval_priority = 0.0f;
 	}
 }
 
+static bool eval_priority_greater(const OperationDepsNode *a,
+                                  const OperationDepsNode *b)
+{
+	return a->eval_priority > b->eval_priority;
+}
+
+static void schedule_node_task(TaskPool *pool,
+                               DepsgraphEvalState *state,
+                               OperationDepsNode *node)
+{
+	TaskPriority priority = (node->eval_priority > state->high_priority_threshold) ?
+	                        TASK_PRIORITY_HIGH : TASK_PRIORITY_LOW;
+	BLI_task_pool_push(pool, deg_task_run_func, node, false, priority);
+}
+
 static void schedule_graph(TaskPool *pool,
                            Depsgraph *graph,
                            const int layers)
 {
+	vector<OperationDepsNode *> ready_nodes;
+
 	BLI_spin_lock(&graph->lock);
 	for (Depsgraph::OperationNodes::const_iterator it = graph->operations.begin();
 	     it != graph->operations.end();
@@ -245,18 +313,40 @@ static void schedule_graph(TaskPool *pool,
 		    node->num_links_pending == 0 &&
 		    (id_node->layers & layers) != 0)
 		{
-			BLI_task_pool_push(pool, deg_task_run_func, node, false, TASK_PRIORITY_LOW);
+			ready_nodes.push_back(node);
 			node->scheduled = true;
 		}
 	}
 	BLI_spin_unlock(&graph->lock);
+
+	/* Start the longest chains first, the queue is FIFO for tasks with equal
+	 * priority so pushing them in this order is enough.
+	 */
+	std::stable_sort(ready_nodes.begin(), ready_nodes.end(), eval_priority_greater);
+	for (vector<OperationDepsNode *>::const_iterator it = ready_nodes.begin();
+	     it != ready_nodes.end();
+	     ++it)
+	{
+		BLI_task_pool_push(pool, deg_task_run_func, *it, false, TASK_PRIORITY_LOW);
+	}
 }
 
+/* Schedule children of the node which became ready for evaluation.
+ *
+ * Cheap operations and the child with the longest critical path are added to
+ * the inline_stack and evaluated by the current thread, the rest are pushed
+ * to the task pool.
+ */
 static void schedule_children(TaskPool *pool,
-                              Depsgraph *graph,
+                              DepsgraphEvalState *state,
                               OperationDepsNode *node,
-                              const int layers)
+                              vector<OperationDepsNode *> &inline_stack)
 {
+	Depsgraph *graph = state->graph;
+	const int layers = state->layers;
+	const size_t inline_start = inline_stack.size();
+	OperationDepsNode *critical_child = NULL;
+
 	for (OperationDepsNode::Relations::const_iterator it = node->outlinks.begin();
 	     it != node->outlinks.end();
 	     ++it)
@@ -285,12 +375,34 @@ static void schedule_children(TaskPool *pool,
 				child->scheduled = true;
 				BLI_spin_unlock(&graph->lock);
 
-				if (need_schedule) {
-					BLI_task_pool_push(pool, deg_task_run_func, child, false, TASK_PRIORITY_LOW);
+				if (!need_schedule) {
+					continue;
+				}
+
+				if (child->is_noop() ||
+				    (child->eval_time > 0.0 && child->eval_time < DEG_EVAL_INLINE_TIME))
+				{
+					inline_stack.push_back(child);
+				}
+				else if (critical_child == NULL) {
+					critical_child = child;
+				}
+				else {
+					if (child->eval_priority > critical_child->eval_priority) {
+						std::swap(child, critical_child);
+					}
+					schedule_node_task(pool, state, child);
 				}
 			}
 		}
 	}
+
+	/* Cheap operations go first since they might make more work available
+	 * to other threads, then continue with the critical path.
+	 */
+	if (critical_child != NULL) {
+		inline_stack.insert(inline_stack.begin() + inline_start, critical_child);
+	}
 }
 
 /**
@@ -321,6 +433,7 @@ void DEG_evaluate_on_refresh_ex(EvaluationContext *eval_ctx,
 	state.eval_ctx = eval_ctx;
 	state.graph = graph;
 	state.layers = layers;
+	state.high_priority_threshold = 0.0f;
 
 	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
 	TaskPool *task_pool = BLI_task_pool_create(task_scheduler, &state);
@@ -347,7 +460,11 @@ void DEG_evaluate_on_refresh_ex(EvaluationContext *eval_ctx,
 	{
 		OperationDepsNode *node = *it;
 		calculate_eval_priority(node);
+		state.high_priority_threshold = std::max(state.high_priority_threshold,
+		                                         node->eval_priority);
 	}
+	/* Chains at least half as long as the longest one start before others. */
+	state.high_priority_threshold *= 0.5f;
 
 	DepsgraphDebug::eval_begin(eval_ctx);
 
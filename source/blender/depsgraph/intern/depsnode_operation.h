@@ -74,7 +74,8 @@ struct OperationDepsNode : public DepsNode {
 
 
 	uint32_t num_links_pending; /* how many inlinks are we still waiting on before we can be evaluated... */
-	float eval_priority;
+	float eval_priority;        /* length of the longest chain of pending work starting at this node */
+	double eval_time;           /* how long the last evaluation took (in seconds), 0.0 when not evaluated yet */
 	bool scheduled;
 
 	short optype;                 /* (eDepsOperation_Type) stage of evaluation */
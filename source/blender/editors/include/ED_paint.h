@@ -43,6 +43,8 @@ enum {
 typedef void (*UndoRestoreCb)(struct bContext *C, struct ListBase *lb);
 typedef void (*UndoFreeCb)(struct ListBase *lb);
 typedef bool (*UndoCleanupCb)(struct bContext *C, struct ListBase *lb);
+/* Merge the older step 'lb_src' into 'lb_dst', returns false when not possible */
+typedef bool (*UndoMergeCb)(struct ListBase *lb_dst, struct ListBase *lb_src, size_t *r_size);
 
 int ED_undo_paint_step(struct bContext *C, int type, int step, const char *name);
 void ED_undo_paint_step_num(struct bContext *C, int type, int num);
@@ -50,7 +52,8 @@ const char *ED_undo_paint_get_name(struct bContext *C, int type, int nr, bool *r
 void ED_undo_paint_free(void);
 bool ED_undo_paint_is_valid(int type, const char *name);
 bool ED_undo_paint_empty(int type);
-void ED_undo_paint_push_begin(int type, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup);
+void ED_undo_paint_push_begin(int type, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup,
+                              UndoMergeCb merge);
 void ED_undo_paint_push_end(int type);
 
 /* paint_image.c */
@@ -2639,6 +2639,10 @@ void init_userdef_do_versions(void)
 		U.node_margin = 80;
 	}
 
+	if (!USER_VERSION_ATLEAST(275, 6)) {
+		U.modcachelimit = 256;
+	}
+
 	if (U.pixelsize == 0.0f)
 		U.pixelsize = 1.0f;
 	
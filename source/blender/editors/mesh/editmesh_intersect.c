@@ -124,6 +124,7 @@ static int edbm_intersect_exec(bContext *C, wmOperator *op)
 	        em->looptris, em->tottri,
 	        test_fn, NULL,
 	        use_self, use_separate,
+	        BMESH_ISECT_BOOLEAN_NONE,
 	        eps);
 
 
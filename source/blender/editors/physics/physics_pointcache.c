@@ -83,8 +83,10 @@ static void bake_console_progress_end(void *UNUSED(arg))
 	printf("\rbake: done!\n");
 }
 
-static void ptcache_free_bake(PointCache *cache)
+static void ptcache_free_bake(PTCacheID *pid)
 {
+	PointCache *cache = pid->cache;
+
 	if (cache->edit) {
 		if (!cache->edit->edited || 1) {// XXX okee("Lose changes done in particle mode?")) {
 			PE_free_ptcache_edit(cache->edit);
@@ -95,6 +97,10 @@ static void ptcache_free_bake(PointCache *cache)
 	else {
 		cache->flag &= ~PTCACHE_BAKED;
 	}
+
+	/* only bakes are packed */
+	if ((cache->flag & PTCACHE_BAKED) == 0)
+		BKE_ptcache_disk_unpack(pid);
 }
 
 static int ptcache_bake_all_exec(bContext *C, wmOperator *op)
@@ -146,7 +152,7 @@ static int ptcache_free_bake_all_exec(bContext *C, wmOperator *UNUSED(op))
 		BKE_ptcache_ids_from_object(&pidlist, base->object, scene, MAX_DUPLI_RECUR);
 
 		for (pid=pidlist.first; pid; pid=pid->next) {
-			ptcache_free_bake(pid->cache);
+			ptcache_free_bake(pid);
 		}
 		
 		BLI_freelistN(&pidlist);
@@ -244,11 +250,23 @@ static int ptcache_bake_exec(bContext *C, wmOperator *op)
 }
 static int ptcache_free_bake_exec(bContext *C, wmOperator *UNUSED(op))
 {
+	Scene *scene = CTX_data_scene(C);
 	PointerRNA ptr= CTX_data_pointer_get_type(C, "point_cache", &RNA_PointCache);
 	PointCache *cache= ptr.data;
 	Object *ob= ptr.id.data;
+	PTCacheID *pid;
+	ListBase pidlist;
+
+	BKE_ptcache_ids_from_object(&pidlist, ob, scene, MAX_DUPLI_RECUR);
 
-	ptcache_free_bake(cache);
+	for (pid=pidlist.first; pid; pid=pid->next) {
+		if (pid->cache == cache) {
+			ptcache_free_bake(pid);
+			break;
+		}
+	}
+
+	BLI_freelistN(&pidlist);
 	
 	WM_event_add_notifier(C, NC_OBJECT|ND_POINTCACHE, ob);
 
@@ -777,7 +777,7 @@ static PaintOperation *texture_paint_init(bContext *C, wmOperator *op, const flo
 	
 	settings->imapaint.flag |= IMAGEPAINT_DRAWING;
 	ED_undo_paint_push_begin(UNDO_PAINT_IMAGE, op->type->name,
-	                         ED_image_undo_restore, ED_image_undo_free, NULL);
+	                         ED_image_undo_restore, ED_image_undo_free, NULL, NULL);
 
 	return pop;
 }
@@ -1495,7 +1495,7 @@ void ED_imapaint_bucket_fill(struct bContext *C, float color[3], wmOperator *op)
 	Image *ima = sima->image;
 
 	ED_undo_paint_push_begin(UNDO_PAINT_IMAGE, op->type->name,
-	                      ED_image_undo_restore, ED_image_undo_free, NULL);
+	                      ED_image_undo_restore, ED_image_undo_free, NULL, NULL);
 
 	paint_2d_bucket_fill(C, color, NULL, NULL, NULL);
 
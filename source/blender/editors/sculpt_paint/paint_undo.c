@@ -52,6 +52,7 @@ typedef struct UndoElem {
 	UndoRestoreCb restore;
 	UndoFreeCb free;
 	UndoCleanupCb cleanup;
+	UndoMergeCb merge;
 } UndoElem;
 
 typedef struct UndoStack {
@@ -79,7 +80,8 @@ static void undo_elem_free(UndoStack *UNUSED(stack), UndoElem *uel)
 	}
 }
 
-static void undo_stack_push_begin(UndoStack *stack, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup)
+static void undo_stack_push_begin(UndoStack *stack, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup,
+                                  UndoMergeCb merge)
 {
 	UndoElem *uel;
 	int nr;
@@ -100,6 +102,7 @@ static void undo_stack_push_begin(UndoStack *stack, const char *name, UndoRestor
 	uel->restore = restore;
 	uel->free = free;
 	uel->cleanup = cleanup;
+	uel->merge = merge;
 	BLI_addtail(&stack->elems, uel);
 
 	/* name can be a dynamic string */
@@ -122,6 +125,43 @@ static void undo_stack_push_begin(UndoStack *stack, const char *name, UndoRestor
 	}
 }
 
+/* Combine the oldest steps while over the memory limit, so fewer
+ * steps need to be freed */
+static void undo_stack_merge_to_limit(UndoStack *stack, uintptr_t maxmem)
+{
+	UndoElem *uel;
+	uintptr_t totmem = 0;
+
+	for (uel = stack->elems.first; uel; uel = uel->next) {
+		totmem += uel->undosize;
+	}
+
+	while (totmem > maxmem) {
+		UndoElem *first = stack->elems.first;
+		UndoElem *second = first ? first->next : NULL;
+		size_t size;
+
+		if (!second || first == stack->current || !first->merge || first->merge != second->merge) {
+			break;
+		}
+
+		if (!second->merge(&second->elems, &first->elems, &size)) {
+			break;
+		}
+
+		totmem -= first->undosize + second->undosize;
+		totmem += size;
+		second->undosize = size;
+
+		if (G.debug & G_DEBUG_WM) {
+			printf("%s: merged '%s' into '%s'\n", __func__, first->name, second->name);
+		}
+
+		undo_elem_free(stack, first);
+		BLI_freelinkN(&stack->elems, first);
+	}
+}
+
 static void undo_stack_push_end(UndoStack *stack)
 {
 	UndoElem *uel;
@@ -156,6 +196,8 @@ static void undo_stack_push_end(UndoStack *stack)
 		totmem = 0;
 		maxmem = ((uintptr_t)U.undomemory) * 1024 * 1024;
 
+		undo_stack_merge_to_limit(stack, maxmem);
+
 		uel = stack->elems.last;
 		while (uel) {
 			totmem += uel->undosize;
@@ -171,6 +213,15 @@ static void undo_stack_push_end(UndoStack *stack)
 			}
 		}
 	}
+
+	if (G.debug & G_DEBUG_WM) {
+		totmem = 0;
+		for (uel = stack->elems.first; uel; uel = uel->next) {
+			totmem += uel->undosize;
+		}
+		printf("%s: %d steps, %.2f MB\n", __func__,
+		       BLI_listbase_count(&stack->elems), (double)totmem / (1024.0 * 1024.0));
+	}
 }
 
 static void undo_stack_cleanup(UndoStack *stack, bContext *C)
@@ -253,12 +304,13 @@ static void undo_stack_free(UndoStack *stack)
 
 /* Exported Functions */
 
-void ED_undo_paint_push_begin(int type, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup)
+void ED_undo_paint_push_begin(int type, const char *name, UndoRestoreCb restore, UndoFreeCb free, UndoCleanupCb cleanup,
+                              UndoMergeCb merge)
 {
 	if (type == UNDO_PAINT_IMAGE)
-		undo_stack_push_begin(&ImageUndoStack, name, restore, free, cleanup);
+		undo_stack_push_begin(&ImageUndoStack, name, restore, free, cleanup, merge);
 	else if (type == UNDO_PAINT_MESH)
-		undo_stack_push_begin(&MeshUndoStack, name, restore, free, cleanup);
+		undo_stack_push_begin(&MeshUndoStack, name, restore, free, cleanup, merge);
 }
 
 ListBase *undo_paint_push_get_list(int type)
@@ -878,10 +878,47 @@ SculptUndoNode *sculpt_undo_push_node(Object *ob, PBVHNode *node,
 	return unode;
 }
 
+/* Merge two consecutive dynamic topology strokes, see BM_log_entry_merge() */
+static bool sculpt_undo_merge(ListBase *lb_dst, ListBase *lb_src, size_t *r_size)
+{
+	SculptUndoNode *unode_dst = lb_dst->first;
+	SculptUndoNode *unode_src = lb_src->first;
+
+	/* Dynamic topology stores a single node per step */
+	if (!unode_dst || !unode_src || unode_dst->next || unode_src->next) {
+		return false;
+	}
+
+	if (!unode_dst->bm_entry || !unode_src->bm_entry ||
+	    ELEM(unode_dst->type, SCULPT_UNDO_DYNTOPO_BEGIN, SCULPT_UNDO_DYNTOPO_END, SCULPT_UNDO_DYNTOPO_SYMMETRIZE) ||
+	    ELEM(unode_src->type, SCULPT_UNDO_DYNTOPO_BEGIN, SCULPT_UNDO_DYNTOPO_END, SCULPT_UNDO_DYNTOPO_SYMMETRIZE) ||
+	    !STREQ(unode_dst->idname, unode_src->idname) ||
+	    !unode_dst->applied || !unode_src->applied)
+	{
+		return false;
+	}
+
+	if (!BM_log_entry_merge(unode_src->bm_entry, unode_dst->bm_entry)) {
+		return false;
+	}
+
+	/* The entry is freed, don't drop it again */
+	unode_src->bm_entry = NULL;
+
+	/* Mask only steps don't rebuild the PBVH on restore */
+	if (unode_dst->type != unode_src->type) {
+		unode_dst->type = SCULPT_UNDO_COORDS;
+	}
+
+	*r_size = BM_log_entry_size(unode_dst->bm_entry);
+	return true;
+}
+
 void sculpt_undo_push_begin(const char *name)
 {
 	ED_undo_paint_push_begin(UNDO_PAINT_MESH, name,
-	                         sculpt_undo_restore, sculpt_undo_free, sculpt_undo_cleanup);
+	                         sculpt_undo_restore, sculpt_undo_free, sculpt_undo_cleanup,
+	                         sculpt_undo_merge);
 }
 
 void sculpt_undo_push_end(void)
@@ -898,6 +935,12 @@ void sculpt_undo_push_end(void)
 
 		if (unode->node)
 			BKE_pbvh_node_layer_disp_free(unode->node);
+
+		/* the stroke is done, the log entry won't change anymore */
+		if (unode->bm_entry) {
+			BM_log_entry_compact(unode->bm_entry);
+			undo_paint_push_count_alloc(UNDO_PAINT_MESH, (int)BM_log_entry_size(unode->bm_entry));
+		}
 	}
 
 	ED_undo_paint_push_end(UNDO_PAINT_MESH);
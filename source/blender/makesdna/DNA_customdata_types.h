@@ -185,6 +185,8 @@ enum {
 	CD_FLAG_EXTERNAL  = (1 << 3),
 	/* Indicates external data is read into memory */
 	CD_FLAG_IN_MEMORY = (1 << 4),
+	/* Indicates layer data is shared with other layers, only the last one frees it */
+	CD_FLAG_SHARED    = (1 << 5),
 };
 
 /* Limits */
@@ -639,7 +639,10 @@ typedef struct BooleanModifierData {
 	ModifierData modifier;
 
 	struct Object *object;
-	int operation, pad;
+	int operation;
+	char solver, pad[3];
+	float double_threshold;
+	int pad2;
 } BooleanModifierData;
 
 typedef enum {
@@ -648,6 +651,12 @@ typedef enum {
 	eBooleanModifierOp_Difference = 2,
 } BooleanModifierOp;
 
+/* Carve is zero so files from before the solver option keep their result */
+typedef enum {
+	eBooleanModifierSolver_Carve = 0,
+	eBooleanModifierSolver_BMesh = 1,
+} BooleanSolver;
+
 typedef struct MDefInfluence {
 	int vertex;
 	float weight;
@@ -71,6 +71,10 @@ enum {
 #define SM_HRES_LINEAR		1
 #define SM_HRES_FULLSAMPLE	2
 
+/* pressure solver */
+#define SM_PRESSURE_PCG		0
+#define SM_PRESSURE_MGPCG	1
+
 /* smoke data fileds (active_fields) */
 #define SM_ACTIVE_HEAT		(1<<0)
 #define SM_ACTIVE_FIRE		(1<<1)
@@ -147,6 +151,9 @@ typedef struct SmokeDomainSettings {
 	float burning_rate, flame_smoke, flame_vorticity;
 	float flame_ignition, flame_max_temp;
 	float flame_smoke_color[3];
+
+	int pressure_solver; /* method used to solve the pressure projection */
+	int pad;
 } SmokeDomainSettings;
 
 
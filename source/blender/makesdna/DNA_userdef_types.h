@@ -564,7 +564,8 @@ typedef struct UserDef {
 	struct WalkNavigation walk_navigation;
 
 	short opensubdiv_compute_type;
-	char pad5[6];
+	short pad5;
+	int modcachelimit;		/* memory for cached modifier stack results (in megabytes) */
 } UserDef;
 
 extern UserDef U; /* from blenkernel blender.c */
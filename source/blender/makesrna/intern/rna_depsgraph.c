@@ -55,6 +55,18 @@ static void rna_Depsgraph_debug_graphviz(Depsgraph *graph, const char *filename)
 	fclose(f);
 }
 
+static void rna_Depsgraph_debug_trace_begin(Depsgraph *UNUSED(graph))
+{
+	DEG_debug_trace_begin();
+}
+
+static void rna_Depsgraph_debug_trace_end(Depsgraph *UNUSED(graph), ReportList *reports, const char *filename)
+{
+	if (!DEG_debug_trace_end(filename)) {
+		BKE_reportf(reports, RPT_ERROR, "Could not write evaluation trace to '%s'", filename);
+	}
+}
+
 static void rna_Depsgraph_debug_rebuild(Depsgraph *UNUSED(graph), Main *bmain)
 {
 	Scene *sce;
@@ -95,6 +107,16 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 	                                "File in which to store graphviz debug output");
 	RNA_def_property_flag(parm, PROP_REQUIRED);
 
+	func = RNA_def_function(srna, "debug_trace_begin", "rna_Depsgraph_debug_trace_begin");
+	RNA_def_function_ui_description(func, "Start recording the time taken by every evaluated operation");
+
+	func = RNA_def_function(srna, "debug_trace_end", "rna_Depsgraph_debug_trace_end");
+	RNA_def_function_ui_description(func, "Stop recording operation timing and store it in a Chrome trace file");
+	RNA_def_function_flag(func, FUNC_USE_REPORTS);
+	parm = RNA_def_string_file_path(func, "filename", NULL, FILE_MAX, "File Name",
+	                                "File in which to store the evaluation trace (JSON)");
+	RNA_def_property_flag(parm, PROP_REQUIRED);
+
 	func = RNA_def_function(srna, "debug_rebuild", "rna_Depsgraph_debug_rebuild");
 	RNA_def_function_flag(func, FUNC_USE_MAIN);
 	RNA_def_property_flag(parm, PROP_REQUIRED);
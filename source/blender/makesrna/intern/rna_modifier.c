@@ -546,6 +546,14 @@ RNA_MOD_OBJECT_SET(NormalEdit, target, OB_EMPTY);
 RNA_MOD_OBJECT_SET(Shrinkwrap, target, OB_MESH);
 RNA_MOD_OBJECT_SET(Shrinkwrap, auxTarget, OB_MESH);
 
+#ifndef WITH_MOD_BOOLEAN
+/* without Carve every solver runs as BMesh, show that instead of an invalid value */
+static int rna_BooleanModifier_solver_get(PointerRNA *UNUSED(ptr))
+{
+	return eBooleanModifierSolver_BMesh;
+}
+#endif
+
 static void rna_HookModifier_object_set(PointerRNA *ptr, PointerRNA value)
 {
 	HookModifierData *hmd = ptr->data;
@@ -1821,6 +1829,14 @@ static void rna_def_modifier_boolean(BlenderRNA *brna)
 		{0, NULL, 0, NULL, NULL}
 	};
 
+	static EnumPropertyItem prop_solver_items[] = {
+		{eBooleanModifierSolver_BMesh, "BMESH", 0, "BMesh", "Use the BMesh boolean solver"},
+#ifdef WITH_MOD_BOOLEAN
+		{eBooleanModifierSolver_Carve, "CARVE", 0, "Carve", "Use the Carve boolean solver"},
+#endif
+		{0, NULL, 0, NULL, NULL}
+	};
+
 	srna = RNA_def_struct(brna, "BooleanModifier", "Modifier");
 	RNA_def_struct_ui_text(srna, "Boolean Modifier", "Boolean operations modifier");
 	RNA_def_struct_sdna(srna, "BooleanModifierData");
@@ -1836,6 +1852,21 @@ static void rna_def_modifier_boolean(BlenderRNA *brna)
 	RNA_def_property_enum_items(prop, prop_operation_items);
 	RNA_def_property_ui_text(prop, "Operation", "");
 	RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
+	prop = RNA_def_property(srna, "solver", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_items(prop, prop_solver_items);
+#ifndef WITH_MOD_BOOLEAN
+	RNA_def_property_enum_funcs(prop, "rna_BooleanModifier_solver_get", NULL, NULL);
+#endif
+	RNA_def_property_ui_text(prop, "Solver", "");
+	RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
+	prop = RNA_def_property(srna, "double_threshold", PROP_FLOAT, PROP_DISTANCE);
+	RNA_def_property_float_sdna(prop, NULL, "double_threshold");
+	RNA_def_property_range(prop, 0, 1.0f);
+	RNA_def_property_ui_range(prop, 0, 1, 0.01, 6);
+	RNA_def_property_ui_text(prop, "Overlap Threshold", "Threshold for checking overlapping geometry");
+	RNA_def_property_update(prop, 0, "rna_Modifier_update");
 }
 
 static void rna_def_modifier_array(BlenderRNA *brna)
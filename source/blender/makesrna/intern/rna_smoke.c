@@ -345,6 +345,14 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 		{0, NULL, 0, NULL, NULL}
 	};
 
+	static EnumPropertyItem smoke_pressure_solver_items[] = {
+		{SM_PRESSURE_MGPCG, "MGPCG", 0, "Multigrid",
+		 "Conjugate gradient with a multigrid preconditioner, converges in few iterations on large domains"},
+		{SM_PRESSURE_PCG, "PCG", 0, "Diagonal",
+		 "Conjugate gradient with a diagonal preconditioner, slow on large domains"},
+		{0, NULL, 0, NULL, NULL}
+	};
+
 	static EnumPropertyItem smoke_domain_colli_items[] = {
 		{SM_BORDER_OPEN, "BORDEROPEN", 0, "Open", "Smoke doesn't collide with any border"},
 		{SM_BORDER_VERTICAL, "BORDERVERTICAL", 0, "Vertically Open",
@@ -470,6 +478,11 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 	                         "Select which domain border will be treated as collision object");
 	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_reset");
 
+	prop = RNA_def_property(srna, "pressure_solver", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_items(prop, smoke_pressure_solver_items);
+	RNA_def_property_ui_text(prop, "Pressure Solver", "Method used to solve the pressure of the fluid");
+	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_resetCache");
+
 	prop = RNA_def_property(srna, "effector_weights", PROP_POINTER, PROP_NONE);
 	RNA_def_property_struct_type(prop, "EffectorWeights");
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
@@ -37,7 +37,10 @@
 
 #include "DNA_object_types.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_utildefines.h"
+#include "BLI_math.h"
 
 #include "BKE_cdderivedmesh.h"
 #include "BKE_modifier.h"
@@ -47,6 +50,17 @@
 #include "MOD_boolean_util.h"
 #include "MOD_util.h"
 
+#include "bmesh.h"
+#include "tools/bmesh_intersect.h"
+
+static void initData(ModifierData *md)
+{
+	BooleanModifierData *bmd = (BooleanModifierData *)md;
+
+	bmd->solver = eBooleanModifierSolver_BMesh;
+	bmd->double_threshold = 1e-6f;
+}
+
 static void copyData(ModifierData *md, ModifierData *target)
 {
 #if 0
@@ -104,7 +118,6 @@ static void updateDepsgraph(ModifierData *md,
 	DEG_add_object_relation(node, ob, DEG_OB_COMP_TRANSFORM, "Boolean Modifier");
 }
 
-#ifdef WITH_MOD_BOOLEAN
 static DerivedMesh *get_quick_derivedMesh(DerivedMesh *derivedData, DerivedMesh *dm, int operation)
 {
 	DerivedMesh *result = NULL;
@@ -130,9 +143,125 @@ static DerivedMesh *get_quick_derivedMesh(DerivedMesh *derivedData, DerivedMesh
 	return result;
 }
 
-static DerivedMesh *applyModifier(ModifierData *md, Object *ob,
-                                  DerivedMesh *derivedData,
-                                  ModifierApplyFlag flag)
+/* has no meaning for faces, do this so we can tell which face is which */
+#define BM_FACE_TAG BM_ELEM_DRAW
+
+/**
+ * Compare selected/unselected.
+ */
+static int bm_face_isect_pair(BMFace *f, void *UNUSED(user_data))
+{
+	return BM_elem_flag_test(f, BM_FACE_TAG) ? 1 : 0;
+}
+
+static DerivedMesh *applyModifier_bmesh(
+        ModifierData *md, Object *ob,
+        DerivedMesh *derivedData,
+        ModifierApplyFlag flag)
+{
+	BooleanModifierData *bmd = (BooleanModifierData *) md;
+	DerivedMesh *dm;
+
+	if (!bmd->object)
+		return derivedData;
+
+	dm = get_dm_for_modifier(bmd->object, flag);
+
+	if (dm) {
+		DerivedMesh *result;
+		BMesh *bm;
+		const BMAllocTemplate allocsize = {
+			derivedData->getNumVerts(derivedData) + dm->getNumVerts(dm),
+			derivedData->getNumEdges(derivedData) + dm->getNumEdges(dm),
+			derivedData->getNumLoops(derivedData) + dm->getNumLoops(dm),
+			derivedData->getNumPolys(derivedData) + dm->getNumPolys(dm),
+		};
+		const bool is_flip = (is_negative_m4(ob->obmat) != is_negative_m4(bmd->object->obmat));
+		BMLoop *(*looptris)[3];
+		int looptris_tot;
+
+		/* when one of objects is empty (has got no faces) the result
+		 * only depends on the operation, no need to intersect */
+		result = get_quick_derivedMesh(derivedData, dm, bmd->operation);
+		if (result) {
+			return result;
+		}
+
+		bm = BM_mesh_create(&allocsize);
+
+		/* the other mesh first, so its elements come first in the tables */
+		DM_to_bmesh_ex(dm, bm, false);
+
+		{
+			const int i_verts_end = dm->getNumVerts(dm);
+			const int i_faces_end = dm->getNumPolys(dm);
+			float imat[4][4];
+			float omat[4][4];
+			BMIter iter;
+			BMVert *eve;
+			BMFace *efa;
+			int i;
+
+			invert_m4_m4(imat, ob->obmat);
+			mul_m4_m4m4(omat, imat, bmd->object->obmat);
+
+			i = 0;
+			BM_ITER_MESH (eve, &iter, bm, BM_VERTS_OF_MESH) {
+				if (i++ == i_verts_end) {
+					break;
+				}
+				mul_m4_v3(omat, eve->co);
+			}
+
+			i = 0;
+			BM_ITER_MESH (efa, &iter, bm, BM_FACES_OF_MESH) {
+				if (i++ == i_faces_end) {
+					break;
+				}
+				/* temp tag to test which side split faces are from */
+				BM_elem_flag_enable(efa, BM_FACE_TAG);
+
+				if (UNLIKELY(is_flip)) {
+					BM_face_normal_flip(bm, efa);
+				}
+			}
+		}
+
+		DM_to_bmesh_ex(derivedData, bm, false);
+
+		/* face normals are used when splitting faces */
+		BM_mesh_normals_update(bm);
+
+		looptris = MEM_mallocN(sizeof(*looptris) * (size_t)poly_to_tri_count(bm->totface, bm->totloop), __func__);
+		BM_bmesh_calc_tessellation(bm, looptris, &looptris_tot);
+
+		BM_mesh_intersect(
+		        bm,
+		        looptris, looptris_tot,
+		        bm_face_isect_pair, NULL,
+		        false, false,
+		        bmd->operation,
+		        bmd->double_threshold);
+
+		MEM_freeN(looptris);
+
+		result = CDDM_from_bmesh(bm, true);
+
+		BM_mesh_free(bm);
+
+		result->dirty |= DM_DIRTY_NORMALS;
+
+		return result;
+	}
+
+	return derivedData;
+}
+
+#ifdef WITH_MOD_BOOLEAN
+static DerivedMesh *applyModifier_carve(
+        ModifierData *md, Object *ob,
+        DerivedMesh *derivedData,
+        ModifierApplyFlag flag)
 {
 	BooleanModifierData *bmd = (BooleanModifierData *) md;
 	DerivedMesh *dm;
@@ -169,14 +298,23 @@ static DerivedMesh *applyModifier(ModifierData *md, Object *ob,
 	
 	return derivedData;
 }
-#else // WITH_MOD_BOOLEAN
-static DerivedMesh *applyModifier(ModifierData *UNUSED(md), Object *UNUSED(ob),
+#endif // WITH_MOD_BOOLEAN
+
+static DerivedMesh *applyModifier(ModifierData *md, Object *ob,
                                   DerivedMesh *derivedData,
-                                  ModifierApplyFlag UNUSED(flag))
+                                  ModifierApplyFlag flag)
 {
-	return derivedData;
+	BooleanModifierData *bmd = (BooleanModifierData *) md;
+
+	switch (bmd->solver) {
+#ifdef WITH_MOD_BOOLEAN
+		case eBooleanModifierSolver_Carve:
+			return applyModifier_carve(md, ob, derivedData, flag);
+#endif
+		default:  /* without Carve, fall back to the BMesh solver */
+			return applyModifier_bmesh(md, ob, derivedData, flag);
+	}
 }
-#endif // WITH_MOD_BOOLEAN
 
 static CustomDataMask requiredDataMask(Object *UNUSED(ob), ModifierData *UNUSED(md))
 {
@@ -203,7 +341,7 @@ ModifierTypeInfo modifierType_Boolean = {
 	/* deformMatricesEM */  NULL,
 	/* applyModifier */     applyModifier,
 	/* applyModifierEM */   NULL,
-	/* initData */          NULL,
+	/* initData */          initData,
 	/* requiredDataMask */  requiredDataMask,
 	/* freeData */          NULL,
 	/* isDisabled */        isDisabled,
@@ -133,6 +133,82 @@ static void updateDepsgraph(ModifierData *md,
 	}
 }
 
+typedef struct CastUserdata {
+	CastModifierData *cmd;
+	MDeformVert *dvert;
+	int defgrp_index;
+	float (*vertexCos)[3];
+	bool has_radius;
+	bool use_ctrl_ob;
+	short flag;
+	short type;
+	float fac;
+	float len;
+	float center[3];
+	float mat[4][4], imat[4][4];
+	float bb[8][3];
+} CastUserdata;
+
+static void sphere_do_task(void *userdata, int i)
+{
+	CastUserdata *data = userdata;
+	const short flag = data->flag;
+	const float len = data->len;
+	float fac = data->fac;
+	float facm;
+	float vec[3];
+	float tmp_co[3];
+
+	copy_v3_v3(tmp_co, data->vertexCos[i]);
+	if (data->use_ctrl_ob) {
+		if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+			mul_m4_v3(data->mat, tmp_co);
+		}
+		else {
+			sub_v3_v3(tmp_co, data->center);
+		}
+	}
+
+	copy_v3_v3(vec, tmp_co);
+
+	if (data->type == MOD_CAST_TYPE_CYLINDER)
+		vec[2] = 0.0f;
+
+	if (data->has_radius) {
+		if (len_v3(vec) > data->cmd->radius) return;
+	}
+
+	if (data->dvert) {
+		const float weight = defvert_find_weight(&data->dvert[i], data->defgrp_index);
+		if (weight == 0.0f) {
+			return;
+		}
+
+		fac *= weight;
+	}
+	facm = 1.0f - fac;
+
+	normalize_v3(vec);
+
+	if (flag & MOD_CAST_X)
+		tmp_co[0] = fac * vec[0] * len + facm * tmp_co[0];
+	if (flag & MOD_CAST_Y)
+		tmp_co[1] = fac * vec[1] * len + facm * tmp_co[1];
+	if (flag & MOD_CAST_Z)
+		tmp_co[2] = fac * vec[2] * len + facm * tmp_co[2];
+
+	if (data->use_ctrl_ob) {
+		if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+			mul_m4_v3(data->imat, tmp_co);
+		}
+		else {
+			add_v3_v3(tmp_co, data->center);
+		}
+	}
+
+	copy_v3_v3(data->vertexCos[i], tmp_co);
+}
+
 static void sphere_do(
         CastModifierData *cmd, Object *ob, DerivedMesh *dm,
         float (*vertexCos)[3], int numVerts)
@@ -145,11 +221,9 @@ static void sphere_do(
 	bool has_radius = false;
 	short flag, type;
 	float len = 0.0f;
-	float fac = cmd->fac;
-	float facm = 1.0f - fac;
-	const float fac_orig = fac;
-	float vec[3], center[3] = {0.0f, 0.0f, 0.0f};
+	float center[3] = {0.0f, 0.0f, 0.0f};
 	float mat[4][4], imat[4][4];
+	CastUserdata data;
 
 	flag = cmd->flag;
 	type = cmd->type; /* projection type: sphere or cylinder */
@@ -200,58 +274,126 @@ static void sphere_do(
 		if (len == 0.0f) len = 10.0f;
 	}
 
-	for (i = 0; i < numVerts; i++) {
-		float tmp_co[3];
+	data.cmd = cmd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.has_radius = has_radius;
+	data.use_ctrl_ob = (ctrl_ob != NULL);
+	data.flag = flag;
+	data.type = type;
+	data.fac = cmd->fac;
+	data.len = len;
+	copy_v3_v3(data.center, center);
+	if (ctrl_ob && (flag & MOD_CAST_USE_OB_TRANSFORM)) {
+		copy_m4_m4(data.mat, mat);
+		copy_m4_m4(data.imat, imat);
+	}
 
-		copy_v3_v3(tmp_co, vertexCos[i]);
-		if (ctrl_ob) {
-			if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-				mul_m4_v3(mat, tmp_co);
-			}
-			else {
-				sub_v3_v3(tmp_co, center);
-			}
-		}
+	modifier_parallel_verts(numVerts, &data, sphere_do_task, true);
+}
 
-		copy_v3_v3(vec, tmp_co);
+static void cuboid_do_task(void *userdata, int i)
+{
+	CastUserdata *data = userdata;
+	const short flag = data->flag;
+	const float radius = data->cmd->radius;
+	float fac = data->fac;
+	float facm;
+	int octant, coord;
+	float d[3], dmax, apex[3], fbb;
+	float tmp_co[3];
+
+	copy_v3_v3(tmp_co, data->vertexCos[i]);
+	if (data->use_ctrl_ob) {
+		if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+			mul_m4_v3(data->mat, tmp_co);
+		}
+		else {
+			sub_v3_v3(tmp_co, data->center);
+		}
+	}
 
-		if (type == MOD_CAST_TYPE_CYLINDER)
-			vec[2] = 0.0f;
+	if (data->has_radius) {
+		if (fabsf(tmp_co[0]) > radius ||
+		    fabsf(tmp_co[1]) > radius ||
+		    fabsf(tmp_co[2]) > radius)
+		{
+			return;
+		}
+	}
 
-		if (has_radius) {
-			if (len_v3(vec) > cmd->radius) continue;
+	if (data->dvert) {
+		const float weight = defvert_find_weight(&data->dvert[i], data->defgrp_index);
+		if (weight == 0.0f) {
+			return;
 		}
 
-		if (dvert) {
-			const float weight = defvert_find_weight(&dvert[i], defgrp_index);
-			if (weight == 0.0f) {
-				continue;
-			}
+		fac *= weight;
+	}
+	facm = 1.0f - fac;
+
+	/* The algo used to project the vertices to their
+	 * bounding box (bb) is pretty simple:
+	 * for each vertex v:
+	 * 1) find in which octant v is in;
+	 * 2) find which outer "wall" of that octant is closer to v;
+	 * 3) calculate factor (var fbb) to project v to that wall;
+	 * 4) project. */
+
+	/* find in which octant this vertex is in */
+	octant = 0;
+	if (tmp_co[0] > 0.0f) octant += 1;
+	if (tmp_co[1] > 0.0f) octant += 2;
+	if (tmp_co[2] > 0.0f) octant += 4;
+
+	/* apex is the bb's vertex at the chosen octant */
+	copy_v3_v3(apex, data->bb[octant]);
+
+	/* find which bb plane is closest to this vertex ... */
+	d[0] = tmp_co[0] / apex[0];
+	d[1] = tmp_co[1] / apex[1];
+	d[2] = tmp_co[2] / apex[2];
+
+	/* ... (the closest has the higher (closer to 1) d value) */
+	dmax = d[0];
+	coord = 0;
+	if (d[1] > dmax) {
+		dmax = d[1];
+		coord = 1;
+	}
+	if (d[2] > dmax) {
+		/* dmax = d[2]; */ /* commented, we don't need it */
+		coord = 2;
+	}
 
-			fac = fac_orig * weight;
-			facm = 1.0f - fac;
-		}
+	/* ok, now we know which coordinate of the vertex to use */
 
-		normalize_v3(vec);
+	if (fabsf(tmp_co[coord]) < FLT_EPSILON) /* avoid division by zero */
+		return;
 
-		if (flag & MOD_CAST_X)
-			tmp_co[0] = fac * vec[0] * len + facm * tmp_co[0];
-		if (flag & MOD_CAST_Y)
-			tmp_co[1] = fac * vec[1] * len + facm * tmp_co[1];
-		if (flag & MOD_CAST_Z)
-			tmp_co[2] = fac * vec[2] * len + facm * tmp_co[2];
+	/* finally, this is the factor we wanted, to project the vertex
+	 * to its bounding box (bb) */
+	fbb = apex[coord] / tmp_co[coord];
 
-		if (ctrl_ob) {
-			if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-				mul_m4_v3(imat, tmp_co);
-			}
-			else {
-				add_v3_v3(tmp_co, center);
-			}
-		}
+	/* calculate the new vertex position */
+	if (flag & MOD_CAST_X)
+		tmp_co[0] = facm * tmp_co[0] + fac * tmp_co[0] * fbb;
+	if (flag & MOD_CAST_Y)
+		tmp_co[1] = facm * tmp_co[1] + fac * tmp_co[1] * fbb;
+	if (flag & MOD_CAST_Z)
+		tmp_co[2] = facm * tmp_co[2] + fac * tmp_co[2] * fbb;
 
-		copy_v3_v3(vertexCos[i], tmp_co);
+	if (data->use_ctrl_ob) {
+		if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+			mul_m4_v3(data->imat, tmp_co);
+		}
+		else {
+			add_v3_v3(tmp_co, data->center);
+		}
 	}
+
+	copy_v3_v3(data->vertexCos[i], tmp_co);
 }
 
 static void cuboid_do(
@@ -264,12 +406,10 @@ static void cuboid_do(
 	int i, defgrp_index;
 	bool has_radius = false;
 	short flag;
-	float fac = cmd->fac;
-	float facm = 1.0f - fac;
-	const float fac_orig = fac;
-	float min[3], max[3], bb[8][3];
+	float min[3], max[3];
 	float center[3] = {0.0f, 0.0f, 0.0f};
 	float mat[4][4], imat[4][4];
+	CastUserdata data;
 
 	flag = cmd->flag;
 
@@ -345,110 +485,31 @@ static void cuboid_do(
 	}
 
 	/* building our custom bounding box */
-	bb[0][0] = bb[2][0] = bb[4][0] = bb[6][0] = min[0];
-	bb[1][0] = bb[3][0] = bb[5][0] = bb[7][0] = max[0];
-	bb[0][1] = bb[1][1] = bb[4][1] = bb[5][1] = min[1];
-	bb[2][1] = bb[3][1] = bb[6][1] = bb[7][1] = max[1];
-	bb[0][2] = bb[1][2] = bb[2][2] = bb[3][2] = min[2];
-	bb[4][2] = bb[5][2] = bb[6][2] = bb[7][2] = max[2];
+	data.bb[0][0] = data.bb[2][0] = data.bb[4][0] = data.bb[6][0] = min[0];
+	data.bb[1][0] = data.bb[3][0] = data.bb[5][0] = data.bb[7][0] = max[0];
+	data.bb[0][1] = data.bb[1][1] = data.bb[4][1] = data.bb[5][1] = min[1];
+	data.bb[2][1] = data.bb[3][1] = data.bb[6][1] = data.bb[7][1] = max[1];
+	data.bb[0][2] = data.bb[1][2] = data.bb[2][2] = data.bb[3][2] = min[2];
+	data.bb[4][2] = data.bb[5][2] = data.bb[6][2] = data.bb[7][2] = max[2];
+
+	data.cmd = cmd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.has_radius = has_radius;
+	data.use_ctrl_ob = (ctrl_ob != NULL);
+	data.flag = flag;
+	data.type = cmd->type;
+	data.fac = cmd->fac;
+	data.len = 0.0f;
+	copy_v3_v3(data.center, center);
+	if (ctrl_ob && (flag & MOD_CAST_USE_OB_TRANSFORM)) {
+		copy_m4_m4(data.mat, mat);
+		copy_m4_m4(data.imat, imat);
+	}
 
 	/* ready to apply the effect, one vertex at a time */
-	for (i = 0; i < numVerts; i++) {
-		int octant, coord;
-		float d[3], dmax, apex[3], fbb;
-		float tmp_co[3];
-
-		copy_v3_v3(tmp_co, vertexCos[i]);
-		if (ctrl_ob) {
-			if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-				mul_m4_v3(mat, tmp_co);
-			}
-			else {
-				sub_v3_v3(tmp_co, center);
-			}
-		}
-
-		if (has_radius) {
-			if (fabsf(tmp_co[0]) > cmd->radius ||
-			    fabsf(tmp_co[1]) > cmd->radius ||
-			    fabsf(tmp_co[2]) > cmd->radius)
-			{
-				continue;
-			}
-		}
-
-		if (dvert) {
-			const float weight = defvert_find_weight(&dvert[i], defgrp_index);
-			if (weight == 0.0f) {
-				continue;
-			}
-
-			fac = fac_orig * weight;
-			facm = 1.0f - fac;
-		}
-
-		/* The algo used to project the vertices to their
-		 * bounding box (bb) is pretty simple:
-		 * for each vertex v:
-		 * 1) find in which octant v is in;
-		 * 2) find which outer "wall" of that octant is closer to v;
-		 * 3) calculate factor (var fbb) to project v to that wall;
-		 * 4) project. */
-
-		/* find in which octant this vertex is in */
-		octant = 0;
-		if (tmp_co[0] > 0.0f) octant += 1;
-		if (tmp_co[1] > 0.0f) octant += 2;
-		if (tmp_co[2] > 0.0f) octant += 4;
-
-		/* apex is the bb's vertex at the chosen octant */
-		copy_v3_v3(apex, bb[octant]);
-
-		/* find which bb plane is closest to this vertex ... */
-		d[0] = tmp_co[0] / apex[0];
-		d[1] = tmp_co[1] / apex[1];
-		d[2] = tmp_co[2] / apex[2];
-
-		/* ... (the closest has the higher (closer to 1) d value) */
-		dmax = d[0];
-		coord = 0;
-		if (d[1] > dmax) {
-			dmax = d[1];
-			coord = 1;
-		}
-		if (d[2] > dmax) {
-			/* dmax = d[2]; */ /* commented, we don't need it */
-			coord = 2;
-		}
-
-		/* ok, now we know which coordinate of the vertex to use */
-
-		if (fabsf(tmp_co[coord]) < FLT_EPSILON) /* avoid division by zero */
-			continue;
-
-		/* finally, this is the factor we wanted, to project the vertex
-		 * to its bounding box (bb) */
-		fbb = apex[coord] / tmp_co[coord];
-
-		/* calculate the new vertex position */
-		if (flag & MOD_CAST_X)
-			tmp_co[0] = facm * tmp_co[0] + fac * tmp_co[0] * fbb;
-		if (flag & MOD_CAST_Y)
-			tmp_co[1] = facm * tmp_co[1] + fac * tmp_co[1] * fbb;
-		if (flag & MOD_CAST_Z)
-			tmp_co[2] = facm * tmp_co[2] + fac * tmp_co[2] * fbb;
-
-		if (ctrl_ob) {
-			if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-				mul_m4_v3(imat, tmp_co);
-			}
-			else {
-				add_v3_v3(tmp_co, center);
-			}
-		}
-
-		copy_v3_v3(vertexCos[i], tmp_co);
-	}
+	modifier_parallel_verts(numVerts, &data, cuboid_do_task, true);
 }
 
 static void deformVerts(ModifierData *md, Object *ob,
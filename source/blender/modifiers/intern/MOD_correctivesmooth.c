@@ -44,6 +44,7 @@
 #include "BKE_cdderivedmesh.h"
 #include "BKE_deform.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_editmesh.h"
 
 #include "MOD_modifiertypes.h"
@@ -179,11 +180,67 @@ static void dm_get_boundaries(DerivedMesh *dm, float *smooth_weights)
 }
 
 
+/* -------------------------------------------------------------------- */
+/* Smoothing Iterations
+ *
+ * Each iteration first gathers the edge vectors around every vertex, then moves
+ * the vertices. Gathering (instead of scattering per edge) lets both passes run
+ * on multiple threads, edges are visited in index order so the result matches
+ * accumulating them one edge at a time.
+ */
+
+typedef struct SmoothingData {
+	float delta[3];
+	float edge_length_sum;
+} SmoothingData;
+
+typedef struct SmoothIterUserdata {
+	float (*vertexCos)[3];
+	const MEdge *edges;
+	const MeshElemMap *vert_edges;
+	SmoothingData *smooth_data;
+	/* per vertex factor (simple), or edge count (length weight) */
+	const float *vertex_edge_fac;
+	const float *smooth_weights;
+	float lambda;
+} SmoothIterUserdata;
+
+
 /* -------------------------------------------------------------------- */
 /* Simple Weighted Smoothing
  *
  * (average of surrounding verts)
  */
+static void smooth_iter__simple_accum_task(void *userdata, int i)
+{
+	SmoothIterUserdata *data = userdata;
+	const MeshElemMap *map = &data->vert_edges[i];
+	SmoothingData *sd = &data->smooth_data[i];
+	int j;
+
+	zero_v3(sd->delta);
+
+	for (j = 0; j < map->count; j++) {
+		const MEdge *e = &data->edges[map->indices[j]];
+		float edge_dir[3];
+
+		sub_v3_v3v3(edge_dir, data->vertexCos[e->v2], data->vertexCos[e->v1]);
+
+		if ((int)e->v1 == i) {
+			add_v3_v3(sd->delta, edge_dir);
+		}
+		else {
+			sub_v3_v3(sd->delta, edge_dir);
+		}
+	}
+}
+
+static void smooth_iter__simple_apply_task(void *userdata, int i)
+{
+	SmoothIterUserdata *data = userdata;
+	madd_v3_v3fl(data->vertexCos[i], data->smooth_data[i].delta, data->vertex_edge_fac[i]);
+}
+
 static void smooth_iter__simple(
         CorrectiveSmoothModifierData *csmd, DerivedMesh *dm,
         float (*vertexCos)[3], unsigned int numVerts,
@@ -195,62 +252,48 @@ static void smooth_iter__simple(
 
 	const unsigned int numEdges = (unsigned int)dm->getNumEdges(dm);
 	const MEdge *edges = dm->getEdgeArray(dm);
+	MeshElemMap *vert_edges;
+	int *vert_edges_mem;
 	float *vertex_edge_count_div;
+	SmoothIterUserdata data;
 
-	struct SmoothingData_Simple {
-		float delta[3];
-	} *smooth_data = MEM_callocN((size_t)numVerts * sizeof(*smooth_data), __func__);
+	SmoothingData *smooth_data = MEM_mallocN((size_t)numVerts * sizeof(*smooth_data), __func__);
 
-	vertex_edge_count_div = MEM_callocN((size_t)numVerts * sizeof(float), __func__);
+	vertex_edge_count_div = MEM_mallocN((size_t)numVerts * sizeof(float), __func__);
 
-	/* calculate as floats to avoid int->float conversion in #smooth_iter */
-	for (i = 0; i < numEdges; i++) {
-		vertex_edge_count_div[edges[i].v1] += 1.0f;
-		vertex_edge_count_div[edges[i].v2] += 1.0f;
-	}
+	BKE_mesh_vert_edge_map_create(&vert_edges, &vert_edges_mem, edges, (int)numVerts, (int)numEdges);
 
 	/* a little confusing, but we can include 'lambda' and smoothing weight
 	 * here to avoid multiplying for every iteration */
-	if (smooth_weights == NULL) {
-		for (i = 0; i < numVerts; i++) {
-			vertex_edge_count_div[i] =
-			        lambda * (vertex_edge_count_div[i] ? (1.0f / vertex_edge_count_div[i]) : 1.0f);
+	for (i = 0; i < numVerts; i++) {
+		/* calculate as floats to avoid int->float conversion in #smooth_iter */
+		const float count = (float)vert_edges[i].count;
+		if (smooth_weights == NULL) {
+			vertex_edge_count_div[i] = lambda * (count ? (1.0f / count) : 1.0f);
 		}
-	}
-	else {
-		for (i = 0; i < numVerts; i++) {
-			vertex_edge_count_div[i] =
-			        smooth_weights[i] * lambda * (vertex_edge_count_div[i] ? (1.0f / vertex_edge_count_div[i]) : 1.0f);
+		else {
+			vertex_edge_count_div[i] = smooth_weights[i] * lambda * (count ? (1.0f / count) : 1.0f);
 		}
 	}
 
+	data.vertexCos = vertexCos;
+	data.edges = edges;
+	data.vert_edges = vert_edges;
+	data.smooth_data = smooth_data;
+	data.vertex_edge_fac = vertex_edge_count_div;
+	data.smooth_weights = smooth_weights;
+	data.lambda = lambda;
+
 	/* -------------------------------------------------------------------- */
 	/* Main Smoothing Loop */
 
 	while (iterations--) {
-		for (i = 0; i < numEdges; i++) {
-			struct SmoothingData_Simple *sd_v1;
-			struct SmoothingData_Simple *sd_v2;
-			float edge_dir[3];
-
-			sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-
-			sd_v1 = &smooth_data[edges[i].v1];
-			sd_v2 = &smooth_data[edges[i].v2];
-
-			add_v3_v3(sd_v1->delta, edge_dir);
-			sub_v3_v3(sd_v2->delta, edge_dir);
-		}
-
-
-		for (i = 0; i < numVerts; i++) {
-			struct SmoothingData_Simple *sd = &smooth_data[i];
-			madd_v3_v3fl(vertexCos[i], sd->delta, vertex_edge_count_div[i]);
-			/* zero for the next iteration (saves memset on entire array) */
-			memset(sd, 0, sizeof(*sd));
-		}
+		modifier_parallel_verts((int)numVerts, &data, smooth_iter__simple_accum_task, true);
+		modifier_parallel_verts((int)numVerts, &data, smooth_iter__simple_apply_task, true);
 	}
 
+	MEM_freeN(vert_edges);
+	MEM_freeN(vert_edges_mem);
 	MEM_freeN(vertex_edge_count_div);
 	MEM_freeN(smooth_data);
 }
@@ -259,97 +302,98 @@ static void smooth_iter__simple(
 /* -------------------------------------------------------------------- */
 /* Edge-Length Weighted Smoothing
  */
+static void smooth_iter__length_weight_accum_task(void *userdata, int i)
+{
+	SmoothIterUserdata *data = userdata;
+	const MeshElemMap *map = &data->vert_edges[i];
+	SmoothingData *sd = &data->smooth_data[i];
+	int j;
+
+	zero_v3(sd->delta);
+	sd->edge_length_sum = 0.0f;
+
+	for (j = 0; j < map->count; j++) {
+		const MEdge *e = &data->edges[map->indices[j]];
+		float edge_dir[3];
+		float edge_dist;
+
+		sub_v3_v3v3(edge_dir, data->vertexCos[e->v2], data->vertexCos[e->v1]);
+		edge_dist = len_v3(edge_dir);
+
+		/* weight by distance */
+		mul_v3_fl(edge_dir, edge_dist);
+
+		if ((int)e->v1 == i) {
+			add_v3_v3(sd->delta, edge_dir);
+		}
+		else {
+			sub_v3_v3(sd->delta, edge_dir);
+		}
+
+		sd->edge_length_sum += edge_dist;
+	}
+}
+
+static void smooth_iter__length_weight_apply_task(void *userdata, int i)
+{
+	SmoothIterUserdata *data = userdata;
+	const float eps = FLT_EPSILON * 10.0f;
+	const SmoothingData *sd = &data->smooth_data[i];
+	/* divide by sum of all neighbour distances (weighted) and amount of neighbours, (mean average) */
+	const float div = sd->edge_length_sum * data->vertex_edge_fac[i];
+
+	if (div > eps) {
+		const float lambda_w = data->smooth_weights ? data->lambda * data->smooth_weights[i] : data->lambda;
+		/* calculate the new location and interpolate in one step */
+		madd_v3_v3fl(data->vertexCos[i], sd->delta, lambda_w / div);
+	}
+}
+
 static void smooth_iter__length_weight(
         CorrectiveSmoothModifierData *csmd, DerivedMesh *dm,
         float (*vertexCos)[3], unsigned int numVerts,
         const float *smooth_weights,
         unsigned int iterations)
 {
-	const float eps = FLT_EPSILON * 10.0f;
 	const unsigned int numEdges = (unsigned int)dm->getNumEdges(dm);
 	/* note: the way this smoothing method works, its approx half as strong as the simple-smooth,
 	 * and 2.0 rarely spikes, double the value for consistent behavior. */
 	const float lambda = csmd->lambda * 2.0f;
 	const MEdge *edges = dm->getEdgeArray(dm);
+	MeshElemMap *vert_edges;
+	int *vert_edges_mem;
 	float *vertex_edge_count;
+	SmoothIterUserdata data;
 	unsigned int i;
 
-	struct SmoothingData_Weighted {
-		float delta[3];
-		float edge_length_sum;
-	} *smooth_data = MEM_callocN((size_t)numVerts * sizeof(*smooth_data), __func__);
+	SmoothingData *smooth_data = MEM_mallocN((size_t)numVerts * sizeof(*smooth_data), __func__);
 
+	BKE_mesh_vert_edge_map_create(&vert_edges, &vert_edges_mem, edges, (int)numVerts, (int)numEdges);
 
 	/* calculate as floats to avoid int->float conversion in #smooth_iter */
-	vertex_edge_count = MEM_callocN((size_t)numVerts * sizeof(float), __func__);
-	for (i = 0; i < numEdges; i++) {
-		vertex_edge_count[edges[i].v1] += 1.0f;
-		vertex_edge_count[edges[i].v2] += 1.0f;
+	vertex_edge_count = MEM_mallocN((size_t)numVerts * sizeof(float), __func__);
+	for (i = 0; i < numVerts; i++) {
+		vertex_edge_count[i] = (float)vert_edges[i].count;
 	}
 
+	data.vertexCos = vertexCos;
+	data.edges = edges;
+	data.vert_edges = vert_edges;
+	data.smooth_data = smooth_data;
+	data.vertex_edge_fac = vertex_edge_count;
+	data.smooth_weights = smooth_weights;
+	data.lambda = lambda;
 
 	/* -------------------------------------------------------------------- */
 	/* Main Smoothing Loop */
 
 	while (iterations--) {
-		for (i = 0; i < numEdges; i++) {
-			struct SmoothingData_Weighted *sd_v1;
-			struct SmoothingData_Weighted *sd_v2;
-			float edge_dir[3];
-			float edge_dist;
-
-			sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-			edge_dist = len_v3(edge_dir);
-
-			/* weight by distance */
-			mul_v3_fl(edge_dir, edge_dist);
-
-
-			sd_v1 = &smooth_data[edges[i].v1];
-			sd_v2 = &smooth_data[edges[i].v2];
-
-			add_v3_v3(sd_v1->delta, edge_dir);
-			sub_v3_v3(sd_v2->delta, edge_dir);
-
-			sd_v1->edge_length_sum += edge_dist;
-			sd_v2->edge_length_sum += edge_dist;
-		}
-
-		if (smooth_weights == NULL) {
-			/* fast-path */
-			for (i = 0; i < numVerts; i++) {
-				struct SmoothingData_Weighted *sd = &smooth_data[i];
-				/* divide by sum of all neighbour distances (weighted) and amount of neighbours, (mean average) */
-				const float div = sd->edge_length_sum * vertex_edge_count[i];
-				if (div > eps) {
-#if 0
-					/* first calculate the new location */
-					mul_v3_fl(sd->delta, 1.0f / div);
-					/* then interpolate */
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda);
-#else
-					/* do this in one step */
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda / div);
-#endif
-				}
-				/* zero for the next iteration (saves memset on entire array) */
-				memset(sd, 0, sizeof(*sd));
-			}
-		}
-		else {
-			for (i = 0; i < numVerts; i++) {
-				struct SmoothingData_Weighted *sd = &smooth_data[i];
-				const float div = sd->edge_length_sum * vertex_edge_count[i];
-				if (div > eps) {
-					const float lambda_w = lambda * smooth_weights[i];
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda_w / div);
-				}
-
-				memset(sd, 0, sizeof(*sd));
-			}
-		}
+		modifier_parallel_verts((int)numVerts, &data, smooth_iter__length_weight_accum_task, true);
+		modifier_parallel_verts((int)numVerts, &data, smooth_iter__length_weight_apply_task, true);
 	}
 
+	MEM_freeN(vert_edges);
+	MEM_freeN(vert_edges_mem);
 	MEM_freeN(vertex_edge_count);
 	MEM_freeN(smooth_data);
 }
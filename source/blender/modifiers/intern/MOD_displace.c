@@ -192,19 +192,80 @@ static void updateDepsgraph(ModifierData *md,
 }
 
 /* dm must be a CDDerivedMesh */
+typedef struct DisplaceUserdata {
+	DisplaceModifierData *dmd;
+	MDeformVert *dvert;
+	int defgrp_index;
+	int direction;
+	float delta_fixed;
+	TexResult *texres;
+	float (*vertexCos)[3];
+	MVert *mvert;
+	float (*vert_clnors)[3];
+} DisplaceUserdata;
+
+static void displaceModifier_do_task(void *userdata, int i)
+{
+	DisplaceUserdata *data = userdata;
+	DisplaceModifierData *dmd = data->dmd;
+	float (*vertexCos)[3] = data->vertexCos;
+	TexResult *texres = data->texres ? &data->texres[i] : NULL;
+	float strength = dmd->strength;
+	float delta;
+
+	if (data->dvert) {
+		const float weight = defvert_find_weight(data->dvert + i, data->defgrp_index);
+		if (weight == 0.0f) return;
+		strength *= weight;
+	}
+
+	if (texres) {
+		delta = texres->tin - dmd->midlevel;
+	}
+	else {
+		delta = data->delta_fixed;  /* (1.0f - dmd->midlevel) */  /* never changes */
+	}
+
+	delta *= strength;
+	CLAMP(delta, -10000, 10000);
+
+	switch (data->direction) {
+		case MOD_DISP_DIR_X:
+			vertexCos[i][0] += delta;
+			break;
+		case MOD_DISP_DIR_Y:
+			vertexCos[i][1] += delta;
+			break;
+		case MOD_DISP_DIR_Z:
+			vertexCos[i][2] += delta;
+			break;
+		case MOD_DISP_DIR_RGB_XYZ:
+			vertexCos[i][0] += (texres->tr - dmd->midlevel) * strength;
+			vertexCos[i][1] += (texres->tg - dmd->midlevel) * strength;
+			vertexCos[i][2] += (texres->tb - dmd->midlevel) * strength;
+			break;
+		case MOD_DISP_DIR_NOR:
+			vertexCos[i][0] += delta * (data->mvert[i].no[0] / 32767.0f);
+			vertexCos[i][1] += delta * (data->mvert[i].no[1] / 32767.0f);
+			vertexCos[i][2] += delta * (data->mvert[i].no[2] / 32767.0f);
+			break;
+		case MOD_DISP_DIR_CLNOR:
+			madd_v3_v3fl(vertexCos[i], data->vert_clnors[i], delta);
+			break;
+	}
+}
+
 static void displaceModifier_do(
         DisplaceModifierData *dmd, Object *ob,
         DerivedMesh *dm, float (*vertexCos)[3], int numVerts)
 {
-	int i;
 	MVert *mvert;
 	MDeformVert *dvert;
 	int direction = dmd->direction;
 	int defgrp_index;
-	float (*tex_co)[3];
-	float weight = 1.0f; /* init value unused but some compilers may complain */
-	const float delta_fixed = 1.0f - dmd->midlevel;  /* when no texture is used, we fallback to white */
+	TexResult *texres = NULL;
 	float (*vert_clnors)[3] = NULL;
+	DisplaceUserdata data;
 
 	if (!dmd->texture && dmd->direction == MOD_DISP_DIR_RGB_XYZ) return;
 	if (dmd->strength == 0.0f) return;
@@ -213,14 +274,19 @@ static void displaceModifier_do(
 	modifier_get_vgroup(ob, dm, dmd->defgrp_name, &dvert, &defgrp_index);
 
 	if (dmd->texture) {
+		float (*tex_co)[3];
+
 		tex_co = MEM_callocN(sizeof(*tex_co) * numVerts,
 		                     "displaceModifier_do tex_co");
 		get_texture_coords((MappingInfoModifierData *)dmd, ob, dm, vertexCos, tex_co, numVerts);
 
 		modifier_init_texture(dmd->modifier.scene, dmd->texture);
-	}
-	else {
-		tex_co = NULL;
+
+		/* sample all vertices up-front, so the texture is evaluated from many threads at once */
+		texres = MEM_mallocN(sizeof(*texres) * (size_t)numVerts, "displaceModifier_do texres");
+		get_texture_values(dmd->modifier.scene, dmd->texture, tex_co, dvert, defgrp_index, numVerts, texres);
+
+		MEM_freeN(tex_co);
 	}
 
 	if (direction == MOD_DISP_DIR_CLNOR) {
@@ -242,58 +308,20 @@ static void displaceModifier_do(
 		}
 	}
 
-	for (i = 0; i < numVerts; i++) {
-		TexResult texres;
-		float strength = dmd->strength;
-		float delta;
-
-		if (dvert) {
-			weight = defvert_find_weight(dvert + i, defgrp_index);
-			if (weight == 0.0f) continue;
-		}
-
-		if (dmd->texture) {
-			texres.nor = NULL;
-			BKE_texture_get_value(dmd->modifier.scene, dmd->texture, tex_co[i], &texres, false);
-			delta = texres.tin - dmd->midlevel;
-		}
-		else {
-			delta = delta_fixed;  /* (1.0f - dmd->midlevel) */  /* never changes */
-		}
+	data.dmd = dmd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.direction = direction;
+	data.delta_fixed = 1.0f - dmd->midlevel;  /* when no texture is used, we fallback to white */
+	data.texres = texres;
+	data.vertexCos = vertexCos;
+	data.mvert = mvert;
+	data.vert_clnors = vert_clnors;
 
-		if (dvert) strength *= weight;
-
-		delta *= strength;
-		CLAMP(delta, -10000, 10000);
-
-		switch (direction) {
-			case MOD_DISP_DIR_X:
-				vertexCos[i][0] += delta;
-				break;
-			case MOD_DISP_DIR_Y:
-				vertexCos[i][1] += delta;
-				break;
-			case MOD_DISP_DIR_Z:
-				vertexCos[i][2] += delta;
-				break;
-			case MOD_DISP_DIR_RGB_XYZ:
-				vertexCos[i][0] += (texres.tr - dmd->midlevel) * strength;
-				vertexCos[i][1] += (texres.tg - dmd->midlevel) * strength;
-				vertexCos[i][2] += (texres.tb - dmd->midlevel) * strength;
-				break;
-			case MOD_DISP_DIR_NOR:
-				vertexCos[i][0] += delta * (mvert[i].no[0] / 32767.0f);
-				vertexCos[i][1] += delta * (mvert[i].no[1] / 32767.0f);
-				vertexCos[i][2] += delta * (mvert[i].no[2] / 32767.0f);
-				break;
-			case MOD_DISP_DIR_CLNOR:
-				madd_v3_v3fl(vertexCos[i], vert_clnors[i], delta);
-				break;
-		}
-	}
+	modifier_parallel_verts(numVerts, &data, displaceModifier_do_task, true);
 
-	if (tex_co) {
-		MEM_freeN(tex_co);
+	if (texres) {
+		MEM_freeN(texres);
 	}
 
 	if (vert_clnors) {
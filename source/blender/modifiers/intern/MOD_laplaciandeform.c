@@ -315,75 +315,81 @@ static void computeImplictRotations(LaplacianSystem *sys)
 	}
 }
 
-static void rotateDifferentialCoordinates(LaplacianSystem *sys)
+/* Vertices only read the previous solution and write their own right hand side row,
+ * so the rotation runs in parallel (the caller holds the OpenNL context). */
+static void rotateDifferentialCoordinates_task(void *userdata, int i)
 {
+	LaplacianSystem *sys = userdata;
 	float alpha, beta, gamma;
 	float pj[3], ni[3], di[3];
 	float uij[3], dun[3], e2[3], pi[3], fni[3], vn[3][3];
-	int i, j, num_fni, k, fi;
+	int j, num_fni, k, fi;
 	int *fidn;
 
-	for (i = 0; i < sys->total_verts; i++) {
-		copy_v3_v3(pi, sys->co[i]);
-		copy_v3_v3(ni, sys->no[i]);
-		k = sys->unit_verts[i];
-		copy_v3_v3(pj, sys->co[k]);
-		sub_v3_v3v3(uij, pj, pi);
-		mul_v3_v3fl(dun, ni, dot_v3v3(uij, ni));
-		sub_v3_v3(uij, dun);
-		normalize_v3(uij);
-		cross_v3_v3v3(e2, ni, uij);
-		copy_v3_v3(di, sys->delta[i]);
-		alpha = dot_v3v3(ni, di);
-		beta = dot_v3v3(uij, di);
-		gamma = dot_v3v3(e2, di);
-
-		pi[0] = nlGetVariable(0, i);
-		pi[1] = nlGetVariable(1, i);
-		pi[2] = nlGetVariable(2, i);
-		zero_v3(ni);
-		num_fni = 0;
-		num_fni = sys->ringf_map[i].count;
-		for (fi = 0; fi < num_fni; fi++) {
-			const unsigned int *vin;
-			fidn = sys->ringf_map[i].indices;
-			vin = sys->tris[fidn[fi]];
-			for (j = 0; j < 3; j++) {
-				vn[j][0] = nlGetVariable(0, vin[j]);
-				vn[j][1] = nlGetVariable(1, vin[j]);
-				vn[j][2] = nlGetVariable(2, vin[j]);
-				if (vin[j] == sys->unit_verts[i]) {
-					copy_v3_v3(pj, vn[j]);
-				}
+	copy_v3_v3(pi, sys->co[i]);
+	copy_v3_v3(ni, sys->no[i]);
+	k = sys->unit_verts[i];
+	copy_v3_v3(pj, sys->co[k]);
+	sub_v3_v3v3(uij, pj, pi);
+	mul_v3_v3fl(dun, ni, dot_v3v3(uij, ni));
+	sub_v3_v3(uij, dun);
+	normalize_v3(uij);
+	cross_v3_v3v3(e2, ni, uij);
+	copy_v3_v3(di, sys->delta[i]);
+	alpha = dot_v3v3(ni, di);
+	beta = dot_v3v3(uij, di);
+	gamma = dot_v3v3(e2, di);
+
+	pi[0] = nlGetVariable(0, i);
+	pi[1] = nlGetVariable(1, i);
+	pi[2] = nlGetVariable(2, i);
+	zero_v3(ni);
+	num_fni = 0;
+	num_fni = sys->ringf_map[i].count;
+	for (fi = 0; fi < num_fni; fi++) {
+		const unsigned int *vin;
+		fidn = sys->ringf_map[i].indices;
+		vin = sys->tris[fidn[fi]];
+		for (j = 0; j < 3; j++) {
+			vn[j][0] = nlGetVariable(0, vin[j]);
+			vn[j][1] = nlGetVariable(1, vin[j]);
+			vn[j][2] = nlGetVariable(2, vin[j]);
+			if (vin[j] == sys->unit_verts[i]) {
+				copy_v3_v3(pj, vn[j]);
 			}
-
-			normal_tri_v3(fni, UNPACK3(vn));
-			add_v3_v3(ni, fni);
 		}
 
-		normalize_v3(ni);
-		sub_v3_v3v3(uij, pj, pi);
-		mul_v3_v3fl(dun, ni, dot_v3v3(uij, ni));
-		sub_v3_v3(uij, dun);
-		normalize_v3(uij);
-		cross_v3_v3v3(e2, ni, uij);
-		fni[0] = alpha * ni[0] + beta * uij[0] + gamma * e2[0];
-		fni[1] = alpha * ni[1] + beta * uij[1] + gamma * e2[1];
-		fni[2] = alpha * ni[2] + beta * uij[2] + gamma * e2[2];
-
-		if (len_squared_v3(fni) > FLT_EPSILON) {
-			nlRightHandSideSet(0, i, fni[0]);
-			nlRightHandSideSet(1, i, fni[1]);
-			nlRightHandSideSet(2, i, fni[2]);
-		}
-		else {
-			nlRightHandSideSet(0, i, sys->delta[i][0]);
-			nlRightHandSideSet(1, i, sys->delta[i][1]);
-			nlRightHandSideSet(2, i, sys->delta[i][2]);
-		}
+		normal_tri_v3(fni, UNPACK3(vn));
+		add_v3_v3(ni, fni);
+	}
+
+	normalize_v3(ni);
+	sub_v3_v3v3(uij, pj, pi);
+	mul_v3_v3fl(dun, ni, dot_v3v3(uij, ni));
+	sub_v3_v3(uij, dun);
+	normalize_v3(uij);
+	cross_v3_v3v3(e2, ni, uij);
+	fni[0] = alpha * ni[0] + beta * uij[0] + gamma * e2[0];
+	fni[1] = alpha * ni[1] + beta * uij[1] + gamma * e2[1];
+	fni[2] = alpha * ni[2] + beta * uij[2] + gamma * e2[2];
+
+	if (len_squared_v3(fni) > FLT_EPSILON) {
+		nlRightHandSideSet(0, i, fni[0]);
+		nlRightHandSideSet(1, i, fni[1]);
+		nlRightHandSideSet(2, i, fni[2]);
+	}
+	else {
+		nlRightHandSideSet(0, i, sys->delta[i][0]);
+		nlRightHandSideSet(1, i, sys->delta[i][1]);
+		nlRightHandSideSet(2, i, sys->delta[i][2]);
 	}
 }
 
+static void rotateDifferentialCoordinates(LaplacianSystem *sys)
+{
+	modifier_parallel_verts(sys->total_verts, sys, rotateDifferentialCoordinates_task, true);
+}
+
 static void laplacianDeformPreview(LaplacianSystem *sys, float (*vertexCos)[3])
 {
 	int vid, i, j, n, na;
@@ -635,6 +641,10 @@ static int isSystemDifferent(LaplacianDeformModifierData *lmd, Object *ob, Deriv
 		wpaint = defvert_find_weight(dv, defgrp_index);
 		dv++;
 		if (wpaint > 0.0f) {
+			/* the cached factorization is only valid for the same anchor vertices */
+			if (total_anchors == sys->total_anchors || sys->index_anchors[total_anchors] != i) {
+				return LAPDEFORM_SYSTEM_ONLY_CHANGE_ANCHORS;
+			}
 			total_anchors++;
 		}
 	}
@@ -141,11 +141,54 @@ static void simpleDeform_bend(const float factor, const float dcut[3], float r_c
 
 
 /* simple deform modifier */
-static void SimpleDeformModifier_do(SimpleDeformModifierData *smd, struct Object *ob, struct DerivedMesh *dm,
-                                    float (*vertexCos)[3], int numVerts)
+typedef struct SimpleDeformUserdata {
+	SimpleDeformModifierData *smd;
+	MDeformVert *dvert;
+	int vgroup;
+	int limit_axis;
+	float smd_limit[2], smd_factor;
+	const SpaceTransform *transf;
+	void (*simpleDeform_callback)(const float factor, const float dcut[3], float co[3]);
+	float (*vertexCos)[3];
+} SimpleDeformUserdata;
+
+static void SimpleDeformModifier_do_task(void *userdata, int i)
 {
 	static const float lock_axis[2] = {0.0f, 0.0f};
 
+	SimpleDeformUserdata *data = userdata;
+	SimpleDeformModifierData *smd = data->smd;
+	float *vco = data->vertexCos[i];
+	float weight = defvert_array_find_weight_safe(data->dvert, i, data->vgroup);
+
+	if (weight != 0.0f) {
+		float co[3], dcut[3] = {0.0f, 0.0f, 0.0f};
+
+		if (data->transf) {
+			BLI_space_transform_apply(data->transf, vco);
+		}
+
+		copy_v3_v3(co, vco);
+
+		/* Apply axis limits */
+		if (smd->mode != MOD_SIMPLEDEFORM_MODE_BEND) { /* Bend mode shoulnt have any lock axis */
+			if (smd->axis & MOD_SIMPLEDEFORM_LOCK_AXIS_X) axis_limit(0, lock_axis, co, dcut);
+			if (smd->axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Y) axis_limit(1, lock_axis, co, dcut);
+		}
+		axis_limit(data->limit_axis, data->smd_limit, co, dcut);
+
+		data->simpleDeform_callback(data->smd_factor, dcut, co);  /* apply deform */
+		interp_v3_v3v3(vco, vco, co, weight);  /* Use vertex weight has coef of linear interpolation */
+
+		if (data->transf) {
+			BLI_space_transform_invert(data->transf, vco);
+		}
+	}
+}
+
+static void SimpleDeformModifier_do(SimpleDeformModifierData *smd, struct Object *ob, struct DerivedMesh *dm,
+                                    float (*vertexCos)[3], int numVerts)
+{
 	int i;
 	int limit_axis = 0;
 	float smd_limit[2], smd_factor;
@@ -153,6 +196,7 @@ static void SimpleDeformModifier_do(SimpleDeformModifierData *smd, struct Object
 	void (*simpleDeform_callback)(const float factor, const float dcut[3], float co[3]) = NULL;  /* Mode callback */
 	int vgroup;
 	MDeformVert *dvert;
+	SimpleDeformUserdata data;
 
 	/* Safe-check */
 	if (smd->origin == ob) smd->origin = NULL;  /* No self references */
@@ -214,33 +258,17 @@ static void SimpleDeformModifier_do(SimpleDeformModifierData *smd, struct Object
 
 	modifier_get_vgroup(ob, dm, smd->vgroup_name, &dvert, &vgroup);
 
-	for (i = 0; i < numVerts; i++) {
-		float weight = defvert_array_find_weight_safe(dvert, i, vgroup);
-
-		if (weight != 0.0f) {
-			float co[3], dcut[3] = {0.0f, 0.0f, 0.0f};
-
-			if (transf) {
-				BLI_space_transform_apply(transf, vertexCos[i]);
-			}
-
-			copy_v3_v3(co, vertexCos[i]);
-
-			/* Apply axis limits */
-			if (smd->mode != MOD_SIMPLEDEFORM_MODE_BEND) { /* Bend mode shoulnt have any lock axis */
-				if (smd->axis & MOD_SIMPLEDEFORM_LOCK_AXIS_X) axis_limit(0, lock_axis, co, dcut);
-				if (smd->axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Y) axis_limit(1, lock_axis, co, dcut);
-			}
-			axis_limit(limit_axis, smd_limit, co, dcut);
-
-			simpleDeform_callback(smd_factor, dcut, co);  /* apply deform */
-			interp_v3_v3v3(vertexCos[i], vertexCos[i], co, weight);  /* Use vertex weight has coef of linear interpolation */
-
-			if (transf) {
-				BLI_space_transform_invert(transf, vertexCos[i]);
-			}
-		}
-	}
+	data.smd = smd;
+	data.dvert = dvert;
+	data.vgroup = vgroup;
+	data.limit_axis = limit_axis;
+	copy_v2_v2(data.smd_limit, smd_limit);
+	data.smd_factor = smd_factor;
+	data.transf = transf;
+	data.simpleDeform_callback = simpleDeform_callback;
+	data.vertexCos = vertexCos;
+
+	modifier_parallel_verts(numVerts, &data, SimpleDeformModifier_do_task, true);
 }
 
 
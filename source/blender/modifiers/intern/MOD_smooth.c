@@ -43,6 +43,7 @@
 #include "BKE_cdderivedmesh.h"
 #include "BKE_particle.h"
 #include "BKE_deform.h"
+#include "BKE_mesh_mapping.h"
 
 #include "MOD_modifiertypes.h"
 #include "MOD_util.h"
@@ -91,19 +92,82 @@ static CustomDataMask requiredDataMask(Object *UNUSED(ob), ModifierData *md)
 	return dataMask;
 }
 
+typedef struct SmoothUserdata {
+	SmoothModifierData *smd;
+	MDeformVert *dvert;
+	int defgrp_index;
+	float (*vertexCos)[3];
+	const MEdge *medges;
+	const MeshElemMap *vert_edges;
+	float (*ftmp)[3];
+	unsigned char *uctmp;
+} SmoothUserdata;
+
+/* Sum the edge mid-points around each vertex, gathering instead of scattering
+ * so vertices can be handled from different threads. */
+static void smoothModifier_accum_task(void *userdata, int i)
+{
+	SmoothUserdata *data = userdata;
+	const MeshElemMap *map = &data->vert_edges[i];
+	float *fp = data->ftmp[i];
+	int j;
+
+	zero_v3(fp);
+
+	for (j = 0; j < data->uctmp[i]; j++) {
+		const MEdge *me = &data->medges[map->indices[j]];
+		float fvec[3];
+
+		mid_v3_v3v3(fvec, data->vertexCos[me->v1], data->vertexCos[me->v2]);
+		add_v3_v3(fp, fvec);
+	}
+}
+
+static void smoothModifier_apply_task(void *userdata, int i)
+{
+	SmoothUserdata *data = userdata;
+	const short flag = data->smd->flag;
+	float f, fm, facw, *fp, *v;
+
+	v = data->vertexCos[i];
+	fp = data->ftmp[i];
+
+	f = data->smd->fac;
+	if (data->dvert) {
+		const float weight = defvert_find_weight(&data->dvert[i], data->defgrp_index);
+		if (weight <= 0.0f) return;
+		f *= weight;
+	}
+	fm = 1.0f - f;
+
+	/* fp is the sum of uctmp[i] verts, so must be averaged */
+	facw = 0.0f;
+	if (data->uctmp[i])
+		facw = f / (float)data->uctmp[i];
+
+	if (flag & MOD_SMOOTH_X)
+		v[0] = fm * v[0] + facw * fp[0];
+	if (flag & MOD_SMOOTH_Y)
+		v[1] = fm * v[1] + facw * fp[1];
+	if (flag & MOD_SMOOTH_Z)
+		v[2] = fm * v[2] + facw * fp[2];
+}
+
 static void smoothModifier_do(
         SmoothModifierData *smd, Object *ob, DerivedMesh *dm,
         float (*vertexCos)[3], int numVerts)
 {
 	MDeformVert *dvert = NULL;
 	MEdge *medges = NULL;
+	MeshElemMap *vert_edges = NULL;
+	int *vert_edges_mem = NULL;
+	SmoothUserdata data;
 
 	int i, j, numDMEdges, defgrp_index;
 	unsigned char *uctmp;
-	float *ftmp, fac, facm;
+	float (*ftmp)[3];
 
-	ftmp = (float *)MEM_callocN(3 * sizeof(float) * numVerts,
-	                            "smoothmodifier_f");
+	ftmp = MEM_mallocN(sizeof(*ftmp) * numVerts, "smoothmodifier_f");
 	if (!ftmp) return;
 	uctmp = (unsigned char *)MEM_callocN(sizeof(unsigned char) * numVerts,
 	                                     "smoothmodifier_uc");
@@ -112,9 +176,6 @@ static void smoothModifier_do(
 		return;
 	}
 
-	fac = smd->fac;
-	facm = 1 - fac;
-
 	if (dm->getNumVerts(dm) == numVerts) {
 		medges = dm->getEdgeArray(dm);
 		numDMEdges = dm->getNumEdges(dm);
@@ -124,91 +185,40 @@ static void smoothModifier_do(
 		numDMEdges = 0;
 	}
 
-	modifier_get_vgroup(ob, dm, smd->defgrp_name, &dvert, &defgrp_index);
+	if (medges) {
+		BKE_mesh_vert_edge_map_create(&vert_edges, &vert_edges_mem, medges, numVerts, numDMEdges);
 
-	/* NOTICE: this can be optimized a little bit by moving the
-	 * if (dvert) out of the loop, if needed */
-	for (j = 0; j < smd->repeat; j++) {
-		for (i = 0; i < numDMEdges; i++) {
-			float fvec[3];
-			float *v1, *v2;
-			unsigned int idx1, idx2;
-
-			idx1 = medges[i].v1;
-			idx2 = medges[i].v2;
-
-			v1 = vertexCos[idx1];
-			v2 = vertexCos[idx2];
-
-			mid_v3_v3v3(fvec, v1, v2);
-
-			v1 = &ftmp[idx1 * 3];
-			v2 = &ftmp[idx2 * 3];
-
-			if (uctmp[idx1] < 255) {
-				uctmp[idx1]++;
-				add_v3_v3(v1, fvec);
-			}
-			if (uctmp[idx2] < 255) {
-				uctmp[idx2]++;
-				add_v3_v3(v2, fvec);
-			}
+		/* only the first 255 edges of each vertex contribute */
+		for (i = 0; i < numVerts; i++) {
+			uctmp[i] = (unsigned char)min_ii(vert_edges[i].count, 255);
 		}
+	}
 
-		if (dvert) {
-			MDeformVert *dv = dvert;
-			for (i = 0; i < numVerts; i++, dv++) {
-				float f, fm, facw, *fp, *v;
-				short flag = smd->flag;
-
-				v = vertexCos[i];
-				fp = &ftmp[i * 3];
-
-
-				f = defvert_find_weight(dv, defgrp_index);
-				if (f <= 0.0f) continue;
-
-				f *= fac;
-				fm = 1.0f - f;
+	modifier_get_vgroup(ob, dm, smd->defgrp_name, &dvert, &defgrp_index);
 
-				/* fp is the sum of uctmp[i] verts, so must be averaged */
-				facw = 0.0f;
-				if (uctmp[i]) 
-					facw = f / (float)uctmp[i];
+	data.smd = smd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.medges = medges;
+	data.vert_edges = vert_edges;
+	data.ftmp = ftmp;
+	data.uctmp = uctmp;
 
-				if (flag & MOD_SMOOTH_X)
-					v[0] = fm * v[0] + facw * fp[0];
-				if (flag & MOD_SMOOTH_Y)
-					v[1] = fm * v[1] + facw * fp[1];
-				if (flag & MOD_SMOOTH_Z)
-					v[2] = fm * v[2] + facw * fp[2];
-			}
+	for (j = 0; j < smd->repeat; j++) {
+		if (vert_edges) {
+			modifier_parallel_verts(numVerts, &data, smoothModifier_accum_task, true);
 		}
-		else { /* no vertex group */
-			for (i = 0; i < numVerts; i++) {
-				float facw, *fp, *v;
-				short flag = smd->flag;
-
-				v = vertexCos[i];
-				fp = &ftmp[i * 3];
-
-				/* fp is the sum of uctmp[i] verts, so must be averaged */
-				facw = 0.0f;
-				if (uctmp[i]) 
-					facw = fac / (float)uctmp[i];
-
-				if (flag & MOD_SMOOTH_X)
-					v[0] = facm * v[0] + facw * fp[0];
-				if (flag & MOD_SMOOTH_Y)
-					v[1] = facm * v[1] + facw * fp[1];
-				if (flag & MOD_SMOOTH_Z)
-					v[2] = facm * v[2] + facw * fp[2];
-			}
-
+		else {
+			memset(ftmp, 0, sizeof(*ftmp) * numVerts);
 		}
 
-		memset(ftmp, 0, 3 * sizeof(float) * numVerts);
-		memset(uctmp, 0, sizeof(unsigned char) * numVerts);
+		modifier_parallel_verts(numVerts, &data, smoothModifier_apply_task, true);
+	}
+
+	if (vert_edges) {
+		MEM_freeN(vert_edges);
+		MEM_freeN(vert_edges_mem);
 	}
 
 	MEM_freeN(ftmp);
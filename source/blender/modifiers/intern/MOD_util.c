@@ -37,16 +37,19 @@
 #include "DNA_modifier_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_texture_types.h"
 
 #include "BLI_utildefines.h"
 #include "BLI_math_vector.h"
 #include "BLI_math_matrix.h"
+#include "BLI_task.h"
 
 #include "BKE_cdderivedmesh.h"
 #include "BKE_deform.h"
 #include "BKE_image.h"
 #include "BKE_lattice.h"
 #include "BKE_mesh.h"
+#include "BKE_texture.h"
 
 #include "BKE_modifier.h"
 
@@ -55,6 +58,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "RE_shader_ext.h"
+
 #ifdef OPENNL_THREADING_HACK
 #include "BLI_threads.h"
 #endif
@@ -141,6 +146,92 @@ void get_texture_coords(MappingInfoModifierData *dmd, Object *ob,
 	}
 }
 
+/* Meshes with fewer vertices are deformed from the calling thread,
+ * the per-vertex work of simple deformers is too cheap to be worth the overhead. */
+#define MOD_PARALLEL_VERTS_THRESHOLD 1024
+
+/**
+ * Call \a func for each vertex, using threads for dense meshes.
+ * \a func must only write data of the vertex it's called for.
+ *
+ * \param use_threading: Set to false when \a func isn't thread safe.
+ */
+void modifier_parallel_verts(
+        int numVerts, void *userdata,
+        void (*func)(void *userdata, int index),
+        const bool use_threading)
+{
+	if (numVerts == 0) {
+		return;
+	}
+
+	if (use_threading) {
+		BLI_task_parallel_range_ex(0, numVerts, userdata, func, MOD_PARALLEL_VERTS_THRESHOLD, false);
+	}
+	else {
+		int i;
+		for (i = 0; i < numVerts; i++) {
+			func(userdata, i);
+		}
+	}
+}
+
+/* Noise texture shares random state between all callers. */
+bool modifier_texture_is_threadsafe(const Tex *texture)
+{
+	return (texture == NULL) || (texture->type != TEX_NOISE);
+}
+
+typedef struct TextureValuesData {
+	const Scene *scene;
+	Tex *texture;
+	struct ImagePool *pool;
+	float (*tex_co)[3];
+	const MDeformVert *dvert;
+	int defgrp_index;
+	TexResult *texres;
+} TextureValuesData;
+
+static void get_texture_values_task(void *userdata, int i)
+{
+	TextureValuesData *data = userdata;
+	TexResult *texres = &data->texres[i];
+
+	if (data->dvert && defvert_find_weight(&data->dvert[i], data->defgrp_index) == 0.0f) {
+		memset(texres, 0, sizeof(*texres));
+		return;
+	}
+
+	texres->nor = NULL;
+	BKE_texture_get_value_ex(data->scene, data->texture, data->tex_co[i], texres, data->pool, false);
+}
+
+/**
+ * Evaluate \a texture for all vertices at once,
+ * sharing image buffers between threads.
+ *
+ * \param dvert: Optional, vertices outside of the group are skipped and get a zero result.
+ */
+void get_texture_values(
+        const Scene *scene, Tex *texture, float (*tex_co)[3],
+        const MDeformVert *dvert, int defgrp_index,
+        int numVerts, TexResult *r_texres)
+{
+	TextureValuesData data;
+
+	data.scene = scene;
+	data.texture = texture;
+	data.pool = BKE_image_pool_new();
+	data.tex_co = tex_co;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.texres = r_texres;
+
+	modifier_parallel_verts(numVerts, &data, get_texture_values_task, modifier_texture_is_threadsafe(texture));
+
+	BKE_image_pool_free(data.pool);
+}
+
 void modifier_vgroup_cache(ModifierData *md, float (*vertexCos)[3])
 {
 	while ((md = md->next) && md->type == eModifierType_Armature) {
@@ -39,10 +39,18 @@ struct ModifierData;
 struct Object;
 struct Scene;
 struct Tex;
+struct TexResult;
 
 void modifier_init_texture(const struct Scene *scene, struct Tex *texture);
 void get_texture_coords(struct MappingInfoModifierData *dmd, struct Object *ob, struct DerivedMesh *dm,
                         float (*co)[3], float (*texco)[3], int numVerts);
+void get_texture_values(const struct Scene *scene, struct Tex *texture, float (*tex_co)[3],
+                        const struct MDeformVert *dvert, int defgrp_index,
+                        int numVerts, struct TexResult *r_texres);
+bool modifier_texture_is_threadsafe(const struct Tex *texture);
+void modifier_parallel_verts(int numVerts, void *userdata,
+                             void (*func)(void *userdata, int index),
+                             const bool use_threading);
 void modifier_vgroup_cache(struct ModifierData *md, float (*vertexCos)[3]);
 struct DerivedMesh *get_cddm(struct Object *ob, struct BMEditMesh *em, struct DerivedMesh *dm,
                              float (*vertexCos)[3], bool use_normals);
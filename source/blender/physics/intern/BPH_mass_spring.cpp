@@ -41,6 +41,7 @@ extern "C" {
 
 #include "BLI_math.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cloth.h"
@@ -79,17 +80,62 @@ static int cloth_count_nondiag_blocks(Cloth *cloth)
 	return nondiag;
 }
 
+/* Linear and bending springs only write their own matrix block, their forces are added to the
+ * points afterwards. Goal and angular bending springs add to the points directly. */
+BLI_INLINE bool cloth_spring_is_deferred(ClothSpring *s)
+{
+	if ((s->type & CLOTH_SPRING_TYPE_STRUCTURAL) || (s->type & CLOTH_SPRING_TYPE_SHEAR) || (s->type & CLOTH_SPRING_TYPE_SEWING)) {
+		return true;
+	}
+	else if (s->type & CLOTH_SPRING_TYPE_GOAL) {
+		return false;
+	}
+	else if (s->type & CLOTH_SPRING_TYPE_BENDING) {
+		return true;
+	}
+	return false;
+}
+
+/* Reserve the off-diagonal matrix blocks of a spring, returns the first one.
+ * Every spring gets its blocks once, whether it ends up active or not, so the layout
+ * doesn't depend on the order in which forces are computed. */
+static int cloth_add_spring_blocks(Implicit_Data *data, ClothSpring *s)
+{
+	int block = -1;
+	
+	if (cloth_spring_is_deferred(s)) {
+		block = BPH_mass_spring_add_block(data, s->ij, s->kl);
+	}
+	else if (s->type & CLOTH_SPRING_TYPE_GOAL) {
+		/* goal springs only act on the diagonal */
+	}
+	else if (s->type & CLOTH_SPRING_TYPE_BENDING_ANG) {
+		/* angular bending combines 3 vertices */
+		block = BPH_mass_spring_add_block(data, s->ij, s->kl);
+		BPH_mass_spring_add_block(data, s->kl, s->mn);
+		BPH_mass_spring_add_block(data, s->ij, s->mn);
+	}
+	
+	return block;
+}
+
 int BPH_cloth_solver_init(Object *UNUSED(ob), ClothModifierData *clmd)
 {
 	Cloth *cloth = clmd->clothObject;
 	ClothVertex *verts = cloth->verts;
 	const float ZERO[3] = {0.0f, 0.0f, 0.0f};
 	Implicit_Data *id;
+	LinkNode *link;
 	unsigned int i, nondiag;
 	
 	nondiag = cloth_count_nondiag_blocks(cloth);
 	cloth->implicit = id = BPH_mass_spring_solver_create(cloth->mvert_num, nondiag);
 	
+	for (link = cloth->springs; link; link = link->next) {
+		ClothSpring *spring = (ClothSpring *)link->link;
+		spring->block = cloth_add_spring_blocks(id, spring);
+	}
+	
 	for (i = 0; i < cloth->mvert_num; i++) {
 		BPH_mass_spring_set_vertex_mass(id, i, verts[i].mass);
 	}
@@ -352,8 +398,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 	if ((s->type & CLOTH_SPRING_TYPE_STRUCTURAL) || (s->type & CLOTH_SPRING_TYPE_SHEAR) || (s->type & CLOTH_SPRING_TYPE_SEWING) ) {
 #ifdef CLOTH_FORCE_SPRING_STRUCTURAL
 		float k, scaling;
-		
-		s->flags |= CLOTH_SPRING_FLAG_NEEDED;
+		bool active;
 		
 		scaling = parms->structural + s->stiffness * fabsf(parms->max_struct - parms->structural);
 		k = scaling / (parms->avg_spring_len + FLT_EPSILON);
@@ -361,10 +406,14 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 		if (s->type & CLOTH_SPRING_TYPE_SEWING) {
 			// TODO: verify, half verified (couldn't see error)
 			// sewing springs usually have a large distance at first so clamp the force so we don't get tunnelling through colission objects
-			BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, parms->max_sewing, s->f, s->dfdx, s->dfdv);
+			active = BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->block, s->restlen, k, parms->Cdis, no_compress, parms->max_sewing, s->f, s->dfdx, s->dfdv);
 		}
 		else {
-			BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, 0.0f, s->f, s->dfdx, s->dfdv);
+			active = BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->block, s->restlen, k, parms->Cdis, no_compress, 0.0f, s->f, s->dfdx, s->dfdv);
+		}
+		
+		if (active) {
+			s->flags |= CLOTH_SPRING_FLAG_NEEDED;
 		}
 #endif
 	}
@@ -389,15 +438,15 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 #ifdef CLOTH_FORCE_SPRING_BEND
 		float kb, cb, scaling;
 		
-		s->flags |= CLOTH_SPRING_FLAG_NEEDED;
-		
 		scaling = parms->bending + s->stiffness * fabsf(parms->max_bend - parms->bending);
 		kb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
 		
 		scaling = parms->bending_damping;
 		cb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
 		
-		BPH_mass_spring_force_spring_bending(data, s->ij, s->kl, s->restlen, kb, cb, s->f, s->dfdx, s->dfdv);
+		if (BPH_mass_spring_force_spring_bending(data, s->ij, s->kl, s->block, s->restlen, kb, cb, s->f, s->dfdx, s->dfdv)) {
+			s->flags |= CLOTH_SPRING_FLAG_NEEDED;
+		}
 #endif
 	}
 	else if (s->type & CLOTH_SPRING_TYPE_BENDING_ANG) {
@@ -417,7 +466,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 		cb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
 		
 		/* XXX assuming same restlen for ij and jk segments here, this can be done correctly for hair later */
-		BPH_mass_spring_force_spring_bending_angular(data, s->ij, s->kl, s->mn, s->target, kb, cb);
+		BPH_mass_spring_force_spring_bending_angular(data, s->ij, s->kl, s->mn, s->block, s->block + 1, s->block + 2, s->target, kb, cb);
 		
 #if 0
 		{
@@ -455,6 +504,67 @@ static void hair_get_boundbox(ClothModifierData *clmd, float gmin[3], float gmax
 	}
 }
 
+/* spring forces are computed in parallel when there are at least this many springs */
+#define CLOTH_SPRING_PARALLEL_THRESHOLD 1024
+
+typedef struct ClothSpringForceData {
+	ClothModifierData *clmd;
+	ClothSpring **springs;
+	float time;
+} ClothSpringForceData;
+
+static void cloth_calc_spring_force_task(void *userdata, int i)
+{
+	ClothSpringForceData *data = (ClothSpringForceData *)userdata;
+	ClothSpring *s = data->springs[i];
+	
+	if (cloth_spring_is_deferred(s)) {
+		cloth_calc_spring_force(data->clmd, s, data->time);
+	}
+}
+
+static void cloth_calc_spring_forces(ClothModifierData *clmd, float time)
+{
+	Cloth *cloth = clmd->clothObject;
+	Implicit_Data *data = cloth->implicit;
+	ClothSpringForceData task_data;
+	int springs_num = BLI_linklist_count(cloth->springs);
+	ClothSpring **springs = (ClothSpring **)MEM_mallocN(sizeof(ClothSpring *) * springs_num, "cloth springs");
+	int i, active_num = 0;
+	
+	for (LinkNode *link = cloth->springs; link; link = link->next) {
+		ClothSpring *spring = (ClothSpring *)link->link;
+		// only handle active springs
+		if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE)) {
+			springs[active_num++] = spring;
+		}
+	}
+	
+	task_data.clmd = clmd;
+	task_data.springs = springs;
+	task_data.time = time;
+	
+	if (active_num > 0) {
+		BLI_task_parallel_range_ex(0, active_num, &task_data, cloth_calc_spring_force_task,
+		                           CLOTH_SPRING_PARALLEL_THRESHOLD, false);
+	}
+	
+	/* points are shared by springs, add to them in spring order so the result
+	 * doesn't depend on the number of threads */
+	for (i = 0; i < active_num; i++) {
+		ClothSpring *spring = springs[i];
+		
+		if (!cloth_spring_is_deferred(spring)) {
+			cloth_calc_spring_force(clmd, spring, time);
+		}
+		else if (spring->flags & CLOTH_SPRING_FLAG_NEEDED) {
+			BPH_mass_spring_apply_spring(data, spring->ij, spring->kl, spring->f, spring->dfdx, spring->dfdv);
+		}
+	}
+	
+	MEM_freeN(springs);
+}
+
 static void cloth_calc_force(ClothModifierData *clmd, float UNUSED(frame), ListBase *effectors, float time)
 {
 	/* Collect forces and derivatives:  F, dFdX, dFdV */
@@ -539,13 +649,7 @@ static void cloth_calc_force(ClothModifierData *clmd, float UNUSED(frame), ListB
 		MEM_freeN(winvec);
 	}
 	
-	// calculate spring forces
-	for (LinkNode *link = cloth->springs; link; link = link->next) {
-		ClothSpring *spring = (ClothSpring *)link->link;
-		// only handle active springs
-		if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE))
-			cloth_calc_spring_force(clmd, spring, time);
-	}
+	cloth_calc_spring_forces(clmd, time);
 }
 
 /* returns vertexes' motion state */
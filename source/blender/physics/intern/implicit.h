@@ -112,16 +112,23 @@ void BPH_mass_spring_force_face_wind(struct Implicit_Data *data, int v1, int v2,
 void BPH_mass_spring_force_edge_wind(struct Implicit_Data *data, int v1, int v2, float radius1, float radius2, const float (*winvec)[3]);
 /* Wind force, acting on a vertex */
 void BPH_mass_spring_force_vertex_wind(struct Implicit_Data *data, int v, float radius, const float (*winvec)[3]);
+/* Off-diagonal matrix block for the interaction of two points, added once per spring when setting up the solver */
+int BPH_mass_spring_add_block(struct Implicit_Data *data, int v1, int v2);
+/* Adds a spring force and its jacobians to both points.
+ * Linear and bending spring functions only write the spring block, so they can run in parallel,
+ * their results have to be applied to the points with this afterwards. */
+void BPH_mass_spring_apply_spring(struct Implicit_Data *data, int i, int j, const float f[3], float dfdx[3][3], float dfdv[3][3]);
 /* Linear spring force between two points */
-bool BPH_mass_spring_force_spring_linear(struct Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_linear(struct Implicit_Data *data, int i, int j, int block_ij, float restlen,
                                          float stiffness, float damping, bool no_compress, float clamp_force,
                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
 /* Bending force, forming a triangle at the base of two structural springs */
-bool BPH_mass_spring_force_spring_bending(struct Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_bending(struct Implicit_Data *data, int i, int j, int block_ij, float restlen,
                                           float kb, float cb,
                                           float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
 /* Angular bending force based on local target vectors */
 bool BPH_mass_spring_force_spring_bending_angular(struct Implicit_Data *data, int i, int j, int k,
+                                                  int block_ij, int block_jk, int block_ik,
                                                   const float target[3], float stiffness, float damping);
 /* Global goal spring */
 bool BPH_mass_spring_force_spring_goal(struct Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
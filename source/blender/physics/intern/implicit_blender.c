@@ -269,6 +269,7 @@ DO_INLINE void add_lfvector_lfvectorS(float (*to)[3], float (*fLongVectorA)[3],
 {
 	unsigned int i = 0;
 
+#pragma omp parallel for private(i) schedule(static) if (verts > CLOTH_OPENMP_LIMIT)
 	for (i = 0; i < verts; i++) {
 		VECADDS(to[i], fLongVectorA[i], fLongVectorB[i], bS);
 
@@ -669,12 +670,120 @@ DO_INLINE void subadd_bfmatrixS_bfmatrixS( fmatrix3x3 *to, fmatrix3x3 *from, flo
 	unsigned int i = 0;
 
 	/* process diagonal elements */
+#pragma omp parallel for private(i) schedule(static) if (matrix[0].vcount > CLOTH_OPENMP_LIMIT)
 	for (i = 0; i < matrix[0].vcount+matrix[0].scount; i++) {
 		subadd_fmatrixS_fmatrixS(to[i].m, from[i].m, aS, matrix[i].m, bS);
 	}
 
 }
 
+///////////////////////////
+// Row index for the SPARSE SYMMETRIC big matrix
+///////////////////////////
+
+/* The big matrix stores every off-diagonal block once, so a product written per block
+ * scatters into two rows. The row index lists for every row the blocks stored in it
+ * (r == row, diagonal block first) and the off-diagonal blocks mirrored into it (c == row),
+ * so rows can be computed independently and in parallel. Both lists keep the array order,
+ * which sums the blocks in the same order as mul_bfmatrix_lfvector. */
+typedef struct bfmatrix_rows {
+	unsigned int *row_start;	/* vcount + 1 offsets into row_blocks */
+	unsigned int *row_blocks;	/* blocks with r == row */
+	unsigned int *col_start;	/* vcount + 1 offsets into col_blocks */
+	unsigned int *col_blocks;	/* off-diagonal blocks with c == row */
+} bfmatrix_rows;
+
+static bfmatrix_rows *create_bfmatrix_rows(unsigned int verts, unsigned int springs)
+{
+	bfmatrix_rows *rows = (bfmatrix_rows *)MEM_callocN(sizeof(bfmatrix_rows), "cloth_implicit_matrix_rows");
+	
+	rows->row_start = (unsigned int *)MEM_callocN(sizeof(unsigned int) * (verts + 1), "cloth_implicit_row_start");
+	rows->row_blocks = (unsigned int *)MEM_mallocN(sizeof(unsigned int) * (verts + springs), "cloth_implicit_row_blocks");
+	rows->col_start = (unsigned int *)MEM_callocN(sizeof(unsigned int) * (verts + 1), "cloth_implicit_col_start");
+	/* allocate at least one element, springs can be zero */
+	rows->col_blocks = (unsigned int *)MEM_mallocN(sizeof(unsigned int) * (springs + 1), "cloth_implicit_col_blocks");
+	
+	return rows;
+}
+
+static void del_bfmatrix_rows(bfmatrix_rows *rows)
+{
+	if (rows != NULL) {
+		MEM_freeN(rows->row_start);
+		MEM_freeN(rows->row_blocks);
+		MEM_freeN(rows->col_start);
+		MEM_freeN(rows->col_blocks);
+		MEM_freeN(rows);
+	}
+}
+
+/* counting sort of the first totblock blocks of matrix by row and by column,
+ * off-diagonal blocks not flagged in use_block (indexed from vcount) are zero and left out */
+static void init_bfmatrix_rows(bfmatrix_rows *rows, fmatrix3x3 *matrix, unsigned int totblock, const char *use_block)
+{
+	unsigned int vcount = matrix[0].vcount;
+	unsigned int i;
+	
+	memset(rows->row_start, 0, sizeof(unsigned int) * (vcount + 1));
+	memset(rows->col_start, 0, sizeof(unsigned int) * (vcount + 1));
+	
+	for (i = 0; i < totblock; i++) {
+		if (i >= vcount && !use_block[i - vcount]) {
+			continue;
+		}
+		rows->row_start[matrix[i].r + 1]++;
+		if (i >= vcount) {
+			rows->col_start[matrix[i].c + 1]++;
+		}
+	}
+	for (i = 0; i < vcount; i++) {
+		rows->row_start[i + 1] += rows->row_start[i];
+		rows->col_start[i + 1] += rows->col_start[i];
+	}
+	
+	/* fill using the start offsets as cursors, this moves every start to the next row */
+	for (i = 0; i < totblock; i++) {
+		if (i >= vcount && !use_block[i - vcount]) {
+			continue;
+		}
+		rows->row_blocks[rows->row_start[matrix[i].r]++] = i;
+		if (i >= vcount) {
+			rows->col_blocks[rows->col_start[matrix[i].c]++] = i;
+		}
+	}
+	for (i = vcount; i > 0; i--) {
+		rows->row_start[i] = rows->row_start[i - 1];
+		rows->col_start[i] = rows->col_start[i - 1];
+	}
+	rows->row_start[0] = 0;
+	rows->col_start[0] = 0;
+}
+
+/* SPARSE SYMMETRIC multiply big matrix with long vector, row by row using the row index */
+/* same result as mul_bfmatrix_lfvector */
+DO_INLINE void mul_bfmatrix_rows_lfvector(float (*to)[3], fmatrix3x3 *from, bfmatrix_rows *rows, lfVector *fLongVector)
+{
+	unsigned int vcount = from[0].vcount;
+	unsigned int i;
+	
+#pragma omp parallel for private(i) schedule(static) if (vcount > CLOTH_OPENMP_LIMIT)
+	for (i = 0; i < vcount; i++) {
+		float lower[3] = {0.0f, 0.0f, 0.0f}, upper[3] = {0.0f, 0.0f, 0.0f};
+		unsigned int b;
+		
+		for (b = rows->col_start[i]; b < rows->col_start[i + 1]; b++) {
+			fmatrix3x3 *block = &from[rows->col_blocks[b]];
+			muladd_fmatrix_fvector(lower, block->m, fLongVector[block->r]);
+		}
+		for (b = rows->row_start[i]; b < rows->row_start[i + 1]; b++) {
+			fmatrix3x3 *block = &from[rows->row_blocks[b]];
+			muladd_fmatrix_fvector(upper, block->m, fLongVector[block->c]);
+		}
+		
+		VECADD(to[i], lower, upper);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////
 // simulator start
 ///////////////////////////////////////////////////////////////////
@@ -686,7 +795,8 @@ typedef struct Implicit_Data  {
 	fmatrix3x3 *M;				/* masses */
 	lfVector *F;				/* forces */
 	fmatrix3x3 *dFdV, *dFdX;	/* force jacobians */
-	int num_blocks;				/* number of off-diagonal blocks (springs) */
+	int num_blocks;				/* number of off-diagonal blocks (springs), added once when the solver is set up */
+	char *block_active;			/* off-diagonal blocks written this step, others stay zero */
 	
 	/* motion state data */
 	lfVector *X, *Xnew;			/* positions */
@@ -700,6 +810,7 @@ typedef struct Implicit_Data  {
 	lfVector *z;				/* target velocity in constrained directions */
 	fmatrix3x3 *S;				/* filtering matrix for constraints */
 	fmatrix3x3 *P, *Pinv;		/* pre-conditioning matrix */
+	bfmatrix_rows *rows;		/* row index of the force jacobians and A */
 } Implicit_Data;
 
 Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
@@ -724,6 +835,9 @@ Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
 	id->B = create_lfvector(numverts);
 	id->dV = create_lfvector(numverts);
 	id->z = create_lfvector(numverts);
+	id->rows = create_bfmatrix_rows(numverts, numsprings);
+	/* allocate at least one element, springs can be zero */
+	id->block_active = (char *)MEM_callocN(sizeof(char) * (numsprings + 1), "cloth_implicit_block_active");
 
 	initdiag_bfmatrix(id->bigI, I);
 
@@ -751,6 +865,9 @@ void BPH_mass_spring_solver_free(Implicit_Data *id)
 	del_lfvector(id->dV);
 	del_lfvector(id->z);
 	
+	del_bfmatrix_rows(id->rows);
+	MEM_freeN(id->block_active);
+	
 	MEM_freeN(id);
 }
 
@@ -786,6 +903,7 @@ DO_INLINE void filter(lfVector *V, fmatrix3x3 *S)
 {
 	unsigned int i=0;
 
+#pragma omp parallel for private(i) schedule(static) if (S[0].vcount > CLOTH_OPENMP_LIMIT)
 	for (i = 0; i < S[0].vcount; i++) {
 		mul_m3_v3(S[i].m, V[S[i].r]);
 	}
@@ -858,7 +976,8 @@ static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z
 }
 #endif
 
-static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z, fmatrix3x3 *S, ImplicitSolverResult *result)
+static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z, fmatrix3x3 *S, bfmatrix_rows *rows,
+                       ImplicitSolverResult *result)
 {
 	// Solves for unknown X in equation AX=B
 	unsigned int conjgrad_loopcount=0, conjgrad_looplimit=100;
@@ -882,7 +1001,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 	delta_target = conjgrad_epsilon*conjgrad_epsilon * bnorm2;
 	
 	/* r = filter(B - A * dV) */
-	mul_bfmatrix_lfvector(AdV, lA, ldV);
+	mul_bfmatrix_rows_lfvector(AdV, lA, rows, ldV);
 	sub_lfvector_lfvector(r, lB, AdV, numverts);
 	filter(r, S);
 	
@@ -905,7 +1024,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 #endif
 	
 	while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
-		mul_bfmatrix_lfvector(q, lA, c);
+		mul_bfmatrix_rows_lfvector(q, lA, rows, c);
 		filter(q, S);
 		
 		alpha = delta_new / dot_lfvector(c, q, numverts);
@@ -1145,13 +1264,16 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 
 	subadd_bfmatrixS_bfmatrixS(data->A, data->dFdV, dt, data->dFdX, (dt*dt));
 
-	mul_bfmatrix_lfvector(dFdXmV, data->dFdX, data->V);
+	/* A and the force jacobians share the block layout of the springs, blocks not written this step are left out */
+	init_bfmatrix_rows(data->rows, data->A, numverts + data->num_blocks, data->block_active);
+
+	mul_bfmatrix_rows_lfvector(dFdXmV, data->dFdX, data->rows, data->V);
 
 	add_lfvectorS_lfvectorS(data->B, data->F, dt, dFdXmV, (dt*dt), numverts);
 
 	// itstart();
 
-	cg_filtered(data->dV, data->A, data->B, data->z, data->S, result); /* conjugate gradient algorithm to solve Ax=b */
+	cg_filtered(data->dV, data->A, data->B, data->z, data->S, data->rows, result); /* conjugate gradient algorithm to solve Ax=b */
 	// cg_filtered_pre(id->dV, id->A, id->B, id->z, id->S, id->P, id->Pinv, id->bigI);
 
 	// itend();
@@ -1247,10 +1369,11 @@ void BPH_mass_spring_set_new_velocity(struct Implicit_Data *data, int index, con
 
 /* -------------------------------- */
 
-static int BPH_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
+int BPH_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
 {
 	int s = data->M[0].vcount + data->num_blocks; /* index from array start */
 	BLI_assert(s < data->M[0].vcount + data->M[0].scount);
+	data->block_active[data->num_blocks] = false;
 	++data->num_blocks;
 	
 	/* tfm and S don't have spring entries (diagonal blocks only) */
@@ -1323,7 +1446,8 @@ void BPH_mass_spring_clear_forces(Implicit_Data *data)
 	init_bfmatrix(data->dFdX, ZERO);
 	init_bfmatrix(data->dFdV, ZERO);
 	
-	data->num_blocks = 0;
+	/* spring blocks keep their layout, only the ones written again are used */
+	memset(data->block_active, 0, sizeof(char) * data->num_blocks);
 }
 
 void BPH_mass_spring_force_reference_frame(Implicit_Data *data, int index, const float acceleration[3], const float omega[3], const float domega_dt[3], float mass)
@@ -1593,23 +1717,28 @@ BLI_INLINE bool spring_length(Implicit_Data *data, int i, int j, float r_extent[
 	return true;
 }
 
-BLI_INLINE void apply_spring(Implicit_Data *data, int i, int j, const float f[3], float dfdx[3][3], float dfdv[3][3])
+/* the spring block is only written by its own spring, this is safe to call in parallel */
+BLI_INLINE void apply_spring_block(Implicit_Data *data, int block_ij, float dfdx[3][3], float dfdv[3][3])
 {
-	int block_ij = BPH_mass_spring_add_block(data, i, j);
+	data->block_active[block_ij - data->M[0].vcount] = true;
 	
+	sub_m3_m3m3(data->dFdX[block_ij].m, data->dFdX[block_ij].m, dfdx);
+	sub_m3_m3m3(data->dFdV[block_ij].m, data->dFdV[block_ij].m, dfdv);
+}
+
+void BPH_mass_spring_apply_spring(Implicit_Data *data, int i, int j, const float f[3], float dfdx[3][3], float dfdv[3][3])
+{
 	add_v3_v3(data->F[i], f);
 	sub_v3_v3(data->F[j], f);
 	
 	add_m3_m3m3(data->dFdX[i].m, data->dFdX[i].m, dfdx);
 	add_m3_m3m3(data->dFdX[j].m, data->dFdX[j].m, dfdx);
-	sub_m3_m3m3(data->dFdX[block_ij].m, data->dFdX[block_ij].m, dfdx);
 	
 	add_m3_m3m3(data->dFdV[i].m, data->dFdV[i].m, dfdv);
 	add_m3_m3m3(data->dFdV[j].m, data->dFdV[j].m, dfdv);
-	sub_m3_m3m3(data->dFdV[block_ij].m, data->dFdV[block_ij].m, dfdv);
 }
 
-bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, int block_ij, float restlen,
                                          float stiffness, float damping, bool no_compress, float clamp_force,
                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
@@ -1634,7 +1763,7 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 		dfdx_spring(dfdx, dir, length, restlen, stiffness);
 		dfdv_damp(dfdv, dir, damping);
 		
-		apply_spring(data, i, j, f, dfdx, dfdv);
+		apply_spring_block(data, block_ij, dfdx, dfdv);
 		
 		if (r_f) copy_v3_v3(r_f, f);
 		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
@@ -1652,7 +1781,7 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 }
 
 /* See "Stable but Responsive Cloth" (Choi, Ko 2005) */
-bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, int block_ij, float restlen,
                                           float kb, float cb,
                                           float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
@@ -1672,7 +1801,7 @@ bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, flo
 		/* XXX damping not supported */
 		zero_m3(dfdv);
 		
-		apply_spring(data, i, j, f, dfdx, dfdv);
+		apply_spring_block(data, block_ij, dfdx, dfdv);
 		
 		if (r_f) copy_v3_v3(r_f, f);
 		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
@@ -1832,6 +1961,7 @@ BLI_INLINE void spring_angbend_estimate_dfdv(Implicit_Data *data, int i, int j,
  * See "Artistic Simulation of Curly Hair" (Pixar technical memo #12-03a)
  */
 bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, int j, int k,
+                                                  int block_ij, int block_jk, int block_ik,
                                                   const float target[3], float stiffness, float damping)
 {
 	float goal[3];
@@ -1841,10 +1971,6 @@ bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, in
 	
 	const float vecnull[3] = {0.0f, 0.0f, 0.0f};
 	
-	int block_ij = BPH_mass_spring_add_block(data, i, j);
-	int block_jk = BPH_mass_spring_add_block(data, j, k);
-	int block_ik = BPH_mass_spring_add_block(data, i, k);
-	
 	world_to_root_v3(data, j, goal, target);
 	
 	spring_angbend_forces(data, i, j, k, goal, stiffness, damping, k, vecnull, vecnull, fk);
@@ -1870,6 +1996,10 @@ bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, in
 	add_m3_m3m3(data->dFdX[j].m, data->dFdX[j].m, dfj_dxj);
 	add_m3_m3m3(data->dFdX[k].m, data->dFdX[k].m, dfk_dxk);
 	
+	data->block_active[block_ij - data->M[0].vcount] = true;
+	data->block_active[block_jk - data->M[0].vcount] = true;
+	data->block_active[block_ik - data->M[0].vcount] = true;
+	
 	add_m3_m3m3(data->dFdX[block_ij].m, data->dFdX[block_ij].m, dfj_dxi);
 	add_m3_m3m3(data->dFdX[block_jk].m, data->dFdX[block_jk].m, dfk_dxj);
 	add_m3_m3m3(data->dFdX[block_ik].m, data->dFdX[block_ik].m, dfk_dxi);
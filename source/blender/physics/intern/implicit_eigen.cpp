@@ -919,7 +919,13 @@ BLI_INLINE bool spring_length(Implicit_Data *data, int i, int j, float r_extent[
 	return true;
 }
 
-BLI_INLINE void apply_spring(Implicit_Data *data, int i, int j, const float f[3], float dfdx[3][3], float dfdv[3][3])
+/* jacobian blocks are addressed by their vertices here, no need to reserve them */
+int BPH_mass_spring_add_block(Implicit_Data *UNUSED(data), int UNUSED(v1), int UNUSED(v2))
+{
+	return 0;
+}
+
+void BPH_mass_spring_apply_spring(Implicit_Data *data, int i, int j, const float f[3], float dfdx[3][3], float dfdv[3][3])
 {
 	add_v3_v3(data->F.v3(i), f);
 	sub_v3_v3(data->F.v3(j), f);
@@ -935,7 +941,7 @@ BLI_INLINE void apply_spring(Implicit_Data *data, int i, int j, const float f[3]
 	data->idFdV.sub(j, i, dfdv);
 }
 
-bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, int UNUSED(block_ij), float restlen,
                                          float stiffness, float damping, bool no_compress, float clamp_force,
                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
@@ -960,8 +966,6 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 		dfdx_spring(dfdx, dir, length, restlen, stiffness);
 		dfdv_damp(dfdv, dir, damping);
 		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
 		if (r_f) copy_v3_v3(r_f, f);
 		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
 		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
@@ -978,7 +982,7 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 }
 
 /* See "Stable but Responsive Cloth" (Choi, Ko 2005) */
-bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, int UNUSED(block_ij), float restlen,
                                           float kb, float cb,
                                           float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
@@ -998,8 +1002,6 @@ bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, flo
 		/* XXX damping not supported */
 		zero_m3(dfdv);
 		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
 		if (r_f) copy_v3_v3(r_f, f);
 		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
 		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
@@ -1158,6 +1160,7 @@ BLI_INLINE void spring_angbend_estimate_dfdv(Implicit_Data *data, int i, int j,
  * See "Artistic Simulation of Curly Hair" (Pixar technical memo #12-03a)
  */
 bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, int j, int k,
+                                                  int UNUSED(block_ij), int UNUSED(block_jk), int UNUSED(block_ik),
                                                   const float target[3], float stiffness, float damping)
 {
 	float goal[3];
@@ -63,6 +63,7 @@
 #include "BKE_main.h"
 #include "BKE_mball_tessellate.h"
 #include "BKE_node.h"
+#include "BKE_pointcache.h"
 #include "BKE_report.h"
 
 #include "BKE_addon.h"
@@ -453,6 +454,9 @@ void WM_exit_ext(bContext *C, const bool do_python)
 		}
 	}
 
+	/* finish cache frames still being written by background bakes */
+	BKE_ptcache_exit();
+
 	BKE_addon_pref_type_free();
 	wm_operatortype_free();
 	wm_dropbox_free();